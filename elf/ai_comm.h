@@ -2,6 +2,7 @@
 #include "common.h"
 
 #include <random>
+#include <vector>
 
 // Game information
 template <typename _Data>
@@ -21,6 +22,9 @@ struct InfoT {
     InfoT(const InfoT<Data> &parent, int child_id) : meta(parent.meta, child_id) { }
 };
 
+template <typename AIComm>
+class AICommGroupT;
+
 // Communication between main_loop and AI (which is in a separate thread).
 // main_loop will send the environment data to AI, and call AI's Act().
 // In Act(), AI will compute the best move and return it back.
@@ -29,6 +33,7 @@ class AICommT {
 public:
     using Comm = _Comm;
     using AIComm = AICommT<Comm>;
+    using Group = AICommGroupT<AIComm>;
     using Data = typename Comm::Data;
     using Info = typename Comm::Info;
     using DataPrepareReturn = decltype(std::declval<Data>().Prepare(SeqInfo()));
@@ -78,6 +83,19 @@ public:
         // std::cout << "[" << _meta.id << "] Done with SendDataWaitReply, continue" << std::endl;
     }
 
+    // Send the data of several AIComms (e.g., all players of one game) and
+    // wait for all of their replies, with a single round trip. They must share
+    // the same Comm and have distinct query ids. If given, buf is used to
+    // gather the infos, so that repeated calls do not allocate.
+    static bool SendDataWaitReply(const std::vector<AIComm *> &ai_comms, std::vector<Info *> *buf = nullptr) {
+        if (ai_comms.empty()) return true;
+        std::vector<Info *> local;
+        std::vector<Info *> &infos = buf != nullptr ? *buf : local;
+        infos.clear();
+        for (AIComm *ai_comm : ai_comms) infos.push_back(&ai_comm->_info);
+        return ai_comms[0]->_comm->SendBatchDataWaitReply(infos);
+    }
+
     void Restart() {
         _info.data.Restart();
         _curr_seq.NewEpisode();
@@ -89,3 +107,26 @@ public:
         return child;
     }
 };
+
+// Collects the requests of the agents of one game during a tick, so that
+// they are sent together. Agents Add() their AIComm once the data is ready;
+// the first one that needs its reply calls Flush().
+template <typename AIComm>
+class AICommGroupT {
+public:
+    void Add(AIComm *ai_comm) { _pending.push_back(ai_comm); }
+
+    // Send all pending data and wait for the replies. Returns the result of
+    // the last round trip if there is nothing pending.
+    bool Flush() {
+        if (_pending.empty()) return _last_result;
+        _last_result = AIComm::SendDataWaitReply(_pending, &_infos);
+        _pending.clear();
+        return _last_result;
+    }
+
+private:
+    std::vector<AIComm *> _pending;
+    std::vector<typename AIComm::Info *> _infos;
+    bool _last_result = true;
+};
@@ -0,0 +1,146 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: alloc_counter.cc
+// Interposes the glibc allocator to count allocations. Link it into an
+// executable (never into a shared library) through the elf-alloc-counter
+// target. operator new goes through malloc, so it is counted as well.
+
+#include "alloc_counter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <execinfo.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#ifndef __GLIBC__
+#error "alloc_counter.cc relies on the glibc __libc_* allocation functions"
+#endif
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *p);
+}
+
+namespace {
+
+struct ThreadStats {
+    uint64_t count;
+    uint64_t bytes;
+    int trace_left;
+    bool in_trace;
+};
+
+// Zero-initialized and trivially destructible, so it is usable from malloc
+// at any point of the life of the thread.
+thread_local ThreadStats t_stats;
+
+std::atomic<uint64_t> g_count(0);
+std::atomic<uint64_t> g_bytes(0);
+std::atomic<int64_t> g_live(0);
+std::atomic<int64_t> g_peak(0);
+
+void trace(size_t size) {
+    t_stats.in_trace = true;
+    t_stats.trace_left --;
+    char header[64];
+    int n = snprintf(header, sizeof(header), "allocation of %zu bytes at\n", size);
+    if (write(STDERR_FILENO, header, n) < 0) { }
+    void *frames[32];
+    int depth = backtrace(frames, 32);
+    // Skip this function and the hook.
+    backtrace_symbols_fd(frames + 2, depth - 2, STDERR_FILENO);
+    t_stats.in_trace = false;
+}
+
+inline void on_alloc(void *p) {
+    if (p == nullptr) return;
+    const size_t size = malloc_usable_size(p);
+    t_stats.count ++;
+    t_stats.bytes += size;
+    g_count.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = g_live.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = g_peak.load(std::memory_order_relaxed);
+    while (live > peak && ! g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+    if (t_stats.trace_left > 0 && ! t_stats.in_trace) trace(size);
+}
+
+inline void on_free(void *p) {
+    if (p == nullptr) return;
+    g_live.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+extern "C" {
+
+void *malloc(size_t size) {
+    void *p = __libc_malloc(size);
+    on_alloc(p);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    void *p = __libc_calloc(n, size);
+    on_alloc(p);
+    return p;
+}
+
+void *realloc(void *p, size_t size) {
+    on_free(p);
+    void *q = __libc_realloc(p, size);
+    if (q != nullptr) on_alloc(q);
+    else if (p != nullptr && size > 0) g_live.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    return q;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    void *p = __libc_memalign(alignment, size);
+    on_alloc(p);
+    return p;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **res, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void *p = memalign(alignment, size);
+    if (p == nullptr) return ENOMEM;
+    *res = p;
+    return 0;
+}
+
+void free(void *p) {
+    on_free(p);
+    __libc_free(p);
+}
+
+}  // extern "C"
+
+namespace elf {
+
+uint64_t AllocCounter::ThreadCount() { return t_stats.count; }
+uint64_t AllocCounter::ThreadBytes() { return t_stats.bytes; }
+uint64_t AllocCounter::TotalCount() { return g_count.load(); }
+uint64_t AllocCounter::TotalBytes() { return g_bytes.load(); }
+int64_t AllocCounter::LiveBytes() { return g_live.load(); }
+int64_t AllocCounter::PeakLiveBytes() { return g_peak.load(); }
+void AllocCounter::ResetPeak() { g_peak.store(g_live.load()); }
+void AllocCounter::TraceThread(int n) { t_stats.trace_left = n; }
+
+}  // namespace elf
@@ -0,0 +1,46 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: alloc_counter.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace elf {
+
+// Counts heap allocations. Only available in executables that link
+// alloc_counter.cc (target elf-alloc-counter), which interposes malloc and
+// friends; the Python modules never do.
+//
+// Used by tools that check that the steady state of a loop does not allocate:
+//     uint64_t before = AllocCounter::ThreadCount();
+//     ... one tick ...
+//     if (AllocCounter::ThreadCount() != before) ...
+class AllocCounter {
+public:
+    // Allocations made by the calling thread (malloc, calloc, realloc,
+    // posix_memalign, operator new, ...).
+    static uint64_t ThreadCount();
+    static uint64_t ThreadBytes();
+
+    // Over all threads.
+    static uint64_t TotalCount();
+    static uint64_t TotalBytes();
+    static int64_t LiveBytes();
+    static int64_t PeakLiveBytes();
+    static void ResetPeak();
+
+    // Print a backtrace to stderr for each of the next n allocations of the
+    // calling thread, to find out where they come from.
+    static void TraceThread(int n);
+};
+
+}  // namespace elf
@@ -0,0 +1,159 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: benchmark-copier.cc
+// Compare the batched, type-specialized CopyToMem/CopyFromMem with the
+// per-sample virtual call path they replace.
+// Usage: benchmark-copier [batchsize=128] [T=1] [feature_size=8800] [iters=2000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hist.h"
+
+using namespace std;
+
+// Same field mix as the MiniRTS GameState.
+struct BenchState {
+    using State = BenchState;
+    using Data = BenchState;
+
+    int32_t id;
+    int32_t seq;
+    int32_t game_counter;
+    char terminal;
+    char last_terminal;
+    std::vector<float> s;
+    std::vector<float> res;
+    float last_r;
+    int64_t a;
+    float V;
+    std::vector<float> pi;
+
+    BenchState &Prepare(const SeqInfo &seq_info) {
+        seq = seq_info.seq;
+        game_counter = seq_info.game_counter;
+        last_terminal = seq_info.last_terminal;
+        return *this;
+    }
+
+    DECLARE_FIELD(BenchState, id, a, V, pi, last_r, s, res, terminal, seq, game_counter, last_terminal);
+};
+
+using Hist = HistT<BenchState>;
+using CopyItem = elf::CopyItemT<BenchState>;
+
+// The previous implementation: one virtual copy_to_mem() and size() per field, time step and sample.
+static void LegacyCopyToMem(const vector<CopyItem> &copier, const vector<Hist *> &batch) {
+    size_t batchsize = batch.size();
+    size_t overall_hist_len = batch[0]->size();
+    for (const auto& item: copier) {
+        size_t hist_len = item.Capacity(batch[0]->newest()) / batchsize;
+        size_t min_hist_len = std::min(hist_len, overall_hist_len);
+        char *p = item.ptr();
+        for (size_t t = 0; t < min_hist_len; ++t) {
+            for (auto* s: batch) p = item.CopyToMem(s->newest(min_hist_len - t - 1), p);
+        }
+    }
+}
+
+static void LegacyCopyFromMem(const vector<CopyItem> &copier, vector<Hist *> &batch) {
+    size_t batchsize = batch.size();
+    size_t overall_hist_len = batch[0]->size();
+    for (const auto& item: copier) {
+        size_t hist_len = item.Capacity(batch[0]->newest()) / batchsize;
+        size_t min_hist_len = std::min(hist_len, overall_hist_len);
+        const char *p = item.ptr();
+        for (size_t t = 0; t < min_hist_len; ++t) {
+            for (auto* s: batch) p = item.CopyFromMem(s->newest(min_hist_len - t - 1), p);
+        }
+    }
+}
+
+template <typename F>
+static double time_usec(int iters, F f) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) f();
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / iters;
+}
+
+int main(int argc, char *argv[]) {
+    int batchsize = argc > 1 ? atoi(argv[1]) : 128;
+    int T = argc > 2 ? atoi(argv[2]) : 1;
+    int feature_size = argc > 3 ? atoi(argv[3]) : 22 * 20 * 20;
+    int iters = argc > 4 ? atoi(argv[4]) : 2000;
+
+    vector<unique_ptr<Hist>> hists;
+    vector<Hist *> batch;
+    for (int i = 0; i < batchsize; ++i) {
+        hists.emplace_back(new Hist());
+        Hist &h = *hists.back();
+        h.InitHist(T);
+        for (auto &st : h.v()) {
+            st.id = i;
+            st.s.resize(feature_size, 0.5f * i);
+            st.res.resize(10, 1.0f);
+            st.pi.resize(9, 0.1f);
+        }
+        SeqInfo seq;
+        for (int t = 0; t < T; ++t) { h.Prepare(seq); seq.Inc(); }
+        batch.push_back(&h);
+    }
+
+    // Buffers laid out as [T, batchsize, ...].
+    const BenchState &proto = batch[0]->newest();
+    vector<vector<char>> storage;
+    auto bind = [&](vector<CopyItem> &copier, const vector<string> &keys) {
+        for (const string &key : keys) {
+            auto *mm = BenchState::get_mm(key);
+            storage.emplace_back(mm->size(proto) * batchsize * T);
+            copier.emplace_back(key, elf::SharedBuffer(storage.back().data(), storage.back().size()), mm);
+        }
+    };
+    vector<CopyItem> input, reply;
+    bind(input, { "s", "res", "last_r", "terminal", "id", "seq", "game_counter", "last_terminal" });
+    bind(reply, { "a", "V", "pi" });
+
+    size_t input_bytes = 0;
+    for (const auto &item : input) input_bytes += item.buf.size();
+
+    // Both paths must produce identical buffers.
+    vector<char> expected;
+    LegacyCopyToMem(input, batch);
+    for (const auto &item : input) expected.insert(expected.end(), item.ptr(), item.ptr() + item.buf.size());
+    for (const auto &item : input) memset(item.ptr(), 0, item.buf.size());
+    elf::CopyToMem(input, batch);
+    vector<char> actual;
+    for (const auto &item : input) actual.insert(actual.end(), item.ptr(), item.ptr() + item.buf.size());
+    if (actual != expected) {
+        cout << "Mismatch between the legacy and batched copier!" << endl;
+        return 1;
+    }
+
+    cout << "batchsize: " << batchsize << " T: " << T << " feature_size: " << feature_size
+         << " input bytes/batch: " << input_bytes << endl;
+    printf("%-22s %12s %12s %10s\n", "path", "us/batch", "ns/sample", "GB/s");
+    auto report = [&](const char *name, double usec, size_t bytes) {
+        printf("%-22s %12.2f %12.1f %10.2f\n", name, usec, usec * 1000 / batchsize, bytes / usec / 1e3);
+    };
+    report("legacy CopyToMem", time_usec(iters, [&]() { LegacyCopyToMem(input, batch); }), input_bytes);
+    report("batched CopyToMem", time_usec(iters, [&]() { elf::CopyToMem(input, batch); }), input_bytes);
+
+    size_t reply_bytes = 0;
+    for (const auto &item : reply) reply_bytes += item.buf.size();
+    report("legacy CopyFromMem", time_usec(iters * 10, [&]() { LegacyCopyFromMem(reply, batch); }), reply_bytes);
+    report("batched CopyFromMem", time_usec(iters * 10, [&]() { elf::CopyFromMem(reply, batch); }), reply_bytes);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: benchmark-fiber.cc
+// Throughput of many games talking to one collector, with one thread per game
+// versus games as fibers multiplexed onto a few threads.
+// Usage: benchmark-fiber [num_games=2048] [batchsize=128] [rounds_per_game=200] [num_game_threads=hw threads] [work_usec=20]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "collector.hh"
+#include "fiber.h"
+
+using namespace std;
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static long max_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Simulated game step.
+static void work(int usec) {
+    auto end = chrono::steady_clock::now() + chrono::microseconds(usec);
+    volatile int x = 0;
+    while (chrono::steady_clock::now() < end) x ++;
+}
+
+struct Result {
+    double wall, cpu;
+    int64_t num_round_trips;
+};
+
+// num_game_threads == 0: one thread per game.
+static Result run(int num_games, int batchsize, int rounds, int num_game_threads, int work_usec) {
+    vector<int> keys;
+    for (int i = 0; i < num_games; ++i) keys.push_back(i);
+    elf::BatchCollectorT<int, int> collector(keys);
+    vector<int> values(num_games);
+
+    double cpu_start = cpu_seconds();
+    auto wall_start = chrono::steady_clock::now();
+
+    thread server([&]() {
+        vector<int> served(num_games, 0);
+        int num_active = num_games;
+        while (num_active > 0) {
+            auto batch = collector.waitBatch(std::min(batchsize, num_active));
+            for (int *v : batch) {
+                int key = *v;
+                if (++ served[key] == rounds) num_active --;
+                collector.signalReply(key);
+            }
+        }
+    });
+
+    auto game = [&](int i) {
+        values[i] = i;
+        for (int r = 0; r < rounds; ++r) {
+            work(work_usec);
+            collector.sendDataWaitReply(i, &values[i]);
+        }
+    };
+
+    if (num_game_threads == 0) {
+        vector<thread> games;
+        for (int i = 0; i < num_games; ++i) games.emplace_back(game, i);
+        for (auto &t : games) t.join();
+    } else {
+        elf::FiberScheduler scheduler(num_game_threads, 64 * 1024);
+        for (int i = 0; i < num_games; ++i) scheduler.Spawn([&game, i]() { game(i); });
+        scheduler.Join();
+    }
+    server.join();
+
+    Result res;
+    res.wall = chrono::duration<double>(chrono::steady_clock::now() - wall_start).count();
+    res.cpu = cpu_seconds() - cpu_start;
+    res.num_round_trips = (int64_t)num_games * rounds;
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    int num_games = argc > 1 ? atoi(argv[1]) : 2048;
+    int batchsize = argc > 2 ? atoi(argv[2]) : 128;
+    int rounds = argc > 3 ? atoi(argv[3]) : 200;
+    int num_game_threads = argc > 4 ? atoi(argv[4]) : std::max(1u, thread::hardware_concurrency());
+    int work_usec = argc > 5 ? atoi(argv[5]) : 20;
+    batchsize = std::max(1, std::min(batchsize, num_games));
+
+    cout << "#games: " << num_games << " batchsize: " << batchsize << " rounds: " << rounds
+         << " work(us): " << work_usec << " hw threads: " << thread::hardware_concurrency() << endl;
+    printf("%-22s %12s %14s %12s\n", "mode", "steps/s", "cpu(us)/step", "maxrss(MB)");
+
+    auto report = [&](const string &name, const Result &r) {
+        printf("%-22s %12.0f %14.2f %12.1f\n", name.c_str(), r.num_round_trips / r.wall,
+               r.cpu / r.num_round_trips * 1e6, max_rss_kb() / 1024.0);
+    };
+    // Fibers first, since maxrss only grows.
+    report("fibers x " + to_string(num_game_threads), run(num_games, batchsize, rounds, num_game_threads, work_usec));
+    report("thread per game", run(num_games, batchsize, rounds, 0, work_usec));
+    return 0;
+}
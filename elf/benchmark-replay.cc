@@ -0,0 +1,155 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: benchmark-replay.cc
+// Insert and sample throughput of the replay buffer, with uniform and
+// prioritized sampling.
+// Usage: benchmark-replay [capacity=100000] [batchsize=128] [T=1] [feature_size=8800] [num_shards=8] [iters=500]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer.h"
+
+using namespace std;
+
+// Same field mix as the MiniRTS GameState.
+struct BenchState {
+    using State = BenchState;
+    using Data = BenchState;
+
+    int32_t id;
+    int32_t seq;
+    int32_t game_counter;
+    char terminal;
+    char last_terminal;
+    std::vector<float> s;
+    std::vector<float> res;
+    float last_r;
+    int64_t a;
+    float V;
+    std::vector<float> pi;
+
+    BenchState &Prepare(const SeqInfo &seq_info) {
+        seq = seq_info.seq;
+        game_counter = seq_info.game_counter;
+        last_terminal = seq_info.last_terminal;
+        return *this;
+    }
+
+    DECLARE_FIELD(BenchState, id, a, V, pi, last_r, s, res, terminal, seq, game_counter, last_terminal);
+};
+
+using Hist = HistT<BenchState>;
+using Replay = elf::ReplayBufferT<BenchState>;
+
+template <typename F>
+static double time_usec(int iters, F f) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) f();
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / iters;
+}
+
+int main(int argc, char *argv[]) {
+    ReplayBufferOptions options;
+    options.capacity = argc > 1 ? atoi(argv[1]) : 100000;
+    options.batchsize = argc > 2 ? atoi(argv[2]) : 128;
+    int T = argc > 3 ? atoi(argv[3]) : 1;
+    int feature_size = argc > 4 ? atoi(argv[4]) : 22 * 20 * 20;
+    options.num_shards = argc > 5 ? atoi(argv[5]) : 8;
+    int iters = argc > 6 ? atoi(argv[6]) : 500;
+    const int batchsize = options.batchsize;
+
+    // One collector batch of games.
+    vector<unique_ptr<Hist>> hists;
+    vector<Hist *> batch;
+    for (int i = 0; i < batchsize; ++i) {
+        hists.emplace_back(new Hist());
+        Hist &h = *hists.back();
+        h.InitHist(T);
+        for (auto &st : h.v()) {
+            st.id = i;
+            st.s.resize(feature_size, 0.5f * i);
+            st.res.resize(10, 1.0f);
+            st.pi.resize(9, 0.1f);
+        }
+        SeqInfo seq;
+        for (int t = 0; t < T; ++t) { h.Prepare(seq); seq.Inc(); }
+        batch.push_back(&h);
+    }
+
+    // Training buffers laid out as [T, batchsize, ...].
+    const BenchState &proto = batch[0]->newest();
+    vector<vector<char>> storage;
+    size_t sample_bytes = 0;
+    auto bind = [&](Replay *replay) {
+        storage.clear();
+        sample_bytes = 0;
+        for (const string key : { "s", "res", "last_r", "a", "V", "pi" }) {
+            storage.emplace_back(BenchState::get_mm(key)->size(proto) * batchsize * T);
+            sample_bytes += storage.back().size();
+            replay->AddEntry(key, elf::SharedBuffer(storage.back().data(), storage.back().size()));
+        }
+    };
+
+    cout << "capacity: " << options.capacity << " batchsize: " << batchsize << " T: " << T << " feature_size: " << feature_size
+         << " #shards: " << options.num_shards << endl;
+    printf("%-26s %12s %14s %10s\n", "op", "us/batch", "entries/s", "GB/s");
+    auto report = [&](const string &name, double usec, size_t bytes) {
+        printf("%-26s %12.2f %14.0f %10.2f\n", name.c_str(), usec, batchsize / usec * 1e6, bytes / usec / 1e3);
+    };
+
+    for (bool prioritized : { false, true }) {
+        options.prioritized = prioritized;
+        Replay replay(options);
+        bind(&replay);
+        const string mode = prioritized ? "prioritized" : "uniform";
+
+        // The first pass over the capacity allocates the entries.
+        const int fill_iters = (options.capacity + batchsize - 1) / batchsize;
+        report(mode + " insert (fill)", time_usec(fill_iters, [&]() { replay.Add(batch); }), sample_bytes);
+        report(mode + " insert", time_usec(iters, [&]() { replay.Add(batch); }), sample_bytes);
+        report(mode + " sample", time_usec(iters, [&]() { replay.Sample(); }), sample_bytes);
+
+        if (prioritized) {
+            mt19937 rng(1);
+            uniform_real_distribution<float> td(0.0f, 2.0f);
+            vector<float> priorities(batchsize);
+            report(mode + " sample+update", time_usec(iters, [&]() {
+                ReplaySample sample = replay.Sample();
+                for (float &p : priorities) p = td(rng);
+                replay.UpdatePriorities(sample.idx, priorities);
+            }), sample_bytes);
+        }
+
+        // Collectors keep inserting while the trainer samples.
+        atomic<bool> stop(false);
+        int64_t num_inserted = 0;
+        thread inserter([&]() {
+            while (! stop) {
+                replay.Add(batch);
+                num_inserted += batchsize;
+            }
+        });
+        double usec = time_usec(iters, [&]() { replay.Sample(); });
+        stop = true;
+        inserter.join();
+        report(mode + " sample (concurrent)", usec, sample_bytes);
+        printf("%-26s %12s %14.0f\n", (mode + " insert (concurrent)").c_str(), "", num_inserted / (usec * iters) * 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: benchmark-wait-policy.cc
+// Round-trip latency and CPU cost of the game <-> collector hand-off for each WaitPolicy.
+// Usage: benchmark-wait-policy [num_clients=16] [batchsize=4] [rounds_per_client=2000] [spin_count=2000]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "collector.hh"
+#include "wait_policy.h"
+
+using namespace std;
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct Result {
+    double wall;
+    double cpu;
+    int64_t num_round_trips;
+    // In microseconds.
+    double lat_mean, lat_p50, lat_p99;
+};
+
+static Result run(const elf::WaitPolicy &policy, int num_clients, int batchsize, int rounds) {
+    using Clock = std::chrono::steady_clock;
+
+    vector<int> keys;
+    for (int i = 0; i < num_clients; ++i) keys.push_back(i);
+    elf::BatchCollectorT<int, int> collector(keys, policy);
+
+    vector<int> values(num_clients);
+    vector<vector<float>> latencies(num_clients);
+
+    double cpu_start = cpu_seconds();
+    auto wall_start = Clock::now();
+
+    // The collector side: serve batches until every client has done its rounds.
+    thread server([&]() {
+        vector<int> served(num_clients, 0);
+        int num_active = num_clients;
+        while (num_active > 0) {
+            auto batch = collector.waitBatch(std::min(batchsize, num_active));
+            for (int *v : batch) {
+                int key = *v;
+                if (++ served[key] == rounds) num_active --;
+                collector.signalReply(key);
+            }
+        }
+    });
+
+    vector<thread> clients;
+    for (int i = 0; i < num_clients; ++i) {
+        clients.emplace_back([&, i]() {
+            values[i] = i;
+            latencies[i].reserve(rounds);
+            for (int r = 0; r < rounds; ++r) {
+                auto t0 = Clock::now();
+                collector.sendDataWaitReply(i, &values[i]);
+                auto t1 = Clock::now();
+                latencies[i].push_back(std::chrono::duration<float, std::micro>(t1 - t0).count());
+            }
+        });
+    }
+    for (auto &t : clients) t.join();
+    server.join();
+
+    Result res;
+    res.wall = std::chrono::duration<double>(Clock::now() - wall_start).count();
+    res.cpu = cpu_seconds() - cpu_start;
+
+    vector<float> all;
+    for (const auto &l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    res.num_round_trips = all.size();
+    double sum = 0;
+    for (float l : all) sum += l;
+    res.lat_mean = sum / all.size();
+    res.lat_p50 = all[all.size() / 2];
+    res.lat_p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    int num_clients = argc > 1 ? atoi(argv[1]) : 16;
+    int batchsize = argc > 2 ? atoi(argv[2]) : 4;
+    int rounds = argc > 3 ? atoi(argv[3]) : 2000;
+    int spin_count = argc > 4 ? atoi(argv[4]) : 2000;
+    batchsize = std::max(1, std::min(batchsize, num_clients));
+
+    cout << "#clients: " << num_clients << " batchsize: " << batchsize << " rounds: " << rounds
+         << " spin_count: " << spin_count << " hw threads: " << thread::hardware_concurrency() << endl;
+    printf("%-10s %12s %10s %10s %10s %12s %10s\n",
+           "policy", "trips/s", "mean(us)", "p50(us)", "p99(us)", "cpu(us)/trip", "cores");
+
+    for (const char *name : { "block", "spin_park", "spin" }) {
+        elf::WaitPolicy policy = elf::WaitPolicy::Parse(name, spin_count);
+        Result r = run(policy, num_clients, batchsize, rounds);
+        printf("%-10s %12.0f %10.1f %10.1f %10.1f %12.2f %10.2f\n",
+               name, r.num_round_trips / r.wall, r.lat_mean, r.lat_p50, r.lat_p99,
+               r.cpu / r.num_round_trips * 1e6, r.cpu / r.wall);
+    }
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include <unordered_map>
 #include <vector>
 #include <thread>
+#include <chrono>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
@@ -22,8 +23,9 @@
 #ifdef USE_TBB
 #include <tbb/concurrent_queue.h>
 #else
-#include "blockingconcurrentqueue.h"
+#include "concurrentqueue.h"
 #endif
+#include "wait_policy.h"
 
 namespace elf {
 
@@ -33,16 +35,18 @@ class CollectorWithCCQueue {
 #ifdef USE_TBB
   tbb::concurrent_queue<int> Q;
 #else
-  moodycamel::BlockingConcurrentQueue<int> Q;
+  moodycamel::ConcurrentQueue<int> Q;
 #endif
+  // Consumers park here when Q is empty.
+  Parker _q_parker;
+  WaitPolicy _policy;
 
   std::unordered_map<Key, int> _index_map;
 
   struct TaskData {
     Value* val = nullptr;
 
-    std::condition_variable cond;
-    std::mutex mutex;
+    Parker parker;
     std::atomic_bool flag{false};
     // reply has come or not
   };
@@ -57,14 +61,37 @@ class CollectorWithCCQueue {
     return it->second;
   }
 
+  inline void push(int index) {
+#ifdef USE_TBB
+    Q.push(index);
+#else
+    Q.enqueue(index);
+#endif
+    _q_parker.notify_one();
+  }
+
+  inline bool try_pop(int &index) {
+#ifdef USE_TBB
+    return Q.try_pop(index);
+#else
+    return Q.try_dequeue(index);
+#endif
+  }
+
   inline void notify(std::unique_ptr<TaskData>& d) {
-    std::lock_guard<std::mutex> lg(d->mutex);
     d->flag.store(true);
-    d->cond.notify_one();
+    d->parker.notify_one();
+  }
+
+  inline void wait(std::unique_ptr<TaskData>& d) {
+    std::atomic_bool &flag = d->flag;
+    d->parker.wait(_policy, [&flag]() { return flag.load(); });
+    d->flag.store(false);
   }
 
   public:
-  explicit CollectorWithCCQueue(const std::vector<Key> &keys) {
+  explicit CollectorWithCCQueue(const std::vector<Key> &keys, const WaitPolicy &policy = WaitPolicy())
+    : _policy(policy) {
       // Preload all the keys.
       for (size_t i = 0; i < keys.size(); ++i) {
           _data.emplace_back(new TaskData{});
@@ -74,16 +101,14 @@ class CollectorWithCCQueue {
 
   CollectorWithCCQueue(const CollectorWithCCQueue&) = delete;
 
+  const WaitPolicy &wait_policy() const { return _policy; }
+
   void sendData(const Key& key, Value* value) {
     int index = get_index(key);
     if (index < 0) throw std::range_error("[sendData] key " + std::to_string(key) + " not found!");
 
     _data[index]->val = value;
-#ifdef USE_TBB
-    Q.push(index);
-#else
-    Q.enqueue(index);
-#endif
+    push(index);
   }
 
   void signalReply(const Key& key) {
@@ -98,11 +123,7 @@ class CollectorWithCCQueue {
     int index = get_index(key);
     if (index < 0) throw std::range_error("[waitReply] key " + std::to_string(key) + " not found!");
 
-    auto& data = _data[index];
-    std::unique_lock<std::mutex> lk(data->mutex);
-    while (!data->flag)
-      data->cond.wait(lk);
-    data->flag.store(false);
+    wait(_data[index]);
   }
 
   void sendDataWaitReply(const Key& key, Value* value) {
@@ -111,67 +132,44 @@ class CollectorWithCCQueue {
 
     auto& data = _data[index];
     data->val = value;
-    std::unique_lock<std::mutex> lk(data->mutex);
-#ifdef USE_TBB
-    Q.push(index);
-#else
-    Q.enqueue(index);
-#endif
-    while (!data->flag)
-      data->cond.wait(lk);
-    data->flag.store(false);
+    push(index);
+    wait(data);
   }
 
   inline Value* waitOne() {
-    int idx;
-#ifdef USE_TBB
-    while (true)
-      if (Q.try_pop(idx))
-        return _data[idx]->val;
-#else
-    Q.wait_dequeue(idx);
+    int idx = -1;
+    _q_parker.wait(_policy, [this, &idx]() { return try_pop(idx); });
     return _data[idx]->val;
-#endif
   }
 
   inline Value* waitOneUntil(int timeout_sec) {
-#ifdef USE_TBB
-    int k;
-    if (!Q.try_pop(k)) {
-      // Sleep would not efficiently return the element.
-      std::this_thread::sleep_for(std::chrono::seconds(timeout_sec));
-      if (!Q.try_pop(k))
-        return nullptr;
-    }
-    return (_data[k]->val);
-#else
-    int k;
-    if (Q.wait_dequeue_timed(k, timeout_sec))
+    int k = -1;
+    if (_q_parker.wait_for(_policy, timeout_sec * 1000000, [this, &k]() { return try_pop(k); }))
       return (_data[k]->val);
     else
       return nullptr;
-#endif
+  }
+
+  // Return false if nothing arrives within timeout_usec.
+  inline bool waitOneFor(int timeout_usec, Value **value) {
+    int k = -1;
+    if (!_q_parker.wait_for(_policy, timeout_usec, [this, &k]() { return try_pop(k); }))
+      return false;
+    *value = _data[k]->val;
+    return true;
   }
 
   // signal reply to all data currently waiting
   void signalReplyAll() {
-#ifdef USE_TBB
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-    int k;
-    while (Q.try_pop(k)) {
-      notify(_data[k]);
-    }
-#else
     // some may lie in queues
     while (true) {
       int k;
-      if (Q.wait_dequeue_timed(k, 2)) {
+      if (_q_parker.wait_for(_policy, 2, [this, &k]() { return try_pop(k); })) {
         notify(_data[k]);
       } else {
         break;
       }
     }
-#endif
 
     // some may be held in buffers.
     for (auto& td: _data) {
@@ -191,21 +189,36 @@ class BatchCollectorT: public CollectorT<Key, Value> {
   public:
     using BatchValue = std::vector<Value*>;
 
-    explicit BatchCollectorT(const std::vector<Key> &keys):
-      CollectorT<Key, Value>{keys} {}
+    explicit BatchCollectorT(const std::vector<Key> &keys, const WaitPolicy &policy = WaitPolicy()):
+      CollectorT<Key, Value>{keys, policy} {}
 
     // non reentrable
-    BatchValue waitBatch(int batch_size) {
-      while ((int)_batch.size() < batch_size) {
-        _batch.emplace_back(this->waitOne());
-      }
-      BatchValue ret;
-      ret.swap(_batch);
-      return ret;
+    // If timeout_usec > 0, return a partial batch once timeout_usec has passed
+    // since the first sample of the batch arrived.
+    BatchValue waitBatch(int batch_size, int timeout_usec = 0) {
+      BatchValue batch;
+      waitBatch(batch_size, timeout_usec, &batch);
+      return batch;
     }
 
-  private:
-    std::vector<Value*> _batch;
+    // Same, but fill *batch, which keeps its capacity from call to call.
+    void waitBatch(int batch_size, int timeout_usec, BatchValue *batch) {
+      batch->clear();
+      if (timeout_usec <= 0) {
+        while ((int)batch->size() < batch_size) {
+          batch->push_back(this->waitOne());
+        }
+      } else {
+        batch->push_back(this->waitOne());
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_usec);
+        while ((int)batch->size() < batch_size) {
+          auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+          Value *v;
+          if (left <= 0 || !this->waitOneFor(left, &v)) break;
+          batch->push_back(v);
+        }
+      }
+    }
 };
 
 }  // namespace elf
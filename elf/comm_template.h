@@ -21,6 +21,7 @@
 #include <map>
 #include <algorithm>
 
+#include "fiber.h"
 #include "pybind_helper.h"
 #include "python_options_utils_cpp.h"
 
@@ -32,14 +33,25 @@ struct GroupStat {
     int gid;
     int hist_len;
     std::string player_name;
-
-    GroupStat() : gid(-1), hist_len(1) { }
+    // If > 0, the group sends a partial batch once this many microseconds
+    // have passed since the first sample of the batch arrived.
+    int timeout_usec;
+    // Number of batch buffer sets. With more than one, the group keeps
+    // collecting while Python holds a batch.
+    int num_slots;
+    // If true, each game always fills the same row of the batch, and the
+    // "valid" input marks the rows of games that reported this round.
+    bool fixed_rows;
+
+    GroupStat() : gid(-1), hist_len(1), timeout_usec(0), num_slots(1), fixed_rows(false) { }
     std::string info() const {
-        return "[gid=" + std::to_string(gid) + "][T=" + std::to_string(hist_len) + "][player_name=" + player_name + "]";
+        return "[gid=" + std::to_string(gid) + "][T=" + std::to_string(hist_len) + "][player_name=" + player_name
+            + "][timeout_usec=" + std::to_string(timeout_usec) + "][num_slots=" + std::to_string(num_slots)
+            + "][fixed_rows=" + (fixed_rows ? "True" : "False") + "]";
     }
 
     // Note that gid will be set by C++ side.
-    REGISTER_PYBIND_FIELDS(hist_len, player_name);
+    REGISTER_PYBIND_FIELDS(hist_len, player_name, timeout_usec, num_slots, fixed_rows);
 };
 
 
@@ -95,14 +107,19 @@ private:
         std::unique_ptr<SemaCollector> counter;
         std::vector<CondPerGroupT<In>> conds;
 
-        Stat(Key k) : key(k), freq(0) {
-            counter.reset(new SemaCollector());
+        // Groups the last data of this key was sent to. Only used by the
+        // thread that owns the key.
+        std::vector<int> selected_groups;
+
+        Stat(Key k, const elf::WaitPolicy &policy) : key(k), freq(0) {
+            counter.reset(new SemaCollector(policy));
         }
 
         void InitCond(int ngroup) {
             for (int i = 0; i < ngroup; ++i) {
                 conds.emplace_back();
             }
+            selected_groups.reserve(ngroup);
         }
     };
 
@@ -114,6 +131,8 @@ private:
     std::vector<Key> _keys;
     std::vector<std::vector<GroupStat>> _exclusive_groups;
 
+    elf::WaitPolicy _wait_policy;
+
     std::vector<std::unique_ptr<CollectorGroup> > _groups;
     ctpl::thread_pool _pool;
 
@@ -140,20 +159,85 @@ private:
 
     void init_stats() {
         for (const Key& key : _keys) {
-            _map.emplace(std::make_pair(key, Stat(key)));
+            _map.emplace(std::make_pair(key, Stat(key, _wait_policy)));
         }
     }
 
+    // Return nullptr if the key is unknown. The groups the data is sent to
+    // are in stats->selected_groups.
+    Stat *send_data(const Key& key, In& info) {
+        auto it = _map.find(key);
+        if (it == _map.end()) return nullptr;
+        Stat &stats = it->second;
+        stats.freq ++;
+        std::vector<int> *selected_groups = &stats.selected_groups;
+        selected_groups->clear();
+
+        V_PRINT(_verbose, "[k=" << key << "] Start sending data, seq = " << info.data.newest().seq << " hist_len = " << info.data.size());
+        // Send the key to all collectors in the container, if the key satisfy the gating function.
+
+        // For each exclusive group, randomly select one.
+        for (size_t i = 0; i < _exclusive_groups.size(); ++i) {
+            int idx = _g() % _exclusive_groups[i].size();
+            const GroupStat &gstat = _exclusive_groups[i][idx];
+
+            if (stats.conds[i].Check(gstat, info)) {
+                V_PRINT(_verbose, "[k=" << key << "] Pass test for group " << gstat.gid << " hist_len = " << gstat.hist_len);
+                stats.conds[i].freq_send ++;
+
+                _groups[gstat.gid]->SendData(key, &info);
+                selected_groups->push_back(gstat.gid);
+            }
+        }
+        if (_verbose && ! selected_groups->empty()) {
+            std::string str_selected_groups;
+            for (const int gid : *selected_groups) str_selected_groups += std::to_string(gid) + ",";
+            PRINT("[k=" << key << "] Sent to " << selected_groups->size() << " groups " << str_selected_groups << " waiting for the data to be processed");
+        }
+        return &stats;
+    }
+
+    void wait_reply(const Key& key, Stat &stats) {
+        const std::vector<int> &selected_groups = stats.selected_groups;
+        if (selected_groups.empty()) return;
+
+        // Wait until all collectors have done their jobs.
+        stats.counter->wait(selected_groups.size());
+
+        V_PRINT(_verbose, "[k=" << key << "] All " << selected_groups.size() << " has done their jobs, Wait until the game is released");
+
+        // Finally wait until resume is sent.
+        for (const int gid : selected_groups) {
+            _groups[gid]->WaitReply(key);
+        }
+    }
+
+    // Gives slot of group gid back, if the daemon still holds it.
+    void release_slot(int gid, int slot) {
+        CollectorGroup &g = *_groups[gid];
+        if (! g.TakeHeldSlot(slot)) return;
+
+        for (const In *in : g.GetBatch(slot)) {
+            auto it = _map.find(in->meta.query_id);
+            if (it != _map.end()) {
+                it->second.counter->notify();
+            }
+        }
+        g.ReleaseSlot(slot);
+    }
+
 public:
     CommT(const ContextOptions &context_options)
-      : _context_options(context_options),  _g(_rd()), _verbose(context_options.verbose_comm) {
+      : _context_options(context_options),  _g(_rd()), _wait_policy(context_options.GetWaitPolicy()),
+        _verbose(context_options.verbose_comm) {
         _signal.reset(new SyncSignal());
         compute_keys();
         init_stats();
     }
 
     int AddCollectors(int batchsize, int exclusive_id, const GroupStat &gstat) {
-        _groups.emplace_back(new CollectorGroup(_groups.size(), _keys, batchsize, _signal.get(), _context_options.verbose_collector));
+        _groups.emplace_back(new CollectorGroup(_groups.size(), _keys, batchsize, _signal.get(), _context_options.verbose_collector,
+                    _wait_policy, gstat.timeout_usec, gstat.num_slots, gstat.fixed_rows));
         int gid = _groups.size() - 1;
 
         if ((int)_exclusive_groups.size() <= exclusive_id) {
@@ -165,6 +249,7 @@ public:
     }
 
     CollectorGroup &GetCollectorGroup(int gid) { return *_groups[gid]; }
+    const CollectorGroup &GetCollectorGroup(int gid) const { return *_groups[gid]; }
     int num_groups() const { return _groups.size(); }
 
     void CollectorsReady() {
@@ -176,75 +261,53 @@ public:
             p.second.InitCond(_exclusive_groups.size());
         }
 
-        _pool.resize(_groups.size());
+        // One thread per collector, plus one to put the replies back for
+        // each group with several slots.
+        int num_threads = _groups.size();
+        for (auto &g : _groups) {
+          if (g->num_slots() > 1) num_threads ++;
+        }
+        _pool.resize(num_threads);
         for (auto &g : _groups) {
           CollectorGroup *p = g.get();
           _pool.push([p, this](int) { p->MainLoop(); });
+          if (p->num_slots() > 1) _pool.push([p](int) { p->ReplyLoop(); });
         }
     }
 
     // Agent side.
     bool SendDataWaitReply(const Key& key, In& info) {
-        auto it = _map.find(key);
-        if (it == _map.end()) return false;
-        Stat &stats = it->second;
-        stats.freq ++;
-
-        V_PRINT(_verbose, "[k=" << key << "] Start sending data, seq = " << info.data.newest().seq << " hist_len = " << info.data.size());
-        // Send the key to all collectors in the container, if the key satisfy the gating function.
-        std::vector<int> selected_groups;
-        std::string str_selected_groups;
-
-        // For each exclusive group, randomly select one.
-        for (size_t i = 0; i < _exclusive_groups.size(); ++i) {
-            int idx = _g() % _exclusive_groups[i].size();
-            const GroupStat &gstat = _exclusive_groups[i][idx];
-
-            if (stats.conds[i].Check(gstat, info)) {
-                V_PRINT(_verbose, "[k=" << key << "] Pass test for group " << gstat.gid << " hist_len = " << gstat.hist_len);
-                stats.conds[i].freq_send ++;
+        Stat *stats = send_data(key, info);
+        if (stats == nullptr) return false;
+        wait_reply(key, *stats);
+        V_PRINT(_verbose, "[k=" << key << "] Done with SendDataWaitReply");
+        return true;
+    }
 
-                _groups[gstat.gid]->SendData(key, &info);
-                str_selected_groups += std::to_string(gstat.gid) + ",";
-                selected_groups.push_back(gstat.gid);
-            }
+    // Send the data of several agents before waiting for any reply, so that
+    // all of them can be put in the same batch. Keys must be distinct.
+    bool SendBatchDataWaitReply(const std::vector<In *> &infos) {
+        bool all_sent = true;
+        for (In *info : infos) {
+            all_sent = send_data(info->meta.query_id, *info) != nullptr && all_sent;
         }
-
-        if (! selected_groups.empty()) {
-            V_PRINT(_verbose, "[k=" << key << "] Sent to " << selected_groups.size() << " groups " << str_selected_groups << " waiting for the data to be processed");
-
-            // Wait until all collectors have done their jobs.
-            stats.counter->wait(selected_groups.size());
-
-            V_PRINT(_verbose, "[k=" << key << "] All " << selected_groups.size() << " has done their jobs, Wait until the game is released");
-
-            // Finally wait until resume is sent.
-            for (const int gid : selected_groups) {
-                _groups[gid]->WaitReply(key);
-            }
+        for (In *info : infos) {
+            auto it = _map.find(info->meta.query_id);
+            if (it != _map.end()) wait_reply(it->first, it->second);
         }
-
-        V_PRINT(_verbose, "[k=" << key << "] Done with SendDataWaitReply");
-        return true;
+        return all_sent;
     }
 
     // Daemon side.
     Infos WaitBatchData(int time_usec = 0) { return _signal->wait_batch(-1, time_usec); }
     Infos WaitGroupBatchData(int group_id, int time_usec = 0) { return _signal->wait_batch(group_id, time_usec); }
 
-    // Tell the collector that a reply was sent.
-    bool Steps(const Infos& infos, int future_time_usec = 0) {
+    // Tell the collector that a reply was sent. Batches held in different
+    // slots may be stepped in any order.
+    bool Steps(const Infos& infos) {
         // For invalid infos, return.
         if (infos.gid < 0) return false;
-
-        std::vector<Key> keys = _groups[infos.gid]->GetBatchKeys();
-        for (const Key &key : keys) {
-            auto it = _map.find(key);
-            if (it != _map.end()) {
-                it->second.counter->notify();
-            }
-        }
-        _groups[infos.gid]->SignalBatchUsed(future_time_usec);
+        release_slot(infos.gid, infos.slot);
         return true;
     }
 
@@ -253,6 +316,11 @@ public:
     }
 
     void PrepareStop() {
+        // Batches still held by the daemon would never come back, leaving the
+        // collectors waiting for a slot and the games for their replies.
+        for (const auto &g : _groups) {
+            for (int slot = 0; slot < g->num_slots(); ++slot) release_slot(g->gid(), slot);
+        }
         for (const auto &g : _groups) g->SetBatchSize(1);
     }
 
@@ -266,6 +334,9 @@ public:
 
         // Wait until all threads are done.
         done.wait(_groups.size());
+        for (auto &g : _groups) {
+            if (g->num_slots() > 1) g->StopReplies();
+        }
         _pool.stop();
     }
 };
@@ -291,6 +362,7 @@ public:
 
     using Comm = CommT<Info>;
     using AIComm = AICommT<Comm>;
+    using AICommGroup = typename AIComm::Group;
 
     using GameStartFunc = std::function<void (int game_idx, const ContextOptions &context_options, const Options& options, const std::atomic_bool &done, Comm *comm)>;
 
@@ -299,14 +371,28 @@ private:
     Options _options;
     ContextOptions _context_options;
 
+    // One thread per game, or (if num_game_threads > 0) one fiber per game.
     ctpl::thread_pool _pool;
+    std::unique_ptr<elf::FiberScheduler> _fibers;
     Notif _done;
     bool _game_started = false;
 
+    void stop_games() {
+        if (_fibers != nullptr) {
+            _fibers->Join();
+            _fibers.reset();
+        } else {
+            _pool.stop();
+        }
+    }
+
 public:
     ContextT(const ContextOptions &context_options, const Options& options)
         : _comm(context_options), _options(options), _context_options(context_options),
-          _pool(context_options.num_games) {
+          _pool(context_options.num_game_threads > 0 ? 0 : context_options.num_games) {
+        if (context_options.num_game_threads > 0) {
+            _fibers.reset(new elf::FiberScheduler(context_options.num_game_threads, context_options.fiber_stack_kb * 1024));
+        }
     }
 
     Comm &comm() { return _comm; }
@@ -316,16 +402,22 @@ public:
         _comm.CollectorsReady();
 
         // Now we start all jobs.
-        for (int i = 0; i < _pool.size(); ++i) {
-            _pool.push([i, this, &game_start_func](int){
+        for (int i = 0; i < size(); ++i) {
+            // Copy game_start_func, since fibers may start after Start() returns.
+            auto job = [i, this, game_start_func]() {
                 const std::atomic_bool &done = _done.flag();
                 game_start_func(i, _context_options, _options, done, &_comm);
                 // std::cout << "G[" << i << "] is ending" << std::endl;
                 _done.notify();
-            });
-
-            // TODO sleep to avoid random seed problem?
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            };
+
+            if (_fibers != nullptr) {
+                _fibers->Spawn(job);
+            } else {
+                _pool.push([job](int) { job(); });
+                // TODO sleep to avoid random seed problem?
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
         }
         _game_started = true;
     }
@@ -334,7 +426,7 @@ public:
     Infos WaitGroup(int group_id, int timeout_usec) { return _comm.WaitGroupBatchData(group_id, timeout_usec); }
     void Steps(const Infos& infos) { _comm.Steps(infos); }
 
-    int size() const { return _pool.size(); }
+    int size() const { return _context_options.num_games; }
 
     void PrintSummary() const { _comm.PrintSummary(); }
 
@@ -369,8 +461,8 @@ public:
         // Then stop all game threads.
         std::cout << "Stop all game threads ..." << std::endl;
         _done.set();
-        _done.wait(_pool.size());
-        _pool.stop();
+        _done.wait(size());
+        stop_games();
 
         // Finally stop all collectors.
         std::cout << "Stop all collectors ..." << std::endl;
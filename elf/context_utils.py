@@ -21,6 +21,12 @@ class ContextArgs:
                 ("T", 6),
                 ("eval", dict(action="store_true")),
                 ("wait_per_group", dict(action="store_true")),
+                ("wait_policy", dict(type=str, choices=["block", "spin", "spin_park"], default="block",
+                                     help="How game threads and collectors wait for each other")),
+                ("wait_spin_count", dict(type=int, default=2000, help="Spin iterations before parking, for spin_park")),
+                ("num_game_threads", dict(type=int, default=0,
+                                          help="If > 0, run games as fibers on this many threads instead of one thread per game")),
+                ("fiber_stack_kb", dict(type=int, default=256, help="Stack size of each game fiber in KB")),
                 ("verbose_comm", dict(action="store_true")),
                 ("verbose_collector", dict(action="store_true"))
             ],
@@ -42,6 +48,10 @@ class ContextArgs:
         co.num_games = args.num_games
         co.T = args.T
         co.wait_per_group = args.wait_per_group
+        co.wait_policy = args.wait_policy
+        co.wait_spin_count = args.wait_spin_count
+        co.num_game_threads = args.num_game_threads
+        co.fiber_stack_kb = args.fiber_stack_kb
         co.verbose_comm = args.verbose_comm
         co.verbose_collector = args.verbose_collector
 
@@ -26,6 +26,12 @@ class FieldMemoryManager {
     virtual void copy_to_mem(const Struct& s, void* dst) = 0;
     virtual void copy_from_mem(const void *src, Struct& s) = 0;
 
+    // Copy this field of batch[0], ..., batch[n - 1] to consecutive places,
+    // starting at dst. Return the end of the written region.
+    // One virtual call per batch, the loop itself is specialized by field type.
+    virtual char* copy_batch_to_mem(const Struct* const* batch, size_t n, char* dst) = 0;
+    virtual const char* copy_batch_from_mem(const char* src, Struct* const* batch, size_t n) = 0;
+
     // return size of buffer required to store this field, in bytes
     virtual size_t size(const Struct& s) const = 0;
 
@@ -76,6 +82,23 @@ class FieldMemoryManagerT<Struct, FieldT,
       memcpy(dstptr, src, sizeof(FieldT));  // should work for basic type, arrays, structs
     }
 
+    char* copy_batch_to_mem(const Struct* const* batch, size_t n, char* dst) override {
+      const int offset = this->_offset;
+      for (size_t i = 0; i < n; ++i, dst += sizeof(FieldT)) {
+        // Fixed size, so this compiles down to a plain load/store.
+        memcpy(dst, reinterpret_cast<const char*>(batch[i]) + offset, sizeof(FieldT));
+      }
+      return dst;
+    }
+
+    const char* copy_batch_from_mem(const char* src, Struct* const* batch, size_t n) override {
+      const int offset = this->_offset;
+      for (size_t i = 0; i < n; ++i, src += sizeof(FieldT)) {
+        memcpy(reinterpret_cast<char*>(batch[i]) + offset, src, sizeof(FieldT));
+      }
+      return src;
+    }
+
     size_t size(const Struct&) const override { return sizeof(FieldT); }
 
     std::string type() const override { return std::string(TypeStr<FieldT>::str); }
@@ -105,6 +128,28 @@ class FieldMemoryManagerT<Struct, VecT,
       memcpy(dstptr->data(), src, dstptr->size() * sizeof(typename VecT::value_type));
     }
 
+    char* copy_batch_to_mem(const Struct* const* batch, size_t n, char* dst) override {
+      const int offset = this->_offset;
+      for (size_t i = 0; i < n; ++i) {
+        const VecT* srcptr = reinterpret_cast<const VecT*>(reinterpret_cast<const char*>(batch[i]) + offset);
+        size_t bytes = srcptr->size() * sizeof(typename VecT::value_type);
+        memcpy(dst, srcptr->data(), bytes);
+        dst += bytes;
+      }
+      return dst;
+    }
+
+    const char* copy_batch_from_mem(const char* src, Struct* const* batch, size_t n) override {
+      const int offset = this->_offset;
+      for (size_t i = 0; i < n; ++i) {
+        VecT* dstptr = reinterpret_cast<VecT*>(reinterpret_cast<char*>(batch[i]) + offset);
+        size_t bytes = dstptr->size() * sizeof(typename VecT::value_type);
+        memcpy(dstptr->data(), src, bytes);
+        src += bytes;
+      }
+      return src;
+    }
+
     size_t size(const Struct& s) const override {
       const VecT* srcptr = reinterpret_cast<const VecT*>(reinterpret_cast<const char*>(&s) + this->_offset);
       return srcptr->size() * sizeof(typename VecT::value_type);
@@ -186,31 +231,38 @@ struct CopyItemT {
       p += mm->size(s);
       return p;
     }
+
+    char *CopyBatchToMem(const State* const* batch, size_t n, char *p) const {
+      return mm->copy_batch_to_mem(batch, n, p);
+    }
+
+    const char *CopyBatchFromMem(State* const* batch, size_t n, const char *p) const {
+      return mm->copy_batch_from_mem(p, batch, n);
+    }
 };
 
+// If max_batchsize > batch.size() (a partial batch), the remaining rows are zeroed,
+// so that stale samples from a previous batch never reach the model.
 template <typename State>
-void CopyToMem(const std::vector<CopyItemT<State>> &copier, const std::vector<State *> &batch) {
+void CopyToMem(const std::vector<CopyItemT<State>> &copier, const std::vector<State *> &batch, size_t max_batchsize = 0) {
   if (batch.empty()) return;
   for (const auto& item: copier) {
     m_assert(item.Check(*batch[0], batch.size()));
 
-    char *p = item.ptr();
-    for (auto* s: batch) {
-       p = item.CopyToMem(*s, p);
+    char *p = item.CopyBatchToMem(batch.data(), batch.size(), item.ptr());
+    if (max_batchsize > batch.size()) {
+       memset(p, 0, (max_batchsize - batch.size()) * item.mm->size(*batch[0]));
     }
   }
 }
 
 template <typename State>
-void CopyFromMem(const std::vector<CopyItemT<State>> &copier, std::vector<State *> &batch) {
+void CopyFromMem(const std::vector<CopyItemT<State>> &copier, std::vector<State *> &batch, size_t /*max_batchsize*/ = 0) {
   if (batch.empty()) return;
   for (const auto& item: copier) {
     m_assert(item.Check(*batch[0], batch.size()));
 
-    const char *p = item.ptr();
-    for (auto* s: batch) {
-       p = item.CopyFromMem(*s, p);
-    }
+    item.CopyBatchFromMem(batch.data(), batch.size(), item.ptr());
   }
 }
 
@@ -0,0 +1,289 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: fiber.h
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace elf {
+
+class FiberScheduler;
+
+// A user-space thread with its own stack. Fibers are created by a
+// FiberScheduler and stay on the worker thread they were spawned on, so
+// thread-affine state (thread_local variables, mutex ownership) remains valid
+// across a suspension.
+//
+// Code running in a fiber does not block its worker thread while waiting on
+// an elf::Parker (and therefore on SemaCollector, Semaphore and the
+// collectors). The fiber is suspended and the worker runs another one.
+class Fiber {
+public:
+    // The fiber running on this thread, or nullptr outside of fibers.
+    static Fiber *Current() { return current(); }
+
+    // Suspend the current fiber until Wake() is called. lock is released
+    // once the fiber has been switched out, so that whoever calls Wake()
+    // under the same mutex cannot resume a fiber that is still running.
+    void Suspend(std::unique_lock<std::mutex> *lock) {
+        _parked = true;
+        _unlock_after_switch = lock;
+        switch_out();
+    }
+
+    // Same as Suspend(), but the worker also resumes the fiber at deadline
+    // if Wake() has not been called by then. The caller tells the two apart
+    // by checking its condition and the clock.
+    inline void SuspendUntil(std::unique_lock<std::mutex> *lock, std::chrono::steady_clock::time_point deadline);
+
+    // Let other fibers on this worker run, then continue.
+    void Yield() {
+        _requeue_after_switch = true;
+        switch_out();
+    }
+
+    // Make a suspended fiber runnable. May be called from any thread.
+    // Returns false if the fiber had already been woken (by its timer).
+    inline bool Wake();
+
+private:
+    friend class FiberScheduler;
+
+    struct Worker;
+    using Timers = std::multimap<std::chrono::steady_clock::time_point, Fiber *>;
+
+    std::function<void ()> _func;
+    Worker *_worker;
+    ucontext_t _ctx;
+    char *_stack;
+    size_t _stack_size;
+    bool _done;
+
+    // Actions run by the worker right after the fiber is switched out.
+    std::unique_lock<std::mutex> *_unlock_after_switch;
+    bool _requeue_after_switch;
+
+    // True while suspended. Whoever resets it makes the fiber runnable, so
+    // that Wake() and the timer cannot both resume it.
+    std::atomic<bool> _parked;
+    // Pending timer of SuspendUntil() in Worker::timers, under the worker mutex.
+    Timers::iterator _timer;
+    bool _has_timer;
+
+    Fiber(std::function<void ()> func, Worker *worker, size_t stack_size)
+        : _func(std::move(func)), _worker(worker), _stack_size(stack_size), _done(false),
+          _unlock_after_switch(nullptr), _requeue_after_switch(false), _parked(false), _has_timer(false) {
+        // One guard page below the stack catches overflows. Pages are only
+        // committed when touched, so a large number of fibers is cheap.
+        const size_t page = sysconf(_SC_PAGESIZE);
+        void *p = mmap(nullptr, _stack_size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) throw std::range_error("Fiber: cannot allocate a stack of " + std::to_string(_stack_size) + " bytes");
+        mprotect(p, page, PROT_NONE);
+        _stack = static_cast<char *>(p);
+    }
+
+    ~Fiber() {
+        munmap(_stack, _stack_size + sysconf(_SC_PAGESIZE));
+    }
+
+    static Fiber *&current() {
+        static thread_local Fiber *fiber = nullptr;
+        return fiber;
+    }
+
+    static void entry() {
+        Fiber *self = current();
+        self->_func();
+        self->_done = true;
+        // Returning switches to uc_link, i.e., back to the worker.
+    }
+
+    inline void switch_out();
+};
+
+struct Fiber::Worker {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Fiber *> ready;
+    // Fibers in SuspendUntil(), by deadline.
+    Timers timers;
+    bool stop = false;
+    ucontext_t ctx;
+    std::thread thread;
+
+    void push(Fiber *f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.push_back(f);
+        }
+        cv.notify_one();
+    }
+
+    // Make the fibers whose deadline has passed runnable. Under mutex.
+    void fire_timers() {
+        if (timers.empty()) return;
+        const auto now = std::chrono::steady_clock::now();
+        while (! timers.empty() && timers.begin()->first <= now) {
+            Fiber *f = timers.begin()->second;
+            timers.erase(timers.begin());
+            f->_has_timer = false;
+            if (f->_parked.exchange(false)) ready.push_back(f);
+        }
+    }
+};
+
+inline void Fiber::switch_out() {
+    swapcontext(&_ctx, &_worker->ctx);
+}
+
+inline bool Fiber::Wake() {
+    if (! _parked.exchange(false)) return false;
+    _worker->push(this);
+    return true;
+}
+
+inline void Fiber::SuspendUntil(std::unique_lock<std::mutex> *lock, std::chrono::steady_clock::time_point deadline) {
+    _parked = true;
+    {
+        // The timer cannot fire before the switch: the worker is busy running us.
+        std::lock_guard<std::mutex> guard(_worker->mutex);
+        _timer = _worker->timers.emplace(deadline, this);
+        _has_timer = true;
+    }
+    _unlock_after_switch = lock;
+    switch_out();
+
+    std::lock_guard<std::mutex> guard(_worker->mutex);
+    if (_has_timer) {
+        _worker->timers.erase(_timer);
+        _has_timer = false;
+    }
+}
+
+// Runs fibers on a fixed number of worker threads (M:N scheduling).
+// Spawned fibers are assigned to workers round-robin.
+class FiberScheduler {
+public:
+    explicit FiberScheduler(int num_workers, size_t stack_size = 256 * 1024)
+        : _stack_size(stack_size), _next_worker(0), _num_alive(0) {
+        if (num_workers <= 0) throw std::range_error("FiberScheduler: num_workers must be positive");
+        for (int i = 0; i < num_workers; ++i) _workers.emplace_back(new Fiber::Worker());
+        for (auto &w : _workers) {
+            Fiber::Worker *worker = w.get();
+            worker->thread = std::thread([this, worker]() { run(worker); });
+        }
+    }
+
+    FiberScheduler(const FiberScheduler &) = delete;
+
+    void Spawn(std::function<void ()> func) {
+        Fiber::Worker *worker = _workers[_next_worker].get();
+        _next_worker = (_next_worker + 1) % _workers.size();
+
+        Fiber *f = new Fiber(std::move(func), worker, _stack_size);
+        getcontext(&f->_ctx);
+        f->_ctx.uc_stack.ss_sp = f->_stack + sysconf(_SC_PAGESIZE);
+        f->_ctx.uc_stack.ss_size = _stack_size;
+        f->_ctx.uc_link = &worker->ctx;
+        makecontext(&f->_ctx, &Fiber::entry, 0);
+
+        _num_alive ++;
+        worker->push(f);
+    }
+
+    int num_workers() const { return _workers.size(); }
+    int num_alive() const { return _num_alive.load(); }
+
+    // Wait until all fibers have returned, then stop the workers.
+    void Join() {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this]() { return _num_alive.load() == 0; });
+        }
+        for (auto &w : _workers) {
+            {
+                std::lock_guard<std::mutex> lock(w->mutex);
+                w->stop = true;
+            }
+            w->cv.notify_all();
+        }
+        for (auto &w : _workers) {
+            if (w->thread.joinable()) w->thread.join();
+        }
+    }
+
+    ~FiberScheduler() { Join(); }
+
+private:
+    size_t _stack_size;
+    std::vector<std::unique_ptr<Fiber::Worker>> _workers;
+    size_t _next_worker;
+
+    std::atomic<int> _num_alive;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+
+    void run(Fiber::Worker *worker) {
+        while (true) {
+            Fiber *f = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(worker->mutex);
+                while (true) {
+                    worker->fire_timers();
+                    if (! worker->ready.empty() || worker->stop) break;
+                    if (worker->timers.empty()) worker->cv.wait(lock);
+                    else worker->cv.wait_until(lock, worker->timers.begin()->first);
+                }
+                if (worker->ready.empty()) break;
+                f = worker->ready.front();
+                worker->ready.pop_front();
+            }
+
+            Fiber::current() = f;
+            swapcontext(&worker->ctx, &f->_ctx);
+            Fiber::current() = nullptr;
+
+            if (f->_unlock_after_switch != nullptr) {
+                auto *lock = f->_unlock_after_switch;
+                f->_unlock_after_switch = nullptr;
+                lock->unlock();
+            }
+            if (f->_requeue_after_switch) {
+                f->_requeue_after_switch = false;
+                worker->push(f);
+            }
+            if (f->_done) {
+                delete f;
+                if (-- _num_alive == 0) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _cv.notify_all();
+                }
+            }
+        }
+    }
+};
+
+}  // namespace elf
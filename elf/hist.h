@@ -57,55 +57,113 @@ public:
 
 namespace elf {
 
+namespace hist_internal {
+
+// Write one time step of a batch: states[j] goes to row rows[j] (row j if
+// rows is null) of a block of batchsize rows starting at p. Rows without a
+// state are zeroed. rows must be increasing. Returns the end of the block.
+template <typename State>
+char *CopyStepToMem(const CopyItemT<State> &item, const std::vector<const State *> &states,
+                    const std::vector<int> *rows, size_t batchsize, size_t row_bytes, char *p) {
+  char *end = p + batchsize * row_bytes;
+  if (rows == nullptr) {
+    p = item.CopyBatchToMem(states.data(), states.size(), p);
+    memset(p, 0, end - p);
+    return end;
+  }
+  // Consecutive rows are copied with one call.
+  size_t row = 0;
+  for (size_t j = 0; j < states.size(); ) {
+    size_t first = j ++;
+    while (j < states.size() && (*rows)[j] == (*rows)[j - 1] + 1) j ++;
+    memset(p + row * row_bytes, 0, ((*rows)[first] - row) * row_bytes);
+    item.CopyBatchToMem(states.data() + first, j - first, p + (*rows)[first] * row_bytes);
+    row = (*rows)[j - 1] + 1;
+  }
+  memset(p + row * row_bytes, 0, end - (p + row * row_bytes));
+  return end;
+}
+
 template <typename State>
-void CopyToMem(const std::vector<CopyItemT<State>> &copier, const std::vector<HistT<State> *> &batch) {
+const char *CopyStepFromMem(const CopyItemT<State> &item, const std::vector<State *> &states,
+                            const std::vector<int> *rows, size_t batchsize, size_t row_bytes, const char *p) {
+  if (rows == nullptr) {
+    item.CopyBatchFromMem(states.data(), states.size(), p);
+  } else {
+    for (size_t j = 0; j < states.size(); ) {
+      size_t first = j ++;
+      while (j < states.size() && (*rows)[j] == (*rows)[j - 1] + 1) j ++;
+      item.CopyBatchFromMem(states.data() + first, j - first, p + (*rows)[first] * row_bytes);
+    }
+  }
+  return p + batchsize * row_bytes;
+}
+
+// Per-thread scratch for the state pointers of a batch, so that copies do
+// not allocate once the largest batch has been seen.
+template <typename T>
+std::vector<T *> &StatePtrs(size_t n) {
+  thread_local std::vector<T *> ptrs;
+  ptrs.resize(n);
+  return ptrs;
+}
+
+}  // namespace hist_internal
+
+// Buffers are laid out as [T, max_batchsize, ...]. For a partial batch
+// (batch.size() < max_batchsize) the unused rows of each time step are zeroed.
+// If rows is given, batch[j] is placed in row rows[j] instead of row j.
+template <typename State>
+void CopyToMem(const std::vector<CopyItemT<State>> &copier, const std::vector<HistT<State> *> &batch, size_t max_batchsize = 0,
+               const std::vector<int> *rows = nullptr) {
   if (batch.empty()) return;
-  size_t batchsize = batch.size();
+  size_t batchsize = std::max(batch.size(), max_batchsize);
   size_t overall_hist_len = batch[0]->size();
+  // States of one time step, gathered across the batch.
+  std::vector<const State *> &states = hist_internal::StatePtrs<const State>(batch.size());
+  auto gather = [&](size_t i) {
+    for (size_t j = 0; j < batch.size(); ++j) states[j] = &batch[j]->newest(i);
+  };
 
   for (const auto& item: copier) {
     size_t capacity = item.Capacity(batch[0]->newest());
     size_t hist_len = capacity / batchsize;
     size_t min_hist_len = std::min(hist_len, overall_hist_len);
+    size_t row_bytes = item.mm->size(batch[0]->newest());
 
     char *p = item.ptr();
-    // std::cout << "key = " << item.key << ". p = " << std::hex << (void *)p << std::dec << " min_hist_len = " << min_hist_len << std::endl;
-    //
     for (size_t t = 0; t < min_hist_len; ++t) {
-      for (auto* s: batch) {
-        const State &state = s->newest(min_hist_len - t - 1);
-        p = item.CopyToMem(state, p);
-      }
+      gather(min_hist_len - t - 1);
+      p = hist_internal::CopyStepToMem(item, states, rows, batchsize, row_bytes, p);
     }
     if (hist_len > overall_hist_len) {
       // Fill them with the oldest hist.
+      gather(min_hist_len - 1);
       for (size_t i = overall_hist_len; i < hist_len; ++i) {
-        for (auto *s: batch) {
-          const State &state = s->newest(min_hist_len - 1);
-          p = item.CopyToMem(state, p);
-        }
+        p = hist_internal::CopyStepToMem(item, states, rows, batchsize, row_bytes, p);
       }
     }
   }
 }
 
 template <typename State>
-void CopyFromMem(const std::vector<CopyItemT<State>> &copier, std::vector<HistT<State> *> &batch) {
+void CopyFromMem(const std::vector<CopyItemT<State>> &copier, std::vector<HistT<State> *> &batch, size_t max_batchsize = 0,
+                 const std::vector<int> *rows = nullptr) {
   if (batch.empty()) return;
-  size_t batchsize = batch.size();
+  size_t batchsize = std::max(batch.size(), max_batchsize);
   size_t overall_hist_len = batch[0]->size();
+  std::vector<State *> &states = hist_internal::StatePtrs<State>(batch.size());
 
   for (const auto& item: copier) {
     size_t capacity = item.Capacity(batch[0]->newest());
     size_t hist_len = capacity / batchsize;
     size_t min_hist_len = std::min(hist_len, overall_hist_len);
+    size_t row_bytes = item.mm->size(batch[0]->newest());
 
     const char *p = item.ptr();
     for (size_t t = 0; t < min_hist_len; ++t) {
-      for (auto* s: batch) {
-         State &state = s->newest(min_hist_len - t - 1);
-         p = item.CopyFromMem(state, p);
-       }
+      for (size_t j = 0; j < batch.size(); ++j) states[j] = &batch[j]->newest(min_hist_len - t - 1);
+      p = hist_internal::CopyStepFromMem(item, states, rows, batchsize, row_bytes, p);
     }
   }
 }
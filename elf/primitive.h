@@ -4,6 +4,8 @@
 #include <condition_variable>
 #include <mutex>
 
+#include "wait_policy.h"
+
 template <typename T>
 using CCQueue2 = moodycamel::BlockingConcurrentQueue<T>;
 
@@ -55,36 +57,33 @@ using CCQueue2 = moodycamel::BlockingConcurrentQueue<T>;
 
 class SemaCollector {
 private:
-    int _count;
-    std::mutex _mutex;
-    std::condition_variable _cv;
+    std::atomic<int> _count;
+    elf::WaitPolicy _policy;
+    elf::Parker _parker;
 
 public:
-    SemaCollector() : _count(0) { }
+    explicit SemaCollector(const elf::WaitPolicy &policy = elf::WaitPolicy())
+      : _count(0), _policy(policy) { }
+
+    void set_wait_policy(const elf::WaitPolicy &policy) { _policy = policy; }
 
     inline void notify() {
-        std::unique_lock<std::mutex> lock(_mutex);
         _count ++;
-        _cv.notify_one();
+        _parker.notify_one();
     }
 
     inline int wait(int expected_count, int usec = 0) {
-        if (expected_count == 0) return _count;
-
-        std::unique_lock<std::mutex> lock(_mutex);
-        if (usec == 0) {
-            _cv.wait(lock, [this, expected_count]() { return _count >= expected_count; });
-        } else {
-            _cv.wait_for(lock, std::chrono::microseconds(usec),
-                [this, expected_count]() { return _count >= expected_count; });
-        }
-        return _count;
+        if (expected_count == 0) return _count.load();
+
+        auto ready = [this, expected_count]() { return _count.load() >= expected_count; };
+        if (usec == 0) _parker.wait(_policy, ready);
+        else _parker.wait_for(_policy, usec, ready);
+        return _count.load();
     }
 
     inline void reset() {
-        std::unique_lock<std::mutex> lock(_mutex);
         _count = 0;
-        _cv.notify_all();
+        _parker.notify_all();
     }
 };
 
@@ -121,39 +120,44 @@ public:
 template <typename T>
 class Semaphore {
 private:
-    bool _flag;
+    std::atomic_bool _flag;
     T _val;
+    // Protects _val against a notify() racing with a reader.
     std::mutex _mutex;
-    std::condition_variable _cv;
+    elf::WaitPolicy _policy;
+    elf::Parker _parker;
 
-    inline void _raw_wait(std::unique_lock<std::mutex> &lock, int usec) {
-        if (usec == 0) {
-            _cv.wait(lock, [this]() { return _flag; });
-        } else {
-            _cv.wait_for(lock, std::chrono::microseconds(usec),  [this]() { return _flag; });
-        }
+    inline void _raw_wait(int usec) {
+        auto ready = [this]() { return _flag.load(); };
+        if (usec == 0) _parker.wait(_policy, ready);
+        else _parker.wait_for(_policy, usec, ready);
     }
 
 public:
-    Semaphore() : _flag(false) { }
+    explicit Semaphore(const elf::WaitPolicy &policy = elf::WaitPolicy())
+      : _flag(false), _policy(policy) { }
+
+    void set_wait_policy(const elf::WaitPolicy &policy) { _policy = policy; }
 
     inline void notify(T val) {
-        std::unique_lock<std::mutex> lock(_mutex);
-        _flag = true;
-        _val = val;
-        _cv.notify_one();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _val = val;
+            _flag = true;
+        }
+        _parker.notify_all();
     }
 
     inline bool wait(T *val, int usec = 0) {
-        std::unique_lock<std::mutex> lock(_mutex);
-        _raw_wait(lock, usec);
+        _raw_wait(usec);
+        std::lock_guard<std::mutex> lock(_mutex);
         if (_flag) *val = _val;
         return _flag;
     }
 
     inline bool wait_and_reset(T *val, int usec = 0) {
-        std::unique_lock<std::mutex> lock(_mutex);
-        _raw_wait(lock, usec);
+        _raw_wait(usec);
+        std::lock_guard<std::mutex> lock(_mutex);
         bool last_flag = _flag;
         if (_flag) *val = _val;
         _flag = false;
@@ -161,7 +165,7 @@ public:
     }
 
     inline void reset() {
-        std::unique_lock<std::mutex> lock(_mutex);
+        std::lock_guard<std::mutex> lock(_mutex);
         _flag = false;
     }
 };
@@ -32,6 +32,11 @@ void register_common_func(py::module &m) {
 
   PYCLASS_WITH_FIELDS(m, Infos);
 
+  PYCLASS_WITH_FIELDS(m, ReplayBufferOptions)
+    .def(py::init<>());
+
+  PYCLASS_WITH_FIELDS(m, ReplaySample);
+
   PYCLASS_WITH_FIELDS(m, State);
 
   using HistState = HistT<State>;
@@ -63,9 +68,21 @@ void register_common_func(py::module &m) {
   EntryInfo GetTensorSpec(int gid, const std::string &key, int T) { \
       return context->comm().GetCollectorGroup(gid).GetEntry(key, T, [&](const std::string &key) { return EntryFunc(key); }); \
   } \
-  void AddTensor(int gid, const std::string &input_reply, const EntryInfo &e) { \
-      context->comm().GetCollectorGroup(gid).AddEntry(input_reply, e); \
+  void AddTensor(int gid, const std::string &input_reply, const EntryInfo &e, int slot) { \
+      context->comm().GetCollectorGroup(gid).AddEntry(input_reply, e, slot); \
+  } \
+\
+  void AddReplayBuffer(int gid, const ReplayBufferOptions &options) { \
+      context->comm().GetCollectorGroup(gid).AddReplayBuffer(options); \
+  } \
+  EntryInfo GetReplayTensorSpec(int gid, const std::string &key, int T) { \
+      return context->comm().GetCollectorGroup(gid).GetReplayEntry(key, T, [&](const std::string &key) { return EntryFunc(key); }); \
+  } \
+  ReplaySample SampleReplay(int gid) { return context->comm().GetCollectorGroup(gid).SampleReplay(); } \
+  void UpdateReplayPriorities(int gid, const std::vector<int64_t> &idx, const std::vector<float> &priorities) { \
+      context->comm().GetCollectorGroup(gid).UpdateReplayPriorities(idx, priorities); \
   } \
+  int GetReplaySize(int gid) const { return context->comm().GetCollectorGroup(gid).GetReplaySize(); } \
 
 
 #define CONTEXT_REGISTER(GameContext) \
@@ -82,6 +99,11 @@ void register_common_func(py::module &m) {
     .def("Start", &GameContext::Start) \
     .def("Stop", &GameContext::Stop) \
     .def("__len__", &GameContext::size) \
-    .def("AddTensor", &GameContext::AddTensor) \
+    .def("AddTensor", &GameContext::AddTensor, py::arg("gid"), py::arg("input_reply"), py::arg("e"), py::arg("slot") = 0) \
     .def("GetTensorSpec", &GameContext::GetTensorSpec, py::return_value_policy::copy) \
+    .def("AddReplayBuffer", &GameContext::AddReplayBuffer) \
+    .def("GetReplayTensorSpec", &GameContext::GetReplayTensorSpec, py::return_value_policy::copy) \
+    .def("SampleReplay", &GameContext::SampleReplay, py::call_guard<py::gil_scoped_release>()) \
+    .def("UpdateReplayPriorities", &GameContext::UpdateReplayPriorities, py::call_guard<py::gil_scoped_release>()) \
+    .def("GetReplaySize", &GameContext::GetReplaySize) \
 
@@ -15,6 +15,7 @@
 #include <string>
 
 #include "pybind_helper.h"
+#include "wait_policy.h"
 
 struct ContextOptions {
     // How many simulation threads we are running.
@@ -33,8 +34,24 @@ struct ContextOptions {
     // Whether we wait for each group or we wait jointly.
     bool wait_per_group = false;
 
+    // How game threads and collectors wait for each other: "block", "spin" or "spin_park".
+    // See elf/wait_policy.h.
+    std::string wait_policy = "block";
+    // Spin iterations before parking, for "spin_park".
+    int wait_spin_count = 2000;
+
+    // If > 0, games run as fibers multiplexed onto this many threads instead
+    // of one thread per game. A game then yields its thread while it waits
+    // for a reply. Games that block outside of elf (e.g., in third-party
+    // code) must keep the thread-per-game mode (0).
+    int num_game_threads = 0;
+    // Stack size of each game fiber, in KB.
+    int fiber_stack_kb = 256;
+
     ContextOptions() {}
 
+    elf::WaitPolicy GetWaitPolicy() const { return elf::WaitPolicy::Parse(wait_policy, wait_spin_count); }
+
     void print() const {
       std::cout << "#Game: " << num_games << std::endl;
       std::cout << "#Max_thread: " << max_num_threads << std::endl;
@@ -42,9 +59,13 @@ struct ContextOptions {
       if (verbose_comm) std::cout << "Comm Verbose On" << std::endl;
       if (verbose_collector) std::cout << "Comm Collector On" << std::endl;
       std::cout << "Wait per group: " << (wait_per_group ? "True" : "False") << std::endl;
+      std::cout << "Wait policy: " << wait_policy;
+      if (wait_policy == "spin_park") std::cout << " [spin=" << wait_spin_count << "]";
+      std::cout << std::endl;
+      if (num_game_threads > 0) std::cout << "Games run as fibers on " << num_game_threads << " threads [stack=" << fiber_stack_kb << "KB]" << std::endl;
     }
 
-    REGISTER_PYBIND_FIELDS(num_games, max_num_threads, T, verbose_comm, verbose_collector, wait_per_group);
+    REGISTER_PYBIND_FIELDS(num_games, max_num_threads, T, verbose_comm, verbose_collector, wait_per_group, wait_policy, wait_spin_count, num_game_threads, fiber_stack_kb);
 };
 
 inline constexpr int get_query_id(int game_id, int thread_id) {
@@ -0,0 +1,283 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: replay_buffer.h
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "copier.hh"
+#include "hist.h"
+#include "pybind_helper.h"
+
+struct ReplayBufferOptions {
+    // Total number of entries. Each entry is one HistT, i.e., T frames.
+    int capacity;
+    // Entries are split into shards with their own lock, so that inserts
+    // from collectors and sampling from Python rarely contend.
+    int num_shards;
+    // Number of entries per SampleReplay().
+    int batchsize;
+    // Prioritized sampling: P(i) ~ priority_i^alpha. Uniform if false.
+    bool prioritized;
+    float alpha;
+    // Exponent of the importance sampling weights (N * P(i))^-beta.
+    float beta;
+    int seed;
+
+    ReplayBufferOptions() : capacity(100000), num_shards(8), batchsize(128), prioritized(false), alpha(0.6), beta(0.4), seed(0) { }
+
+    std::string info() const {
+        return "[capacity=" + std::to_string(capacity) + "][num_shards=" + std::to_string(num_shards) + "][batchsize=" + std::to_string(batchsize)
+            + "][prioritized=" + (prioritized ? "True" : "False") + "][alpha=" + std::to_string(alpha) + "][beta=" + std::to_string(beta) + "]";
+    }
+
+    REGISTER_PYBIND_FIELDS(capacity, num_shards, batchsize, prioritized, alpha, beta, seed);
+};
+
+// Returned by a sample. Entries are identified by idx when priorities are updated.
+struct ReplaySample {
+    int batchsize;
+    std::vector<int64_t> idx;
+    // Importance sampling weights, normalized to a maximum of 1. All 1 for uniform sampling.
+    std::vector<float> weight;
+
+    ReplaySample() : batchsize(0) { }
+
+    REGISTER_PYBIND_FIELDS(batchsize, idx, weight);
+};
+
+namespace elf {
+
+// Binary tree of partial sums over a fixed number of leaves.
+// Set() and Find() are O(log n).
+class SumTree {
+public:
+    explicit SumTree(size_t n) : _n(1) {
+        while (_n < n) _n *= 2;
+        _nodes.assign(2 * _n, 0.0);
+    }
+
+    void Set(size_t i, double v) {
+        size_t k = i + _n;
+        double delta = v - _nodes[k];
+        for (; k >= 1; k /= 2) _nodes[k] += delta;
+    }
+    double Get(size_t i) const { return _nodes[i + _n]; }
+    double total() const { return _nodes[1]; }
+
+    // The leaf i such that sum(leaf[0..i)) <= mass < sum(leaf[0..i]).
+    size_t Find(double mass) const {
+        size_t k = 1;
+        while (k < _n) {
+            if (mass < _nodes[2 * k] || _nodes[2 * k + 1] <= 0) k = 2 * k;
+            else {
+                mass -= _nodes[2 * k];
+                k = 2 * k + 1;
+            }
+        }
+        return k - _n;
+    }
+
+private:
+    size_t _n;
+    std::vector<double> _nodes;
+};
+
+// Stores the HistT of samples that went through a collector group, and
+// produces training batches from them into buffers bound like the ones of
+// the group (layout [T, batchsize, ...]).
+template <typename State>
+class ReplayBufferT {
+public:
+    using CopyItem = CopyItemT<State>;
+
+    explicit ReplayBufferT(const ReplayBufferOptions &options)
+        : _options(options), _next_shard(0), _rng(options.seed) {
+        if (options.capacity <= 0 || options.num_shards <= 0 || options.batchsize <= 0)
+            throw std::range_error("ReplayBuffer: capacity, num_shards and batchsize must be positive. " + options.info());
+        const int num_shards = std::min(options.num_shards, options.capacity);
+        _shard_capacity = (options.capacity + num_shards - 1) / num_shards;
+        for (int i = 0; i < num_shards; ++i) _shards.emplace_back(new Shard(_shard_capacity));
+    }
+
+    const ReplayBufferOptions &options() const { return _options; }
+
+    void AddEntry(const std::string &key, const SharedBuffer &buf) {
+        auto *mm = State::get_mm(key);
+        if (mm == nullptr) throw std::range_error("ReplayBuffer: unknown key " + key);
+        _copier.emplace_back(key, buf, mm);
+    }
+
+    // Called by the collector group before the games are resumed. All
+    // entries of a batch go to the same shard.
+    void Add(const std::vector<HistT<State> *> &batch) {
+        if (batch.empty()) return;
+        Shard &shard = *_shards[_next_shard.fetch_add(1) % _shards.size()];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const HistT<State> *h : batch) {
+            const size_t pos = shard.next;
+            shard.next = (shard.next + 1) % _shard_capacity;
+            if (shard.size < _shard_capacity) shard.size ++;
+
+            // Oldest frame first. Assignment reuses the memory of the entry
+            // that is overwritten.
+            std::vector<State> &frames = shard.entries[pos];
+            const int T = h->size();
+            frames.resize(T);
+            for (int t = 0; t < T; ++t) frames[t] = h->newest(T - t - 1);
+
+            if (_options.prioritized) shard.tree.Set(pos, shard.max_priority);
+        }
+    }
+
+    size_t size() const {
+        size_t n = 0;
+        for (const auto &shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            n += shard->size;
+        }
+        return n;
+    }
+
+    // Fill the bound buffers with options().batchsize entries. Returns an
+    // empty sample if the buffer is empty. Not thread-safe against other
+    // Sample() calls.
+    ReplaySample Sample() {
+        ReplaySample res;
+        const int batchsize = _options.batchsize;
+
+        // Mass (or size) of each shard. Inserts may add more in the meantime,
+        // which is harmless.
+        std::vector<double> mass(_shards.size());
+        std::vector<size_t> sizes(_shards.size());
+        double total = 0;
+        size_t total_size = 0;
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            std::lock_guard<std::mutex> lock(_shards[i]->mutex);
+            sizes[i] = _shards[i]->size;
+            mass[i] = _options.prioritized ? _shards[i]->tree.total() : sizes[i];
+            total += mass[i];
+            total_size += sizes[i];
+        }
+        if (total_size == 0 || total <= 0) return res;
+
+        // Stratified: one draw per equal segment of the total mass.
+        std::vector<std::vector<std::pair<double, int>>> draws(_shards.size());
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        const double segment = total / batchsize;
+        size_t shard_idx = 0;
+        double shard_start = 0;
+        for (int i = 0; i < batchsize; ++i) {
+            double m = std::min((i + uniform(_rng)) * segment, std::nextafter(total, 0.0));
+            while (shard_idx + 1 < _shards.size() && m >= shard_start + mass[shard_idx]) {
+                shard_start += mass[shard_idx];
+                shard_idx ++;
+            }
+            draws[shard_idx].emplace_back(m - shard_start, i);
+        }
+
+        res.batchsize = batchsize;
+        res.idx.resize(batchsize);
+        res.weight.assign(batchsize, 1.0f);
+
+        for (size_t s = 0; s < _shards.size(); ++s) {
+            if (draws[s].empty()) continue;
+            Shard &shard = *_shards[s];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto &d : draws[s]) {
+                size_t pos;
+                if (_options.prioritized) {
+                    pos = std::min(shard.tree.Find(d.first), std::max(shard.size, (size_t)1) - 1);
+                    double p = shard.tree.Get(pos) / total;
+                    res.weight[d.second] = p > 0 ? std::pow(total_size * p, -_options.beta) : 1.0f;
+                } else {
+                    pos = std::min((size_t)d.first, shard.size - 1);
+                }
+                res.idx[d.second] = s * _shard_capacity + pos;
+                // Copied under the lock, so the entry cannot be overwritten halfway.
+                copy_to_mem(shard.entries[pos], d.second, batchsize);
+            }
+        }
+
+        if (_options.prioritized) {
+            float max_w = *std::max_element(res.weight.begin(), res.weight.end());
+            for (float &w : res.weight) w /= max_w;
+        }
+        return res;
+    }
+
+    // priorities are |TD error| or similar; they are raised to alpha here.
+    void UpdatePriorities(const std::vector<int64_t> &idx, const std::vector<float> &priorities) {
+        if (! _options.prioritized) return;
+        if (idx.size() != priorities.size())
+            throw std::range_error("ReplayBuffer: #idx = " + std::to_string(idx.size()) + " but #priorities = " + std::to_string(priorities.size()));
+        const double eps = 1e-6;
+        for (size_t i = 0; i < idx.size(); ++i) {
+            if (idx[i] < 0 || idx[i] >= (int64_t)(_shards.size() * _shard_capacity)) continue;
+            Shard &shard = *_shards[idx[i] / _shard_capacity];
+            const size_t pos = idx[i] % _shard_capacity;
+            const double p = std::pow(std::abs(priorities[i]) + eps, _options.alpha);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (pos >= shard.size) continue;
+            shard.tree.Set(pos, p);
+            shard.max_priority = std::max(shard.max_priority, p);
+        }
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<std::vector<State>> entries;
+        size_t next = 0;
+        size_t size = 0;
+        SumTree tree;
+        // New entries get the largest priority seen so far, so that they are
+        // sampled at least once soon.
+        double max_priority = 1.0;
+
+        explicit Shard(size_t capacity) : entries(capacity), tree(capacity) { }
+    };
+
+    ReplayBufferOptions _options;
+    size_t _shard_capacity;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<size_t> _next_shard;
+
+    std::mt19937 _rng;
+    std::vector<CopyItem> _copier;
+
+    // Write one entry to row i of every bound buffer. Same layout as
+    // CopyToMem of a HistT batch: [T, batchsize, ...], oldest frame first.
+    void copy_to_mem(const std::vector<State> &frames, int i, int batchsize) const {
+        const int n = frames.size();
+        for (const auto &item : _copier) {
+            const size_t frame_bytes = item.mm->size(frames.back());
+            const int hist_len = item.buf.size() / (frame_bytes * batchsize);
+            const int min_hist_len = std::min(hist_len, n);
+            for (int t = 0; t < hist_len; ++t) {
+                // Like CopyToMem, extra time steps repeat the oldest frame.
+                const State &frame = frames[n - min_hist_len + (t < min_hist_len ? t : 0)];
+                item.CopyToMem(frame, item.ptr() + (t * batchsize + i) * frame_bytes);
+            }
+        }
+    }
+};
+
+}  // namespace elf
@@ -10,6 +10,7 @@
 //File: state_collector.h
 
 #pragma once
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
@@ -27,15 +28,20 @@
 #include "primitive.h"
 #include "collector.hh"
 #include "hist.h"
+#include "replay_buffer.h"
 
 struct Infos {
     int gid;
+    // Number of valid samples. Can be smaller than the batchsize of the group
+    // if the group has a timeout; the rest of the input buffers are zeroed.
     int batchsize;
+    // Which buffer set of the group holds the batch.
+    int slot;
 
-    Infos(int gid, int batchsize) : gid(gid), batchsize(batchsize) { }
-    Infos() : gid(-1), batchsize(0) { }
+    Infos(int gid, int batchsize, int slot = 0) : gid(gid), batchsize(batchsize), slot(slot) { }
+    Infos() : gid(-1), batchsize(0), slot(0) { }
 
-    REGISTER_PYBIND_FIELDS(gid, batchsize);
+    REGISTER_PYBIND_FIELDS(gid, batchsize, slot);
 };
 
 class SyncSignal {
@@ -59,9 +65,9 @@ public:
         _queue_per_group.resize(num_groups);
     }
 
-    void push(int gid, int batchsize) {
-        if (_queue_per_group.empty() || gid == -1) _queue.enqueue(Infos(gid, batchsize));
-        else _queue_per_group[gid].enqueue(Infos(gid, batchsize));
+    void push(int gid, int batchsize, int slot = 0) {
+        if (_queue_per_group.empty() || gid == -1) _queue.enqueue(Infos(gid, batchsize, slot));
+        else _queue_per_group[gid].enqueue(Infos(gid, batchsize, slot));
     }
 
     // From the main thread.
@@ -137,6 +143,12 @@ struct EntryInfo {
 };
 
 // Each collector group has a batch collector and a sequence of operators.
+// A group owns num_slots sets of batch buffers. While Python works on the
+// batch in one slot, the next batch is gathered and copied into another.
+// Slots are released by Steps() and may be released in any order.
+// With fixed rows, each game keeps the same row of the batch for the whole
+// run (e.g., so that recurrent states can stay in place on the model side),
+// and the "valid" input tells which rows hold a sample.
 template <typename In>
 class CollectorGroupT {
 public:
@@ -147,59 +159,180 @@ public:
     using EntryFunc = std::function<EntryInfo (const std::string &key)>;
 
 private:
+    struct Slot {
+        std::vector<In *> batch;
+        std::vector<Data *> batch_data;
+        // Batchsize the buffers were filled with.
+        int batchsize = 0;
+
+        std::vector<CopyItem> copier_input;
+        std::vector<CopyItem> copier_reply;
+
+        // With fixed rows: the row of each sample (increasing), and an
+        // optional mask buffer with 1 for the rows that hold a sample.
+        std::vector<int> rows;
+        elf::SharedBuffer valid{(void *)nullptr, 0};
+
+        // True from send_batch() until the daemon gives the slot back.
+        std::atomic<bool> held{false};
+    };
+
     const int _gid;
     // Here batchsize can be changed on demand.
     int _batchsize;
+    // If > 0, emit a partial batch once this much time has passed since its first sample.
+    int _timeout_usec;
     CCQueue2<int> _batchsize_q;
     Semaphore<int> _batchsize_back;
 
-    // Current batch.
-    std::vector<In *> _batch;
-    std::vector<Data *> _batch_data;
     elf::BatchCollectorT<Key, In> _batch_collector;
 
-    std::vector<CopyItem> _copier_input;
-    std::vector<CopyItem> _copier_reply;
+    std::vector<Slot> _slots;
+    // Slots not held by Python.
+    moodycamel::ConcurrentQueue<int> _free_slots;
+    // Slots given back by Python, whose replies are still to be put back.
+    moodycamel::ConcurrentQueue<int> _returned_slots;
+    elf::WaitPolicy _policy;
+    elf::Parker _slot_parker;
+    elf::Parker _returned_parker;
 
     SyncSignal *_signal;
 
+    // If true, every game is given a row of the batch the first time it
+    // reports to this group, and its samples always go to that row.
+    bool _fixed_rows;
+    // Batchsize the buffers were laid out with. Rows stay within it even if
+    // the batchsize is lowered later (e.g., by PrepareStop()).
+    const int _row_capacity;
+    std::unordered_map<Key, int> _rows;
+    std::vector<std::pair<int, In *>> _sorted;
+
+    // If set, every sample of the group is also stored for replay.
+    std::unique_ptr<elf::ReplayBufferT<State>> _replay;
+
     bool _verbose;
 
     // Statistics
     int _num_enqueue;
 
-    // Wakeup signal.
-    Semaphore<int> _wakeup;
+    int acquire_slot() {
+        int slot = -1;
+        _slot_parker.wait(_policy, [this, &slot]() { return _free_slots.try_dequeue(slot); });
+        return slot;
+    }
+
+    void send_batch(int slot, int batchsize) {
+        _slots[slot].held = true;
+        _signal->push(_gid, batchsize, slot);
+    }
+
+    int wait_returned_slot() {
+        int slot = -1;
+        _returned_parker.wait(_policy, [this, &slot]() { return _returned_slots.try_dequeue(slot); });
+        return slot;
+    }
+
+    // Put the replies of the batch in slot back, resume its games and give
+    // the slot back to the collector.
+    void put_replies(int slot) {
+        Slot &s = _slots[slot];
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] PutReplies()");
+
+        elf::CopyFromMem(s.copier_reply, s.batch_data, s.batchsize, _fixed_rows ? &s.rows : nullptr);
+        // Store the samples together with their replies before the games overwrite them.
+        if (_replay != nullptr) _replay->Add(s.batch_data);
+
+        // Finally make the game run again.
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] Resume games");
+        for (In *in : s.batch) {
+            const Key& key = in->meta.query_id;
+            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Resume signal sent to k = " << key);
+            _batch_collector.signalReply(key);
+        }
 
-    void send_batch(int batchsize) {
-        _wakeup.reset();
-        _signal->push(_gid, batchsize);
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] All resume signal sent, batchsize = " << s.batch.size());
+        _free_slots.enqueue(slot);
+        _slot_parker.notify_one();
     }
 
-    int wait_batch_used() {
-        int future_timeout;
-        _wakeup.wait(&future_timeout);
-        return future_timeout;
+    // Order the batch by row and fill the mask. Only the collector thread
+    // touches _rows.
+    void assign_rows(Slot &s) {
+        auto &sorted = _sorted;
+        sorted.clear();
+        for (In *in : s.batch) {
+            auto it = _rows.find(in->meta.query_id);
+            if (it == _rows.end()) it = _rows.emplace(in->meta.query_id, _rows.size()).first;
+            if (it->second >= _row_capacity) {
+                elf::error_exit("CollectorGroup: [" + std::to_string(_gid) + "] game " + std::to_string(in->meta.query_id)
+                    + " has row " + std::to_string(it->second) + " but batchsize = " + std::to_string(_row_capacity)
+                    + ". With fixed rows, batchsize must be at least the number of games sending to the group.");
+            }
+            sorted.emplace_back(it->second, in);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<int, In *> &a, const std::pair<int, In *> &b) { return a.first < b.first; });
+
+        unsigned char *valid = static_cast<unsigned char *>(s.valid.ptr());
+        if (valid != nullptr) memset(valid, 0, s.valid.size());
+        s.rows.clear();
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            s.rows.push_back(sorted[i].first);
+            s.batch[i] = sorted[i].second;
+            if (valid != nullptr && (size_t)sorted[i].first < s.valid.size()) valid[sorted[i].first] = 1;
+        }
     }
 
 public:
-    CollectorGroupT(int gid, const std::vector<Key> &keys, int batchsize, SyncSignal *signal, bool verbose)
-        : _gid(gid), _batchsize(batchsize), _batch_collector(keys), _signal(signal), _verbose(verbose) {
+    CollectorGroupT(int gid, const std::vector<Key> &keys, int batchsize, SyncSignal *signal, bool verbose,
+                    const elf::WaitPolicy &policy = elf::WaitPolicy(), int timeout_usec = 0, int num_slots = 1, bool fixed_rows = false)
+        : _gid(gid), _batchsize(batchsize), _timeout_usec(timeout_usec), _batchsize_back(policy), _batch_collector(keys, policy),
+          _slots(std::max(num_slots, 1)), _policy(policy), _signal(signal), _fixed_rows(fixed_rows), _row_capacity(batchsize), _verbose(verbose) {
+        for (size_t i = 0; i < _slots.size(); ++i) _free_slots.enqueue(i);
     }
 
     EntryInfo GetEntry(const std::string &key, int hist_len, EntryFunc entry_func) const {
         if (key.empty()) return EntryInfo();
+        // One byte per row, 1 if the row holds a sample of the current batch.
+        if (_fixed_rows && key == "valid") return EntryInfo(key, "unsigned char", { _batchsize });
 
         EntryInfo entry_info = entry_func(key);
         entry_info.SetBatchSizeAndHistory(_batchsize, hist_len);
         return entry_info;
     }
 
-    void AddEntry(const std::string &input_reply, const EntryInfo &e) {
+    void AddReplayBuffer(const ReplayBufferOptions &options) {
+        _replay.reset(new elf::ReplayBufferT<State>(options));
+    }
+
+    // Spec of a tensor filled by SampleReplay(): [hist_len, replay batchsize, ...].
+    EntryInfo GetReplayEntry(const std::string &key, int hist_len, EntryFunc entry_func) const {
+        if (key.empty() || _replay == nullptr) return EntryInfo();
+
+        EntryInfo entry_info = entry_func(key);
+        entry_info.SetBatchSizeAndHistory(_replay->options().batchsize, hist_len);
+        return entry_info;
+    }
+
+    // input_reply is "input", "reply", or "replay" for the output of SampleReplay().
+    void AddEntry(const std::string &input_reply, const EntryInfo &e, int slot = 0) {
+        if (input_reply == "replay") {
+            if (_replay == nullptr) throw std::range_error("Group " + std::to_string(_gid) + " has no replay buffer");
+            _replay->AddEntry(e.key, elf::SharedBuffer(e.p, e.byte_size));
+            return;
+        }
+        if (slot < 0 || slot >= (int)_slots.size())
+            throw std::range_error("Slot " + std::to_string(slot) + " out of range, #slots = " + std::to_string(_slots.size()));
+
+        if (input_reply == "input" && e.key == "valid") {
+            if (! _fixed_rows) throw std::range_error("Group " + std::to_string(_gid) + " has no fixed rows, so no valid mask");
+            _slots[slot].valid = elf::SharedBuffer(e.p, e.byte_size);
+            return;
+        }
+
         std::vector<CopyItem> *copier = nullptr;
 
-        if (input_reply == "input") copier = &_copier_input;
-        else if (input_reply == "reply") copier = &_copier_reply;
+        if (input_reply == "input") copier = &_slots[slot].copier_input;
+        else if (input_reply == "reply") copier = &_slots[slot].copier_reply;
         else throw std::range_error("Unknown input_reply " + input_reply);
 
         auto *mm = State::get_mm(e.key);
@@ -208,6 +341,8 @@ public:
     }
 
     int gid() const { return _gid; }
+    int num_slots() const { return _slots.size(); }
+    bool fixed_rows() const { return _fixed_rows; }
 
     void SetBatchSize(int batchsize) {
         // std::cout << "Before send batchsize " << batchsize << std::endl;
@@ -233,7 +368,7 @@ public:
 
     // Main Loop
     void MainLoop() {
-        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Starting MainLoop of collector, batchsize = " << _batchsize);
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Starting MainLoop of collector, batchsize = " << _batchsize << " #slots = " << _slots.size());
         while (true) {
             // Wait until we have a complete batch.
             int new_batchsize;
@@ -243,56 +378,97 @@ public:
                 _batchsize_back.notify(0);
                 // std::cout << "CollectorGroup: After notification. batchsize = " << _batchsize << std::endl;
             }
-            _batch = _batch_collector.waitBatch(_batchsize);
-            _batch_data.clear();
-            for (In *b : _batch) {
-                _batch_data.push_back(&b->data);
-            }
-
-            // Time to leave the loop.
-            if (_batch.size() == 1 && _batch[0] == nullptr) break;
 
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Compute input. batchsize = " << _batch.size());
+            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Wait for a free slot");
+            int slot = acquire_slot();
+            Slot &s = _slots[slot];
 
-            elf::CopyToMem(_copier_input, _batch_data);
+            _batch_collector.waitBatch(_batchsize, _timeout_usec, &s.batch);
 
-            // Signal.
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Send_batch. batchsize = " << _batch.size());
-            send_batch(_batch.size());
+            // Time to leave the loop.
+            if (s.batch.size() == 1 && s.batch[0] == nullptr) break;
 
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Wait until the batch is processed");
-            // Wait until it is processed.
-            wait_batch_used();
+            if (_fixed_rows) assign_rows(s);
+            s.batch_data.clear();
+            for (In *b : s.batch) {
+                s.batch_data.push_back(&b->data);
+            }
 
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] PutReplies()");
+            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] Compute input. batchsize = " << s.batch.size());
 
-            elf::CopyFromMem(_copier_reply, _batch_data);
+            // The batch may be partial due to timeout. Its real size goes to Infos::batchsize
+            // and the tail of the buffers is zeroed. With fixed rows, the rows of the games
+            // that did not report are zeroed instead.
+            s.batchsize = _fixed_rows ? _row_capacity : _batchsize;
+            elf::CopyToMem(s.copier_input, s.batch_data, s.batchsize, _fixed_rows ? &s.rows : nullptr);
 
-            // Finally make the game run again.
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Resume games");
-            for (In *in : _batch) {
-                const Key& key = in->meta.query_id;
-                V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Resume signal sent to k = " << key);
-                _batch_collector.signalReply(key);
-            }
+            // Signal. The slot is handed to the daemon until ReleaseSlot().
+            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] Send_batch. batchsize = " << s.batch.size());
+            send_batch(slot, s.batch.size());
 
-            V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] All resume signal sent, batchsize = " << _batch.size());
+            // With a single slot there is nothing to collect meanwhile: wait
+            // for the daemon and put the replies back here, as ReplyLoop() does.
+            if (_slots.size() == 1) put_replies(wait_returned_slot());
         }
 
         V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] Collector ends. Notify the upper level");
         _signal->GetDoneNotif().notify();
     }
 
+    // With several slots, puts the replies of the slots given back by the
+    // daemon while MainLoop() collects the next batches. Runs on its own
+    // thread until StopReplies().
+    void ReplyLoop() {
+        while (true) {
+            const int slot = wait_returned_slot();
+            if (slot < 0) break;
+            put_replies(slot);
+        }
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "] ReplyLoop ends");
+    }
+
+    void StopReplies() {
+        _returned_slots.enqueue(-1);
+        _returned_parker.notify_one();
+    }
+
     // Daemon side.
-    std::vector<Key> GetBatchKeys() const {
+    std::vector<Key> GetBatchKeys(int slot) const {
         std::vector<Key> keys;
-        for (const In *in : _batch) {
+        for (const In *in : _slots[slot].batch) {
             keys.push_back(in->meta.query_id);
         }
         return keys;
     }
 
-    void SignalBatchUsed(int future_timeout) { _wakeup.notify(future_timeout); }
+    // The samples of the batch held in slot, without copying.
+    const std::vector<In *> &GetBatch(int slot) const { return _slots[slot].batch; }
+
+    // Whether the daemon holds slot. Returns true only once per batch: the
+    // caller then owns the release of the slot.
+    bool TakeHeldSlot(int slot) { return _slots[slot].held.exchange(false); }
+
+    // Called once the batch in slot has been processed (and TakeHeldSlot()).
+    // Only hands the slot back: the replies are copied and the games resumed
+    // on the collector side, not on the daemon thread.
+    void ReleaseSlot(int slot) {
+        V_PRINT(_verbose, "CollectorGroup: [" << _gid << "][" << slot << "] ReleaseSlot()");
+        _returned_slots.enqueue(slot);
+        _returned_parker.notify_one();
+    }
+
+    // Fill the tensors bound with AddEntry("replay", ...).
+    ReplaySample SampleReplay() {
+        if (_replay == nullptr) throw std::range_error("Group " + std::to_string(_gid) + " has no replay buffer");
+        return _replay->Sample();
+    }
+
+    void UpdateReplayPriorities(const std::vector<int64_t> &idx, const std::vector<float> &priorities) {
+        if (_replay == nullptr) throw std::range_error("Group " + std::to_string(_gid) + " has no replay buffer");
+        _replay->UpdatePriorities(idx, priorities);
+    }
+
+    int GetReplaySize() const { return _replay == nullptr ? 0 : _replay->size(); }
 
     void PrintSummary() const {
         /*
@@ -57,7 +57,7 @@ class Batch:
 
         return v, info
 
-    def load(GC, input_reply, desc, group_id, use_gpu=True, use_numpy=False):
+    def load(GC, input_reply, desc, group_id, use_gpu=True, use_numpy=False, slot=0):
         batch = Batch()
         batch.infos = { }
 
@@ -69,7 +69,7 @@ class Batch:
             v, info = Batch._alloc(info, use_gpu=use_gpu, use_numpy=use_numpy)
             batch.batch[info.key] = v
             batch.infos[info.key] = info
-            GC.AddTensor(group_id, input_reply, info)
+            GC.AddTensor(group_id, input_reply, info, slot)
 
         return batch
 
@@ -168,8 +168,8 @@ class GCWrapper:
         num_recv_thread = max(num_recv_thread, 1)
         print("#recv_thread = %d" % num_recv_thread)
 
-        inputs = []
-        replies = []
+        input_slots = []
+        reply_slots = []
         idx2name = {}
         name2idx = defaultdict(list)
 
@@ -189,6 +189,15 @@ class GCWrapper:
             # If we specifiy filters, we need to put the info into gstat.
             filters = v.get("filters", {})
             gstat.player_name = filters.get("player_name", "")
+            # Send a partial batch after timeout_usec. Batch.batchsize then tells how many rows are valid.
+            gstat.timeout_usec = v.get("timeout_usec", 0)
+            # Number of batch buffer sets per group, so that collection overlaps with the model.
+            gstat.num_slots = v.get("num_slots", 1)
+            # Each game always uses the same row of the batch. The "valid" input (one byte per row)
+            # tells which rows hold a sample in the current batch.
+            gstat.fixed_rows = v.get("fixed_rows", False)
+            if gstat.fixed_rows and "valid" not in input["keys"]:
+                input = dict(input, keys=list(input["keys"]) + ["valid"])
 
             print("Deal with connector. key = %s, hist_len = %d, player_name = %s" % (key, gstat.hist_len, gstat.player_name))
 
@@ -196,11 +205,11 @@ class GCWrapper:
             for i in range(num_recv_thread):
                 group_id = GC.AddCollectors(batchsize, len(gpu2gid) - 1, gstat)
 
-                inputs.append(Batch.load(GC, "input", input, group_id, use_gpu=use_gpu, use_numpy=use_numpy))
+                input_slots.append([ Batch.load(GC, "input", input, group_id, use_gpu=use_gpu, use_numpy=use_numpy, slot=slot) for slot in range(gstat.num_slots) ])
                 if reply is not None:
-                    replies.append(Batch.load(GC, "reply", reply, group_id, use_gpu=use_gpu, use_numpy=use_numpy))
+                    reply_slots.append([ Batch.load(GC, "reply", reply, group_id, use_gpu=use_gpu, use_numpy=use_numpy, slot=slot) for slot in range(gstat.num_slots) ])
                 else:
-                    replies.append(None)
+                    reply_slots.append([ None ] * gstat.num_slots)
 
                 idx2name[group_id] = key
                 name2idx[key].append(group_id)
@@ -208,13 +217,17 @@ class GCWrapper:
                 gid2gpu[group_id] = len(gpu2gid) - 1
 
         # Zero out all replies.
-        for reply in replies:
-            if reply is not None:
-                reply.setzero()
+        for replies in reply_slots:
+            for reply in replies:
+                if reply is not None:
+                    reply.setzero()
 
         self.GC = GC
-        self.inputs = inputs
-        self.replies = replies
+        self.input_slots = input_slots
+        self.reply_slots = reply_slots
+        # Buffers of the first slot of each group.
+        self.inputs = [ slots[0] for slots in input_slots ]
+        self.replies = [ slots[0] for slots in reply_slots ]
         self.idx2name = idx2name
         self.name2idx = name2idx
         self.gid2gpu = gid2gpu
@@ -224,7 +237,8 @@ class GCWrapper:
         '''Setup the gpu used in the wrapper'''
         if gpu is not None and self.gpu != gpu:
             self.gpu = gpu
-            self.inputs_gpu = [ self.inputs[gids[0]].cpu2gpu(gpu=gpu) for gids in self.gpu2gid ]
+            # One set of buffers per slot, so that batches held at the same time do not overwrite each other.
+            self.inputs_gpu = [ [ sel.cpu2gpu(gpu=gpu) for sel in self.input_slots[gids[0]] ] for gids in self.gpu2gid ]
 
     def reg_callback(self, key, cb):
         '''Set callback function for key
@@ -242,17 +256,19 @@ class GCWrapper:
         return True
 
     def _call(self, infos):
-        sel = self.inputs[infos.gid]
+        sel = self.input_slots[infos.gid][infos.slot]
         if self.inputs_gpu is not None:
-            sel_gpu = self.inputs_gpu[self.gid2gpu[infos.gid]]
+            sel_gpu = self.inputs_gpu[self.gid2gpu[infos.gid]][infos.slot]
             sel.transfer_cpu2gpu(sel_gpu)
             picked = sel_gpu
         else:
             picked = sel
+        # Number of valid rows. Smaller than the allocated batch if the group timed out.
+        picked.batchsize = infos.batchsize
 
         # Get the reply array
-        if len(self.replies) > infos.gid and self.replies[infos.gid] is not None:
-            sel_reply = self.replies[infos.gid]
+        if len(self.reply_slots) > infos.gid and self.reply_slots[infos.gid][infos.slot] is not None:
+            sel_reply = self.reply_slots[infos.gid][infos.slot]
         else:
             sel_reply = None
 
@@ -274,6 +290,19 @@ class GCWrapper:
         self.GC.Steps(self.infos)
         return res
 
+    def Acquire(self):
+        '''Wait for a batch without releasing it. Returns ``(infos, input_batch, reply_batch)``.
+        With ``num_slots > 1`` in the descriptions, several batches of a group can be held at once.
+        Each of them has to be given back with :func:`Release()`, in any order.'''
+        infos = self.GC.Wait(0)
+        sel = self.input_slots[infos.gid][infos.slot]
+        sel.batchsize = infos.batchsize
+        return infos, sel, self.reply_slots[infos.gid][infos.slot]
+
+    def Release(self, infos):
+        '''Send the replies of a batch obtained by :func:`Acquire()` and resume its games.'''
+        self.GC.Steps(infos)
+
     def Start(self):
         '''Start all game environments'''
         self.GC.Start()
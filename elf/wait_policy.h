@@ -0,0 +1,201 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: wait_policy.h
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fiber.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace elf {
+
+// How a thread waits for a condition that is made true by another thread.
+//   WAIT_BLOCK:     sleep on a condition variable right away. Cheapest in CPU,
+//                   but every hand-off pays a futex wake-up.
+//   WAIT_SPIN:      busy-wait and never sleep. Lowest latency, burns one core
+//                   per waiter. Only sensible when waiters <= free cores.
+//   WAIT_SPIN_PARK: spin for spin_count iterations, then sleep.
+enum WaitMode { WAIT_BLOCK = 0, WAIT_SPIN, WAIT_SPIN_PARK };
+
+struct WaitPolicy {
+    WaitMode mode = WAIT_BLOCK;
+    // Number of spin iterations before parking (WAIT_SPIN_PARK only).
+    int spin_count = 2000;
+
+    WaitPolicy() { }
+    WaitPolicy(WaitMode mode, int spin_count = 2000) : mode(mode), spin_count(spin_count) { }
+
+    static WaitPolicy Parse(const std::string &name, int spin_count) {
+        if (name == "block") return WaitPolicy(WAIT_BLOCK, spin_count);
+        if (name == "spin") return WaitPolicy(WAIT_SPIN, spin_count);
+        if (name == "spin_park") return WaitPolicy(WAIT_SPIN_PARK, spin_count);
+        throw std::range_error("Unknown wait policy " + name);
+    }
+
+    std::string name() const {
+        switch (mode) {
+            case WAIT_BLOCK: return "block";
+            case WAIT_SPIN: return "spin";
+            case WAIT_SPIN_PARK: return "spin_park";
+        }
+        return "";
+    }
+};
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// A place where threads wait for a predicate to become true under a given
+// WaitPolicy. The predicate state is owned by the caller; whoever changes it
+// must call notify_one()/notify_all() afterwards. Notification only touches
+// the mutex when somebody is actually parked, so spinning waiters and
+// uncontended hand-offs never enter the kernel.
+//
+// A waiter running in an elf::Fiber neither spins nor blocks: the fiber is
+// suspended and resumed by the next notification, or by its worker at the
+// deadline of wait_for().
+class Parker {
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::atomic<int> _num_parked;
+    // Suspended fibers, protected by _mutex.
+    std::vector<Fiber *> _fibers;
+
+    template <typename Pred>
+    void fiber_wait(Fiber *fiber, Pred &pred) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (! pred()) {
+            _num_parked ++;
+            _fibers.push_back(fiber);
+            fiber->Suspend(&lock);
+            lock.lock();
+            _num_parked --;
+        }
+    }
+
+    // As fiber_wait(), with the worker resuming the fiber at the deadline.
+    template <typename Pred>
+    bool fiber_wait_until(Fiber *fiber, std::chrono::steady_clock::time_point deadline, Pred &pred) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (! pred()) {
+            if (std::chrono::steady_clock::now() >= deadline) return false;
+            _num_parked ++;
+            _fibers.push_back(fiber);
+            fiber->SuspendUntil(&lock, deadline);
+            lock.lock();
+            _num_parked --;
+            // Still listed if the timer woke it up.
+            auto it = std::find(_fibers.begin(), _fibers.end(), fiber);
+            if (it != _fibers.end()) _fibers.erase(it);
+        }
+        return true;
+    }
+
+    template <typename Pred>
+    bool spin(const WaitPolicy &policy, Pred &pred) {
+        if (policy.mode == WAIT_BLOCK) return pred();
+        for (int i = 0; policy.mode == WAIT_SPIN || i < policy.spin_count; ++i) {
+            if (pred()) return true;
+            cpu_relax();
+        }
+        return pred();
+    }
+
+    template <typename Pred>
+    bool spin_until(const WaitPolicy &policy, std::chrono::steady_clock::time_point deadline, Pred &pred) {
+        if (policy.mode == WAIT_BLOCK) return pred();
+        for (int i = 0; policy.mode == WAIT_SPIN || i < policy.spin_count; ++i) {
+            if (pred()) return true;
+            // Checking the clock is expensive compared to a pause.
+            if ((i & 63) == 63 && std::chrono::steady_clock::now() >= deadline) return pred();
+            cpu_relax();
+        }
+        return pred();
+    }
+
+    inline void wake(bool all) {
+        // Pairs with the increment of _num_parked in wait(): either the waiter
+        // sees the new state, or we see the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_num_parked.load() == 0) return;
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (all) _cv.notify_all();
+        else _cv.notify_one();
+        if (_fibers.empty()) return;
+        if (all) {
+            for (Fiber *f : _fibers) f->Wake();
+            _fibers.clear();
+            return;
+        }
+        // Skip the fibers that their timer has already woken up.
+        while (! _fibers.empty()) {
+            Fiber *f = _fibers.front();
+            _fibers.erase(_fibers.begin());
+            if (f->Wake()) break;
+        }
+    }
+
+public:
+    Parker() : _num_parked(0) { }
+    Parker(const Parker &) = delete;
+
+    template <typename Pred>
+    void wait(const WaitPolicy &policy, Pred pred) {
+        if (Fiber *fiber = Fiber::Current()) {
+            fiber_wait(fiber, pred);
+            return;
+        }
+        if (spin(policy, pred)) return;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _num_parked ++;
+        _cv.wait(lock, pred);
+        _num_parked --;
+    }
+
+    // Return the value of pred() when the wait ends.
+    template <typename Pred>
+    bool wait_for(const WaitPolicy &policy, int usec, Pred pred) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(usec);
+        if (Fiber *fiber = Fiber::Current()) return fiber_wait_until(fiber, deadline, pred);
+        if (spin_until(policy, deadline, pred)) return true;
+        if (policy.mode == WAIT_SPIN) return false;
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _num_parked ++;
+        bool res = _cv.wait_until(lock, deadline, pred);
+        _num_parked --;
+        return res;
+    }
+
+    inline void notify_one() { wake(false); }
+    inline void notify_all() { wake(true); }
+};
+
+}  // namespace elf
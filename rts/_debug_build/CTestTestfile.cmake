@@ -0,0 +1,12 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/rts
+# Build directory: /root/repo/rts/_debug_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+subdirs("elf")
+subdirs("vendor")
+subdirs("engine")
+subdirs("minirts")
+subdirs("backend")
+subdirs("bench")
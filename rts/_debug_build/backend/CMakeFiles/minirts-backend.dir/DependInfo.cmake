@@ -0,0 +1,47 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/rts/engine/ai.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/ai.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/ai.cc.o.d"
+  "/root/repo/rts/engine/bullet.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/bullet.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/bullet.cc.o.d"
+  "/root/repo/rts/engine/cluster_graph.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cluster_graph.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cluster_graph.cc.o.d"
+  "/root/repo/rts/engine/cmd.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd.cc.o.d"
+  "/root/repo/rts/engine/cmd_arena.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_arena.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_arena.cc.o.d"
+  "/root/repo/rts/engine/cmd_receiver.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_receiver.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_receiver.cc.o.d"
+  "/root/repo/rts/engine/cmd_specific.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_specific.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_specific.cc.o.d"
+  "/root/repo/rts/engine/cmd_util.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_util.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/cmd_util.cc.o.d"
+  "/root/repo/rts/engine/game.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/game.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/game.cc.o.d"
+  "/root/repo/rts/engine/game_env.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/game_env.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/game_env.cc.o.d"
+  "/root/repo/rts/engine/gamedef.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/gamedef.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/gamedef.cc.o.d"
+  "/root/repo/rts/engine/map.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/map.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/map.cc.o.d"
+  "/root/repo/rts/engine/mcts.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/mcts.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/mcts.cc.o.d"
+  "/root/repo/rts/engine/path_search.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/path_search.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/path_search.cc.o.d"
+  "/root/repo/rts/engine/player.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/player.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/player.cc.o.d"
+  "/root/repo/rts/engine/replay.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/replay.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/replay.cc.o.d"
+  "/root/repo/rts/engine/rule_actor.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/rule_actor.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/rule_actor.cc.o.d"
+  "/root/repo/rts/engine/unit.cc" "backend/CMakeFiles/minirts-backend.dir/__/engine/unit.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/engine/unit.cc.o.d"
+  "/root/repo/rts/game_MC/ai.cc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/ai.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/ai.cc.o.d"
+  "/root/repo/rts/game_MC/cmd_specific.cc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/cmd_specific.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/cmd_specific.cc.o.d"
+  "/root/repo/rts/game_MC/gamedef.cc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/gamedef.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/gamedef.cc.o.d"
+  "/root/repo/rts/game_MC/mc_rule_actor.cc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/mc_rule_actor.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/mc_rule_actor.cc.o.d"
+  "/root/repo/rts/game_MC/mcts_ai.cc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/mcts_ai.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/__/game_MC/mcts_ai.cc.o.d"
+  "/root/repo/rts/backend/comm_ai.cc" "backend/CMakeFiles/minirts-backend.dir/comm_ai.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/comm_ai.cc.o.d"
+  "/root/repo/rts/backend/main_loop.cc" "backend/CMakeFiles/minirts-backend.dir/main_loop.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/main_loop.cc.o.d"
+  "/root/repo/rts/backend/raw2cmd.cc" "backend/CMakeFiles/minirts-backend.dir/raw2cmd.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/raw2cmd.cc.o.d"
+  "/root/repo/elf/lib/debugutils.cc" "backend/CMakeFiles/minirts-backend.dir/root/repo/elf/lib/debugutils.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/root/repo/elf/lib/debugutils.cc.o.d"
+  "/root/repo/elf/lib/strutils.cc" "backend/CMakeFiles/minirts-backend.dir/root/repo/elf/lib/strutils.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/root/repo/elf/lib/strutils.cc.o.d"
+  "/root/repo/rts/backend/save2json.cc" "backend/CMakeFiles/minirts-backend.dir/save2json.cc.o" "gcc" "backend/CMakeFiles/minirts-backend.dir/save2json.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,63 @@
+file(REMOVE_RECURSE
+  "../minirts-bench"
+  "../minirts-bench.pdb"
+  "CMakeFiles/minirts-bench.dir/__/engine/ai.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/ai.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/bullet.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/bullet.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cluster_graph.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cluster_graph.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_arena.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_arena.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_receiver.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_receiver.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_specific.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_specific.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_util.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/cmd_util.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/game.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/game.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/game_env.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/game_env.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/gamedef.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/gamedef.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/map.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/map.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/mcts.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/mcts.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/path_search.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/path_search.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/player.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/player.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/replay.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/replay.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/rule_actor.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/rule_actor.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/engine/unit.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/engine/unit.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/ai.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/ai.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/cmd_specific.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/cmd_specific.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/gamedef.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/gamedef.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/mc_rule_actor.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/mc_rule_actor.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/mcts_ai.cc.o"
+  "CMakeFiles/minirts-bench.dir/__/game_MC/mcts_ai.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/bench.cc.o"
+  "CMakeFiles/minirts-bench.dir/bench.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/alloc_counter.cc.o"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/alloc_counter.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/lib/debugutils.cc.o"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/lib/debugutils.cc.o.d"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/lib/strutils.cc.o"
+  "CMakeFiles/minirts-bench.dir/root/repo/elf/lib/strutils.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minirts-bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
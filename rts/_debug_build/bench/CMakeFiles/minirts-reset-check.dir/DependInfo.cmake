@@ -0,0 +1,44 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/rts/engine/ai.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/ai.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/ai.cc.o.d"
+  "/root/repo/rts/engine/bullet.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/bullet.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/bullet.cc.o.d"
+  "/root/repo/rts/engine/cluster_graph.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cluster_graph.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cluster_graph.cc.o.d"
+  "/root/repo/rts/engine/cmd.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd.cc.o.d"
+  "/root/repo/rts/engine/cmd_arena.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_arena.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_arena.cc.o.d"
+  "/root/repo/rts/engine/cmd_receiver.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_receiver.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_receiver.cc.o.d"
+  "/root/repo/rts/engine/cmd_specific.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_specific.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_specific.cc.o.d"
+  "/root/repo/rts/engine/cmd_util.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_util.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/cmd_util.cc.o.d"
+  "/root/repo/rts/engine/game.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/game.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/game.cc.o.d"
+  "/root/repo/rts/engine/game_env.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/game_env.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/game_env.cc.o.d"
+  "/root/repo/rts/engine/gamedef.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/gamedef.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/gamedef.cc.o.d"
+  "/root/repo/rts/engine/map.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/map.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/map.cc.o.d"
+  "/root/repo/rts/engine/mcts.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/mcts.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/mcts.cc.o.d"
+  "/root/repo/rts/engine/path_search.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/path_search.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/path_search.cc.o.d"
+  "/root/repo/rts/engine/player.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/player.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/player.cc.o.d"
+  "/root/repo/rts/engine/replay.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/replay.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/replay.cc.o.d"
+  "/root/repo/rts/engine/rule_actor.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/rule_actor.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/rule_actor.cc.o.d"
+  "/root/repo/rts/engine/unit.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/unit.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/engine/unit.cc.o.d"
+  "/root/repo/rts/game_MC/ai.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/ai.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/ai.cc.o.d"
+  "/root/repo/rts/game_MC/cmd_specific.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/cmd_specific.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/cmd_specific.cc.o.d"
+  "/root/repo/rts/game_MC/gamedef.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/gamedef.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/gamedef.cc.o.d"
+  "/root/repo/rts/game_MC/mc_rule_actor.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/mc_rule_actor.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/mc_rule_actor.cc.o.d"
+  "/root/repo/rts/game_MC/mcts_ai.cc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/mcts_ai.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/__/game_MC/mcts_ai.cc.o.d"
+  "/root/repo/rts/bench/reset_check.cc" "bench/CMakeFiles/minirts-reset-check.dir/reset_check.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/reset_check.cc.o.d"
+  "/root/repo/elf/lib/debugutils.cc" "bench/CMakeFiles/minirts-reset-check.dir/root/repo/elf/lib/debugutils.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/root/repo/elf/lib/debugutils.cc.o.d"
+  "/root/repo/elf/lib/strutils.cc" "bench/CMakeFiles/minirts-reset-check.dir/root/repo/elf/lib/strutils.cc.o" "gcc" "bench/CMakeFiles/minirts-reset-check.dir/root/repo/elf/lib/strutils.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
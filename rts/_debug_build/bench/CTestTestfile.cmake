@@ -0,0 +1,10 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/rts/bench
+# Build directory: /root/repo/rts/_debug_build/bench
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(alloc-check "/root/repo/rts/_debug_build/minirts-alloc-check")
+set_tests_properties(alloc-check PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/rts/bench/CMakeLists.txt;7;add_test;/root/repo/rts/bench/CMakeLists.txt;0;")
+add_test(reset-check "/root/repo/rts/_debug_build/minirts-reset-check")
+set_tests_properties(reset-check PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/rts/bench/CMakeLists.txt;29;add_test;/root/repo/rts/bench/CMakeLists.txt;0;")
@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark-copier.dir/benchmark-copier.cc.o"
+  "CMakeFiles/benchmark-copier.dir/benchmark-copier.cc.o.d"
+  "CMakeFiles/benchmark-copier.dir/lib/debugutils.cc.o"
+  "CMakeFiles/benchmark-copier.dir/lib/debugutils.cc.o.d"
+  "CMakeFiles/benchmark-copier.dir/lib/strutils.cc.o"
+  "CMakeFiles/benchmark-copier.dir/lib/strutils.cc.o.d"
+  "benchmark-copier"
+  "benchmark-copier.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchmark-copier.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
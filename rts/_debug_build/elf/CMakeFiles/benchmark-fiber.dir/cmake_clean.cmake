@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark-fiber.dir/benchmark-fiber.cc.o"
+  "CMakeFiles/benchmark-fiber.dir/benchmark-fiber.cc.o.d"
+  "CMakeFiles/benchmark-fiber.dir/lib/debugutils.cc.o"
+  "CMakeFiles/benchmark-fiber.dir/lib/debugutils.cc.o.d"
+  "CMakeFiles/benchmark-fiber.dir/lib/strutils.cc.o"
+  "CMakeFiles/benchmark-fiber.dir/lib/strutils.cc.o.d"
+  "benchmark-fiber"
+  "benchmark-fiber.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchmark-fiber.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark-replay.dir/benchmark-replay.cc.o"
+  "CMakeFiles/benchmark-replay.dir/benchmark-replay.cc.o.d"
+  "CMakeFiles/benchmark-replay.dir/lib/debugutils.cc.o"
+  "CMakeFiles/benchmark-replay.dir/lib/debugutils.cc.o.d"
+  "CMakeFiles/benchmark-replay.dir/lib/strutils.cc.o"
+  "CMakeFiles/benchmark-replay.dir/lib/strutils.cc.o.d"
+  "benchmark-replay"
+  "benchmark-replay.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchmark-replay.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/elf/benchmark-wait-policy.cc" "elf/CMakeFiles/benchmark-wait-policy.dir/benchmark-wait-policy.cc.o" "gcc" "elf/CMakeFiles/benchmark-wait-policy.dir/benchmark-wait-policy.cc.o.d"
+  "/root/repo/elf/lib/debugutils.cc" "elf/CMakeFiles/benchmark-wait-policy.dir/lib/debugutils.cc.o" "gcc" "elf/CMakeFiles/benchmark-wait-policy.dir/lib/debugutils.cc.o.d"
+  "/root/repo/elf/lib/strutils.cc" "elf/CMakeFiles/benchmark-wait-policy.dir/lib/strutils.cc.o" "gcc" "elf/CMakeFiles/benchmark-wait-policy.dir/lib/strutils.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
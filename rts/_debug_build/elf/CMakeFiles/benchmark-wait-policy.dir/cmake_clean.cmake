@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/benchmark-wait-policy.dir/benchmark-wait-policy.cc.o"
+  "CMakeFiles/benchmark-wait-policy.dir/benchmark-wait-policy.cc.o.d"
+  "CMakeFiles/benchmark-wait-policy.dir/lib/debugutils.cc.o"
+  "CMakeFiles/benchmark-wait-policy.dir/lib/debugutils.cc.o.d"
+  "CMakeFiles/benchmark-wait-policy.dir/lib/strutils.cc.o"
+  "CMakeFiles/benchmark-wait-policy.dir/lib/strutils.cc.o.d"
+  "benchmark-wait-policy"
+  "benchmark-wait-policy.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/benchmark-wait-policy.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
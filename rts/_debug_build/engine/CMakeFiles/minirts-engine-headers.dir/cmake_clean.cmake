@@ -0,0 +1,10 @@
+file(REMOVE_RECURSE
+  "/root/repo/rts/engine/cmd.gen.h"
+  "/root/repo/rts/engine/cmd_specific.gen.h"
+  "CMakeFiles/minirts-engine-headers"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/minirts-engine-headers.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,9 @@
+file(REMOVE_RECURSE
+  "/root/repo/rts/game_MC/cmd_specific.gen.h"
+  "CMakeFiles/minirts-game-headers"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/minirts-game-headers.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,45 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/rts/engine/ai.cc" "minirts/CMakeFiles/minirts.dir/__/engine/ai.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/ai.cc.o.d"
+  "/root/repo/rts/engine/bullet.cc" "minirts/CMakeFiles/minirts.dir/__/engine/bullet.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/bullet.cc.o.d"
+  "/root/repo/rts/engine/cluster_graph.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cluster_graph.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cluster_graph.cc.o.d"
+  "/root/repo/rts/engine/cmd.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd.cc.o.d"
+  "/root/repo/rts/engine/cmd_arena.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_arena.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_arena.cc.o.d"
+  "/root/repo/rts/engine/cmd_receiver.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_receiver.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_receiver.cc.o.d"
+  "/root/repo/rts/engine/cmd_specific.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_specific.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_specific.cc.o.d"
+  "/root/repo/rts/engine/cmd_util.cc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_util.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/cmd_util.cc.o.d"
+  "/root/repo/rts/engine/game.cc" "minirts/CMakeFiles/minirts.dir/__/engine/game.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/game.cc.o.d"
+  "/root/repo/rts/engine/game_env.cc" "minirts/CMakeFiles/minirts.dir/__/engine/game_env.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/game_env.cc.o.d"
+  "/root/repo/rts/engine/gamedef.cc" "minirts/CMakeFiles/minirts.dir/__/engine/gamedef.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/gamedef.cc.o.d"
+  "/root/repo/rts/engine/map.cc" "minirts/CMakeFiles/minirts.dir/__/engine/map.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/map.cc.o.d"
+  "/root/repo/rts/engine/mcts.cc" "minirts/CMakeFiles/minirts.dir/__/engine/mcts.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/mcts.cc.o.d"
+  "/root/repo/rts/engine/path_search.cc" "minirts/CMakeFiles/minirts.dir/__/engine/path_search.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/path_search.cc.o.d"
+  "/root/repo/rts/engine/player.cc" "minirts/CMakeFiles/minirts.dir/__/engine/player.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/player.cc.o.d"
+  "/root/repo/rts/engine/replay.cc" "minirts/CMakeFiles/minirts.dir/__/engine/replay.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/replay.cc.o.d"
+  "/root/repo/rts/engine/rule_actor.cc" "minirts/CMakeFiles/minirts.dir/__/engine/rule_actor.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/rule_actor.cc.o.d"
+  "/root/repo/rts/engine/unit.cc" "minirts/CMakeFiles/minirts.dir/__/engine/unit.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/__/engine/unit.cc.o.d"
+  "/root/repo/rts/game_MC/ai.cc" "minirts/CMakeFiles/minirts.dir/ai.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/ai.cc.o.d"
+  "/root/repo/rts/game_MC/cmd_specific.cc" "minirts/CMakeFiles/minirts.dir/cmd_specific.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/cmd_specific.cc.o.d"
+  "/root/repo/rts/game_MC/gamedef.cc" "minirts/CMakeFiles/minirts.dir/gamedef.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/gamedef.cc.o.d"
+  "/root/repo/rts/game_MC/mc_rule_actor.cc" "minirts/CMakeFiles/minirts.dir/mc_rule_actor.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/mc_rule_actor.cc.o.d"
+  "/root/repo/rts/game_MC/mcts_ai.cc" "minirts/CMakeFiles/minirts.dir/mcts_ai.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/mcts_ai.cc.o.d"
+  "/root/repo/rts/game_MC/python_wrapper.cc" "minirts/CMakeFiles/minirts.dir/python_wrapper.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/python_wrapper.cc.o.d"
+  "/root/repo/elf/lib/debugutils.cc" "minirts/CMakeFiles/minirts.dir/root/repo/elf/lib/debugutils.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/root/repo/elf/lib/debugutils.cc.o.d"
+  "/root/repo/elf/lib/strutils.cc" "minirts/CMakeFiles/minirts.dir/root/repo/elf/lib/strutils.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/root/repo/elf/lib/strutils.cc.o.d"
+  "/root/repo/rts/game_MC/wrapper_callback.cc" "minirts/CMakeFiles/minirts.dir/wrapper_callback.cc.o" "gcc" "minirts/CMakeFiles/minirts.dir/wrapper_callback.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,63 @@
+file(REMOVE_RECURSE
+  "/root/repo/rts/game_MC/minirts.pdb"
+  "/root/repo/rts/game_MC/minirtsNone"
+  "CMakeFiles/minirts.dir/__/engine/ai.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/ai.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/bullet.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/bullet.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cluster_graph.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cluster_graph.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cmd.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cmd.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cmd_arena.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cmd_arena.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cmd_receiver.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cmd_receiver.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cmd_specific.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cmd_specific.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/cmd_util.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/cmd_util.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/game.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/game.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/game_env.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/game_env.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/gamedef.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/gamedef.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/map.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/map.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/mcts.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/mcts.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/path_search.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/path_search.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/player.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/player.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/replay.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/replay.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/rule_actor.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/rule_actor.cc.o.d"
+  "CMakeFiles/minirts.dir/__/engine/unit.cc.o"
+  "CMakeFiles/minirts.dir/__/engine/unit.cc.o.d"
+  "CMakeFiles/minirts.dir/ai.cc.o"
+  "CMakeFiles/minirts.dir/ai.cc.o.d"
+  "CMakeFiles/minirts.dir/cmd_specific.cc.o"
+  "CMakeFiles/minirts.dir/cmd_specific.cc.o.d"
+  "CMakeFiles/minirts.dir/gamedef.cc.o"
+  "CMakeFiles/minirts.dir/gamedef.cc.o.d"
+  "CMakeFiles/minirts.dir/mc_rule_actor.cc.o"
+  "CMakeFiles/minirts.dir/mc_rule_actor.cc.o.d"
+  "CMakeFiles/minirts.dir/mcts_ai.cc.o"
+  "CMakeFiles/minirts.dir/mcts_ai.cc.o.d"
+  "CMakeFiles/minirts.dir/python_wrapper.cc.o"
+  "CMakeFiles/minirts.dir/python_wrapper.cc.o.d"
+  "CMakeFiles/minirts.dir/root/repo/elf/lib/debugutils.cc.o"
+  "CMakeFiles/minirts.dir/root/repo/elf/lib/debugutils.cc.o.d"
+  "CMakeFiles/minirts.dir/root/repo/elf/lib/strutils.cc.o"
+  "CMakeFiles/minirts.dir/root/repo/elf/lib/strutils.cc.o.d"
+  "CMakeFiles/minirts.dir/wrapper_callback.cc.o"
+  "CMakeFiles/minirts.dir/wrapper_callback.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/minirts.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
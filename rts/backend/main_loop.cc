@@ -16,6 +16,7 @@
 #include "engine/cmd_util.h"
 #include "engine/ai.h"
 #include "ai.h"
+#include "mcts_ai.h"
 #include "comm_ai.h"
 
 #include <iostream>
@@ -43,17 +44,15 @@ bool add_players(const string &args, int frame_skip, RTSGame *game) {
             int tick_start = (params.size() == 1 ? 0 : std::stoi(params[1]));
             bots.push_back(new TCPAI("tcpai", tick_start, 8000, nullptr));
         }
-        /*else if (player.find("mcts") == 0) {
+        else if (player.find("mcts=") == 0) {
+            // mcts=#threads=#rollouts per thread[=more MCTSAI args, e.g. parallel/root|rollout/hit_and_run]
             vector<string> params = split(player, '=');
-            int mcts_thread = std::stoi(params[1]);
-            int mcts_rollout_per_thread = std::stoi(params[2]);
-            vector<string> prerun_cmds;
-            if (params.size() >= 4) {
-                prerun_cmds = split(params[3], '-');
-            }
-            bots.push_back(new MCTSAI(INVALID, frame_skip, nullptr, mcts_thread, mcts_rollout_per_thread, false, &prerun_cmds));
-            mcts = true;
-        }*/
+            AIOptions opt;
+            opt.fs = frame_skip;
+            opt.args = "threads/" + params[1] + "|sims/" + std::to_string(std::stoi(params[1]) * std::stoi(params[2]));
+            if (params.size() >= 4) opt.args = params[3] + "|" + opt.args;
+            bots.push_back(new MCTSAI(opt, nullptr));
+        }
         else if (player.find("spectator") == 0) {
             vector<string> params = split(player, '=');
             int tick_start = (params.size() == 1 ? 0 : std::stoi(params[1]));
@@ -104,10 +103,14 @@ RTSGameOptions GetOptions(const Parser &parser) {
     options.max_tick = parser.GetItem<int>("max_tick");
     options.output_file = parser.GetItem<string>("output_file", "");
     options.save_with_binary_format = parser.GetItem<bool>("binary_io");
+    options.save_replay_binary = parser.GetItem<bool>("binary_replay");
+    options.replay_keyframe_interval = parser.GetItem<int>("replay_keyframe_interval");
     options.tick_prompt_n_step = parser.GetItem<int>("tick_prompt_n_step");
     options.seed = parser.GetItem<int>("seed");
     options.cmd_verbose = parser.GetItem<int>("cmd_verbose");
     options.handicap_level = parser.GetItem<int>("handicap_level", 0);
+    options.hash_check = parser.GetItem<bool>("hash_check");
+    options.jump_point_search = parser.GetItem<bool>("jump_point_search");
 
     string ticks = parser.GetItem<string>("peek_ticks", "");
     for (const auto &tick : split(ticks, ',')) {
@@ -149,15 +152,14 @@ RTSGameOptions ai_vs_ai2(const Parser &parser, string *players) {
 
     return options;
 }
-/*
 RTSGameOptions ai_vs_mcts(const Parser &parser, string *players) {
     RTSGameOptions options = GetOptions(parser);
     int mcts_threads = parser.GetItem<int>("mcts_threads");
     int mcts_rollout_per_thread = parser.GetItem<int>("mcts_rollout_per_thread");
-    string str_prerun_cmds = parser.GetItem<string>("mcts_prerun_cmds", "");
+    string mcts_args = parser.GetItem<string>("mcts_args", "");
 
     *players = "mcts=" + to_string(mcts_threads) + "=" + to_string(mcts_rollout_per_thread);
-    if (! str_prerun_cmds.empty()) *players + "=" + str_prerun_cmds;
+    if (! mcts_args.empty()) *players += "=" + mcts_args;
     *players += ",simple";
 
     int vis_after = parser.GetItem<int>("vis_after");
@@ -165,7 +167,6 @@ RTSGameOptions ai_vs_mcts(const Parser &parser, string *players) {
 
     return options;
 }
-*/
 RTSGameOptions flag_ai_vs_ai(const Parser &parser, string *players) {
     RTSGameOptions options = GetOptions(parser);
     *players = "flag_simple,flag_simple,dummy";
@@ -318,10 +319,13 @@ void test() {
 }
 
 int main(int argc, char *argv[]) {
+    // Registers the AIs that players are created from.
+    GameDef::GlobalInit();
+
     const map<string, function<RTSGameOptions (const Parser &, string *)> > func_mapping = {
         { "selfplay", ai_vs_ai },
         { "selfplay2", ai_vs_ai2 },
-        //{ "mcts", ai_vs_mcts },
+        { "mcts", ai_vs_mcts },
 
         { "replay", replay },
         { "replay_cmd", replay_cmd },
@@ -339,8 +343,8 @@ int main(int argc, char *argv[]) {
     };
 
     CmdLineUtils::CmdLineParser parser("playstyle --save_replay --load_replay --vis_after[-1] --save_snapshot_prefix --load_snapshot_prefix --seed[0] \
---load_snapshot_length --max_tick[30000] --binary_io[1] --games[16] --frame_skip[1] --tick_prompt_n_step[2000] --cmd_verbose[0] --peek_ticks --cmd_dumper_prefix \
---output_file[cout] --mcts_threads[16] --mcts_rollout_per_thread[100] --threads[64] --load_binary_string --mcts_verbose --mcts_prerun_cmds --handicap_level[0]");
+--load_snapshot_length --max_tick[30000] --binary_io[1] --binary_replay[1] --replay_keyframe_interval[1000] --games[16] --frame_skip[1] --tick_prompt_n_step[2000] --cmd_verbose[0] --peek_ticks --cmd_dumper_prefix \
+--output_file[cout] --mcts_threads[16] --mcts_rollout_per_thread[100] --threads[64] --load_binary_string --mcts_verbose --mcts_args --handicap_level[0] --hash_check[0] --jump_point_search[0]");
 
     if (! parser.Parse(argc, argv)) {
         cout << parser.PrintHelper() << endl;
@@ -151,7 +151,11 @@ RawMsgStatus RawToCmd::Process(const GameEnv &env, const string&s, CmdReceiver *
             // Reorder the four corners.
             if (p.x > p2.x) swap(p.x, p2.x);
             if (p.y > p2.y) swap(p.y, p2.y);
-            selected = m.GetUnitIdInRegion(p, p2);
+            {
+            vector<UnitId> ids;
+            m.GetUnitIdInRegion(p, p2, &ids);
+            selected.insert(ids.begin(), ids.end());
+            }
             break;
         case 'F':
             receiver->SendCmd(UICmd::GetUIFaster());
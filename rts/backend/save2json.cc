@@ -24,17 +24,17 @@ static inline void set_cmd(const CmdDurative *_c, json *cmd) {
     (*cmd)["state"] = 0;
 
     if (c.type() == ATTACK) {
-        const CmdAttack &tmp = dynamic_cast<const CmdAttack &>(c);
+        const CmdAttack &tmp = static_cast<const CmdAttack &>(c);
         (*cmd)["target_id"] = tmp.target();
     } else if (c.type() == MOVE) {
-        const CmdMove &tmp = dynamic_cast<const CmdMove &>(c);
+        const CmdMove &tmp = static_cast<const CmdMove &>(c);
         set_p(tmp.p(), &(*cmd)["p"]);
     } else if (c.type() == GATHER) {
-        const CmdGather &tmp = dynamic_cast<const CmdGather &>(c);
+        const CmdGather &tmp = static_cast<const CmdGather &>(c);
         (*cmd)["target_id"] = tmp.resource();
         (*cmd)["state"] = tmp.state();
     } else if (c.type() == BUILD) {
-        const CmdBuild &tmp = dynamic_cast<const CmdBuild &>(c);
+        const CmdBuild &tmp = static_cast<const CmdBuild &>(c);
         (*cmd)["state"] = tmp.state();
     }
 }
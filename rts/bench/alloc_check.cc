@@ -0,0 +1,336 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: alloc_check.cc
+// Checks that the steady state of the tick loop (and of the ELF step path)
+// does not touch the heap. Exits with 1 if any measured tick or step allocates.
+//
+// Steady state is a game that has already played warmup_games whole games:
+// like in training, one game object plays episode after episode, and what
+// grows with the size of a game (armies, command queues, path fields) has
+// reached its size by then.
+//
+// Usage: minirts-alloc-check [key=value ...]
+//   mode=rts       rule-based bots only, one game played again and again.
+//   mode=elf       an AI_NN bot per game that talks to a C++ stand-in for the
+//                  trainer (random actions) through a collector group.
+//   players=simple,simple   bots in rts mode ("simple" or "hit_and_run").
+//   opponent=AI_SIMPLE      opponent of the AI_NN bot in elf mode.
+//   games=1        #games (elf mode: run concurrently, also the batchsize).
+//   warmup_games=20 games (episodes) each game plays before measuring.
+//   warmup=500     ticks (per episode) before measuring. Elf mode: also the
+//                  trainer steps before measuring, at least.
+//   ticks=5000     measured ticks (per game in elf mode).
+//   seed=1
+//   trace=0        print a backtrace for the first n allocations measured.
+//   trace_trainer=0   elf mode: trace the trainer thread instead of a game.
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_args.h"
+#include "elf/alloc_counter.h"
+#include "engine/game.h"
+#include "engine/wrapper_template.h"
+#include "ai.h"
+
+using namespace std;
+using bench::arg;
+using elf::AllocCounter;
+
+namespace {
+
+// Allocations seen in the measured window, over all games.
+struct Report {
+    mutex m;
+    uint64_t ticks = 0;
+    uint64_t allocating_ticks = 0;
+    uint64_t allocs = 0;
+    atomic<int> trace_budget{0};
+
+    void Add(uint64_t n_ticks, uint64_t n_allocating, uint64_t n_allocs) {
+        lock_guard<mutex> lock(m);
+        ticks += n_ticks;
+        allocating_ticks += n_allocating;
+        allocs += n_allocs;
+    }
+} g_report;
+
+// A spectator that measures the allocations of its thread between two
+// consecutive calls, i.e., over one whole tick. The first warmup_games
+// episodes, the first warmup ticks of an episode and its last tick (game
+// over, new episode) are not measured, and it stops after measuring ticks
+// ticks.
+class AllocProbe : public AI {
+public:
+    // #probes that have started measuring, and that have measured their ticks.
+    static atomic<int> num_measuring, num_done;
+
+    // If given, profiler is reset when the first measured episode reaches
+    // warmup.
+    AllocProbe(int warmup_games, int warmup, uint64_t ticks, TickProfiler *profiler = nullptr)
+        : AI("alloc_probe", 1, nullptr), _warmup_games(warmup_games), _warmup(warmup), _target_ticks(ticks), _profiler(profiler) { }
+
+    bool Act(const GameEnv &env, bool) override {
+        const uint64_t now = AllocCounter::ThreadCount();
+        if (env.GetTermination()) {
+            _episode_tick = 0;
+            _episode ++;
+        } else if (_episode >= _warmup_games) {
+            if (_episode_tick > _warmup && _ticks < _target_ticks) {
+                const uint64_t n = now - _last;
+                if (++ _ticks == _target_ticks) num_done ++;
+                if (n > 0) {
+                    _allocating_ticks ++;
+                    _allocs += n;
+                }
+            }
+            if (_episode_tick == _warmup) {
+                if (! _measuring) {
+                    _measuring = true;
+                    num_measuring ++;
+                }
+                if (_profiler != nullptr) {
+                    _profiler->Reset();
+                    _profiler = nullptr;
+                }
+                int budget = g_report.trace_budget.exchange(0);
+                if (budget > 0) AllocCounter::TraceThread(budget);
+            }
+            _episode_tick ++;
+        }
+        _last = AllocCounter::ThreadCount();
+        return true;
+    }
+
+    uint64_t ticks() const { return _ticks; }
+    int episode() const { return _episode; }
+
+    ~AllocProbe() {
+        g_report.Add(_ticks, _allocating_ticks, _allocs);
+    }
+
+private:
+    const int _warmup_games;
+    const int _warmup;
+    const uint64_t _target_ticks;
+    TickProfiler *_profiler;
+    bool _measuring = false;
+    int _episode = 0;
+    int _episode_tick = 0;
+    uint64_t _last = 0;
+    uint64_t _ticks = 0, _allocating_ticks = 0, _allocs = 0;
+};
+
+atomic<int> AllocProbe::num_measuring(0);
+atomic<int> AllocProbe::num_done(0);
+
+void print_profile(const TickProfiler &profiler) {
+    cout << "Per phase (measured window):" << endl;
+    for (const auto &item : profiler.Summary()) {
+        cout << "  " << item.first << ": calls " << (uint64_t)item.second.at("count")
+             << " allocs " << (uint64_t)item.second.at("allocs") << endl;
+    }
+}
+
+int run_rts() {
+    const vector<string> players = CmdLineUtils::split(arg("players", "simple,simple"), ',');
+    const int warmup = arg("warmup", 500);
+    const uint64_t ticks = arg("ticks", 5000);
+
+    RTSGameOptions op;
+    op.seed = arg("seed", 1);
+    op.max_tick = warmup + ticks + 1;
+    op.tick_prompt_n_step = -1;
+    RTSGame game(op);
+    TickProfiler profiler;
+    game.SetProfiler(&profiler);
+    for (const string &p : players) {
+        AI *ai = AI::CreateAI(p, "1");
+        if (ai == nullptr) {
+            cerr << "Unknown player " << p << endl;
+            return 2;
+        }
+        game.AddBot(ai);
+    }
+    AllocProbe *probe = new AllocProbe(arg("warmup_games", 20), warmup, ticks, &profiler);
+    game.AddSpectator(probe);
+
+    for (int g = 0; probe->ticks() < ticks; ++g) {
+        const uint64_t measured = probe->ticks();
+        game.MainLoop();
+        cout << "Game " << g << " ended at tick " << game.GetCmdReceiver()->GetTick() << ", measured " << probe->ticks() - measured << " ticks" << endl;
+        game.Reset();
+    }
+    print_profile(profiler);
+    return 0;
+}
+
+// Stand-in for WrapperCallbacks of the Python module, without Python.
+class ElfCallbacks {
+public:
+    static atomic<int> num_episodes;
+
+    ElfCallbacks(int game_idx, const ContextOptions &context_options, const PythonOptions &options, Context::Comm *comm)
+        : _game_idx(game_idx), _context_options(context_options), _options(options), _comm(comm) { }
+
+    void OnGameOptions(RTSGameOptions *op) { op->tick_prompt_n_step = -1; }
+
+    void OnGameInit(RTSGame *game) {
+        for (const AIOptions &opt : _options.ai_options) {
+            if (opt.type == "AI_NN") {
+                _ai_comm.reset(new Context::AIComm(_game_idx, _comm));
+                auto &hstate = _ai_comm->info().data;
+                hstate.InitHist(_context_options.T);
+                for (auto &item : hstate.v()) item.Init(_game_idx, GameDef::GetNumAction());
+                game->AddBot(new TrainedAI2(opt, nullptr, _ai_comm.get()));
+            } else if (opt.type == "AI_HIT_AND_RUN") {
+                game->AddBot(new HitAndRunAI(opt, nullptr));
+            } else {
+                game->AddBot(new SimpleAI(opt, nullptr));
+            }
+        }
+        game->AddSpectator(new AllocProbe(arg("warmup_games", 20), arg("warmup", 500), arg("ticks", 5000)));
+    }
+
+    void OnEpisodeStart(int, std::mt19937 *, RTSGame *) { num_episodes ++; }
+
+private:
+    int _game_idx;
+    const ContextOptions &_context_options;
+    const PythonOptions &_options;
+    Context::Comm *_comm;
+    unique_ptr<Context::AIComm> _ai_comm;
+};
+
+atomic<int> ElfCallbacks::num_episodes(0);
+
+int run_elf() {
+    const int num_games = arg("games", 1);
+    const int warmup = arg("warmup", 500);
+
+    ContextOptions co;
+    co.num_games = num_games;
+    co.T = 1;
+    PythonOptions options;
+    options.seed = arg("seed", 1);
+    options.max_tick = 30000;
+    AIOptions nn;
+    nn.type = "AI_NN";
+    nn.fs = 1;
+    AIOptions opponent;
+    opponent.type = arg("opponent", "AI_SIMPLE");
+    opponent.fs = 1;
+    options.AddAIOptions(nn);
+    options.AddAIOptions(opponent);
+
+    unique_ptr<Context> context(new Context(co, options));
+    GroupStat gstat;
+    gstat.hist_len = 1;
+    const int gid = context->comm().AddCollectors(num_games, 0, gstat);
+
+    // Buffers the trainer would bind, sized like in the Python module.
+    map<string, int> sizes = {
+        { "s", (GameDef::GetNumUnitType() + 7) * 20 * 20 }, { "res", 2 * NUM_RES_SLOT }, { "last_r", 1 }, { "id", 1 },
+        { "a", 1 }, { "V", 1 }, { "pi", GameDef::GetNumAction() }
+    };
+    map<string, size_t> type_sizes = { { "float", 4 }, { "int32_t", 4 }, { "int64_t", 8 }, { "char", 1 }, { "unsigned char", 1 } };
+    vector<vector<char>> buffers;
+    int64_t *actions = nullptr;
+    for (const char *input_reply : { "input", "reply" }) {
+        for (const string &key : (strcmp(input_reply, "input") == 0 ? vector<string>{ "s", "res", "last_r", "id" } : vector<string>{ "a", "V", "pi" })) {
+            auto *mm = GameState::get_mm(key);
+            buffers.emplace_back(sizes[key] * type_sizes[mm->type()] * num_games);
+            EntryInfo e(key, mm->type());
+            e.p = reinterpret_cast<uint64_t>(buffers.back().data());
+            e.byte_size = buffers.back().size();
+            context->comm().GetCollectorGroup(gid).AddEntry(input_reply, e);
+            if (key == "a") actions = reinterpret_cast<int64_t *>(buffers.back().data());
+        }
+    }
+
+    WrapperT<ElfCallbacks, Context::Comm, PythonOptions> wrapper;
+    context->Start([&](int game_idx, const ContextOptions &co, const PythonOptions &options, const std::atomic_bool &done, Context::Comm *comm) {
+        wrapper.thread_main(game_idx, co, options, done, comm);
+    });
+
+    // The trainer: random actions.
+    std::mt19937 rng(options.seed);
+    const int num_action = GameDef::GetNumAction();
+    uint64_t measured_steps = 0, allocating_steps = 0, step_allocs = 0;
+    auto step = [&]() {
+        Infos infos = context->Wait(0);
+        for (int j = 0; j < infos.batchsize; ++j) actions[j] = rng() % num_action;
+        context->Steps(infos);
+    };
+    // Until every game measures.
+    for (int i = 0; i < warmup || AllocProbe::num_measuring.load() < num_games; ++i) step();
+
+    wrapper.GetProfiler().Reset();
+    const uint64_t total_before = AllocCounter::TotalCount();
+    const int episodes_before = ElfCallbacks::num_episodes.load();
+    if (arg("trace_trainer", 0)) AllocCounter::TraceThread(g_report.trace_budget.exchange(0));
+    // Until every game has measured its ticks.
+    while (AllocProbe::num_done.load() < num_games) {
+        const uint64_t before = AllocCounter::ThreadCount();
+        step();
+        const uint64_t n = AllocCounter::ThreadCount() - before;
+        measured_steps ++;
+        if (n > 0) {
+            allocating_steps ++;
+            step_allocs += n;
+        }
+    }
+    const uint64_t total_allocs = AllocCounter::TotalCount() - total_before;
+    const int episodes = ElfCallbacks::num_episodes.load() - episodes_before;
+    print_profile(wrapper.GetProfiler());
+
+    context->Stop();
+    context.reset();
+
+    cout << "Trainer steps: " << measured_steps << ", allocating: " << allocating_steps << ", allocations: " << step_allocs << endl;
+    cout << "All threads: " << total_allocs << " allocations in the window, " << episodes << " episodes started" << endl;
+    if (allocating_steps > 0) return 1;
+    // Other threads (collectors) are only checked if no game restarted.
+    if (episodes == 0 && total_allocs > 0) return 1;
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (! bench::ParseArgs(argc, argv)) return 2;
+
+    GameDef::GlobalInit();
+    TickProfiler::SetAllocCounter(&AllocCounter::ThreadCount);
+    g_report.trace_budget = arg("trace", 0);
+
+    const string mode = arg("mode", "rts");
+    int ret = 0;
+    if (mode == "rts") ret = run_rts();
+    else if (mode == "elf") ret = run_elf();
+    else {
+        cerr << "Unknown mode " << mode << endl;
+        return 2;
+    }
+    if (ret == 2) return ret;
+
+    cout << "Ticks measured: " << g_report.ticks << ", allocating: " << g_report.allocating_ticks
+         << ", allocations: " << g_report.allocs << endl;
+    if (g_report.allocating_ticks > 0) ret = 1;
+    cout << (ret == 0 ? "PASS" : "FAIL") << endl;
+    return ret;
+}
@@ -0,0 +1,219 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: bench.cc
+// Throughput benchmark of the RTS engine: runs headless games between rule
+// based bots on a few threads, and reports ticks/sec, the durations and
+// allocations of each tick phase, and the memory footprint as JSON.
+//
+// Usage: minirts-bench [key=value ...]
+//   players=simple,simple   bots, by the names registered by the game
+//                  (GAME_DIR): simple, hit_and_run (MC); td_simple,
+//                  td_built_in (TD); flag_simple (CF). "dummy" does nothing.
+//   games=64       #games, over all threads.
+//   threads=1      #threads, each plays its share of games one after another.
+//   map=20         map size (map x map).
+//   max_tick=30000
+//   frame_skip=1
+//   seed=1         0 for a seed from the clock.
+//   jps=0          1 for jump point search in path planning.
+//   format=json    json or text.
+//   output=FILE    write the report to FILE instead of stdout.
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_args.h"
+#include "elf/alloc_counter.h"
+#include "engine/cmd_util.h"
+#include "engine/game.h"
+#include "json.hpp"
+#include "ai.h"
+
+using namespace std;
+using bench::arg;
+using elf::AllocCounter;
+using json = nlohmann::json;
+
+namespace {
+
+// Peak and current resident set size in kB, from /proc (0 if unavailable).
+void read_rss(uint64_t *peak_kb, uint64_t *current_kb) {
+    *peak_kb = *current_kb = 0;
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) *peak_kb = std::stoull(line.substr(6));
+        else if (line.compare(0, 6, "VmRSS:") == 0) *current_kb = std::stoull(line.substr(6));
+    }
+}
+
+// What the threads play, and what they bring back.
+struct Result {
+    uint64_t games = 0;
+    uint64_t ticks = 0;
+    // Indexed by winner + 1 (INVALID: no winner).
+    vector<uint64_t> wins;
+    double busy_s = 0.0;
+};
+
+bool add_players(const vector<string> &players, int frame_skip, RTSGame *game) {
+    for (const string &p : players) {
+        AI *ai = p == "dummy" ? new AI("dummy", frame_skip, nullptr) : AI::CreateAI(p, std::to_string(frame_skip));
+        if (ai == nullptr) {
+            cerr << "Unknown player " << p << endl;
+            return false;
+        }
+        game->AddBot(ai);
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (! bench::ParseArgs(argc, argv)) return 2;
+
+    GameDef::GlobalInit();
+    TickProfiler::SetAllocCounter(&AllocCounter::ThreadCount);
+
+    const vector<string> players = CmdLineUtils::split(arg("players", "simple,simple"), ',');
+    const int num_games = arg("games", 64);
+    const int num_threads = std::max(arg("threads", 1), 1);
+    const int map_size = arg("map", 20);
+    const int max_tick = arg("max_tick", 30000);
+    const int frame_skip = arg("frame_skip", 1);
+    const int seed = arg("seed", 1);
+    const bool jps = arg("jps", 0) != 0;
+    const string format = arg("format", "json");
+
+    // Check the players before starting the threads.
+    {
+        RTSGameOptions op;
+        op.map_size = map_size;
+        RTSGame game(op);
+        if (! add_players(players, frame_skip, &game)) return 2;
+    }
+
+    TickProfiler profiler;
+    atomic<int> next_game(0);
+    vector<Result> results(num_threads);
+    vector<thread> threads;
+
+    AllocCounter::ResetPeak();
+    const uint64_t allocs_before = AllocCounter::TotalCount();
+    const uint64_t bytes_before = AllocCounter::TotalBytes();
+    const int64_t live_before = AllocCounter::LiveBytes();
+    const auto start = chrono::steady_clock::now();
+
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            Result &r = results[t];
+            r.wins.assign(players.size() + 1, 0);
+            const auto thread_start = chrono::steady_clock::now();
+
+            RTSGameOptions op;
+            op.seed = seed == 0 ? 0 : seed + t * 241;
+            op.max_tick = max_tick;
+            op.map_size = map_size;
+            op.tick_prompt_n_step = -1;
+            op.jump_point_search = jps;
+            RTSGame game(op);
+            game.SetProfiler(&profiler);
+            add_players(players, frame_skip, &game);
+
+            while (next_game.fetch_add(1) < num_games) {
+                const PlayerId winner = game.MainLoop();
+                r.games ++;
+                // MainLoop returns at the tick the game ends, without counting it.
+                r.ticks += game.GetCmdReceiver()->GetTick() + 1;
+                if (winner >= 0 && winner < (PlayerId)players.size()) r.wins[winner + 1] ++;
+                else r.wins[0] ++;
+                game.Reset();
+            }
+            r.busy_s = chrono::duration<double>(chrono::steady_clock::now() - thread_start).count();
+        });
+    }
+    for (auto &th : threads) th.join();
+
+    const double wall_s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    const uint64_t allocs = AllocCounter::TotalCount() - allocs_before;
+    const uint64_t alloc_bytes = AllocCounter::TotalBytes() - bytes_before;
+
+    Result total;
+    total.wins.assign(players.size() + 1, 0);
+    for (const Result &r : results) {
+        total.games += r.games;
+        total.ticks += r.ticks;
+        total.busy_s += r.busy_s;
+        for (size_t i = 0; i < r.wins.size(); ++i) total.wins[i] += r.wins[i];
+    }
+    uint64_t rss_peak_kb, rss_kb;
+    read_rss(&rss_peak_kb, &rss_kb);
+
+    json report;
+    report["config"] = {
+        { "players", players }, { "games", num_games }, { "threads", num_threads }, { "map", map_size },
+        { "max_tick", max_tick }, { "frame_skip", frame_skip }, { "seed", seed }, { "jps", jps }
+    };
+    report["games"] = total.games;
+    report["ticks"] = total.ticks;
+    report["wall_s"] = wall_s;
+    report["ticks_per_sec"] = wall_s > 0 ? total.ticks / wall_s : 0.0;
+    report["ticks_per_sec_per_thread"] = total.busy_s > 0 ? total.ticks / total.busy_s : 0.0;
+    json wins;
+    wins["none"] = total.wins[0];
+    for (size_t i = 0; i < players.size(); ++i) wins[std::to_string(i)] = total.wins[i + 1];
+    report["wins"] = wins;
+
+    json phases;
+    for (const auto &item : profiler.Summary()) phases[item.first] = item.second;
+    report["phases"] = phases;
+
+    report["allocations"] = {
+        { "count", allocs }, { "bytes", alloc_bytes },
+        { "per_tick", total.ticks > 0 ? (double)allocs / total.ticks : 0.0 }
+    };
+    report["memory"] = {
+        { "peak_live_bytes", AllocCounter::PeakLiveBytes() - live_before },
+        { "live_bytes", AllocCounter::LiveBytes() - live_before },
+        { "peak_rss_kb", rss_peak_kb }, { "rss_kb", rss_kb }
+    };
+
+    stringstream ss;
+    if (format == "json") {
+        ss << report.dump(2) << endl;
+    } else {
+        ss << "Games: " << total.games << " ticks: " << total.ticks << " in " << wall_s << "s, "
+           << report["ticks_per_sec"].get<double>() << " ticks/s ("
+           << report["ticks_per_sec_per_thread"].get<double>() << " per thread)" << endl;
+        ss << profiler.PrintInfo();
+        ss << "Allocations: " << allocs << " (" << alloc_bytes << " bytes), peak live " << AllocCounter::PeakLiveBytes() - live_before
+           << " bytes, peak RSS " << rss_peak_kb << " kB" << endl;
+    }
+
+    const string output = arg("output", "");
+    if (output.empty()) {
+        cout << ss.str();
+    } else {
+        ofstream f(output);
+        if (! f) {
+            cerr << "Cannot write to " << output << endl;
+            return 1;
+        }
+        f << ss.str();
+    }
+    return 0;
+}
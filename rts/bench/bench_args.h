@@ -0,0 +1,52 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: bench_args.h
+// Command line of the tools in this directory: key=value arguments, each read
+// with its default where it is used, e.g., arg("games", 64).
+
+#ifndef _BENCH_ARGS_H_
+#define _BENCH_ARGS_H_
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "engine/cmd_util.h"
+
+namespace bench {
+
+inline std::map<std::string, std::string> &args() {
+    static std::map<std::string, std::string> args;
+    return args;
+}
+
+// Returns false (and says why) if an argument is not key=value.
+inline bool ParseArgs(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::vector<std::string> kv = CmdLineUtils::split(argv[i], '=');
+        if (kv.size() != 2) {
+            std::cerr << "Arguments are key=value, got " << argv[i] << std::endl;
+            return false;
+        }
+        args()[kv[0]] = kv[1];
+    }
+    return true;
+}
+
+inline std::string arg(const std::string &key, const std::string &def) {
+    auto it = args().find(key);
+    return it == args().end() ? def : it->second;
+}
+inline int arg(const std::string &key, int def) { return std::stoi(arg(key, std::to_string(def))); }
+
+}  // namespace bench
+
+#endif
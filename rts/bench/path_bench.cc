@@ -0,0 +1,290 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: path_bench.cc
+// Path planning benchmark on synthetic large maps: for long queries between
+// random cells, compares flat A* capped as in micro_move (and uncapped), a
+// flow field per target, and hierarchical path finding over the cluster
+// graph. Each method produces the first kAhead cells of a route, which is
+// what a unit needs to pick its next waypoint. Reports success rates, time
+// per query and route lengths (relative to the shortest) as JSON.
+//
+// Usage: minirts-path-bench [key=value ...]
+//   terrains=scatter,rooms,maze   scatter: random impassable cells; rooms:
+//                  walls with doors; maze: corridors 2 cells wide.
+//   sizes=64,128,256,512          map sizes (size x size).
+//   queries=200    #queries per map, between cells at least size / 2 apart.
+//   changes=200    #buildings added then removed on each map, one query each.
+//   max_iteration=1000            cap of the flat A*.
+//   seed=1
+//   format=json    json or text.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_args.h"
+#include "engine/cmd_util.h"
+#include "engine/map.h"
+#include "engine/path_search.h"
+#include "json.hpp"
+
+using namespace std;
+using bench::arg;
+using json = nlohmann::json;
+
+namespace {
+
+const size_t kAhead = 16;
+
+class Timer {
+public:
+    Timer() : _start(chrono::steady_clock::now()) { }
+    double us() const { return chrono::duration<double, micro>(chrono::steady_clock::now() - _start).count(); }
+private:
+    chrono::steady_clock::time_point _start;
+};
+
+void set_impassable(RTSMap *m, int x, int y) {
+    if (m->IsIn(x, y)) (*m)(m->GetLoc(x, y)).type = IMPASSABLE;
+}
+
+void generate_scatter(RTSMap *m, mt19937 *rng) {
+    const int size = m->GetXSize();
+    uniform_int_distribution<int> coord(0, size - 1);
+    for (int i = 0; i < size * size / 4; ++i) set_impassable(m, coord(*rng), coord(*rng));
+}
+
+// Square rooms, each wall segment between two rooms with a door 2 cells wide.
+void generate_rooms(RTSMap *m, mt19937 *rng) {
+    const int size = m->GetXSize();
+    const int kRoom = 12;
+    uniform_int_distribution<int> door(1, kRoom - 3);
+    for (int w = kRoom; w < size; w += kRoom) {
+        for (int i = 0; i < size; ++i) {
+            set_impassable(m, w, i);
+            set_impassable(m, i, w);
+        }
+    }
+    for (int w = kRoom; w < size; w += kRoom) {
+        for (int start = 0; start < size; start += kRoom) {
+            const int x = start + door(*rng), y = start + door(*rng);
+            for (int d = 0; d < 2; ++d) {
+                (*m)(m->GetLoc(w, std::min(x + d, size - 1))).type = NORMAL;
+                (*m)(m->GetLoc(std::min(y + d, size - 1), w)).type = NORMAL;
+            }
+        }
+    }
+}
+
+// Depth first maze on a grid of 3 x 3 blocks: 2 x 2 of corridor, 1 of wall.
+void generate_maze(RTSMap *m, mt19937 *rng) {
+    const int size = m->GetXSize();
+    const int cells = size / 3;
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) set_impassable(m, x, y);
+    }
+    auto open_block = [&](int x0, int y0, int w, int h) {
+        for (int x = x0; x < x0 + w; ++x) {
+            for (int y = y0; y < y0 + h; ++y) (*m)(m->GetLoc(x, y)).type = NORMAL;
+        }
+    };
+    vector<uint8_t> visited(cells * cells, 0);
+    vector<int> stack(1, 0);
+    visited[0] = 1;
+    open_block(0, 0, 2, 2);
+    while (! stack.empty()) {
+        const int c = stack.back();
+        const int cx = c % cells, cy = c / cells;
+        int next[4], num_next = 0;
+        if (cx > 0 && ! visited[c - 1]) next[num_next++] = c - 1;
+        if (cx < cells - 1 && ! visited[c + 1]) next[num_next++] = c + 1;
+        if (cy > 0 && ! visited[c - cells]) next[num_next++] = c - cells;
+        if (cy < cells - 1 && ! visited[c + cells]) next[num_next++] = c + cells;
+        if (num_next == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const int n = next[uniform_int_distribution<int>(0, num_next - 1)(*rng)];
+        const int nx = n % cells, ny = n / cells;
+        open_block(nx * 3, ny * 3, 2, 2);
+        // The wall between the two blocks.
+        open_block(std::min(cx, nx) * 3 + (nx != cx ? 2 : 0), std::min(cy, ny) * 3 + (ny != cy ? 2 : 0), nx != cx ? 1 : 2, ny != cy ? 1 : 2);
+        visited[n] = 1;
+        stack.push_back(n);
+    }
+}
+
+struct Query {
+    Loc from, to;
+    float dist;
+};
+
+struct Method {
+    int found = 0;
+    double us = 0;
+    // Sum of route length / shortest distance, over the routes found.
+    double ratio = 0;
+
+    void Add(bool ok, double t, double length, double shortest) {
+        us += t;
+        if (! ok) return;
+        found ++;
+        ratio += length / shortest;
+    }
+    json Report(size_t num_queries) const {
+        json j = {
+            { "success_rate", (double)found / num_queries },
+            { "us_per_query", us / num_queries }
+        };
+        if (ratio > 0) j["length_ratio"] = ratio / found;
+        return j;
+    }
+};
+
+json bench_map(const string &terrain, int size, int num_queries, int num_changes, int max_iteration, mt19937 *rng) {
+    RTSMap m;
+    m.SetSize(size, size);
+    if (terrain == "scatter") generate_scatter(&m, rng);
+    else if (terrain == "rooms") generate_rooms(&m, rng);
+    else if (terrain == "maze") generate_maze(&m, rng);
+    else throw std::range_error("Unknown terrain " + terrain);
+    m.TerrainChanged();
+    // One field per query: none of them is reused, as with moving targets.
+    m.SetDistanceFieldCacheSize(0);
+    m.SetFlowFieldCacheSize(0);
+
+    // Long queries between cells that can reach each other.
+    const int plane = m.GetPlaneSize();
+    uniform_int_distribution<Loc> cell(0, plane - 1);
+    vector<Query> queries;
+    for (int trial = 0; (int)queries.size() < num_queries && trial < num_queries * 100; ++trial) {
+        const Loc from = cell(*rng), to = cell(*rng);
+        if (! m.IsTerrainPassable(m.GetCoord(from)) || ! m.IsTerrainPassable(m.GetCoord(to))) continue;
+        const float dist = m.GetTerrainDistance(from, to);
+        if (dist == kUnreachableDist || dist < size / 2) continue;
+        queries.push_back(Query{from, to, dist});
+    }
+
+    Method astar, astar_capped, flow, hpa;
+    vector<Loc> cells;
+    GridSearch &search = GridSearch::ThreadLocal(size, size);
+    auto passable = [&](Loc l) { return m.IsTerrainPassable(m.GetCoord(l)); };
+
+    for (const Query &q : queries) {
+        const int tx = q.to % size, ty = q.to / size;
+        auto heuristic = [&](Loc l) { return (float)(std::abs(l % size - tx) + std::abs(l / size - ty)); };
+        float cost = 0;
+        Timer t;
+        Loc l = search.Search(q.from, q.to, max_iteration, false, passable, heuristic, &cost);
+        astar_capped.Add(l == q.to, t.us(), cost, q.dist);
+
+        Timer t2;
+        l = search.Search(q.from, q.to, plane + 1, false, passable, heuristic, &cost);
+        astar.Add(l == q.to, t2.us(), cost, q.dist);
+    }
+
+    Timer build;
+    m.GetClusterRoute(queries.empty() ? 0 : queries[0].from, queries.empty() ? 0 : queries[0].to, kAhead, &cells);
+    const double build_us = build.us();
+
+    for (const Query &q : queries) {
+        Timer t;
+        FlowFieldCache::FieldPtr field = m.GetFlowField(q.to);
+        cells.clear();
+        for (Loc l = field->Next(q.from); l != INVALID && cells.size() < kAhead; l = field->Next(l)) cells.push_back(l);
+        flow.Add(! cells.empty(), t.us(), field->Get(q.from), q.dist);
+
+        Timer t2;
+        const float dist = m.GetClusterRoute(q.from, q.to, kAhead, &cells);
+        hpa.Add(! cells.empty(), t2.us(), dist, q.dist);
+    }
+
+    // Buildings popping up and disappearing, each followed by a query.
+    Method repair;
+    size_t num_reachable = 0;
+    vector<PointF> buildings;
+    uniform_real_distribution<float> coord(0, size - 1);
+    for (int i = 0; i < 2 * num_changes && ! queries.empty(); ++i) {
+        const Query &q = queries[i % queries.size()];
+        Timer t;
+        if (i < num_changes) {
+            buildings.push_back(PointF(coord(*rng), coord(*rng)));
+            m.AddBuilding(buildings.back());
+        } else {
+            m.RemoveBuilding(buildings[i - num_changes]);
+        }
+        const float dist = m.GetClusterRoute(q.from, q.to, kAhead, &cells);
+        const double us = t.us();
+        // Buildings may have made the route longer, or cut it.
+        const float shortest = m.GetFlowField(q.to)->Get(q.from);
+        if (shortest == kUnreachableDist) continue;
+        num_reachable ++;
+        repair.Add(! cells.empty(), us, dist, shortest);
+    }
+
+    const ClusterGraph &graph = m.GetClusterGraph();
+    json report = {
+        { "terrain", terrain }, { "size", size }, { "queries", queries.size() },
+        { "astar_capped", astar_capped.Report(queries.size()) },
+        { "astar", astar.Report(queries.size()) },
+        { "flow_field", flow.Report(queries.size()) },
+        { "hpa", hpa.Report(queries.size()) },
+        { "hpa_after_change", repair.Report(num_reachable) },
+        { "cluster_graph", {
+            { "clusters", graph.num_clusters() }, { "nodes", graph.num_nodes() }, { "build_ms", build_us / 1000 }
+        } }
+    };
+    report["astar_capped"]["max_iteration"] = max_iteration;
+    return report;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (! bench::ParseArgs(argc, argv)) return 2;
+
+    const vector<string> terrains = CmdLineUtils::split(arg("terrains", "scatter,rooms,maze"), ',');
+    const vector<string> sizes = CmdLineUtils::split(arg("sizes", "64,128,256,512"), ',');
+    const int num_queries = arg("queries", 200);
+    const int num_changes = arg("changes", 200);
+    const int max_iteration = arg("max_iteration", 1000);
+    const string format = arg("format", "json");
+    mt19937 rng(arg("seed", 1));
+
+    json maps = json::array();
+    for (const string &terrain : terrains) {
+        for (const string &size : sizes) {
+            try {
+                maps.push_back(bench_map(terrain, std::stoi(size), num_queries, num_changes, max_iteration, &rng));
+            } catch (const std::range_error &e) {
+                cerr << e.what() << endl;
+                return 2;
+            }
+        }
+    }
+
+    if (format == "json") {
+        cout << maps.dump(2) << endl;
+        return 0;
+    }
+    for (const json &r : maps) {
+        cout << r["terrain"].get<string>() << " " << r["size"] << "x" << r["size"] << ", " << r["queries"] << " queries, "
+             << r["cluster_graph"]["nodes"] << " nodes built in " << r["cluster_graph"]["build_ms"] << " ms" << endl;
+        for (const char *method : { "astar_capped", "astar", "flow_field", "hpa", "hpa_after_change" }) {
+            const json &j = r[method];
+            cout << "  " << method << ": success " << j["success_rate"] << ", " << j["us_per_query"] << " us/query";
+            if (j.count("length_ratio")) cout << ", length x" << j["length_ratio"];
+            cout << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+//File: reset_check.cc
+// Checks that resetting a game forgets what the players knew of the last one:
+// plays games between rule based bots, and after each reset, that no player
+// has explored (or sees) any cell yet. Exits with 1 otherwise.
+//
+// Usage: minirts-reset-check [key=value ...]
+//   players=simple,simple   bots (see minirts-bench).
+//   games=3        #games, each followed by a reset.
+//   max_tick=2000
+//   seed=1
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_args.h"
+#include "engine/cmd_util.h"
+#include "engine/game.h"
+#include "ai.h"
+
+using namespace std;
+using bench::arg;
+
+namespace {
+
+// #cells explored and visible, over all players.
+void count_fog(const GameEnv &env, int *explored, int *visible) {
+    *explored = *visible = 0;
+    const int plane = env.GetMap().GetPlaneSize();
+    for (PlayerId id = 0; id < env.GetNumOfPlayers(); ++id) {
+        const Player &player = env.GetPlayer(id);
+        for (Loc l = 0; l < plane; ++l) {
+            if (player.HasExplored(l)) (*explored) ++;
+            if (player.CanSeeTerrain(l)) (*visible) ++;
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    if (! bench::ParseArgs(argc, argv)) return 2;
+
+    GameDef::GlobalInit();
+
+    RTSGameOptions op;
+    op.seed = arg("seed", 1);
+    op.max_tick = arg("max_tick", 2000);
+    op.tick_prompt_n_step = -1;
+    RTSGame game(op);
+    for (const string &p : CmdLineUtils::split(arg("players", "simple,simple"), ',')) {
+        AI *ai = AI::CreateAI(p, "1");
+        if (ai == nullptr) {
+            cerr << "Unknown player " << p << endl;
+            return 2;
+        }
+        game.AddBot(ai);
+    }
+
+    bool ok = true;
+    const int num_games = arg("games", 3);
+    for (int i = 0; i < num_games; ++i) {
+        game.MainLoop();
+        int explored, visible;
+        count_fog(game.GetGameEnv(), &explored, &visible);
+        if (explored == 0) {
+            cerr << "Game " << i << ": nothing explored after playing, the check is void" << endl;
+            ok = false;
+        }
+
+        game.Reset();
+        count_fog(game.GetGameEnv(), &explored, &visible);
+        cout << "Game " << i << ": after reset, explored cells: " << explored << ", visible cells: " << visible << endl;
+        if (explored != 0 || visible != 0) ok = false;
+    }
+
+    cout << (ok ? "OK" : "FAIL") << endl;
+    return ok ? 0 : 1;
+}
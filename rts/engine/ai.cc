@@ -16,7 +16,9 @@
 std::map<std::string, std::function<AI *(const std::string &spec)>> AI::_factories;
 
 bool AI::gather_decide(const GameEnv &env, std::function<bool (const GameEnv&, string *, AssignedCmds *)> func) {
-    string state_string;
+    // Reuse the buffer of the previous call.
+    string &state_string = _state_string;
+    state_string.clear();
     AssignedCmds assigned_cmds;
 
     // cout << "Before gathering info" << endl << flush;
@@ -48,8 +50,8 @@ void AI::actual_send_cmds(const GameEnv &env, AssignedCmds &assigned_cmds) {
 }
 
 void AI::SendComment(const string& s) {
-    // Finally send these commands.
-    if (_receiver != nullptr) {
+    // Comments are only kept in replays and command dumps.
+    if (_receiver != nullptr && _receiver->GetUseCmdComment()) {
         auto cmt = "[" + std::to_string(_player_id) + "] " + s;
         _receiver->SendCmd(CmdBPtr(new CmdComment(INVALID, cmt)));
     }
@@ -23,6 +23,9 @@ protected:
     const std::string _name;
     CmdReceiver *_receiver;
 
+    // Filled by the rule actor in gather_decide().
+    std::string _state_string;
+
     // Run Act() every _frame_skip
     int _frame_skip;
 
@@ -75,6 +78,16 @@ public:
         return true;
     }
 
+    // Two-phase Act(), used by RTSGame so that all bots of a game can send
+    // their states to the model together. PrepareAct() is called on every bot
+    // before FinishAct() is called on any of them. By default all the work is
+    // done in FinishAct().
+    virtual void PrepareAct(const GameEnv &env, bool must_act = false) {
+        (void)env;
+        (void)must_act;
+    }
+    virtual bool FinishAct(const GameEnv &env, bool must_act = false) { return Act(env, must_act); }
+
     // Get called when we start a new game.
     virtual void Reset() { }
 
@@ -114,16 +127,22 @@ template <typename AIComm>
 class AIWithComm : public AI {
 public:
     using Data = typename AIComm::Data;
+    using AICommGroup = typename AIComm::Group;
 
 protected:
     AIComm *_ai_comm;
     std::function<AI* (int)> _factory;
 
+    // If set, requests are sent jointly with the other bots of the game.
+    AICommGroup *_comm_group = nullptr;
+    bool _reply_pending = false;
+
     vector<int> _state;
 
     // This function is called by Act.
     // In specific situations (e.g., MCTS), it is used separately to get the value of the current situation.
     bool send_data_wait_reply(const GameEnv& env);
+    void prepare_data(const GameEnv& env);
 
     string plot_structured_state(const Data &data) const;
 
@@ -141,6 +160,10 @@ public:
         : AI(name, frame_skip, receiver), _ai_comm(ai_comm) {
     }
     bool Act(const GameEnv &env, bool must_act = false) override;
+    void PrepareAct(const GameEnv &env, bool must_act = false) override;
+    bool FinishAct(const GameEnv &env, bool must_act = false) override;
+
+    void SetCommGroup(AICommGroup *comm_group) { _comm_group = comm_group; }
 
     // Get called when we start a new game.
     void Reset() override { if (_ai_comm != nullptr) _ai_comm->Restart(); }
@@ -175,12 +198,41 @@ bool AIWithComm<AIComm>::Act(const GameEnv &env, bool must_act) {
 }
 
 template <typename AIComm>
-bool AIWithComm<AIComm>::send_data_wait_reply(const GameEnv& env) {
+void AIWithComm<AIComm>::PrepareAct(const GameEnv &env, bool must_act) {
+    _reply_pending = false;
+    if (_comm_group == nullptr) return;
+
+    Tick t = _receiver->GetTick();
+    if (! must_act && ! NeedAct(t)) return;
+    if (need_structured_state(t)) {
+        prepare_data(env);
+        _comm_group->Add(_ai_comm);
+        _reply_pending = true;
+    }
+}
+
+template <typename AIComm>
+bool AIWithComm<AIComm>::FinishAct(const GameEnv &env, bool must_act) {
+    if (! _reply_pending) return Act(env, must_act);
+    _reply_pending = false;
+
+    // The first bot to get here sends the data of all bots in the group.
+    if (_comm_group->Flush()) return on_act(env);
+    else return false;
+}
+
+template <typename AIComm>
+void AIWithComm<AIComm>::prepare_data(const GameEnv& env) {
     _ai_comm->Prepare();
     Data *data = &_ai_comm->info().data;
     save_structured_state(env, data);
     on_save_data(data);
     // cout << PlotStructuredState(*_ai_comm->GetData()) << endl;
+}
+
+template <typename AIComm>
+bool AIWithComm<AIComm>::send_data_wait_reply(const GameEnv& env) {
+    prepare_data(env);
     return _ai_comm->SendDataWaitReply();
 }
 
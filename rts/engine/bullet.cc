@@ -19,8 +19,7 @@ string Bullet::Draw() const {
 // Unlike Unit, we don't do Act then PerformAct since collision check is not needed.
 CmdBPtr Bullet::Forward(const RTSMap&, const Units& units) {
     // First check whether the attacker is dead, if so, remove _id_from to avoid issues.
-    auto self_it = units.find(_id_from);
-    if (self_it == units.end()) _id_from = INVALID;
+    if (units.get(_id_from) == nullptr) _id_from = INVALID;
 
     // If it already exploded, the state changes until it goes to DONE.
     if (_state == BULLET_EXPLODE1) {
@@ -39,13 +38,13 @@ CmdBPtr Bullet::Forward(const RTSMap&, const Units& units) {
     // Change its state until it is done.
     PointF target;
     if (_target_id != INVALID) {
-        auto it = units.find(_target_id);
-        if (it == units.end()) {
+        const Unit *target_unit = units.get(_target_id);
+        if (target_unit == nullptr) {
             // The target is destroyed, destroy itself.
             _state = BULLET_DONE;
             return CmdBPtr();
         }
-        target = it->second->GetPointF();
+        target = target_unit->GetPointF();
     } else {
         if (_target_p.IsInvalid()) {
             _state = BULLET_DONE;
@@ -11,7 +11,7 @@
 #define _BULLET_H_
 
 #include "common.h"
-#include "unit.h"
+#include "unit_slot_map.h"
 
 // The class is used for flying bullets for long-range attacker and other visual effects,
 // E.g., visualization showing a unit is casting a spell (and can be interrupted before it is finished).
@@ -0,0 +1,277 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "cluster_graph.h"
+
+#include <algorithm>
+#include <limits>
+#include "path_search.h"
+
+void ClusterGraph::Build(int m, int n, std::vector<uint8_t> &&passable, int cluster_size) {
+    _m = m;
+    _n = n;
+    _size = cluster_size;
+    _cm = (m + _size - 1) / _size;
+    _cn = (n + _size - 1) / _size;
+
+    // A new graph: the one shared with copies (if any) stays theirs.
+    _graph = CowPtr<Graph>();
+    Graph &g = _graph.mut();
+    g.passable = std::move(passable);
+    g.clusters.assign(_cm * _cn, Cluster());
+    for (int cy = 0; cy < _cn; ++cy) {
+        for (int cx = 0; cx < _cm; ++cx) {
+            Cluster &c = g.clusters[cy * _cm + cx];
+            c.x0 = cx * _size;
+            c.y0 = cy * _size;
+            c.x1 = std::min(m, c.x0 + _size);
+            c.y1 = std::min(n, c.y0 + _size);
+        }
+    }
+    g.node_index.assign(m * n, -1);
+    _dirty.clear();
+    _marked.assign(g.clusters.size(), 0);
+
+    for (size_t i = 0; i < g.clusters.size(); ++i) rebuild(i);
+    _num_built ++;
+}
+
+void ClusterGraph::Invalidate() {
+    _graph = CowPtr<Graph>();
+    _dirty.clear();
+    _marked.clear();
+}
+
+void ClusterGraph::SetPassable(Loc loc, bool passable) {
+    if (! valid() || (_graph->passable[loc] != 0) == passable) return;
+    _graph.mut().passable[loc] = passable;
+    const int ci = cluster_of(loc);
+    if (! _marked[ci]) {
+        _marked[ci] = 1;
+        _dirty.push_back(ci);
+    }
+}
+
+size_t ClusterGraph::num_nodes() const {
+    size_t n = 0;
+    for (const Cluster &c : _graph->clusters) n += c.nodes.size();
+    return n;
+}
+
+// Calls f(inside, outside) on each crossing of the border between cluster
+// (cx, cy) and its neighbor to the east (or to the south), inside being the
+// cell of (cx, cy). Both clusters see the same crossings.
+template <typename F>
+void ClusterGraph::for_each_crossing(int cx, int cy, bool east, F f) const {
+    const std::vector<uint8_t> &passable = _graph->passable;
+    const Cluster &c = _graph->clusters[cy * _cm + cx];
+    const Loc first = east ? c.y0 * _m + c.x1 - 1 : (c.y1 - 1) * _m + c.x0;
+    const int along = east ? _m : 1;
+    const int across = east ? 1 : _m;
+    const int length = east ? c.y1 - c.y0 : c.x1 - c.x0;
+
+    int run = 0;
+    for (int i = 0; i <= length; ++i) {
+        const Loc l = first + i * along;
+        if (i < length && passable[l] && passable[l + across]) {
+            run ++;
+            continue;
+        }
+        if (run == 0) continue;
+        const Loc begin = l - run * along;
+        if (run < kMinDoubleEntrance) {
+            const Loc middle = begin + (run - 1) / 2 * along;
+            f(middle, middle + across);
+        } else {
+            const Loc end = l - along;
+            f(begin, begin + across);
+            f(end, end + across);
+        }
+        run = 0;
+    }
+}
+
+void ClusterGraph::rebuild(int ci) {
+    Graph &g = _graph.mut();
+    Cluster &c = g.clusters[ci];
+    for (const Node &node : c.nodes) g.node_index[node.loc] = -1;
+    c.nodes.clear();
+
+    auto add = [&](Loc inside, Loc outside) {
+        int &i = g.node_index[inside];
+        if (i < 0) {
+            i = c.nodes.size();
+            c.nodes.push_back(Node{inside, 0, {INVALID, INVALID}});
+        }
+        Node &node = c.nodes[i];
+        node.partners[node.num_partners++] = outside;
+    };
+    auto add_reversed = [&](Loc outside, Loc inside) { add(inside, outside); };
+
+    const int cx = ci % _cm, cy = ci / _cm;
+    if (cx > 0) for_each_crossing(cx - 1, cy, true, add_reversed);
+    if (cx < _cm - 1) for_each_crossing(cx, cy, true, add);
+    if (cy > 0) for_each_crossing(cx, cy - 1, false, add_reversed);
+    if (cy < _cn - 1) for_each_crossing(cx, cy, false, add);
+
+    // Distances are symmetric: one search per node fills its row and column.
+    const size_t k = c.nodes.size();
+    c.dist.assign(k * k, kUnreachableDist);
+    for (size_t i = 0; i < k; ++i) {
+        c.dist[i * k + i] = 0;
+        if (i + 1 == k) break;
+        fill_distances(c, c.nodes[i].loc, &_node_dist);
+        for (size_t j = i + 1; j < k; ++j) {
+            c.dist[i * k + j] = c.dist[j * k + i] = _node_dist[local(c, c.nodes[j].loc)];
+        }
+    }
+}
+
+void ClusterGraph::repair() {
+    if (_dirty.empty()) return;
+    // The crossings on the borders of a changed cluster may have moved, so
+    // its neighbors get new nodes too.
+    const size_t num_dirty = _dirty.size();
+    for (size_t i = 0; i < num_dirty; ++i) {
+        const int ci = _dirty[i];
+        const int cx = ci % _cm, cy = ci / _cm;
+        const int neighbors[] = {
+            cx > 0 ? ci - 1 : -1, cx < _cm - 1 ? ci + 1 : -1,
+            cy > 0 ? ci - _cm : -1, cy < _cn - 1 ? ci + _cm : -1
+        };
+        for (int nb : neighbors) {
+            if (nb >= 0 && ! _marked[nb]) {
+                _marked[nb] = 1;
+                _dirty.push_back(nb);
+            }
+        }
+    }
+    for (int ci : _dirty) {
+        rebuild(ci);
+        _marked[ci] = 0;
+    }
+    _num_repaired += _dirty.size();
+    _dirty.clear();
+}
+
+void ClusterGraph::fill_distances(const Cluster &c, Loc source, std::vector<float> *dist) {
+    // In the coordinates of the cluster: cell (x, y) is y * w + x.
+    const int w = c.x1 - c.x0, h = c.y1 - c.y0;
+    const Loc origin = c.y0 * _m + c.x0;
+    const std::vector<uint8_t> &passable = _graph->passable;
+    dist->assign(w * h, kUnreachableDist);
+    const int s = local(c, source);
+    (*dist)[s] = 0;
+    _queue.clear();
+    _queue.push_back(s);
+
+    for (size_t head = 0; head < _queue.size(); ++head) {
+        const int i = _queue[head];
+        const int x = i % w, y = i / w;
+        const float d = (*dist)[i] + 1;
+        auto visit = [&](int next, int dx, int dy) {
+            float &dn = (*dist)[next];
+            if (dn == kUnreachableDist && passable[origin + (y + dy) * _m + x + dx]) {
+                dn = d;
+                _queue.push_back(next);
+            }
+        };
+        if (x > 0) visit(i - 1, -1, 0);
+        if (x < w - 1) visit(i + 1, 1, 0);
+        if (y > 0) visit(i - w, 0, -1);
+        if (y < h - 1) visit(i + w, 0, 1);
+    }
+}
+
+struct ClusterGraph::Expand {
+    const ClusterGraph &g;
+    Loc from, to;
+    const Cluster &c_from, &c_to;
+
+    template <typename Relax>
+    void operator()(Loc l, Relax relax) const {
+        if (l == from) {
+            for (const Node &node : c_from.nodes) {
+                const float d = g._from_dist[g.local(c_from, node.loc)];
+                if (d != kUnreachableDist) relax(node.loc, d);
+            }
+            if (&c_from == &c_to) {
+                const float d = g._from_dist[g.local(c_from, to)];
+                if (d != kUnreachableDist) relax(to, d);
+            }
+        }
+        const int i = g._graph->node_index[l];
+        if (i < 0) return;
+
+        const Cluster &c = g._graph->clusters[g.cluster_of(l)];
+        const size_t k = c.nodes.size();
+        const float *row = &c.dist[i * k];
+        for (size_t j = 0; j < k; ++j) {
+            if ((int)j != i && row[j] != kUnreachableDist) relax(c.nodes[j].loc, row[j]);
+        }
+        const Node &node = c.nodes[i];
+        for (int j = 0; j < node.num_partners; ++j) relax(node.partners[j], 1.0f);
+        if (&c == &c_to) {
+            const float d = g._to_dist[g.local(c_to, l)];
+            if (d != kUnreachableDist) relax(to, d);
+        }
+    }
+};
+
+float ClusterGraph::FindPath(Loc from, Loc to, std::vector<Loc> *nodes) {
+    nodes->clear();
+    repair();
+    _num_searches ++;
+
+    const Cluster &c_from = _graph->clusters[cluster_of(from)];
+    const Cluster &c_to = _graph->clusters[cluster_of(to)];
+    fill_distances(c_from, from, &_from_dist);
+    fill_distances(c_to, to, &_to_dist);
+
+    const int tx = to % _m, ty = to / _m;
+    auto heuristic = [&](Loc l) { return (float)(std::abs(l % _m - tx) + std::abs(l / _m - ty)); };
+
+    GridSearch &search = GridSearch::ThreadLocal(_m, _n);
+    float cost = kUnreachableDist;
+    const Loc l = search.SearchGraph(from, to, std::numeric_limits<int>::max(),
+                                     Expand{*this, from, to, c_from, c_to}, heuristic, &cost);
+    if (l != to) return kUnreachableDist;
+
+    const std::vector<Loc> &path = search.GetNodes(to);
+    nodes->assign(path.rbegin(), path.rend());
+    return cost;
+}
+
+void ClusterGraph::Refine(const std::vector<Loc> &nodes, size_t max_cells, std::vector<Loc> *cells) {
+    cells->clear();
+    GridSearch &search = GridSearch::ThreadLocal(_m, _n);
+
+    for (size_t i = 1; i < nodes.size() && cells->size() < max_cells; ++i) {
+        const Loc a = nodes[i - 1], b = nodes[i];
+        const int bx = b % _m, by = b / _m;
+        if (std::abs(a % _m - bx) + std::abs(a / _m - by) == 1) {
+            cells->push_back(b);
+            continue;
+        }
+
+        // Not a crossing: both ends are in the same cluster, and so is the
+        // shortest path between them that the graph is built on.
+        const Cluster &c = _graph->clusters[cluster_of(b)];
+        auto passable = [&](Loc l) {
+            const int x = l % _m, y = l / _m;
+            return x >= c.x0 && x < c.x1 && y >= c.y0 && y < c.y1 && _graph->passable[l];
+        };
+        auto heuristic = [&](Loc l) { return (float)(std::abs(l % _m - bx) + std::abs(l / _m - by)); };
+        float cost;
+        if (search.Search(a, b, std::numeric_limits<int>::max(), false, passable, heuristic, &cost) != b) break;
+
+        const std::vector<Loc> &path = search.GetPath(b);
+        for (auto it = path.rbegin() + 1; it != path.rend(); ++it) cells->push_back(*it);
+    }
+}
@@ -0,0 +1,140 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _CLUSTER_GRAPH_H_
+#define _CLUSTER_GRAPH_H_
+
+#include <cstdint>
+#include <sstream>
+#include <vector>
+#include "common.h"
+#include "cow_ptr.h"
+#include "distance_field.h"
+#include "serializer.h"
+
+// Hierarchical path finding (HPA*) over an m x n map plane, 4 neighbors of
+// unit cost.
+//
+// The plane is cut into square clusters. Where two clusters touch, every run
+// of border cells passable on both sides is an entrance, crossed at its middle
+// cell, or at both ends if it is long. The cells on either side of a crossing
+// are nodes of the abstract graph: the two sides are linked by one step, and
+// nodes of the same cluster by their shortest distance inside the cluster.
+//
+// A query links the start and the target to the nodes of their clusters and
+// runs A* on that graph, a few nodes per cluster instead of every cell. The
+// abstract path is then turned into cells piece by piece, as far as the
+// caller needs. Paths are at most a few percent longer than the shortest ones.
+//
+// Changing a cell rebuilds its cluster and the ones around it, before the
+// next query.
+//
+// Copies share the graph until one of them changes a cell, so forking a game
+// does not copy it.
+class ClusterGraph {
+public:
+    static const int kDefaultClusterSize = 16;
+
+    // passable[loc] != 0 if a unit may stand on loc.
+    void Build(int m, int n, std::vector<uint8_t> &&passable, int cluster_size = kDefaultClusterSize);
+    void Invalidate();
+    bool valid() const { return ! _graph->passable.empty(); }
+
+    // Whether a unit may stand on loc from now on.
+    void SetPassable(Loc loc, bool passable);
+
+    // Abstract path from -> to: from, the nodes in between, then to. Neither
+    // from nor to needs to be passable, but then the path leaves (enters) it
+    // through its own cluster. Fills *nodes (cleared first), and returns the
+    // length of the path in cells, or kUnreachableDist (*nodes empty) if
+    // there is none.
+    float FindPath(Loc from, Loc to, std::vector<Loc> *nodes);
+
+    // The cells of an abstract path after nodes[0], in order, until there are
+    // at least max_cells of them or the path ends. Fills *cells (cleared first).
+    void Refine(const std::vector<Loc> &nodes, size_t max_cells, std::vector<Loc> *cells);
+
+    int cluster_size() const { return _size; }
+    size_t num_clusters() const { return _graph->clusters.size(); }
+    size_t num_nodes() const;
+
+    string PrintInfo() const {
+        stringstream ss;
+        ss << "ClusterGraph: #clusters: " << num_clusters() << " #nodes: " << num_nodes()
+           << " built: " << _num_built << " repaired: " << _num_repaired << " searches: " << _num_searches;
+        return ss.str();
+    }
+
+    // Not saved, like the field caches: loading a snapshot rebuilds it on
+    // first use.
+    friend serializer::saver &operator<<(serializer::saver &oo, const ClusterGraph &) { return oo; }
+    friend serializer::loader &operator>>(serializer::loader &ii, ClusterGraph &g) {
+        g.Invalidate();
+        return ii;
+    }
+
+private:
+    // Runs of passable border cells at least this long get two crossings.
+    static const int kMinDoubleEntrance = 6;
+
+    struct Node {
+        Loc loc;
+        // The cells across the cluster borders (two at a corner).
+        int num_partners;
+        Loc partners[2];
+    };
+
+    struct Cluster {
+        // Cells [x0, x1) x [y0, y1).
+        int x0, y0, x1, y1;
+        std::vector<Node> nodes;
+        // dist[i * nodes.size() + j]: shortest distance from node i to node j
+        // inside the cluster.
+        std::vector<float> dist;
+    };
+
+    // What Build() computes, shared between copies (see CowPtr).
+    struct Graph {
+        std::vector<uint8_t> passable;
+        std::vector<Cluster> clusters;
+        // Index of the node of each cell in its cluster, -1 if it is not a node.
+        std::vector<int> node_index;
+    };
+
+    // Expands a node of the abstract graph during FindPath().
+    struct Expand;
+
+    int _m = 0, _n = 0;
+    int _size = kDefaultClusterSize;
+    // #clusters along x and y.
+    int _cm = 0, _cn = 0;
+    CowPtr<Graph> _graph;
+
+    // Clusters with changed cells, to rebuild with their neighbors.
+    std::vector<int> _dirty;
+    std::vector<uint8_t> _marked;
+
+    // Scratch.
+    std::vector<float> _from_dist, _to_dist, _node_dist;
+    std::vector<int> _queue;
+
+    uint64_t _num_built = 0, _num_repaired = 0, _num_searches = 0;
+
+    int cluster_of(Loc l) const { return (l / _m / _size) * _cm + (l % _m) / _size; }
+    int local(const Cluster &c, Loc l) const { return (l / _m - c.y0) * (c.x1 - c.x0) + (l % _m - c.x0); }
+
+    template <typename F>
+    void for_each_crossing(int cx, int cy, bool east, F f) const;
+    void rebuild(int ci);
+    void repair();
+    // Distance from source to every cell of its cluster, inside the cluster.
+    void fill_distances(const Cluster &c, Loc source, std::vector<float> *dist);
+};
+
+#endif
@@ -102,7 +102,8 @@ float micro_move(Tick tick, const Unit& u, const GameEnv &env, const PointF& tar
             Coord first_block;
             float est_dist;
             planning_success = player.PathPlanning(tick, u.GetId(), curr, target,
-                kMaxPlanningIteration, receiver->GetPathPlanningVerbose(), &first_block, &est_dist);
+                kMaxPlanningIteration, receiver->GetPathPlanningVerbose(), &first_block, &est_dist,
+                receiver->GetPathPlanningJumpPoints());
             if (planning_success && first_block.x >= 0 && first_block.y >= 0) {
                 waypoint.x = first_block.x;
                 waypoint.y = first_block.y;
@@ -11,6 +11,7 @@
 #define _CMD_H_
 
 #include "common.h"
+#include "cmd_arena.h"
 #include <sstream>
 
 /*  Common commands for all games, specified in cmd.def.
@@ -63,10 +64,14 @@ typedef int CmdType;
 #define INVALID_CMD -1
 #define CMD_BASE 0
 
+// Which queue a command goes to. Stored in CmdBase so that commands can be
+// routed without dynamic_cast.
+custom_enum(CmdKind, CMD_KIND_BASE = 0, CMD_KIND_DURATIVE, CMD_KIND_IMMEDIATE);
+
 class CmdReceiver;
 class GameEnv;
 
-// Base class for commands.
+// Base class for commands. All commands are allocated from CmdArena.
 class CmdBase {
 protected:
     int _cmd_id;
@@ -75,11 +80,15 @@ protected:
     // Main id.
     UnitId _id;
 
+    // Set by the constructors of CmdDurative and CmdImmediate, never saved.
+    CmdKind _kind;
+
 public:
     explicit CmdBase(UnitId iid = INVALID) {
         _tick = _start_tick = INVALID;
         _id = iid;
         _cmd_id = -1;
+        _kind = CMD_KIND_BASE;
     }
     explicit CmdBase(Tick t, UnitId iid) : CmdBase(iid) {
         _tick = _start_tick = t;
@@ -90,7 +99,12 @@ public:
     void set_tick_and_start_tick(Tick t) { _tick = _start_tick = t; }
     UnitId id() const { return _id; }
     void set_id(UnitId id) { _id = id; }
+    int cmd_id() const { return _cmd_id; }
     void set_cmd_id(int i) { _cmd_id = i; }
+    CmdKind kind() const { return _kind; }
+
+    static void *operator new(size_t size) { return CmdArena::Alloc(size); }
+    static void operator delete(void *p, size_t size) { CmdArena::Free(p, size); }
 
     virtual std::unique_ptr<CmdBase> clone() const { return std::unique_ptr<CmdBase>(new CmdBase(*this)); }
     virtual CmdType type() const { return CMD_BASE; }
@@ -134,8 +148,8 @@ protected:
     virtual bool run(const GameEnv&, CmdReceiver *) { return true; }
 
 public:
-    explicit CmdDurative(UnitId id = INVALID) : CmdBase(id), _done(false) { }
-    explicit CmdDurative(Tick t, UnitId id) : CmdBase(t, id), _done(false) { }
+    explicit CmdDurative(UnitId id = INVALID) : CmdBase(id), _done(false) { _kind = CMD_KIND_DURATIVE; }
+    explicit CmdDurative(Tick t, UnitId id) : CmdBase(t, id), _done(false) { _kind = CMD_KIND_DURATIVE; }
 
     // Check whether this command is done. If so, it will be removed from the current queue.
     bool IsDone() const { return _done; }
@@ -163,8 +177,8 @@ protected:
     virtual bool run(GameEnv*, CmdReceiver *) { return true; }
 
 public:
-    explicit CmdImmediate(UnitId id = INVALID) : CmdBase(id) { }
-    explicit CmdImmediate(Tick t, UnitId id) : CmdBase(t, id) { }
+    explicit CmdImmediate(UnitId id = INVALID) : CmdBase(id) { _kind = CMD_KIND_IMMEDIATE; }
+    explicit CmdImmediate(Tick t, UnitId id) : CmdBase(t, id) { _kind = CMD_KIND_IMMEDIATE; }
     bool Run(GameEnv* env, CmdReceiver *receiver){ return run(env, receiver); }
 
     virtual ~CmdImmediate() { }
@@ -177,7 +191,19 @@ public:
 typedef unique_ptr<CmdBase> CmdBPtr;
 typedef unique_ptr<CmdDurative> CmdDPtr;
 typedef unique_ptr<CmdImmediate> CmdIPtr;
-typedef map<UnitId, CmdBPtr> AssignedCmds;
+typedef map<UnitId, CmdBPtr, std::less<UnitId>, CmdArena::Allocator<std::pair<const UnitId, CmdBPtr>>> AssignedCmds;
+
+// Downcast to a generated command class, checked by command type. Returns
+// nullptr if cmd is of another type.
+template <typename T>
+T *cmd_cast(CmdBase *cmd) {
+    return cmd != nullptr && cmd->type() == T::kType ? static_cast<T *>(cmd) : nullptr;
+}
+
+template <typename T>
+const T *cmd_cast(const CmdBase *cmd) {
+    return cmd != nullptr && cmd->type() == T::kType ? static_cast<const T *>(cmd) : nullptr;
+}
 
 class CmdTypeLookup {
 private:
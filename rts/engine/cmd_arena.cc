@@ -0,0 +1,115 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "cmd_arena.h"
+
+#include <algorithm>
+
+namespace {
+
+const size_t kGranularity = 16;
+const size_t kMaxBlockSize = 256;
+const int kNumClasses = kMaxBlockSize / kGranularity;
+// Beyond this, freed blocks go back to the global allocator.
+const int kMaxFreePerClass = 4096;
+// #blocks added at least when a free list runs out.
+const int kMinRefill = 16;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// Trivially destructible, so that it stays usable while other thread_local
+// objects (which may own commands) are destroyed at thread exit.
+struct FreeLists {
+    FreeBlock *head[kNumClasses];
+    int count[kNumClasses];
+    // #blocks handed out and not freed (on this thread) yet.
+    int live[kNumClasses];
+    bool registered;
+    bool dead;
+};
+
+thread_local FreeLists t_lists;
+
+inline int size_class(size_t size) { return (size - 1) / kGranularity; }
+
+void release_all() {
+    for (int c = 0; c < kNumClasses; ++c) {
+        while (t_lists.head[c] != nullptr) {
+            FreeBlock *b = t_lists.head[c];
+            t_lists.head[c] = b->next;
+            ::operator delete(b);
+        }
+        t_lists.count[c] = 0;
+    }
+}
+
+// Gives the cached blocks back when the thread exits.
+struct Releaser {
+    ~Releaser() {
+        release_all();
+        t_lists.dead = true;
+    }
+};
+
+void push(int c, void *p) {
+    if (! t_lists.registered) {
+        static thread_local Releaser releaser;
+        (void)releaser;
+        t_lists.registered = true;
+    }
+    FreeBlock *b = static_cast<FreeBlock *>(p);
+    b->next = t_lists.head[c];
+    t_lists.head[c] = b;
+    t_lists.count[c] ++;
+}
+
+// Adds as many blocks as are in use, so that like a vector, a class grows
+// geometrically and a game that goes beyond its earlier peak of commands
+// goes to the global allocator a few times rather than for each command.
+void refill(int c) {
+    const int n = std::min(std::max(t_lists.live[c], kMinRefill), kMaxFreePerClass);
+    for (int i = 0; i < n; ++i) push(c, ::operator new((c + 1) * kGranularity));
+}
+
+}  // namespace
+
+void *CmdArena::Alloc(size_t size) {
+    if (size == 0 || size > kMaxBlockSize) return ::operator new(size);
+    const int c = size_class(size);
+    if (t_lists.head[c] == nullptr && ! t_lists.dead) refill(c);
+    FreeBlock *b = t_lists.head[c];
+    if (b == nullptr) return ::operator new((c + 1) * kGranularity);
+    t_lists.head[c] = b->next;
+    t_lists.count[c] --;
+    t_lists.live[c] ++;
+    return b;
+}
+
+void CmdArena::Free(void *p, size_t size) {
+    if (p == nullptr) return;
+    if (size == 0 || size > kMaxBlockSize || t_lists.dead) {
+        ::operator delete(p);
+        return;
+    }
+    const int c = size_class(size);
+    if (t_lists.live[c] > 0) t_lists.live[c] --;
+    if (t_lists.count[c] >= kMaxFreePerClass) {
+        ::operator delete(p);
+        return;
+    }
+    push(c, p);
+}
+
+size_t CmdArena::NumCached() {
+    size_t n = 0;
+    for (int c = 0; c < kNumClasses; ++c) n += t_lists.count[c];
+    return n;
+}
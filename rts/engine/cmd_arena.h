@@ -0,0 +1,51 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _CMD_ARENA_H_
+#define _CMD_ARENA_H_
+
+#include <cstddef>
+#include <new>
+
+// Recycles the memory of commands. Commands are created and destroyed by the
+// thousands every tick; instead of going to the global allocator each time,
+// freed blocks are kept in free lists (one per 16-byte size class, up to 256
+// bytes) and handed out again. A free list that runs out gets as many blocks
+// as its class has in use at once, so it grows geometrically. The free lists
+// belong to the thread, so a game thread reuses the commands of its own
+// previous ticks without any lock.
+// A block freed by another thread simply moves to that thread's lists.
+class CmdArena {
+public:
+    static void *Alloc(size_t size);
+    static void Free(void *p, size_t size);
+
+    // #blocks in the free lists of the calling thread.
+    static size_t NumCached();
+
+    // STL allocator on top of the arena, e.g., for maps of commands.
+    template <typename T>
+    struct Allocator {
+        using value_type = T;
+
+        Allocator() { }
+        template <typename U>
+        Allocator(const Allocator<U> &) { }
+
+        T *allocate(size_t n) { return static_cast<T *>(CmdArena::Alloc(n * sizeof(T))); }
+        void deallocate(T *p, size_t n) { CmdArena::Free(p, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator==(const Allocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const Allocator<U> &) const { return false; }
+    };
+};
+
+#endif
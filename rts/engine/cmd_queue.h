@@ -0,0 +1,400 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _CMD_QUEUE_H_
+#define _CMD_QUEUE_H_
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "serializer.h"
+#include "zobrist.h"
+
+// Command queue of CmdReceiver, keyed by tick (a timing wheel).
+//
+// Ticks are dense, so commands are kept in a ring of buckets, one per tick
+// from the current tick on. The bucket of the current tick also holds the
+// commands of earlier ticks that are still pending. Within a bucket, commands
+// form a list sorted by the command order (operator< of CmdBase), so commands
+// pop out in exactly the same order as from a single priority queue over all
+// commands. Commands too far in the future wait in a separate sorted list
+// until the ring reaches them.
+//
+// The lists are linked through a pool of nodes shared by all of them, and
+// freed nodes are reused. Once the queue has held as many commands at a time
+// as it ever will, pushing commands no longer allocates; clear() keeps the
+// pool.
+//
+// The queue keeps a Zobrist hash of its commands (see zobrist.h), updated as
+// they are pushed and popped. A command is keyed by its id, unit, type and
+// tick; what a durative command keeps of its progress is not hashed.
+//
+// T is a unique_ptr to a command.
+template <typename T>
+class CmdQueue {
+public:
+    CmdQueue() : _now(0), _size(0), _hash(0), _buckets(kMinBuckets), _free(kNil) { }
+    CmdQueue(const CmdQueue &) = delete;
+    CmdQueue &operator=(const CmdQueue &) = delete;
+    CmdQueue(CmdQueue &&) = default;
+    CmdQueue &operator=(CmdQueue &&) = default;
+
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    uint64_t HashCode() const { return _hash; }
+    uint64_t ComputeHashCode() const {
+        uint64_t code = 0;
+        for_each([&](const T &cmd) { code ^= hash_key(cmd); });
+        return code;
+    }
+
+    void push(T &&cmd) {
+        _hash ^= hash_key(cmd);
+        const int i = new_node();
+        _nodes[i].cmd = std::move(cmd);
+        insert(i);
+        _size ++;
+    }
+
+    // Makes tick the current tick: afterwards, top() is the first command
+    // with tick() <= tick, if any.
+    void Advance(Tick tick) {
+        if (tick < _now || tick - _now >= (Tick)_buckets.size()) {
+            rebuild(tick);
+            return;
+        }
+        while (_now < tick) {
+            List &b = bucket(_now);
+            _now ++;
+            List &next = bucket(_now);
+            if (next.head == kNil) std::swap(b, next);
+            else {
+                for (int i = b.head; i != kNil; ) {
+                    const int n = _nodes[i].next;
+                    insert_sorted(&next, i);
+                    i = n;
+                }
+                b = List();
+            }
+            pull_far();
+        }
+    }
+
+    // The next command due at the current tick, nullptr if there is none.
+    const T *top() const {
+        const List &b = bucket(_now);
+        return b.head == kNil ? nullptr : &_nodes[b.head].cmd;
+    }
+
+    T pop_top() {
+        List &b = bucket(_now);
+        const int i = b.head;
+        b.head = _nodes[i].next;
+        if (b.head == kNil) b.tail = kNil;
+        T cmd = std::move(_nodes[i].cmd);
+        free_node(i);
+        _size --;
+        _hash ^= hash_key(cmd);
+        return cmd;
+    }
+
+    void clear() {
+        for (auto &b : _buckets) free_list(&b);
+        free_list(&_far);
+        _size = 0;
+        _hash = 0;
+        _now = 0;
+    }
+
+    // Makes this queue a copy of other, with clones of its commands laid out
+    // the same way. on_copy(original, clone) is called for each command.
+    template <typename F>
+    void CopyFrom(const CmdQueue &other, F on_copy) {
+        clear();
+        _now = other._now;
+        _size = other._size;
+        _hash = other._hash;
+        _buckets.resize(other._buckets.size());
+        for (size_t i = 0; i < _buckets.size(); ++i) copy_list(other, other._buckets[i], &_buckets[i], on_copy);
+        copy_list(other, other._far, &_far, on_copy);
+    }
+
+    // Visits all commands in no particular order.
+    template <typename F>
+    void for_each(F f) const {
+        for (const List &b : _buckets) {
+            for (int i = b.head; i != kNil; i = _nodes[i].next) f(_nodes[i].cmd);
+        }
+        for (int i = _far.head; i != kNil; i = _nodes[i].next) f(_nodes[i].cmd);
+    }
+
+    // Same format as the p_queue it replaces. Commands are written in the
+    // order they would be executed, so the output does not depend on how the
+    // queue was filled.
+    friend serializer::saver &operator<<(serializer::saver &s, const CmdQueue &q) {
+        std::vector<const T *> cmds;
+        cmds.reserve(q._size);
+        q.for_each([&](const T &cmd) { cmds.push_back(&cmd); });
+        std::sort(cmds.begin(), cmds.end(), [](const T *a, const T *b) { return later(*b, *a); });
+
+        int size = cmds.size();
+        if (! s.is_binary()) s.get() << " ";
+        s << size;
+        if (! s.is_binary()) s.get() << " ";
+        for (const T *cmd : cmds) {
+            s << *cmd;
+            if (! s.is_binary()) s.get() << " ";
+        }
+        return s;
+    }
+
+    friend serializer::loader &operator>>(serializer::loader &l, CmdQueue &q) {
+        int size;
+        l >> size;
+        q.clear();
+        for (int i = 0; i < size; ++i) {
+            T cmd;
+            l >> cmd;
+            q.push(std::move(cmd));
+        }
+        return l;
+    }
+
+private:
+    static const int kMinBuckets = 64;
+    static const int kMaxBuckets = 4096;
+    static const int kNil = -1;
+
+    struct Node {
+        T cmd;
+        // Next node in its list (or in the free list).
+        int next;
+    };
+
+    // Nodes in the order the commands are executed.
+    struct List {
+        int head, tail;
+        List() : head(kNil), tail(kNil) { }
+    };
+
+    // First tick of the ring.
+    Tick _now;
+    size_t _size;
+    uint64_t _hash;
+    // Size is a power of 2.
+    std::vector<List> _buckets;
+    // Commands at or beyond _now + kMaxBuckets.
+    List _far;
+    std::vector<Node> _nodes;
+    // Head of the free nodes.
+    int _free;
+
+    static uint64_t hash_key(const T &cmd) {
+        const int id = cmd->cmd_id();
+        return zobrist::key(id, 2048, cmd->tick()) ^ zobrist::key(id, 2049, cmd->id()) ^ zobrist::key(id, 2050, cmd->type());
+    }
+
+    // Order: c1 is executed after c2.
+    static bool later(const T &c1, const T &c2) { return *c1 < *c2; }
+
+    List &bucket(Tick t) { return _buckets[t & (_buckets.size() - 1)]; }
+    const List &bucket(Tick t) const { return _buckets[t & (_buckets.size() - 1)]; }
+
+    int new_node() {
+        if (_free == kNil) {
+            _nodes.emplace_back();
+            return _nodes.size() - 1;
+        }
+        const int i = _free;
+        _free = _nodes[i].next;
+        return i;
+    }
+
+    void free_node(int i) {
+        _nodes[i].cmd = T();
+        _nodes[i].next = _free;
+        _free = i;
+    }
+
+    void free_list(List *l) {
+        for (int i = l->head; i != kNil; ) {
+            const int n = _nodes[i].next;
+            free_node(i);
+            i = n;
+        }
+        *l = List();
+    }
+
+    // Puts node i in the bucket of its tick, or in _far.
+    void insert(int i) {
+        const Tick tick = _nodes[i].cmd->tick();
+        const Tick t = tick > _now ? tick : _now;
+        if (t - _now >= (Tick)_buckets.size() && ! grow(t - _now + 1)) insert_sorted(&_far, i);
+        else insert_sorted(&bucket(t), i);
+    }
+
+    // After the commands it does not come before. Commands are mostly pushed
+    // in the order they are executed, so the tail is checked first.
+    void insert_sorted(List *l, int i) {
+        Node &node = _nodes[i];
+        if (l->head == kNil || ! later(_nodes[l->tail].cmd, node.cmd)) {
+            node.next = kNil;
+            if (l->head == kNil) l->head = i;
+            else _nodes[l->tail].next = i;
+            l->tail = i;
+            return;
+        }
+        int *link = &l->head;
+        while (! later(_nodes[*link].cmd, node.cmd)) link = &_nodes[*link].next;
+        node.next = *link;
+        *link = i;
+    }
+
+    template <typename F>
+    void copy_list(const CmdQueue &other, const List &src, List *dst, F on_copy) {
+        for (int j = src.head; j != kNil; j = other._nodes[j].next) {
+            const T &cmd = other._nodes[j].cmd;
+            const int i = new_node();
+            _nodes[i].cmd.reset(static_cast<typename T::element_type *>(cmd->clone().release()));
+            _nodes[i].next = kNil;
+            if (dst->head == kNil) dst->head = i;
+            else _nodes[dst->tail].next = i;
+            dst->tail = i;
+            on_copy(cmd, _nodes[i].cmd);
+        }
+    }
+
+    void pull_far() {
+        while (_far.head != kNil && _nodes[_far.head].cmd->tick() - _now < (Tick)_buckets.size()) {
+            const int i = _far.head;
+            _far.head = _nodes[i].next;
+            if (_far.head == kNil) _far.tail = kNil;
+            insert(i);
+        }
+    }
+
+    // Takes all commands out, as a chain of nodes (in no particular order)
+    // that can be put back with another current tick or ring size.
+    int take_all() {
+        int chain = kNil;
+        auto take = [&](List *l) {
+            if (l->head == kNil) return;
+            _nodes[l->tail].next = chain;
+            chain = l->head;
+            *l = List();
+        };
+        for (auto &b : _buckets) take(&b);
+        take(&_far);
+        return chain;
+    }
+
+    // Puts the chain back, relative to _now. The ring is first made large
+    // enough, so that insert() does not need to grow it.
+    void put_back(int chain) {
+        Tick span = 1;
+        for (int i = chain; i != kNil; i = _nodes[i].next) {
+            const Tick tick = _nodes[i].cmd->tick();
+            const Tick d = (tick > _now ? tick : _now) - _now + 1;
+            if (d <= kMaxBuckets && d > span) span = d;
+        }
+        size_t num_buckets = _buckets.size();
+        while ((Tick)num_buckets < span) num_buckets *= 2;
+        _buckets.resize(num_buckets);
+
+        for (int i = chain; i != kNil; ) {
+            const int n = _nodes[i].next;
+            insert(i);
+            i = n;
+        }
+    }
+
+    void rebuild(Tick tick) {
+        const int chain = take_all();
+        _now = tick;
+        put_back(chain);
+    }
+
+    // Grows the ring to cover n ticks. Returns false if n is too large.
+    bool grow(Tick n) {
+        if (n > kMaxBuckets) return false;
+        const int chain = take_all();
+        size_t num_buckets = _buckets.size();
+        while ((Tick)num_buckets < n) num_buckets *= 2;
+        _buckets.resize(num_buckets);
+        put_back(chain);
+        return true;
+    }
+};
+
+// Current durative command of each unit, indexed by the lower 24 bits of the
+// UnitId, which come from a counter that is never reused within a game (see
+// Player::CombinePlayerId). Entries keep the full id, so an entry left behind
+// by a removed unit never matches another unit. Does not own the commands.
+// Like CmdQueue, the table keeps a Zobrist hash of its entries.
+template <typename Cmd>
+class UnitCmdTable {
+public:
+    UnitCmdTable() : _size(0), _hash(0) { }
+
+    size_t size() const { return _size; }
+
+    uint64_t HashCode() const { return _hash; }
+    uint64_t ComputeHashCode() const {
+        uint64_t code = 0;
+        for (const Entry &e : _table) {
+            if (e.second != nullptr) code ^= hash_key(e.first, e.second);
+        }
+        return code;
+    }
+
+    Cmd *get(UnitId id) const {
+        const size_t idx = raw(id);
+        if (id < 0 || idx >= _table.size() || _table[idx].first != id) return nullptr;
+        return _table[idx].second;
+    }
+
+    void set(UnitId id, Cmd *cmd) {
+        const size_t idx = raw(id);
+        if (idx >= _table.size()) _table.resize(std::max(idx + 1, _table.size() * 2), Entry(INVALID, nullptr));
+        if (_table[idx].second == nullptr) _size ++;
+        else _hash ^= hash_key(_table[idx].first, _table[idx].second);
+        _table[idx] = Entry(id, cmd);
+        _hash ^= hash_key(id, cmd);
+    }
+
+    // Returns the command removed, nullptr if the unit had none.
+    Cmd *erase(UnitId id) {
+        Cmd *cmd = get(id);
+        if (cmd != nullptr) {
+            _table[raw(id)] = Entry(INVALID, nullptr);
+            _size --;
+            _hash ^= hash_key(id, cmd);
+        }
+        return cmd;
+    }
+
+    void clear() {
+        if (_size > 0) std::fill(_table.begin(), _table.end(), Entry(INVALID, nullptr));
+        _size = 0;
+        _hash = 0;
+    }
+
+private:
+    typedef std::pair<UnitId, Cmd *> Entry;
+    std::vector<Entry> _table;
+    size_t _size;
+    uint64_t _hash;
+
+    static size_t raw(UnitId id) { return id & 0xffffff; }
+    static uint64_t hash_key(UnitId id, const Cmd *cmd) { return zobrist::key(id, 2051, cmd->cmd_id()); }
+};
+
+#endif
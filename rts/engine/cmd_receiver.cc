@@ -16,29 +16,59 @@ bool CmdReceiver::StartDurativeCmd(CmdDurative *cmd) {
     if (id == INVALID) return false;
 
     FinishDurativeCmd(id);
-    _unit_durative_cmd[id] = cmd;
+    _unit_durative_cmd.set(id, cmd);
     return true;
 }
 
 bool CmdReceiver::FinishDurativeCmd(UnitId id) {
-    auto it = _unit_durative_cmd.find(id);
-    if (it != _unit_durative_cmd.end()) {
-        it->second->SetDone();
-        _unit_durative_cmd.erase(it);
+    CmdDurative *cmd = _unit_durative_cmd.erase(id);
+    if (cmd != nullptr) {
+        cmd->SetDone();
         return true;
     }
     else return false;
 }
 
 bool CmdReceiver::FinishDurativeCmdIfDone(UnitId id) {
-    auto it = _unit_durative_cmd.find(id);
-    if (it != _unit_durative_cmd.end() && it->second->IsDone()) {
-        _unit_durative_cmd.erase(it);
+    const CmdDurative *cmd = _unit_durative_cmd.get(id);
+    if (cmd != nullptr && cmd->IsDone()) {
+        _unit_durative_cmd.erase(id);
         return true;
     }
     else return false;
 }
 
+void CmdReceiver::CopyFrom(const CmdReceiver &other) {
+    _tick = other._tick;
+    _cmd_next_id = other._cmd_next_id;
+    _stats = other._stats;
+    _stats.SetGlobalStats(nullptr);
+
+    // The current durative command of a unit is always in the queue.
+    _unit_durative_cmd.clear();
+    _durative_cmd_queue.CopyFrom(other._durative_cmd_queue, [&](const CmdDPtr &cmd, const CmdDPtr &copy) {
+        if (other._unit_durative_cmd.get(cmd->id()) == cmd.get()) _unit_durative_cmd.set(copy->id(), copy.get());
+    });
+    _immediate_cmd_queue.CopyFrom(other._immediate_cmd_queue, [](const CmdIPtr &, const CmdIPtr &) { });
+    _ui_cmd_queue = other._ui_cmd_queue;
+
+    _tick_history.clear();
+    for (const auto &cmd : other._tick_history) {
+        _tick_history.emplace_back(static_cast<CmdDurative *>(cmd->clone().release()));
+    }
+    _cmd_history = ReplayWriter();
+    _keep_history = false;
+    _use_cmd_comment = false;
+    _cmd_dumper.reset();
+
+    _save_to_history = other._save_to_history;
+    _verbose_player_id = other._verbose_player_id;
+    _verbose_choice = other._verbose_choice;
+    _path_planning_verbose = other._path_planning_verbose;
+    _path_planning_jump_points = other._path_planning_jump_points;
+    _hash_check = other._hash_check;
+}
+
 bool CmdReceiver::SendCmd(CmdBPtr &&cmd) {
     return SendCmdWithTick(std::move(cmd), _tick);
 }
@@ -56,25 +86,25 @@ bool CmdReceiver::SendCmdWithTick(CmdBPtr &&cmd, Tick tick) {
 
     // Check wehther we need to save stuff to _cmd_history.
     // For all commands that issued in ExecuteCmd(), we don't need to send them to _cmd_history.
-    if (IsSaveToHistory()) _cmd_history.push_back(cmd->clone());
+    if (IsSaveToHistory()) {
+        if (_keep_history) _cmd_history.Add(*cmd);
+        if (cmd->kind() == CMD_KIND_DURATIVE) {
+            _tick_history.emplace_back(static_cast<CmdDurative *>(cmd->clone().release()));
+        }
+    }
 
     // Put the command to different queue
-    CmdDurative *durative = dynamic_cast<CmdDurative *>(cmd.get());
-    if (durative != nullptr) {
-        // show_prompt_cond("Receive Durative Cmd", cmd);
-        // cout << "Receive Durative Cmd " << cmd->PrintInfo() << endl;
-        cmd.release();
-        _durative_cmd_queue.push(CmdDPtr(durative));
-    } else {
-        CmdImmediate *immediate = dynamic_cast<CmdImmediate *>(cmd.get());
-        if (immediate != nullptr) {
-            // show_prompt_cond("Receive Immediate Cmd", cmd);
+    switch (cmd->kind()) {
+        case CMD_KIND_DURATIVE:
+            // cout << "Receive Durative Cmd " << cmd->PrintInfo() << endl;
+            _durative_cmd_queue.push(CmdDPtr(static_cast<CmdDurative *>(cmd.release())));
+            break;
+        case CMD_KIND_IMMEDIATE:
             // cout << "Receive Immediate Cmd " << cmd->PrintInfo() << endl;
-            cmd.release();
-            _immediate_cmd_queue.push(CmdIPtr(immediate));
-        } else {
+            _immediate_cmd_queue.push(CmdIPtr(static_cast<CmdImmediate *>(cmd.release())));
+            break;
+        default:
             throw std::range_error("Error! the command is neither durative or immediate! " + cmd->PrintInfo());
-        }
     }
     return true;
 }
@@ -85,9 +115,7 @@ bool CmdReceiver::SendCmd(UICmd &&cmd) {
 }
 
 const CmdDurative *CmdReceiver::GetUnitDurativeCmd(UnitId id) const {
-    auto it = _unit_durative_cmd.find(id);
-    if (it == _unit_durative_cmd.end()) return nullptr;
-    else return it->second;
+    return _unit_durative_cmd.get(id);
 }
 
 bool CmdReceiver::LoadReplay(const string& replay_filename) {
@@ -97,37 +125,39 @@ bool CmdReceiver::LoadReplay(const string& replay_filename) {
     //
     if (replay_filename.empty()) return false;
 
-    _loaded_replay.clear();
     _tick = 0;
-    _next_replay_idx = 0;
 
     // cout << "Loading replay = " << replay_filename << endl;
-
-    serializer::loader loader(false);
-    if (! loader.read_from_file(replay_filename)) {
+    if (! _loaded_replay.Load(replay_filename)) {
         return false;
     }
-
-    _loaded_replay.clear();
-    loader >> _loaded_replay;
     // cout << "Loaded replay, size = " << _loaded_replay.size() << endl;
 
-    _cmd_history.clear();
-    _durative_cmd_queue = p_queue<CmdDPtr>();
-    _immediate_cmd_queue = p_queue<CmdIPtr>();
+    _cmd_history = ReplayWriter();
+    _tick_history.clear();
+    _durative_cmd_queue.clear();
+    _immediate_cmd_queue.clear();
 
     SendCurrentReplay();
     return true;
 }
 
-bool CmdReceiver::SaveReplay(const string& replay_filename) const {
+bool CmdReceiver::SaveReplay(const string& replay_filename, bool binary) const {
     // Load the replay_file (which is a action sequence)
     // Each action looks like the following:
     //    Tick, CmdType, UnitId, UnitType, Loc
     //
-    serializer::saver saver(false);
     // if (_verbose) cout << "Save replay to " << replay_filename << " #record: " << _cmd_history.size() << endl;
-    saver << _cmd_history;
+    if (binary) return _cmd_history.Save(replay_filename);
+
+    // The legacy text format is written from the decoded history.
+    ReplayReader reader;
+    reader.LoadFromString(_cmd_history.Serialize());
+    vector<CmdBPtr> cmds;
+    while (! reader.Done()) cmds.push_back(reader.Next());
+
+    serializer::saver saver(false);
+    saver << cmds;
     if (! saver.write_to_file(replay_filename)) return false;
 
     return true;
@@ -139,17 +169,17 @@ void CmdReceiver::ExecuteDurativeCmds(const GameEnv &env, bool force_verbose) {
     // cout << "Starting ExecutiveDurativeCmds[" << _tick << "]" << endl;
 
     // Execute durative cmds.
-    while (! _durative_cmd_queue.empty()) {
-        const CmdDPtr& cmd_ref = _durative_cmd_queue.top();
+    _durative_cmd_queue.Advance(_tick);
+    while (const CmdDPtr *top = _durative_cmd_queue.top()) {
+        const CmdDPtr& cmd_ref = *top;
         // cout << "Top: " << cmd_ref->PrintInfo() << endl;
-        if (cmd_ref->tick() > _tick) break;
 
         show_prompt_cond("ExecuteDurativeCmds", cmd_ref, force_verbose);
 
         // If the command is done (often set by other preemptive commands, we skip.
         if (cmd_ref->IsDone()) {
             FinishDurativeCmdIfDone(cmd_ref->id());
-            _durative_cmd_queue.pop();
+            _durative_cmd_queue.pop_top();
             continue;
         }
 
@@ -176,11 +206,8 @@ void CmdReceiver::ExecuteImmediateCmds(GameEnv *env, bool force_verbose) {
     // cout << "Starting ExecutiveImmediateCmds[" << _tick << "]" << endl;
 
     // Execute immediate cmds, which will change the game state.
-    while (! _immediate_cmd_queue.empty()) {
-        const CmdIPtr &cmd_ref = _immediate_cmd_queue.top();
-        // cout << "Top: " << cmd_ref->PrintInfo() << endl;
-        if (cmd_ref->tick() > _tick) break;
-
+    _immediate_cmd_queue.Advance(_tick);
+    while (_immediate_cmd_queue.top() != nullptr) {
         CmdIPtr cmd = _immediate_cmd_queue.pop_top();
 
         show_prompt_cond("ExecuteImmediateCmds", cmd, force_verbose);
@@ -203,28 +230,21 @@ void CmdReceiver::ExecuteUICmds(function<void (const UICmd&)> default_f) {
 }
 
 void CmdReceiver::SendCurrentReplay() {
-    while (_next_replay_idx <  _loaded_replay.size()) {
-        const auto& cmd = _loaded_replay[_next_replay_idx];
-        if (cmd->tick() > _tick) break;
-        // cout << "Send Current Replay: " << cmd->PrintInfo() << endl;
-        SendCmd(cmd->clone());
-        _next_replay_idx ++;
+    while (! _loaded_replay.Done()) {
+        if (_loaded_replay.PeekTick() > _tick) break;
+        // cout << "Send Current Replay: " << _loaded_replay.pos() << endl;
+        SendCmd(_loaded_replay.Next());
     }
-    // cout << "Replay sent, #record = " << _next_replay_idx << endl;
+    // cout << "Replay sent, #record = " << _loaded_replay.pos() << endl;
 }
 
 vector<CmdDurative*> CmdReceiver::GetHistoryAtCurrentTick() const {
+    // Most recent first.
     vector<CmdDurative*> res;
-    for (int i = _cmd_history.size() - 1; i >= 0; i--) {
-        const auto &cmd = _cmd_history[i];
-        if (cmd->tick() < _tick) break;
-        CmdDurative *durative = dynamic_cast<CmdDurative *>(cmd.get());
-        if (durative != nullptr) {
-            res.push_back(durative);
-        }
+    for (int i = _tick_history.size() - 1; i >= 0; i--) {
+        if (_tick_history[i]->tick() >= _tick) res.push_back(_tick_history[i].get());
     }
     return res;
-
 }
 
 
@@ -234,12 +254,8 @@ void CmdReceiver::SaveCmdReceiver(serializer::saver &saver) const {
 }
 
 void CmdReceiver::AlignReplayIdx() {
-    // Adjust the _next_replay_idx pointer.
-    _next_replay_idx = 0;
-    while (_next_replay_idx < _loaded_replay.size()) {
-        if (_loaded_replay[_next_replay_idx]->tick() >= _tick) break;
-        _next_replay_idx ++;
-    }
+    // Move the replay to the first command at or after the current tick.
+    _loaded_replay.Seek(_tick);
 }
 
 void CmdReceiver::LoadCmdReceiver(serializer::loader &loader) {
@@ -248,18 +264,37 @@ void CmdReceiver::LoadCmdReceiver(serializer::loader &loader) {
     // Set the failed_moves.
     _stats.SetTick(_tick);
 
-    // load durative cmd queue. Note that the priority queue is opaque so we need some hacks.
-    int size = _durative_cmd_queue.size();
-    const CmdDPtr *c = &(_durative_cmd_queue.top());
+    // Rebuild the current durative command of each unit from the queue.
+    // Commands that have not run yet (start_tick == tick) are not registered,
+    // so each unit has at most one candidate, whatever the queue order.
     _unit_durative_cmd.clear();
-    for (int i = 0; i < size; ++i) {
-        const CmdDPtr &curr = c[i];
-        if (! curr->IsDone()) _unit_durative_cmd.insert(make_pair(curr->id(), curr.get()));
-    }
+    _durative_cmd_queue.for_each([&](const CmdDPtr &curr) {
+        if (! curr->IsDone() && curr->start_tick() != curr->tick()) _unit_durative_cmd.set(curr->id(), curr.get());
+    });
 
     AlignReplayIdx();
 }
 
+uint64_t CmdReceiver::CurrentHashCode() const {
+    const uint64_t code = zobrist::key(0, 2052, _tick) ^ _immediate_cmd_queue.HashCode() ^ _durative_cmd_queue.HashCode() ^ _unit_durative_cmd.HashCode();
+    if (_hash_check) {
+        const uint64_t full = ComputeHashCode();
+        if (code != full) {
+            std::stringstream ss;
+            ss << "CmdReceiver: [" << _tick << "] incremental hash " << hex << code << " != " << full << dec
+               << " (immediate: " << (_immediate_cmd_queue.HashCode() != _immediate_cmd_queue.ComputeHashCode())
+               << " durative: " << (_durative_cmd_queue.HashCode() != _durative_cmd_queue.ComputeHashCode())
+               << " unit durative: " << (_unit_durative_cmd.HashCode() != _unit_durative_cmd.ComputeHashCode()) << ")";
+            throw std::range_error(ss.str());
+        }
+    }
+    return code;
+}
+
+uint64_t CmdReceiver::ComputeHashCode() const {
+    return zobrist::key(0, 2052, _tick) ^ _immediate_cmd_queue.ComputeHashCode() ^ _durative_cmd_queue.ComputeHashCode() ^ _unit_durative_cmd.ComputeHashCode();
+}
+
 void CmdReceiver::SetCmdDumper(const string& cmd_dumper_filename) {
     // Set the command dumper if there is any file specified.
     _cmd_dumper.reset(new ofstream(cmd_dumper_filename));
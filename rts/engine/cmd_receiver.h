@@ -12,8 +12,9 @@
 
 #include "cmd.h"
 #include "game_stats.h"
+#include "replay.h"
 
-#include "pq_extend.h"
+#include "cmd_queue.h"
 #include <map>
 #include <functional>
 // #include "Selene.h"
@@ -45,19 +46,23 @@ private:
 
     GameStats _stats;
 
-    p_queue<CmdIPtr> _immediate_cmd_queue;
-    p_queue<CmdDPtr> _durative_cmd_queue;
+    CmdQueue<CmdIPtr> _immediate_cmd_queue;
+    CmdQueue<CmdDPtr> _durative_cmd_queue;
     std::queue<UICmd> _ui_cmd_queue;
 
-    vector<CmdBPtr> _cmd_history;
+    // All commands sent so far (and the keyframes), stored by value in the
+    // binary replay encoding. Only recorded if _keep_history.
+    ReplayWriter _cmd_history;
 
-    // Idx for the next replay to send to the queue.
-    unsigned int _next_replay_idx;
-    vector<CmdBPtr> _loaded_replay;
+    // Copies of the durative commands sent during the current tick.
+    vector<CmdDPtr> _tick_history;
+
+    // Replay being played. Commands are decoded as they are sent to the queue.
+    ReplayReader _loaded_replay;
 
     // Record current state of each unit. Note that this pointer does not own anything.
     // When the command is destroyed, we should manually delete the entry as well.
-    map<UnitId, CmdDurative *> _unit_durative_cmd;
+    UnitCmdTable<CmdDurative> _unit_durative_cmd;
 
     // Use to dump SendCmd.
     unique_ptr<ostream> _cmd_dumper;
@@ -65,15 +70,23 @@ private:
     // Whether we save the current issued command to the history buffer.
     bool _save_to_history;
 
+    // Whether the history of all ticks is kept (needed to save a replay).
+    bool _keep_history;
+
     // For player id, talk a bit more.
     // id == INVALID means verbose to all players.
     int _verbose_player_id;
     VerboseChoice _verbose_choice;
     bool _path_planning_verbose;
+    // Whether path planning only expands jump points (see GridSearch).
+    bool _path_planning_jump_points;
     bool _use_cmd_comment;
 
+    // Whether CurrentHashCode() is checked against ComputeHashCode().
+    bool _hash_check;
+
     template <typename CmdType>
-    bool show_prompt_cond(const string &prompt, const unique_ptr<CmdType> &cmd, bool force_verbose = false) const {
+    bool show_prompt_cond(const char *prompt, const unique_ptr<CmdType> &cmd, bool force_verbose = false) const {
         if (force_verbose) {
             cout << prompt << " " << cmd->PrintInfo() << endl;
             return true;
@@ -91,17 +104,30 @@ private:
 
 public:
     CmdReceiver()
-        : _tick(0), _cmd_next_id(0), _next_replay_idx(-1),
-          _cmd_dumper(nullptr), _save_to_history(true),
-          _verbose_player_id(INVALID), _verbose_choice(CR_NO_VERBOSE), _path_planning_verbose(false), _use_cmd_comment(false)  {
+        : _tick(0), _cmd_next_id(0),
+          _cmd_dumper(nullptr), _save_to_history(true), _keep_history(true),
+          _verbose_player_id(INVALID), _verbose_choice(CR_NO_VERBOSE), _path_planning_verbose(false), _path_planning_jump_points(false), _use_cmd_comment(false), _hash_check(false)  {
     }
 
+    CmdReceiver(const CmdReceiver &) = delete;
+    CmdReceiver &operator=(const CmdReceiver &) = delete;
+
+    // Makes this receiver a copy of other (a fork), with clones of all the
+    // pending commands. The fork does not keep a history, sends no comments
+    // and does not report to global stats. The replay being played, if any,
+    // is not copied.
+    void CopyFrom(const CmdReceiver &other);
+
     const GameStats &GetGameStats() const { return _stats; }
     GameStats &GetGameStats() { return _stats; }
 
     Tick GetTick() const { return _tick; }
     Tick GetNextTick() const { return _tick + 1; }
-    inline void IncTick() { _tick ++; _stats.IncTick(); }
+    inline void IncTick() {
+        _tick ++;
+        _stats.IncTick();
+        _tick_history.clear();
+    }
     inline void ResetTick() { _tick = 0; _stats.Reset(); }
 
     void SetCmdDumper(const string &cmd_dumper_filename);
@@ -110,16 +136,19 @@ public:
     bool GetUseCmdComment() const { return _use_cmd_comment; }
     void SetPathPlanningVerbose(bool verbose) { _path_planning_verbose = verbose; }
     bool GetPathPlanningVerbose() const { return _path_planning_verbose; }
+    void SetPathPlanningJumpPoints(bool jump_points) { _path_planning_jump_points = jump_points; }
+    bool GetPathPlanningJumpPoints() const { return _path_planning_jump_points; }
 
     void SetVerbose(VerboseChoice choice, PlayerId player_id) {
         _verbose_choice = choice;
         _verbose_player_id = player_id;
     }
     void ClearCmd() {
-        while (! _immediate_cmd_queue.empty()) _immediate_cmd_queue.pop();
-        while (! _durative_cmd_queue.empty()) _durative_cmd_queue.pop();
+        _immediate_cmd_queue.clear();
+        _durative_cmd_queue.clear();
         while (! _ui_cmd_queue.empty()) _ui_cmd_queue.pop();
-        _cmd_history.clear();
+        _cmd_history = ReplayWriter();
+        _tick_history.clear();
         _unit_durative_cmd.clear();
         _cmd_next_id = 0;
     }
@@ -134,6 +163,10 @@ public:
     void SetSaveToHistory(bool v) { _save_to_history = v; }
     bool IsSaveToHistory() const { return _save_to_history; }
 
+    // Set this to be false if no replay will be saved, so that no history is
+    // recorded. GetHistoryAtCurrentTick() still works.
+    void SetKeepHistory(bool v) { _keep_history = v; }
+
     // Start a durative cmd specified by the pointer.
     bool StartDurativeCmd(CmdDurative *);
 
@@ -143,12 +176,17 @@ public:
 
     const CmdDurative *GetUnitDurativeCmd(UnitId id) const;
     int GetLoadedReplaySize() const { return _loaded_replay.size(); }
-    int GetLoadedReplayLastTick() const { return _loaded_replay.back()->tick(); }
+    int GetLoadedReplayLastTick() const { return _loaded_replay.last_tick(); }
+    const ReplayReader &GetLoadedReplay() const { return _loaded_replay; }
     vector<CmdDurative*> GetHistoryAtCurrentTick() const;
 
-    // Save and load Replay from a file
+    // Save and load Replay from a file. LoadReplay accepts both the binary
+    // and the legacy text format. Keyframes are only saved in binary replays.
     bool LoadReplay(const string& replay_filename);
-    bool SaveReplay(const string& replay_filename) const;
+    bool SaveReplay(const string& replay_filename, bool binary = true) const;
+
+    // Record a binary snapshot of the game at the start of tick, to be saved with the replay.
+    void AddReplayKeyframe(Tick tick, string &&state) { _cmd_history.AddKeyframe(tick, std::move(state)); }
 
     // Execute Durative Commands. This will not change the game environment.
     void ExecuteDurativeCmds(const GameEnv &env, bool force_verbose);
@@ -166,6 +204,15 @@ public:
     void SaveCmdReceiver(serializer::saver &saver) const;
     void LoadCmdReceiver(serializer::loader &loader);
 
+    // Zobrist hash of the tick and of the pending commands, kept up to date
+    // as commands are queued, run and finished (see CmdQueue). The history
+    // and the replay being played are not part of it.
+    uint64_t CurrentHashCode() const;
+    // The same hash computed from scratch.
+    uint64_t ComputeHashCode() const;
+    // If set, CurrentHashCode() throws if it differs from ComputeHashCode().
+    void SetHashCheck(bool check) { _hash_check = check; }
+
     ~CmdReceiver() { }
 };
 
@@ -230,51 +230,4 @@ struct Cooldown {
 };
 
 STD_HASH(Cooldown);
-
-class MyClock {
-private:
-    chrono::time_point<chrono::system_clock> _time_start;
-    map<string, pair<chrono::duration<double>, int> > _durations;
-public:
-    MyClock() { }
-    void Restart() {
-        for (auto it = _durations.begin(); it != _durations.end(); ++it) {
-            it->second.first = chrono::duration<double>::zero();
-            it->second.second = 0;
-        }
-        _time_start = chrono::system_clock::now();
-    }
-
-    void SetStartPoint() {
-        _time_start = chrono::system_clock::now();
-    }
-
-    string Summary() const {
-        stringstream ss;
-        double total_time = 0;
-        for (auto it = _durations.begin(); it != _durations.end(); ++it) {
-            if (it->second.second > 0) {
-                double v = it->second.first.count() * 1000 / it->second.second;
-                ss << it->first << ": " << v << "ms. ";
-                total_time += v;
-            }
-        }
-        ss << "Total: " << total_time << "ms.";
-        return ss.str();
-    }
-
-    inline bool Record(const string & item) {
-        // cout << "Record: " << item << endl;
-        auto it = _durations.find(item);
-        if (it == _durations.end()) {
-            it = _durations.insert(make_pair(item, make_pair(chrono::duration<double>(0), 0))).first;
-        }
-
-        auto time_tmp = chrono::system_clock::now();
-        it->second.first += time_tmp - _time_start;
-        it->second.second ++;
-        _time_start = time_tmp;
-        return true;
-    }
-};
 #endif
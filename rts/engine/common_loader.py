@@ -13,7 +13,9 @@ class CommonLoader:
                 ("players", dict(type=str, help=";-separated player infos. For example: type=AI_NN,fs=50,args=backup/AI_SIMPLE|decay/0.99|start/1000,fow=True;type=AI_SIMPLE,fs=50")),
                 ("max_tick", dict(type=int, default=30000, help="Maximal tick")),
                 ("shuffle_player", dict(action="store_true")),
-                ("mcts_threads", 64),
+                ("joint_act", dict(action="store_true", help="All players of a game send their states together (one round trip per tick)")),
+                ("mcts_threads", dict(type=int, default=1, help="#search threads of each AI_MCTS player")),
+                ("mcts_rollout_per_thread", dict(type=int, default=50, help="#simulations per search thread of each AI_MCTS decision")),
                 ("seed", 0),
                 ("actor_only", dict(action="store_true")),
                 ("additional_labels", dict(type=str, default=None, help="Add additional labels in the batch. E.g., id,seq,last_terminal")),
@@ -54,6 +56,27 @@ class CommonLoader:
             if player_names is not None:
                 self._set_key(ai_options, "name", player_names[i])
             opt.AddAIOptions(ai_options)
+        return len(players_str.split(";"))
+
+    def _num_value_keys(self):
+        '''#keys taken by the search threads of the AI_MCTS players that evaluate leaves with the model.'''
+        players_str = str(self.args.players).strip("\"")
+        num_keys = 0
+        for player in players_str.split(";"):
+            items = dict(item.split("=") for item in player.split(","))
+            if items.get("type") != "AI_MCTS":
+                continue
+            # As AIOptions args are parsed in C++: the first value of a key wins.
+            args = dict()
+            for arg in items.get("args", "").split("|"):
+                kv = arg.split("/")
+                if len(kv) == 2:
+                    args.setdefault(kv[0], kv[1])
+            if args.get("eval") != "model":
+                continue
+            # threads/ in the args of the player wins over --mcts_threads.
+            num_keys += int(args.get("threads", self.args.mcts_threads))
+        return num_keys
 
     def _init_gc(self, player_names=None):
         args = self.args
@@ -65,12 +88,21 @@ class CommonLoader:
         opt.seed = args.seed
         opt.shuffle_player = args.shuffle_player
         opt.mcts_threads = args.mcts_threads
-        opt.mcts_rollout_per_thread = 50
+        opt.mcts_rollout_per_thread = args.mcts_rollout_per_thread
         opt.max_tick = args.max_tick
         # [TODO] Put it to TD.
         opt.handicap_level = args.handicap_level
 
-        self._parse_players(opt, player_names)
+        num_players = self._parse_players(opt, player_names)
+
+        opt.joint_act = args.joint_act
+        if args.joint_act:
+            # Each player needs its own key.
+            co.max_num_threads = max(co.max_num_threads, num_players)
+        num_value_keys = self._num_value_keys()
+        if num_value_keys > 0:
+            # Each search thread of AI_MCTS sends its leaves with its own key, after those of the players.
+            co.max_num_threads = max(co.max_num_threads, num_players + num_value_keys)
 
         # opt.output_filename = b"simulators.txt"
         # opt.output_filename = b"cout"
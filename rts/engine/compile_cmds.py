@@ -38,6 +38,8 @@ $var_decl
 $override_run
 
 public:
+    static constexpr CmdType kType = $enum_name;
+
     explicit $classname() { }
     explicit $classname(UnitId id$var_init_list) : $baseclass(id)$var_initializer { }
     CmdType type() const override { return $enum_name; }
@@ -0,0 +1,50 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _COW_PTR_H_
+#define _COW_PTR_H_
+
+#include <memory>
+#include "serializer.h"
+
+// Copy-on-write value. Copies share the object; the first write access
+// (mut()) through a copy that is still shared makes a private copy of it.
+// Used for the parts of a game state that forks rarely change, e.g., the
+// terrain.
+template <typename T>
+class CowPtr {
+public:
+    CowPtr() : _p(std::make_shared<T>()) { }
+
+    const T &operator*() const { return *_p; }
+    const T *operator->() const { return _p.get(); }
+
+    T &mut() {
+        if (_p.use_count() > 1) _p = std::make_shared<T>(*_p);
+        return *_p;
+    }
+
+    bool shared() const { return _p.use_count() > 1; }
+
+    friend serializer::saver &operator<<(serializer::saver &s, const CowPtr &v) {
+        s << *v._p;
+        return s;
+    }
+
+    friend serializer::loader &operator>>(serializer::loader &l, CowPtr &v) {
+        v._p = std::make_shared<T>();
+        l >> *v._p;
+        return l;
+    }
+
+private:
+    std::shared_ptr<T> _p;
+};
+
+#endif
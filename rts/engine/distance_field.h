@@ -0,0 +1,309 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _DISTANCE_FIELD_H_
+#define _DISTANCE_FIELD_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "serializer.h"
+
+const float kUnreachableDist = 1e38;
+
+// Exact 4-neighbor shortest distance (in cells) from every cell of a map
+// plane to one target cell, considering terrain only (units are ignored).
+// Cells that cannot reach the target have distance kUnreachableDist.
+class DistanceField {
+private:
+    Loc _target;
+    std::vector<float> _dist;
+
+public:
+    // passable[loc] != 0 if a unit may stand on loc. The target itself is
+    // always reachable, even if it is not passable (e.g., a building site).
+    DistanceField(Loc target, int m, int n, const std::vector<uint8_t> &passable) {
+        Build(target, m, n, passable);
+    }
+    // A field for no target yet, to be built later.
+    DistanceField(int m, int n) : _target(INVALID), _dist(m * n, kUnreachableDist) { }
+
+    // Recomputes the field in place, for another target or terrain.
+    void Build(Loc target, int m, int n, const std::vector<uint8_t> &passable) {
+        static thread_local std::vector<Loc> q;
+        _target = target;
+        _dist.assign(m * n, kUnreachableDist);
+        q.clear();
+        q.reserve(m * n);
+        _dist[target] = 0;
+        q.push_back(target);
+
+        for (size_t head = 0; head < q.size(); ++head) {
+            const Loc l = q[head];
+            const int x = l % m, y = l / m;
+            const float d = _dist[l] + 1;
+            auto visit = [&](Loc next) {
+                if (passable[next] && _dist[next] == kUnreachableDist) {
+                    _dist[next] = d;
+                    q.push_back(next);
+                }
+            };
+            if (x > 0) visit(l - 1);
+            if (x < m - 1) visit(l + 1);
+            if (y > 0) visit(l - m);
+            if (y < n - 1) visit(l + m);
+        }
+    }
+
+    static constexpr const char *kName = "DistanceFieldCache";
+
+    Loc target() const { return _target; }
+    float Get(Loc loc) const { return _dist[loc]; }
+    bool Reachable(Loc loc) const { return _dist[loc] != kUnreachableDist; }
+    size_t bytes() const { return _dist.size() * sizeof(float) + sizeof(*this); }
+};
+
+// The route of all the units going to one target. Its integration field is
+// the DistanceField of the target; its direction field gives, for every cell
+// that reaches the target, the neighbor one step closer. Following Next()
+// from any cell is a shortest path, at one lookup per step, however many
+// units share the field.
+class FlowField {
+private:
+    DistanceField _dist;
+    int _m;
+    // The step to take (0: +x, 1: -x, 2: +y, 3: -y, see Next()), kNone on
+    // the target and on cells that cannot reach it.
+    std::vector<uint8_t> _dir;
+
+    static const uint8_t kNone = 4;
+
+public:
+    static constexpr const char *kName = "FlowFieldCache";
+
+    FlowField(Loc target, int m, int n, const std::vector<uint8_t> &passable)
+        : _dist(target, m, n, passable) {
+        build_dir(m, n);
+    }
+    // A field for no target yet, to be built later.
+    FlowField(int m, int n) : _dist(m, n), _m(m), _dir(m * n, uint8_t(kNone)) { }
+
+    // Recomputes the field in place, for another target or terrain.
+    void Build(Loc target, int m, int n, const std::vector<uint8_t> &passable) {
+        _dist.Build(target, m, n, passable);
+        build_dir(m, n);
+    }
+
+    Loc target() const { return _dist.target(); }
+    // #steps to the target.
+    float Get(Loc loc) const { return _dist.Get(loc); }
+    bool Reachable(Loc loc) const { return _dist.Reachable(loc); }
+    // The next cell on the way to the target, INVALID if there is none.
+    Loc Next(Loc loc) const {
+        switch (_dir[loc]) {
+            case 0: return loc + 1;
+            case 1: return loc - 1;
+            case 2: return loc + _m;
+            case 3: return loc - _m;
+            default: return INVALID;
+        }
+    }
+    size_t bytes() const { return _dist.bytes() + _dir.size() + sizeof(*this); }
+
+private:
+    void build_dir(int m, int n) {
+        _m = m;
+        _dir.assign(m * n, uint8_t(kNone));
+        const Loc target = _dist.target();
+        const int tx = target % m, ty = target / m;
+        for (Loc l = 0; l < m * n; ++l) {
+            if (l == target || ! _dist.Reachable(l)) continue;
+            const int x = l % m, y = l / m;
+            const float d = _dist.Get(l) - 1;
+            // Among the neighbors one step closer, go along the axis on which
+            // the target is farther, so that paths stay close to straight.
+            uint8_t dir_x = kNone, dir_y = kNone;
+            if (x < m - 1 && _dist.Get(l + 1) == d) dir_x = 0;
+            else if (x > 0 && _dist.Get(l - 1) == d) dir_x = 1;
+            if (y < n - 1 && _dist.Get(l + m) == d) dir_y = 2;
+            else if (y > 0 && _dist.Get(l - m) == d) dir_y = 3;
+            if (dir_x != kNone && (dir_y == kNone || std::abs(x - tx) >= std::abs(y - ty))) _dir[l] = dir_x;
+            else _dir[l] = dir_y;
+        }
+    }
+};
+
+// Lazily built fields (DistanceField or FlowField) keyed by target, evicted
+// in LRU order once the total size exceeds a memory cap. Fields are handed
+// out as shared_ptr, so a caller may keep using one after it has been
+// evicted or invalidated.
+//
+// Fields evicted or invalidated are kept as spares (within the cap), and a
+// spare no caller holds any more is rebuilt in place for the next target, so
+// once the cache is warm, building a field does not allocate. When no spare
+// is free, as many as there are fields and spares are added at once, so that
+// like a vector, the cache grows geometrically.
+template <typename Field>
+class FieldCache {
+public:
+    using FieldPtr = std::shared_ptr<const Field>;
+
+    static const size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+
+    FieldCache() : _m(0), _n(0), _valid(false), _max_bytes(kDefaultMaxBytes), _bytes(0), _spare_bytes(0), _num_built(0), _num_hit(0) { }
+    FieldCache(const FieldCache &other) { *this = other; }
+
+    // Fields are immutable, so a copy shares them with the original. Spares
+    // are not copied.
+    FieldCache &operator=(const FieldCache &other) {
+        if (this == &other) return *this;
+        _m = other._m;
+        _n = other._n;
+        _passable = other._passable;
+        _valid = other._valid;
+        _lru = other._lru;
+        _index.assign(other._index.size(), _lru.end());
+        for (auto it = _lru.begin(); it != _lru.end(); ++it) _index[(*it)->target()] = it;
+        _spare.clear();
+        _max_bytes = other._max_bytes;
+        _bytes = other._bytes;
+        _spare_bytes = 0;
+        _num_built = other._num_built;
+        _num_hit = other._num_hit;
+        return *this;
+    }
+
+    // Drop all fields. Must be called whenever what they are computed on changes.
+    void Invalidate() {
+        _spare.splice(_spare.end(), _lru);
+        _spare_bytes += _bytes;
+        _bytes = 0;
+        _valid = false;
+        evict();
+    }
+    bool valid() const { return _valid; }
+
+    // Set the terrain the fields are computed on: passable(loc) != 0 if a
+    // unit may stand on loc.
+    template <typename F>
+    void Reset(int m, int n, F passable) {
+        Invalidate();
+        _m = m;
+        _n = n;
+        _passable.resize(m * n);
+        for (Loc l = 0; l < m * n; ++l) _passable[l] = passable(l);
+        _index.assign(m * n, _lru.end());
+        _valid = true;
+    }
+
+    void SetMaxBytes(size_t max_bytes) {
+        _max_bytes = max_bytes;
+        evict();
+    }
+
+    FieldPtr Get(Loc target) {
+        auto it = _index[target];
+        if (it != _lru.end()) {
+            _num_hit ++;
+            _lru.splice(_lru.begin(), _lru, it);
+            return *it;
+        }
+
+        _num_built ++;
+        auto spare = _spare.begin();
+        while (spare != _spare.end() && spare->use_count() > 1) ++spare;
+        if (spare == _spare.end()) spare = add_spares();
+        _spare_bytes -= (*spare)->bytes();
+        (*spare)->Build(target, _m, _n, _passable);
+        _lru.splice(_lru.begin(), _spare, spare);
+        _index[target] = _lru.begin();
+        _bytes += _lru.front()->bytes();
+        FieldPtr field = _lru.front();
+        evict();
+        return field;
+    }
+
+    size_t size() const { return _lru.size(); }
+    size_t bytes() const { return _bytes; }
+
+    string PrintInfo() const {
+        stringstream ss;
+        ss << Field::kName << ": #fields: " << _lru.size() << " bytes: " << _bytes << "/" << _max_bytes
+           << " built: " << _num_built << " hit: " << _num_hit;
+        return ss.str();
+    }
+
+    // Fields are not saved; loading a snapshot drops them since the terrain
+    // (and the buildings) have been replaced.
+    friend serializer::saver &operator<<(serializer::saver &oo, const FieldCache &) { return oo; }
+    friend serializer::loader &operator>>(serializer::loader &ii, FieldCache &c) {
+        c.Invalidate();
+        return ii;
+    }
+
+private:
+    using List = std::list<std::shared_ptr<Field>>;
+
+    int _m, _n;
+    std::vector<uint8_t> _passable;
+    bool _valid;
+
+    List _lru;
+    // Position of each target in _lru, _lru.end() if it has no field.
+    std::vector<typename List::iterator> _index;
+    // Fields dropped from _lru.
+    List _spare;
+
+    size_t _max_bytes;
+    size_t _bytes, _spare_bytes;
+
+    uint64_t _num_built, _num_hit;
+
+    // Adds spares (at least one, otherwise as many as there are fields and
+    // spares, as far as the cap allows) and returns the first one.
+    typename List::iterator add_spares() {
+        std::shared_ptr<Field> field = std::make_shared<Field>(_m, _n);
+        const size_t used = _bytes + _spare_bytes + field->bytes();
+        const size_t room = used < _max_bytes ? (_max_bytes - used) / field->bytes() : 0;
+        size_t n = std::min(_lru.size() + _spare.size(), room) + 1;
+        _spare_bytes += field->bytes();
+        _spare.push_front(std::move(field));
+        while (-- n > 0) {
+            _spare.push_front(std::make_shared<Field>(_m, _n));
+            _spare_bytes += _spare.front()->bytes();
+        }
+        return _spare.begin();
+    }
+
+    void evict() {
+        // Always keep the most recent field, even if it alone exceeds the cap.
+        while (_bytes > _max_bytes && _lru.size() > 1) {
+            const size_t bytes = _lru.back()->bytes();
+            _bytes -= bytes;
+            _spare_bytes += bytes;
+            _index[_lru.back()->target()] = _lru.end();
+            _spare.splice(_spare.begin(), _lru, std::prev(_lru.end()));
+        }
+        // Spares only use what the cap leaves.
+        while (! _spare.empty() && _bytes + _spare_bytes > _max_bytes) {
+            _spare_bytes -= _spare.back()->bytes();
+            _spare.pop_back();
+        }
+    }
+};
+
+using DistanceFieldCache = FieldCache<DistanceField>;
+using FlowFieldCache = FieldCache<FlowField>;
+
+#endif
@@ -0,0 +1,106 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _FOG_OF_WAR_H_
+#define _FOG_OF_WAR_H_
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include "common.h"
+#include "serializer.h"
+
+// One bit per cell of a map plane, indexed by Loc (row-major, x fastest).
+// A horizontal run of cells is a contiguous run of bits, so it can be set
+// a word at a time.
+class PlaneBits {
+private:
+    int _size;
+    std::vector<uint64_t> _words;
+
+public:
+    PlaneBits() : _size(0) { }
+    explicit PlaneBits(int size) : _size(size), _words((size + 63) / 64, 0) { }
+
+    int size() const { return _size; }
+    bool Get(Loc loc) const { return (_words[loc >> 6] >> (loc & 63)) & 1; }
+    void Set(Loc loc) { _words[loc >> 6] |= uint64_t(1) << (loc & 63); }
+    void Clear() { std::fill(_words.begin(), _words.end(), 0); }
+
+    // Set bits [lo, hi] (inclusive).
+    void SetRange(int lo, int hi) {
+        int wlo = lo >> 6, whi = hi >> 6;
+        uint64_t mlo = ~uint64_t(0) << (lo & 63);
+        uint64_t mhi = ~uint64_t(0) >> (63 - (hi & 63));
+        if (wlo == whi) {
+            _words[wlo] |= mlo & mhi;
+            return;
+        }
+        _words[wlo] |= mlo;
+        for (int w = wlo + 1; w < whi; ++w) _words[w] = ~uint64_t(0);
+        _words[whi] |= mhi;
+    }
+
+    PlaneBits &operator|=(const PlaneBits &other) {
+        for (size_t i = 0; i < _words.size(); ++i) _words[i] |= other._words[i];
+        return *this;
+    }
+
+    SERIALIZER(PlaneBits, _size, _words);
+};
+
+// Precomputed sight region for each vision range. Same shape as
+// RTSMap::GetSight: all cells within L1 distance <= range. Row dy
+// (from -range to range) spans x in [-half_width[dy + range], half_width[dy + range]].
+class SightStencil {
+private:
+    std::vector<int> _half_width;
+
+    static const int kMaxCached = 64;
+
+public:
+    explicit SightStencil(int range) {
+        for (int dy = -range; dy <= range; ++dy) _half_width.push_back(range - std::abs(dy));
+    }
+
+    int range() const { return (int)_half_width.size() / 2; }
+    int HalfWidth(int dy) const { return _half_width[dy + range()]; }
+
+    // Stencils are immutable and shared by all games.
+    static const SightStencil &Get(int range) {
+        static const std::vector<SightStencil> cache = []() {
+            std::vector<SightStencil> stencils;
+            for (int r = 0; r <= kMaxCached; ++r) stencils.emplace_back(r);
+            return stencils;
+        }();
+        if (range <= kMaxCached) return cache[std::max(range, 0)];
+        static thread_local std::deque<SightStencil> large;
+        for (const auto &s : large) {
+            if (s.range() == range) return s;
+        }
+        large.emplace_back(range);
+        return large.back();
+    }
+
+    // OR the sight region centered at (x, y) into bits of an m x n plane.
+    void Apply(int x, int y, int m, int n, PlaneBits *bits) const {
+        const int r = range();
+        const int ymin = std::max(0, y - r);
+        const int ymax = std::min(n - 1, y + r);
+        for (int yy = ymin; yy <= ymax; ++yy) {
+            const int w = _half_width[yy - y + r];
+            const int xmin = std::max(0, x - w);
+            const int xmax = std::min(m - 1, x + w);
+            bits->SetRange(yy * m + xmin, yy * m + xmax);
+        }
+    }
+};
+
+#endif
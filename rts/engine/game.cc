@@ -18,9 +18,45 @@
 
 using namespace std::chrono;
 
+////////////////////////// RTSState ////////////////////////////////////
+void RTSState::CopyFrom(const GameEnv &env, const CmdReceiver &receiver, Tick max_tick) {
+    _env.CopyFrom(env);
+    _cmd_receiver.CopyFrom(receiver);
+    _max_tick = max_tick;
+}
+
+PlayerId RTSState::Forward(const vector<AI *> &bots, int num_ticks) {
+    for (int i = 0; i < num_ticks; i++) {
+        for (AI *bot : bots) {
+            if (bot != nullptr) bot->PrepareAct(_env, false);
+        }
+        for (AI *bot : bots) {
+            if (bot != nullptr) bot->FinishAct(_env, false);
+        }
+        _env.Forward(&_cmd_receiver);
+        _cmd_receiver.ExecuteDurativeCmds(_env, false);
+        _cmd_receiver.ExecuteImmediateCmds(&_env, false);
+        _env.ComputeFOW();
+
+        const bool exceeds_max_tick = _cmd_receiver.GetTick() >= _max_tick;
+        PlayerId winner_id = _env.GetGameDef().CheckWinner(_env, exceeds_max_tick);
+        _env.SetWinnerId(winner_id);
+        if (exceeds_max_tick) {
+            _env.SetTermination();
+            return MAX_GAME_LENGTH_EXCEEDED;
+        }
+        if (winner_id != INVALID) {
+            _env.SetTermination();
+            return winner_id;
+        }
+        _cmd_receiver.IncTick();
+    }
+    return INVALID;
+}
+
 ////////////////////////// RTSGame ////////////////////////////////////
 RTSGame::RTSGame(const RTSGameOptions &options)
-    : _options(options), _cmd_receiver(), _snapshot_to_load(-1), _paused(false), _output_stream_owned(false), _output_stream(nullptr) {
+    : _options(options), _cmd_receiver(), _snapshot_to_load(-1), _paused(false), _output_stream_owned(false), _output_stream(nullptr), _profiler(&TickProfiler::Global()) {
     if (_options.output_file.empty()) {
         _output_stream = _options.output_stream;
         _output_stream_owned = false;
@@ -37,6 +73,10 @@ RTSGame::RTSGame(const RTSGameOptions &options)
     _bots.clear();
     _env.InitGameDef();
     _env.ClearAllPlayers();
+    if (_options.map_size != _env.GetMap().GetXSize()) _env.GetMap().SetSize(_options.map_size, _options.map_size);
+    _env.SetHashCheck(_options.hash_check);
+    _cmd_receiver.SetHashCheck(_options.hash_check);
+    _cmd_receiver.SetPathPlanningJumpPoints(_options.jump_point_search);
 }
 
 RTSGame::~RTSGame() {
@@ -75,7 +115,7 @@ bool RTSGame::move_to_tick(float percent) {
     cout << "snapshot_load_prefix = " << _options.snapshot_load_prefix << endl;
     cout << "#snapshot = " << _options.snapshots.size() << endl;
 
-    if (num_replay_entry == 0 || _options.snapshot_load_prefix.empty()) {
+    if (num_replay_entry == 0) {
         _snapshot_to_load = -1;
         return false;
     }
@@ -83,6 +123,19 @@ bool RTSGame::move_to_tick(float percent) {
     Tick last_tick = _cmd_receiver.GetLoadedReplayLastTick();
     Tick new_tick = static_cast<Tick>(percent * last_tick + 0.5);
 
+    // Keyframes embedded in the replay take precedence over snapshot files.
+    Tick keyframe_tick;
+    string state;
+    if (_cmd_receiver.GetLoadedReplay().GetKeyframe(new_tick, &keyframe_tick, &state)) {
+        _snapshot_to_load = keyframe_tick;
+        return true;
+    }
+
+    if (_options.snapshot_load_prefix.empty()) {
+        _snapshot_to_load = -1;
+        return false;
+    }
+
     const auto &snapshots = _options.snapshots;
 
     // Check the closest earlier snapshot and load it.
@@ -174,18 +227,37 @@ void RTSGame::Reset() {
    }
 }
 
+void RTSGame::act_bots(bool must_act) {
+    // Bots that talk to a model only fill and queue their states in
+    // PrepareAct(). The first FinishAct() that needs a reply sends all the
+    // queued states at once (AICommGroupT::Flush()), so the bots of a game
+    // share one round trip.
+    for (const auto &bot : _bots) {
+        bot->PrepareAct(_env, must_act);
+    }
+    for (const auto &bot : _bots) {
+        bot->FinishAct(_env, must_act);
+    }
+}
+
 PlayerId RTSGame::Step(int num_ticks, std::string *state) {
     load_from_string(*state);
+    PhaseClock clock(_profiler);
     for (int i = 0; i < num_ticks; i++) {
-        for (const auto &bot : _bots) {
-            bot->Act(_env);
-        }
+        clock.Start();
+        act_bots(false);
+        clock.Record(PHASE_ACT);
         auto default_cmd_dispatch = [&](const UICmd& cmd) { return dispatch_cmds(cmd); };
         _env.Forward(&_cmd_receiver);
+        clock.Record(PHASE_FORWARD);
         _cmd_receiver.ExecuteDurativeCmds(_env, false);
+        clock.Record(PHASE_DURATIVE);
         _cmd_receiver.ExecuteImmediateCmds(&_env, false);
+        clock.Record(PHASE_IMMEDIATE);
         _cmd_receiver.ExecuteUICmds(default_cmd_dispatch);
+        clock.Record(PHASE_UI);
         _env.ComputeFOW();
+        clock.Record(PHASE_FOW);
         PlayerId winner_id = _env.GetGameDef().CheckWinner(_env, _cmd_receiver.GetTick() >= _options.max_tick);
         _env.SetWinnerId(winner_id);
         if (_cmd_receiver.GetTick() >= _options.max_tick) {
@@ -215,6 +287,7 @@ bool RTSGame::PrepareGame() {
   }
 
   _cmd_receiver.SetUseCmdComment(! _options.save_replay_prefix.empty() || ! _options.cmd_dumper_prefix.empty() );
+  _cmd_receiver.SetKeepHistory(! _options.save_replay_prefix.empty());
 
   /*
   if (! _options.map_filename.empty()) {
@@ -290,8 +363,7 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
   auto default_cmd_dispatch = [&](const UICmd& cmd) { return dispatch_cmds(cmd); };
 
   // Start the main loop
-  MyClock clock;
-  clock.Restart();
+  PhaseClock clock(_profiler);
 
   _snapshot_to_load = -1;
   _paused = false;
@@ -302,7 +374,7 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
 
   while (true) {
       auto time_loop_start = chrono::system_clock::now();
-      clock.SetStartPoint();
+      clock.Start();
 
       Tick t = _cmd_receiver.GetTick();
       bool tick_verbose = (_options.peek_ticks.find(t) != _options.peek_ticks.end());
@@ -315,11 +387,25 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
 
       if (! _options.snapshot_prefix.empty()) {
           save_snapshot(_options.snapshot_prefix + "-" + to_string(t) + ".bin");
-          clock.Record("SaveSnapshot");
+          clock.Record(PHASE_SAVE_SNAPSHOT);
+      }
+      if (! _options.save_replay_prefix.empty() && _options.save_replay_binary
+          && _options.replay_keyframe_interval > 0 && t % _options.replay_keyframe_interval == 0) {
+          string state;
+          save_to_string(&state);
+          _cmd_receiver.AddReplayKeyframe(t, std::move(state));
+          clock.Record(PHASE_SAVE_KEYFRAME);
       }
-      if (! _options.snapshot_load_prefix.empty() && _snapshot_to_load >= 0) {
-          string filename = _options.snapshot_load_prefix + "-" + to_string(_snapshot_to_load) + ".bin";
-          load_snapshot(filename);
+      if (_snapshot_to_load >= 0) {
+          Tick keyframe_tick;
+          string state;
+          if (_cmd_receiver.GetLoadedReplay().GetKeyframe(_snapshot_to_load, &keyframe_tick, &state)
+              && keyframe_tick == _snapshot_to_load) {
+              load_from_string(state);
+          } else if (! _options.snapshot_load_prefix.empty()) {
+              string filename = _options.snapshot_load_prefix + "-" + to_string(_snapshot_to_load) + ".bin";
+              load_snapshot(filename);
+          }
           _snapshot_to_load = -1;
       }
       // Check bots input.
@@ -340,10 +426,8 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
 
       if (! _paused) {
           if (!_options.bypass_bot_actions) {
-              for (const auto &bot : _bots) {
-                  if (tick_prompt) *_output_stream << "Run bot " << bot->GetId() << endl << flush;
-                  bot->Act(_env);
-              }
+              if (tick_prompt) *_output_stream << "Run " << _bots.size() << " bots" << endl << flush;
+              act_bots(false);
           } else {
               // Replace all actions with replays.
               _cmd_receiver.SendCurrentReplay();
@@ -354,21 +438,26 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
           _spectator->Act(_env);
       }
 
-      clock.Record("Act");
+      clock.Record(PHASE_ACT);
 
       if (tick_prompt) *_output_stream << "Forwarding ... " << endl << flush;
 
       _env.Forward(&_cmd_receiver);
+      clock.Record(PHASE_FORWARD);
 
       if (tick_prompt) *_output_stream << "Start executing cmds... " << endl << flush;
 
       _cmd_receiver.ExecuteDurativeCmds(_env, tick_verbose);
+      clock.Record(PHASE_DURATIVE);
       _cmd_receiver.ExecuteImmediateCmds(&_env, tick_verbose);
+      clock.Record(PHASE_IMMEDIATE);
       _cmd_receiver.ExecuteUICmds(default_cmd_dispatch);
+      clock.Record(PHASE_UI);
       // cout << "Compute Fow" << endl;
       _env.ComputeFOW();
-
-      clock.Record("Cmd");
+      clock.Record(PHASE_FOW);
+      // Throws if the incremental hash went wrong during this tick.
+      if (_options.hash_check) CurrentHashCode();
 
       if (tick_prompt) *_output_stream << "Checking winner" << endl << flush;
       PlayerId winner_id = _env.GetGameDef().CheckWinner(_env, _cmd_receiver.GetTick() >= _options.max_tick);
@@ -386,9 +475,7 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
               }
           }
 
-          for (const auto &bot : _bots) {
-              bot->Act(_env, true);
-          }
+          act_bots(true);
           if (_spectator != nullptr) {
             _spectator->Act(_env);
           }
@@ -404,7 +491,7 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
           _cmd_receiver.SetPathPlanningVerbose(false);
       }
 
-      clock.Record("Vis");
+      clock.Record(PHASE_END_TICK);
       if (_options.tick_prompt_n_step > 0 && (t + 1) % _options.tick_prompt_n_step == 0) {
           if (_output_stream) *_output_stream << "[" << prefix << "][" << t << "] Time/tick: " << clock.Summary() << endl << flush;
           clock.Restart();
@@ -416,7 +503,7 @@ PlayerId RTSGame::MainLoop(const std::atomic_bool *done) {
 
   // cout << "[" << prefix << "] About to save to rep" << endl;
   if (! _options.save_replay_prefix.empty()) {
-      _cmd_receiver.SaveReplay(prefix + ".rep");
+      _cmd_receiver.SaveReplay(prefix + ".rep", _options.save_replay_binary);
   }
   return _env.GetWinnerId();
 }
@@ -24,6 +24,7 @@
 #include <set>
 #include "game_env.h"
 #include "ai.h"
+#include "profiler.h"
 
 struct RTSGameOptions {
     // A map file that specifies the map, the terrain
@@ -34,6 +35,10 @@ struct RTSGameOptions {
     vector<string> load_replay_filenames;
 
     string save_replay_prefix;
+    // Save replays in the indexed binary format (see replay.h) instead of text.
+    bool save_replay_binary = true;
+    // Embed a game snapshot in binary replays every this many ticks (0: never).
+    int replay_keyframe_interval = 1000;
     string snapshot_prefix;
     string snapshot_load;
     string snapshot_load_prefix;
@@ -75,6 +80,9 @@ struct RTSGameOptions {
     // Max tick for the game to run.
     int max_tick = 30000;
 
+    // The map is map_size x map_size. The features sent to Python assume 20.
+    int map_size = 20;
+
     // Print Interval, in ticks.
     int tick_prompt_n_step = 2000;
 
@@ -84,6 +92,14 @@ struct RTSGameOptions {
     // Handicap_level used in Capture the Flag.
     int handicap_level = 0;
 
+    // Check the incremental hash of the game against a full recompute at
+    // the end of every tick (see GameEnv::SetHashCheck). Slow, for debugging.
+    bool hash_check = false;
+
+    // Path planning only expands jump points (see GridSearch). Same path
+    // lengths, but searches reach further within their iteration budget.
+    bool jump_point_search = false;
+
     string PrintInfo() const {
         std::stringstream ss;
 
@@ -91,6 +107,8 @@ struct RTSGameOptions {
         ss << "Load replay filenames: " << endl;
         for (const auto &f : load_replay_filenames) ss << "  \"" << f << "\"" << endl;
         ss << "Save replay prefix: \"" << save_replay_prefix << "\"" << endl;
+        ss << "Save replay binary: " << (save_replay_binary ? "True" : "False") << endl;
+        ss << "Replay keyframe interval: " << replay_keyframe_interval << endl;
         ss << "Snapshot prefix: \"" << snapshot_prefix << "\"" << endl;
         ss << "Snapshot load: \"" << snapshot_load << "\"" << endl;
         ss << "Snapshot load prefix: \"" << snapshot_load_prefix << "\"" << endl;
@@ -109,13 +127,53 @@ struct RTSGameOptions {
         ss << "Output file: " << output_file << endl;
         ss << "Output stream: " << (output_stream ? "Not Null" : "Null") << endl;
         ss << "Max ticks: " << max_tick << endl;
+        ss << "Map size: " << map_size << endl;
         ss << "Tick prompt n step: " << tick_prompt_n_step << endl;
         ss << "Save with binary format: " << (save_with_binary_format ? "True" : "False") << endl;
+        ss << "Hash check: " << (hash_check ? "True" : "False") << endl;
+        ss << "Jump point search: " << (jump_point_search ? "True" : "False") << endl;
 
         return ss.str();
     }
 };
 
+// A fork of the state of an RTSGame that can be stepped on its own, e.g.,
+// for lookahead search. Bots are owned by the caller and must be given the
+// receiver of the state (SetCmdReceiver) before they act in it.
+class RTSState {
+private:
+    GameEnv _env;
+    CmdReceiver _cmd_receiver;
+    Tick _max_tick;
+
+public:
+    RTSState() : _max_tick(0) { }
+
+    // Makes this state a copy of env and receiver, see GameEnv::CopyFrom
+    // and CmdReceiver::CopyFrom. Buffers are reused across calls.
+    void CopyFrom(const GameEnv &env, const CmdReceiver &receiver, Tick max_tick);
+    void CopyFrom(const RTSState &other) { CopyFrom(other._env, other._cmd_receiver, other._max_tick); }
+
+    const GameEnv &env() const { return _env; }
+    GameEnv &env() { return _env; }
+    const CmdReceiver &receiver() const { return _cmd_receiver; }
+    CmdReceiver &receiver() { return _cmd_receiver; }
+
+    Tick GetTick() const { return _cmd_receiver.GetTick(); }
+    Tick GetMaxTick() const { return _max_tick; }
+    void SetMaxTick(Tick max_tick) { _max_tick = max_tick; }
+    bool IsTerminal() const { return _env.GetTermination(); }
+
+    // Hash of the game state and the pending commands, e.g., to find
+    // transpositions in a search. Cheap, see GameEnv::CurrentHashCode().
+    uint64_t CurrentHashCode() const { return _env.CurrentHashCode() ^ _cmd_receiver.CurrentHashCode(); }
+
+    // Runs num_ticks ticks like RTSGame does; bots[i] (if not nullptr) plays
+    // player i. Returns the winner, MAX_GAME_LENGTH_EXCEEDED, or INVALID if
+    // the game goes on.
+    PlayerId Forward(const vector<AI *> &bots, int num_ticks);
+};
+
 // A tick-based RTS game.
 class RTSGame {
 private:
@@ -144,6 +202,9 @@ private:
     bool _output_stream_owned;
     ostream *_output_stream;
 
+    // Where the durations of tick phases go.
+    TickProfiler *_profiler;
+
 private:
     // Dispatch commands received from gui.
     CmdReturn dispatch_cmds(const UICmd& cmd);
@@ -161,6 +222,9 @@ private:
     // Load a game from a state string.
     void load_from_string(const string &s);
 
+    // Let all bots act for the current tick.
+    void act_bots(bool must_act);
+
 public:
     // Initialize the game.
     explicit RTSGame(const RTSGameOptions &options);
@@ -168,9 +232,15 @@ public:
     // Not a good design. Need to fix.
     CmdReceiver *GetCmdReceiver() { return &_cmd_receiver; }
 
+    // Record tick phases to profiler instead of TickProfiler::Global().
+    void SetProfiler(TickProfiler *profiler) { _profiler = profiler; }
+
     // Get game environment associated with rts game.
     const GameEnv &GetGameEnv() const { return _env; }
 
+    // Same as RTSState::CurrentHashCode(); a fork hashes like its source.
+    uint64_t CurrentHashCode() const { return _env.CurrentHashCode() ^ _cmd_receiver.CurrentHashCode(); }
+
     // Reset game conditions
     void Reset();
 
@@ -183,6 +253,8 @@ public:
     PlayerId MainLoop(const std::atomic_bool *done = nullptr);
     // Step the game once and modify state string in place.
     PlayerId Step(int num_step, std::string *state);
+    // Fork the current state of the game into state.
+    void Fork(RTSState *state) const { state->CopyFrom(_env, _cmd_receiver, _options.max_tick); }
     void save_to_string(string *s) const;
     ~RTSGame();
 };
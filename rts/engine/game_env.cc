@@ -10,13 +10,44 @@
 #include "game_env.h"
 #include "cmd.h"
 
-GameEnv::GameEnv() {
+GameEnv::GameEnv() : _hash(0), _all_units_dirty(false), _players_dirty(false), _hash_check(false) {
+    _gamedef = std::make_shared<GameDef>();
     // Load the map.
     _map = unique_ptr<RTSMap>(new RTSMap());
     _game_counter = -1;
     Reset();
 }
 
+void GameEnv::CopyFrom(const GameEnv &other) {
+    _gamedef = other._gamedef;
+    _game_counter = other._game_counter;
+    _next_unit_id = other._next_unit_id;
+    _units.CopyFrom(other._units);
+    _bullets = other._bullets;
+    *_map = *other._map;
+    _players = other._players;
+    for (auto &player : _players) {
+        player.ResetMap(_map.get());
+    }
+    _rng = other._rng;
+    _winner_id = other._winner_id;
+    _terminated = other._terminated;
+
+    // Units keep their keys through UnitSlotMap::CopyFrom.
+    _hash = other._hash;
+    _dirty_units = other._dirty_units;
+    _all_units_dirty = other._all_units_dirty;
+    _player_keys = other._player_keys;
+    _players_dirty = other._players_dirty;
+    _hash_check = other._hash_check;
+}
+
+std::unique_ptr<GameEnv> GameEnv::Clone() const {
+    std::unique_ptr<GameEnv> env(new GameEnv());
+    env->CopyFrom(*this);
+    return env;
+}
+
 void GameEnv::Visualize() const {
     for (const auto &player : _players) {
         std::cout << player.PrintInfo() << std::endl;
@@ -32,6 +63,8 @@ void GameEnv::Visualize() const {
 
 void GameEnv::ClearAllPlayers() {
     _players.clear();
+    for (uint64_t key : _player_keys) _hash ^= key;
+    _player_keys.clear();
 }
 
 void GameEnv::Reset() {
@@ -43,16 +76,27 @@ void GameEnv::Reset() {
     _units.clear();
     _bullets.clear();
     for (auto& player : _players) {
-        player.ClearCache();
+        player.Reset();
     }
+
+    _hash = 0;
+    _dirty_units.clear();
+    _all_units_dirty = false;
+    _player_keys.clear();
+    _players_dirty = true;
 }
 
 void GameEnv::AddPlayer(PlayerPrivilege pv) {
     _players.emplace_back(*_map, _players.size());
     _players.back().SetPrivilege(pv);
+    _players_dirty = true;
 }
 
 void GameEnv::RemovePlayer() {
+    if (_player_keys.size() == _players.size()) {
+        _hash ^= _player_keys.back();
+        _player_keys.pop_back();
+    }
     _players.pop_back();
 }
 
@@ -80,42 +124,92 @@ void GameEnv::LoadSnapshot(serializer::loader &loader) {
     for (auto &player : _players) {
         player.ResetMap(_map.get());
     }
+
+    // Loaded units have no key yet.
+    _hash = 0;
+    _dirty_units.clear();
+    _all_units_dirty = true;
+    _player_keys.clear();
+    _players_dirty = true;
 }
 
-// Compute the hash code.
-uint64_t GameEnv::CurrentHashCode() const {
-    uint64_t code = 0;
-    for (auto it = _units.begin(); it != _units.end(); ++it) {
-        serializer::hash_combine(code, it->first);
-        serializer::hash_combine(code, *it->second);
-        // cout << "Unit: " << it->first << ": #hash = " << this_code << ", " << it->second->GetProperty().CD(CD_ATTACK).PrintInfo() << endl;
-        // code ^= this_code;
+void GameEnv::rekey(Unit *u) const {
+    const uint64_t key = u->ComputeHashKey();
+    _hash ^= u->_hash_key ^ key;
+    u->_hash_key = key;
+    u->_hash_dirty = false;
+}
+
+void GameEnv::update_hash() const {
+    if (_all_units_dirty) {
+        for (const auto &item : _units) rekey(item.second);
+        _all_units_dirty = false;
+    } else {
+        // Units removed since are skipped, their keys are already out.
+        for (UnitId id : _dirty_units) {
+            Unit *u = _units.get(id);
+            if (u != nullptr) rekey(u);
+        }
     }
-    // Players.
-    for (const auto &player : _players) {
-        serializer::hash_combine(code, player);
+    _dirty_units.clear();
+
+    if (_players_dirty) {
+        _player_keys.resize(_players.size(), 0);
+        for (size_t i = 0; i < _players.size(); ++i) {
+            const uint64_t key = _players[i].ComputeHashKey();
+            _hash ^= _player_keys[i] ^ key;
+            _player_keys[i] = key;
+        }
+        _players_dirty = false;
     }
+}
+
+uint64_t GameEnv::CurrentHashCode() const {
+    update_hash();
+    if (_hash_check) {
+        const uint64_t full = ComputeHashCode();
+        if (_hash != full) {
+            std::stringstream ss;
+            ss << "GameEnv: incremental hash " << hex << _hash << " != " << full << dec << ", units changed unnoticed:";
+            for (const auto &item : _units) {
+                if (item.second->_hash_key != item.second->ComputeHashKey()) ss << " " << item.first;
+            }
+            throw std::range_error(ss.str());
+        }
+    }
+    return _hash;
+}
+
+uint64_t GameEnv::ComputeHashCode() const {
+    uint64_t code = 0;
+    for (const auto &item : _units) code ^= item.second->ComputeHashKey();
+    for (const auto &player : _players) code ^= player.ComputeHashKey();
     return code;
 }
 
 bool GameEnv::AddUnit(Tick tick, UnitType type, const PointF &p, PlayerId player_id) {
     // Check if there is any space.
-    if (!_gamedef.CheckAddUnit(_map.get(), type, p)) return false;
+    if (!_gamedef->CheckAddUnit(_map.get(), type, p)) return false;
     // cout << "Actual adding unit." << endl;
 
     UnitId new_id = Player::CombinePlayerId(_next_unit_id, player_id);
-    Unit *new_unit = new Unit(tick, new_id, type, p, _gamedef.unit(type)._property);
-    _units.insert(make_pair(new_id, unique_ptr<Unit>(new_unit)));
+    Unit *u = _units.insert(Unit(tick, new_id, type, p, _gamedef->unit(type)._property));
+    // The unit has no key yet, it gets one on the next CurrentHashCode().
+    u->_hash_dirty = true;
+    _dirty_units.push_back(new_id);
     _map->AddUnit(new_id, p);
+    if (_gamedef->IsUnitTypeBuilding(type)) _map->AddBuilding(p);
 
     _next_unit_id ++;
     return true;
 }
 
 bool GameEnv::RemoveUnit(const UnitId &id) {
-    auto it = _units.find(id);
-    if (it == _units.end()) return false;
-    _units.erase(it);
+    const Unit *u = _units.get(id);
+    if (u == nullptr) return false;
+    _hash ^= u->_hash_key;
+    if (_gamedef->IsUnitTypeBuilding(u->GetUnitType())) _map->RemoveBuilding(u->GetPointF());
+    _units.erase(id);
 
     _map->RemoveUnit(id);
     return true;
@@ -124,7 +218,7 @@ bool GameEnv::RemoveUnit(const UnitId &id) {
 UnitId GameEnv::FindClosestBase(PlayerId player_id) const {
     // Find closest base. [TODO]: Not efficient here.
     for (auto it = _units.begin(); it != _units.end(); ++it) {
-        const Unit *u = it->second.get();
+        const Unit *u = it->second;
         if ((u->GetUnitType() == BASE || u->GetUnitType() == FLAG_BASE) && u->GetPlayerId() == player_id) {
             return u->GetId();
         }
@@ -135,7 +229,7 @@ UnitId GameEnv::FindClosestBase(PlayerId player_id) const {
 PlayerId GameEnv::CheckBase(UnitType base_type) const{
     PlayerId last_player_has_base = INVALID;
     for (auto it = _units.begin(); it != _units.end(); ++it) {
-        const Unit *u = it->second.get();
+        const Unit *u = it->second;
         if (u->GetUnitType() == base_type) {
             if (last_player_has_base == INVALID) {
                 last_player_has_base = u->GetPlayerId();
@@ -189,9 +283,11 @@ bool GameEnv::FindBuildPlaceNearby(const PointF &p, int l1_radius, PointF *res_p
 bool GameEnv::FindClosestPlaceWithDistance(const PointF &p, int dist,
   const vector<const Unit *>& units, PointF *res_p) const {
   const RTSMap &m = *_map;
-  vector<Loc> distances(m.GetXSize() * m.GetYSize());
-  vector<Loc> current;
-  vector<Loc> nextloc;
+  // Per thread, so that the search does not allocate once warm.
+  static thread_local vector<Loc> distances, current, nextloc;
+  distances.assign(m.GetXSize() * m.GetYSize(), 0);
+  current.clear();
+  nextloc.clear();
   for (auto unit : units) {
       Loc loc = m.GetLoc(unit->GetPointF().ToCoord());
       distances[loc] = 0;
@@ -213,7 +309,7 @@ bool GameEnv::FindClosestPlaceWithDistance(const PointF &p, int dist,
               }
           }
       }
-      current = nextloc;
+      current.swap(nextloc);
       nextloc.clear();
   }
 
@@ -234,8 +330,9 @@ bool GameEnv::FindClosestPlaceWithDistance(const PointF &p, int dist,
 }
 
 void GameEnv::Forward(CmdReceiver *receiver) {
-    // Compute all bullets.
-    set<int> done_bullets;
+    // Compute all bullets. Indices of those done, in ascending order.
+    static thread_local vector<int> done_bullets;
+    done_bullets.clear();
     for (size_t i = 0; i < _bullets.size(); ++i) {
         CmdBPtr cmd = _bullets[i].Forward(*_map, _units);
         if (cmd.get() != nullptr) {
@@ -245,12 +342,12 @@ void GameEnv::Forward(CmdReceiver *receiver) {
             receiver->SendCmd(std::move(cmd));
             receiver->SetSaveToHistory(true);
         }
-        if (_bullets[i].IsDead()) done_bullets.insert(i);
+        if (_bullets[i].IsDead()) done_bullets.push_back(i);
     }
 
     // Remove bullets that are done.
     // Need to traverse in the reverse order.
-    for (set<int>::reverse_iterator it = done_bullets.rbegin(); it != done_bullets.rend(); ++it) {
+    for (auto it = done_bullets.rbegin(); it != done_bullets.rend(); ++it) {
         unsigned int idx = *it;
         if (idx < _bullets.size() - 1) {
             swap(_bullets[idx], _bullets.back());
@@ -278,11 +375,11 @@ bool GameEnv::GenerateTDMaze() {
     return _map->GenerateTDMaze(GetRandomFunc());
 }
 
-const Unit *GameEnv::PickFirstIdle(const vector<const Unit *> units, const CmdReceiver &receiver) {
+const Unit *GameEnv::PickFirstIdle(const vector<const Unit *> &units, const CmdReceiver &receiver) {
     return PickFirst(units, receiver, INVALID_CMD);
 }
 
-const Unit *GameEnv::PickFirst(const vector<const Unit *> units, const CmdReceiver &receiver, CmdType t) {
+const Unit *GameEnv::PickFirst(const vector<const Unit *> &units, const CmdReceiver &receiver, CmdType t) {
     for (const auto *u : units) {
         const CmdDurative *cmd = receiver.GetUnitDurativeCmd(u->GetId());
         if ( (t == INVALID_CMD && cmd == nullptr) || (cmd != nullptr && cmd->type() == t)) return u;
@@ -11,7 +11,7 @@
 #define _GAME_DEV_H_
 
 #include "cmd_receiver.h"
-#include "unit.h"
+#include "unit_slot_map.h"
 #include "bullet.h"
 #include "map.h"
 #include "player.h"
@@ -19,8 +19,8 @@
 
 class GameEnv {
 private:
-    // Game definitions.
-    GameDef _gamedef;
+    // Game definitions. Never changed after InitGameDef(), so forks share them.
+    std::shared_ptr<const GameDef> _gamedef;
 
     // Game counter.
     int _game_counter;
@@ -50,6 +50,21 @@ private:
     // This happens if the time tick exceeds max_tick, or there is anything wrong.
     bool _terminated;
 
+    // Zobrist hash of units and players (see CurrentHashCode()). It covers
+    // the keys cached in the units and in _player_keys; units and players
+    // handed out for writing since are re-keyed on the next call.
+    mutable uint64_t _hash;
+    mutable vector<UnitId> _dirty_units;
+    // All units may have changed (GetUnits() was called for writing).
+    mutable bool _all_units_dirty;
+    mutable vector<uint64_t> _player_keys;
+    mutable bool _players_dirty;
+    // Whether CurrentHashCode() is checked against ComputeHashCode().
+    bool _hash_check;
+
+    void update_hash() const;
+    void rekey(Unit *u) const;
+
 public:
     class UnitIterator {
         private:
@@ -63,7 +78,7 @@ public:
                 while (_it != _env->_units.end()) {
                     const Unit &u = *_it->second;
                     if (_player_id == INVALID || _env->_players[_player_id].FilterWithFOW(u)) {
-                        bool is_building = _env->_gamedef.IsUnitTypeBuilding(u.GetUnitType());
+                        bool is_building = _env->_gamedef->IsUnitTypeBuilding(u.GetUnitType());
                         if ((is_building && _output_building) || (! is_building && _output_moving)) break;
                     }
                     ++ _it;
@@ -90,6 +105,16 @@ public:
     };
 
     GameEnv();
+    GameEnv(const GameEnv &) = delete;
+    GameEnv &operator=(const GameEnv &) = delete;
+
+    // Makes this environment a copy of other (a fork). The terrain and the
+    // game definitions are shared with other, everything else is copied.
+    // The copy hashes to the same CurrentHashCode() and, given the same
+    // commands, evolves exactly like other. Buffers of this environment are
+    // reused, so forking repeatedly into the same environment is cheap.
+    void CopyFrom(const GameEnv &other);
+    std::unique_ptr<GameEnv> Clone() const;
 
     void Visualize() const;
 
@@ -124,30 +149,26 @@ public:
     bool GenerateTDMaze();
 
     const Units& GetUnits() const { return _units; }
-    Units& GetUnits() { return _units; }
+    Units& GetUnits() { _all_units_dirty = true; return _units; }
 
     // Initialize different units for this game.
     void InitGameDef() {
-        _gamedef.Init();
-    }
-    const GameDef &GetGameDef() const { return _gamedef; }
-
-    // Get a unit from its Id.
-    const Unit *GetUnit(UnitId id) const {
-        const Unit *target = nullptr;
-        if (id != INVALID) {
-            auto it = _units.find(id);
-            if (it != _units.end()) target = it->second.get();
-        }
-        return target;
+        auto gamedef = std::make_shared<GameDef>();
+        gamedef->Init();
+        _gamedef = gamedef;
     }
+    const GameDef &GetGameDef() const { return *_gamedef; }
+
+    // Get a unit from its Id. The non-const version marks the unit as
+    // changed for CurrentHashCode().
+    const Unit *GetUnit(UnitId id) const { return _units.get(id); }
     Unit *GetUnit(UnitId id) {
-        Unit *target = nullptr;
-        if (id != INVALID) {
-            auto it = _units.find(id);
-            if (it != _units.end()) target = it->second.get();
+        Unit *u = _units.get(id);
+        if (u != nullptr && ! u->_hash_dirty) {
+            u->_hash_dirty = true;
+            _dirty_units.push_back(id);
         }
-        return target;
+        return u;
     }
 
     // Find the closest base.
@@ -164,7 +185,7 @@ public:
             const vector<const Unit *>& units, PointF *res_p) const;
 
     const Player &GetPlayer(PlayerId player_id) const { return _players[player_id]; }
-    Player &GetPlayer(PlayerId player_id) { return _players[player_id]; }
+    Player &GetPlayer(PlayerId player_id) { _players_dirty = true; return _players[player_id]; }
 
     // Add and remove units.
     bool AddUnit(Tick tick, UnitType type, const PointF &p, PlayerId player_id);
@@ -236,15 +257,23 @@ public:
     void SaveSnapshot(serializer::saver &saver) const;
     void LoadSnapshot(serializer::loader &loader);
 
-    // Compute the hash code.
+    // Zobrist hash of all units and players. Only what changed since the
+    // last call is re-keyed: units and players count as changed once they
+    // are handed out for writing (non-const GetUnit(), GetUnits() and
+    // GetPlayer()), and added and removed units are accounted for directly.
     uint64_t CurrentHashCode() const;
+    // The same hash computed from scratch.
+    uint64_t ComputeHashCode() const;
+    // If set, CurrentHashCode() throws if it differs from ComputeHashCode().
+    // Slow, for debugging.
+    void SetHashCheck(bool check) { _hash_check = check; }
 
     string PrintDebugInfo() const;
     ~GameEnv() { }
 
     // Some utility function to pick first from units in a group.
-    static const Unit *PickFirstIdle(const vector<const Unit *> units, const CmdReceiver &receiver);
-    static const Unit *PickFirst(const vector<const Unit *> units, const CmdReceiver &receiver, CmdType t) ;
+    static const Unit *PickFirstIdle(const vector<const Unit *> &units, const CmdReceiver &receiver);
+    static const Unit *PickFirst(const vector<const Unit *> &units, const CmdReceiver &receiver, CmdType t) ;
 };
 
 #endif
@@ -8,6 +8,7 @@
 */
 
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <sstream>
 #include <mutex>
@@ -55,11 +56,20 @@ public:
 
 class GameStats {
 private:
+    // #ticks CheckGameSmooth() looks back.
+    static const int kSmoothWindow = 30;
+
     int _base_choice;
     PlayerId _winner;
-    std::vector<float> _ratio_failed_moves;
+    // #failed moves of the last kSmoothWindow ticks, tick t in slot
+    // t % kSmoothWindow, so that it does not grow with the game.
+    float _ratio_failed_moves[kSmoothWindow];
+    Tick _tick;
     GlobalStats *_gstats;
 
+    float &failed_moves(Tick tick) { return _ratio_failed_moves[tick % kSmoothWindow]; }
+    float failed_moves(Tick tick) const { return _ratio_failed_moves[tick % kSmoothWindow]; }
+
 public:
     GameStats(GlobalStats *gstats = nullptr) : _gstats(nullptr) {
         Reset();
@@ -74,18 +84,19 @@ public:
 
     bool CheckGameSmooth(Tick tick, std::ostream *output = nullptr) const {
         // Check if the game goes smoothly.
-        if (_ratio_failed_moves[tick] < 1.0) return true;
+        if (failed_moves(tick) < 1.0) return true;
         float failed_summation = 0.0;
 
         // Check last 30 ticks, if there is a lot of congestion, return false;
-        for (int i = 0; i < min(tick, 30); ++i) {
-            failed_summation += _ratio_failed_moves[tick - i];
+        const int window = tick < kSmoothWindow ? tick : kSmoothWindow;
+        for (int i = 0; i < window; ++i) {
+            failed_summation += failed_moves(tick - i);
         }
         if (failed_summation >= 250.0) {
             if (output) {
               *output<< "[" << tick << "]: The game is not in good shape! sum_failed = " << failed_summation << endl;
-              for (int i = 0; i < min(tick, 30); ++i) {
-                  *output << "  [" << tick - i << "]: " << _ratio_failed_moves[tick - i] << endl;
+              for (int i = 0; i < window; ++i) {
+                  *output << "  [" << tick - i << "]: " << failed_moves(tick - i) << endl;
               }
             }
             return false;
@@ -94,7 +105,7 @@ public:
 
     // Called by the move command, record #failed moves.
     void RecordFailedMove(Tick tick, float ratio_unit_failed) {
-        _ratio_failed_moves[tick] += ratio_unit_failed;
+        failed_moves(tick) += ratio_unit_failed;
     }
 
     void Reset() {
@@ -103,7 +114,8 @@ public:
         }
         _base_choice = -1;
         _winner = INVALID;
-        _ratio_failed_moves.resize(1, 0.0);
+        std::fill(_ratio_failed_moves, _ratio_failed_moves + kSmoothWindow, 0.0f);
+        _tick = 0;
     }
 
     void PickBase(int base_choice) {
@@ -111,11 +123,16 @@ public:
     }
 
     void IncTick() {
-        _ratio_failed_moves.push_back(0.0);
+        failed_moves(++_tick) = 0.0;
     }
 
+    // The ticks in between start with no failed moves. Going back also
+    // forgets the ticks whose slots were reused since.
     void SetTick(Tick tick) {
-        _ratio_failed_moves.resize(tick + 1, 0);
+        const Tick from = std::min(tick, _tick);
+        const Tick to = std::min(std::max(tick, _tick), from + kSmoothWindow);
+        for (Tick t = from + 1; t <= to; ++t) failed_moves(t) = 0.0;
+        _tick = tick;
     }
 
     void SetWinner(PlayerId id) {
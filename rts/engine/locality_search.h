@@ -10,11 +10,11 @@
 #ifndef _LOCALITY_SEARCH_H_
 #define _LOCALITY_SEARCH_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
-#include <set>
 #include <sstream>
 #include <vector>
-#include <unordered_map>
 #include <utility>
 
 #include <iostream>
@@ -107,21 +107,60 @@ struct LineCoeff {
     }
 };
 
+// Objects of radius up to max_radius (units), indexed by a uniform grid of
+// buckets of side 2 * max_radius: an object can only touch the objects of
+// the 3x3 buckets around its own.
+//
+// The grid is flat. Each bucket is a fixed slice of kBucketCapacity entries
+// of one array, so nothing is allocated as objects move. Objects that are
+// larger, outside of the grid, or that do not fit in their bucket (they would
+// have to overlap, which RTSMap does not allow) go to a short list of
+// irregular objects, which every query checks as well.
+//
+// Keys are UnitIds: the location of an object is found in a table indexed by
+// the lower 24 bits of its key (see UnitSlotMap), which keeps its capacity
+// when objects are removed or cleared.
 template <typename T>
 class LocalitySearch {
+public:
+    static const int kBucketCapacity = 4;
+
+    // Squared distance and key of an object found by KNearest().
+    using Neighbor = std::pair<float, T>;
+
 private:
+    using Loc = std::pair<PointF, float>;
+
+    struct Entry {
+        T key;
+        Loc loc;
+    };
+
     PointF _pmin;
     PointF _pmax;
-    float _margin;
-    int _n;
-    int _m;
-
-    using Loc = std::pair<PointF, float>;
-    using KeysToLocs = std::unordered_map<T, Loc>;
-    // If memory usage is an issue, we can store iterator in the grid instead
-    KeysToLocs _keys2locs;
-    KeysToLocs _irreg_keys2locs;
-    std::vector<std::vector<KeysToLocs>> _grid;
+    float _margin = 1.0;
+    // #buckets along x and y.
+    int _n = 0;
+    int _m = 0;
+
+    // Entries keep the full key, INVALID if the slot is empty.
+    std::vector<Entry> _keys2locs;
+    // Bucket (x, y) holds _counts[b] entries from _buckets[b * kBucketCapacity],
+    // where b = x * _m + y.
+    std::vector<Entry> _buckets;
+    std::vector<uint8_t> _counts;
+    std::vector<Entry> _irregular;
+
+    static size_t raw(const T& key) { return static_cast<size_t>(key) & 0xffffff; }
+
+    const Entry *find(const T& key) const {
+        const size_t idx = raw(key);
+        if (key < 0 || idx >= _keys2locs.size() || _keys2locs[idx].key != key) return nullptr;
+        return &_keys2locs[idx];
+    }
+    Entry *find(const T& key) {
+        return const_cast<Entry *>(static_cast<const LocalitySearch *>(this)->find(key));
+    }
 
     int GetXBucket(float x) const {
         return static_cast<int>((x - _pmin.x) / _margin);
@@ -139,6 +178,20 @@ private:
         return GetYBucket(p.y);
     }
 
+    // Bucket of a coordinate, clamped to the grid (also for points far away).
+    static int clamp_bucket(float v, float vmin, float margin, int n) {
+        const float b = (v - vmin) / margin;
+        if (b <= 0) return 0;
+        if (b >= n - 1) return n - 1;
+        return static_cast<int>(b);
+    }
+
+    int bucket(int x_i, int y_i) const { return x_i * _m + y_i; }
+    int bucket(const PointF& p) const { return bucket(GetXBucket(p), GetYBucket(p)); }
+
+    const Entry *bucket_begin(int b) const { return &_buckets[b * kBucketCapacity]; }
+    const Entry *bucket_end(int b) const { return bucket_begin(b) + _counts[b]; }
+
     bool IsRegular(const PointF& p, const float radius) const {
         return 2 * radius < _margin + std::numeric_limits<float>::epsilon()
             && p.IsIn(_pmin, _pmax);
@@ -150,11 +203,67 @@ private:
       return dist_sqr < sum_dist * sum_dist;
     }
 
+    void insert(const T& key, const Loc& loc) {
+        if (IsRegular(loc.first, loc.second)) {
+            const int b = bucket(loc.first);
+            if (_counts[b] < kBucketCapacity) {
+                _buckets[b * kBucketCapacity + _counts[b]] = Entry{ key, loc };
+                _counts[b] ++;
+                return;
+            }
+        }
+        _irregular.push_back(Entry{ key, loc });
+    }
+
+    void erase(const T& key, const Loc& loc) {
+        if (IsRegular(loc.first, loc.second)) {
+            const int b = bucket(loc.first);
+            Entry *entries = &_buckets[b * kBucketCapacity];
+            for (int i = 0; i < _counts[b]; ++i) {
+                if (entries[i].key == key) {
+                    _counts[b] --;
+                    entries[i] = entries[_counts[b]];
+                    return;
+                }
+            }
+        }
+        for (size_t i = 0; i < _irregular.size(); ++i) {
+            if (_irregular[i].key == key) {
+                _irregular[i] = _irregular.back();
+                _irregular.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Calls f(entry) on the irregular objects and on the objects of all the
+    // buckets that intersect the box [lo, hi], until f returns false.
+    template <typename F>
+    bool for_each_in_box(const PointF& lo, const PointF& hi, F f) const {
+        for (const Entry &e : _irregular) {
+            if (! f(e)) return false;
+        }
+        const int x0 = clamp_bucket(lo.x, _pmin.x, _margin, _n);
+        const int x1 = clamp_bucket(hi.x, _pmin.x, _margin, _n);
+        const int y0 = clamp_bucket(lo.y, _pmin.y, _margin, _m);
+        const int y1 = clamp_bucket(hi.y, _pmin.y, _margin, _m);
+        for (int x_i = x0; x_i <= x1; ++x_i) {
+            for (int y_i = y0; y_i <= y1; ++y_i) {
+                const int b = bucket(x_i, y_i);
+                for (const Entry *e = bucket_begin(b); e != bucket_end(b); ++e) {
+                    if (! f(*e)) return false;
+                }
+            }
+        }
+        return true;
+    }
+
     bool _line_passable(const LineCoeff &c, int x_ind, int y_ind, T* id, LineResult* result) const {
-        if (x_ind < 0 || x_ind >= _m || y_ind < 0 || y_ind >= _n) return true;
-        for (const auto& item : _grid[x_ind][y_ind]) {
-            if (! c.IsPassable(item.second.first, item.second.second, result)) {
-                if (id) *id = item.first;
+        if (x_ind < 0 || x_ind >= _n || y_ind < 0 || y_ind >= _m) return true;
+        const int b = bucket(x_ind, y_ind);
+        for (const Entry *e = bucket_begin(b); e != bucket_end(b); ++e) {
+            if (! c.IsPassable(e->loc.first, e->loc.second, result)) {
+                if (id) *id = e->key;
                 return false;
             }
         }
@@ -162,10 +271,10 @@ private:
     }
 
     bool _line_irregular_passable(const LineCoeff &c, T* id, LineResult *result) const {
-        for (const auto& item : _irreg_keys2locs) {
-            // cout << "Check irregular " << item.second.first << " radius = " << item.second.second << endl;
-            if (! c.IsPassable(item.second.first, item.second.second, result)) {
-                if (id) *id = item.first;
+        for (const Entry &e : _irregular) {
+            // cout << "Check irregular " << e.loc.first << " radius = " << e.loc.second << endl;
+            if (! c.IsPassable(e.loc.first, e.loc.second, result)) {
+                if (id) *id = e.key;
                 return false;
             }
         }
@@ -178,60 +287,59 @@ public:
     LocalitySearch(
         const PointF& pmin,
         const PointF& pmax,
-        const float max_radius = kUnitRadius)
-            : _pmin(pmin), _pmax(pmax), _margin(2 * max_radius) {
+        const float max_radius = kUnitRadius) {
+        Reset(pmin, pmax, max_radius);
+    }
+
+    // Same as a new LocalitySearch, but keeps the storage of this one.
+    void Reset(const PointF& pmin, const PointF& pmax, const float max_radius = kUnitRadius) {
+        _pmin = pmin;
+        _pmax = pmax;
+        _margin = 2 * max_radius;
         _n = static_cast<int>((_pmax.x - _pmin.x + _margin) / _margin);
         _m = static_cast<int>((_pmax.y - _pmin.y + _margin) / _margin);
-        _grid.resize(_n, std::vector<KeysToLocs>(_m));
+        _buckets.resize(_n * _m * kBucketCapacity);
+        _counts.resize(_n * _m);
+        Clear();
     }
 
     // Add location and key
     void Add(const T& key, const PointF& p, const float radius) {
         const auto loc = Loc(p, radius);
-        _keys2locs.emplace(key, loc);
-        if (IsRegular(p, radius)) {
-            int x_i = GetXBucket(p);
-            int y_i = GetYBucket(p);
-            // cout << "Add " << p << " to (" << x_i << ", " << y_i << ")" << endl;
-            _grid[x_i][y_i].emplace(key, loc);
-        } else {
-            // cout << "Add " << p << " to irregular spot" << " # size = " << _irreg_keys2locs.size() << endl;
-            _irreg_keys2locs.emplace(key, loc);
+        if (find(key) == nullptr) {
+            const size_t idx = raw(key);
+            if (idx >= _keys2locs.size()) {
+                _keys2locs.resize(std::max(idx + 1, _keys2locs.size() * 2), Entry{ INVALID, Loc() });
+                // There cannot be more irregular objects than keys.
+                _irregular.reserve(_keys2locs.size());
+            }
+            _keys2locs[idx] = Entry{ key, loc };
         }
+        insert(key, loc);
+    }
+
+    // Move an object to p, keeping its radius.
+    bool Move(const T& key, const PointF& p) {
+        Entry *e = find(key);
+        if (e == nullptr) return false;
+        erase(key, e->loc);
+        e->loc.first = p;
+        insert(key, e->loc);
+        return true;
     }
 
     bool Exists(const T& key) const {
-        return _keys2locs.find(key) != _keys2locs.end();
+        return find(key) != nullptr;
     }
 
     bool IsEmpty(const PointF& p, const float radius,
         const T& key_exclude = INVALID) const {
         const auto loc = Loc(p, radius);
-        if (!IsRegular(p, radius)) {
-            for (const auto& item : _irreg_keys2locs) {
-                if (item.first == key_exclude) continue;
-                if (CheckCollision(loc, item.second)) {
-                    return false;
-                }
-            }
-            return true;
-        }
-        const int bx = GetXBucket(p);
-        const int by = GetYBucket(p);
-        // Explore 8 adjacent blocks as well
-        for (int dx = -1; dx <= 1; ++dx) {
-            if (bx + dx < 0 || bx + dx >= _n) continue;
-            for (int dy = -1; dy <= 1; ++dy) {
-                if (by + dy < 0 || by + dy >= _m) continue;
-                for (const auto& item : _grid[bx + dx][by + dy]) {
-                    if (item.first == key_exclude) continue;
-                    if (CheckCollision(loc, item.second)) {
-                        return false;
-                    }
-                }
-            }
-        }
-        return true;
+        // Objects in the buckets have a radius of at most _margin / 2.
+        const float r = radius + _margin / 2;
+        return for_each_in_box(PointF(p.x - r, p.y - r), PointF(p.x + r, p.y + r), [&](const Entry &e) {
+            return e.key == key_exclude || ! CheckCollision(loc, e.loc);
+        });
     }
 
     // Check whether a line of a given radius can pass though all the points.
@@ -292,15 +400,10 @@ public:
 
     // Remove the entry.
     void Remove(const T& key) {
-        const auto it = _keys2locs.find(key);
-        if (it != _keys2locs.end()) {
-            const auto& p = it->second.first;
-            if (IsRegular(p, it->second.second)) {
-                _grid[GetXBucket(p)][GetYBucket(p)].erase(key);
-            } else {
-                _irreg_keys2locs.erase(key);
-            }
-            _keys2locs.erase(it);
+        Entry *e = find(key);
+        if (e != nullptr) {
+            erase(key, e->loc);
+            e->key = INVALID;
         }
     }
 
@@ -309,59 +412,131 @@ public:
     const T* Loc2Key(const PointF& p, float* const min_dist_sqr) const {
         const T* res = nullptr;
         float min_dist = std::numeric_limits<float>::max();
-        for (const auto& item : _keys2locs) {
-            const auto& q = item.second.first;
-            const float r = item.second.second;
-            const float dist_sqr = PointF::L2Sqr(p, q);
-            if (dist_sqr < r * r && dist_sqr < min_dist) {
-                res = &item.first;
+        const float r = _margin / 2;
+        for_each_in_box(PointF(p.x - r, p.y - r), PointF(p.x + r, p.y + r), [&](const Entry &e) {
+            const float dist_sqr = PointF::L2Sqr(p, e.loc.first);
+            if (dist_sqr < e.loc.second * e.loc.second && dist_sqr < min_dist) {
+                res = &e.key;
                 min_dist = dist_sqr;
             }
-        }
+            return true;
+        });
         *min_dist_sqr = min_dist;
         return res;
     }
 
     const PointF* Key2Loc(const T& key) const {
-        const auto it = _keys2locs.find(key);
-        return it == _keys2locs.end() ? nullptr : &it->second->first;
-    }
-
-    std::set<T> KeysInRegion(
-        const PointF& left_top,
-        const PointF& right_bottom) const {
-        std::set<T> res;
-        for (const auto& item : _keys2locs) {
-            const auto& p = item.second.first;
-            if (p.IsIn(left_top, right_bottom)) {
-                res.insert(item.first);
+        const Entry *e = find(key);
+        return e == nullptr ? nullptr : &e->loc.first;
+    }
+
+    // Keys of the objects whose centers are in the rectangle (borders
+    // included). *keys is cleared first, and keeps its capacity.
+    void KeysInRegion(const PointF& left_top, const PointF& right_bottom, std::vector<T> *keys) const {
+        keys->clear();
+        for_each_in_box(left_top, right_bottom, [&](const Entry &e) {
+            if (e.loc.first.IsIn(left_top, right_bottom)) keys->push_back(e.key);
+            return true;
+        });
+    }
+
+    // The (at most) k objects whose centers are closest to p and within
+    // max_r, closest first, ties broken by key. Only keys for which
+    // accept(key) is true count. Buckets are visited in rings around p, until
+    // the next ring cannot hold anything closer.
+    template <typename Accept>
+    void KNearest(const PointF& p, int k, float max_r, std::vector<Neighbor> *neighbors, Accept accept) const {
+        auto &res = *neighbors;
+        res.clear();
+        if (k <= 0) return;
+
+        // res is a max-heap until the end.
+        const float max_r_sqr = max_r * max_r;
+        auto visit = [&](const Entry &e) {
+            const float dist_sqr = PointF::L2Sqr(p, e.loc.first);
+            if (dist_sqr > max_r_sqr || ! accept(e.key)) return;
+            if ((int)res.size() < k) {
+                res.emplace_back(dist_sqr, e.key);
+                std::push_heap(res.begin(), res.end());
+            } else if (Neighbor(dist_sqr, e.key) < res.front()) {
+                std::pop_heap(res.begin(), res.end());
+                res.back() = Neighbor(dist_sqr, e.key);
+                std::push_heap(res.begin(), res.end());
+            }
+        };
+        for (const Entry &e : _irregular) visit(e);
+
+        if (_n > 0 && _m > 0) {
+            const int bx = clamp_bucket(p.x, _pmin.x, _margin, _n);
+            const int by = clamp_bucket(p.y, _pmin.y, _margin, _m);
+            const int max_ring = std::max(std::max(bx, _n - 1 - bx), std::max(by, _m - 1 - by));
+            auto visit_bucket = [&](int x_i, int y_i) {
+                if (y_i < 0 || y_i >= _m) return;
+                const int b = bucket(x_i, y_i);
+                for (const Entry *e = bucket_begin(b); e != bucket_end(b); ++e) visit(*e);
+            };
+            for (int d = 0; d <= max_ring; ++d) {
+                // Centers in ring d are at least (d - 1) * _margin away from p.
+                const float bound = (d - 1) * _margin;
+                if (d > 0 && (bound > max_r || ((int)res.size() == k && bound * bound > res.front().first))) break;
+                for (int x_i = std::max(bx - d, 0); x_i <= std::min(bx + d, _n - 1); ++x_i) {
+                    if (x_i == bx - d || x_i == bx + d) {
+                        for (int y_i = by - d; y_i <= by + d; ++y_i) visit_bucket(x_i, y_i);
+                    } else {
+                        visit_bucket(x_i, by - d);
+                        visit_bucket(x_i, by + d);
+                    }
+                }
             }
         }
-        return res;
+        std::sort_heap(res.begin(), res.end());
+    }
+
+    void KNearest(const PointF& p, int k, float max_r, std::vector<Neighbor> *neighbors) const {
+        KNearest(p, k, max_r, neighbors, [](const T &) { return true; });
     }
 
     void Clear() {
-        _keys2locs.clear();
-        _irreg_keys2locs.clear();
-        for (auto& row : _grid) {
-            for (auto& item : row) {
-                item.clear();
-            }
-        }
+        for (Entry &e : _keys2locs) e.key = INVALID;
+        _irregular.clear();
+        std::fill(_counts.begin(), _counts.end(), 0);
     }
 
     std::string PrintDebugInfo() const {
         std::stringstream ss;
         ss << "Locality table: " << endl;
-        for (const auto& item : _keys2locs) {
-            ss << "Id " << item.first << " -> " << item.second.first << ", "
-                << item.second.second << std::endl;
+        for (const Entry& e : _keys2locs) {
+            if (e.key == INVALID) continue;
+            ss << "Id " << e.key << " -> " << e.loc.first << ", "
+                << e.loc.second << std::endl;
         }
         return ss.str();
     }
 
-    SERIALIZER(LocalitySearch,
-        _pmin, _pmax, _margin, _keys2locs, _irreg_keys2locs, _grid);
+    // Only the objects are saved, sorted by key. The buckets are rebuilt on load.
+    serializer::saver &Save(serializer::saver &oo) const {
+        std::vector<std::pair<T, Loc>> items;
+        for (const Entry &e : _keys2locs) {
+            if (e.key != INVALID) items.emplace_back(e.key, e.loc);
+        }
+        std::sort(items.begin(), items.end(), [](const std::pair<T, Loc> &a, const std::pair<T, Loc> &b) { return a.first < b.first; });
+        serializer::Save(oo, _pmin, _pmax, _margin, items);
+        if (! oo.is_binary()) oo.get() << "\n";
+        return oo;
+    }
+    serializer::loader &Load(serializer::loader &ii) {
+        std::vector<std::pair<T, Loc>> items;
+        serializer::Load(ii, _pmin, _pmax, _margin, items);
+        Reset(_pmin, _pmax, _margin / 2);
+        for (const auto &item : items) Add(item.first, item.second.first, item.second.second);
+        return ii;
+    }
+    friend serializer::saver &operator<<(serializer::saver &oo, const LocalitySearch &p) {
+        return p.Save(oo);
+    }
+    friend serializer::loader &operator>>(serializer::loader &ii, LocalitySearch& p) {
+        return p.Load(ii);
+    }
 };
 
 #endif
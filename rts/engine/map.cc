@@ -32,12 +32,13 @@ bool RTSMap::find_two_nearby_empty_slots(const std::function<uint16_t(int)>& f,
 }
 
 bool RTSMap::GenerateImpassable(const std::function<uint16_t(int)>& f, int nImpassable) {
-    _map.assign(_m * _n * _level, MapSlot());
+    _map.mut().assign(_m * _n * _level, MapSlot());
     for (int i = 0; i < nImpassable; ++i) {
         const int x = f(_m);
         const int y = f(_n);
-        _map[GetLoc(Coord(x, y))].type = IMPASSABLE;
+        _map.mut()[GetLoc(Coord(x, y))].type = IMPASSABLE;
     }
+    TerrainChanged();
     return true;
 }
 
@@ -45,11 +46,11 @@ bool RTSMap::GenerateTDMaze(const std::function<uint16_t(int)>& f) {
     const int blank = 3;
     int m = _m / 2;
     int n = _n / 2;
-    _map.assign(_m * _n * _level, MapSlot());
+    _map.mut().assign(_m * _n * _level, MapSlot());
     for (int x = 0; x < _m; x++) {
         for (int y = 0; y < _n; y++) {
         if ((x < _m - blank * 2) || (y < _n - blank * 2))
-            _map[GetLoc(Coord(x, y))].type = IMPASSABLE;
+            _map.mut()[GetLoc(Coord(x, y))].type = IMPASSABLE;
         }
     }
     int maze[m * n];
@@ -95,8 +96,8 @@ bool RTSMap::GenerateTDMaze(const std::function<uint16_t(int)>& f) {
         maze[curr] = 1;
         int xc = curr / m;
         int yc = curr % m;
-        _map[GetLoc(Coord(xc * 2, yc * 2))].type = NORMAL;
-        _map[GetLoc(Coord(xc * 2 - dx[coming_from], yc * 2 - dy[coming_from]))].type = NORMAL;
+        _map.mut()[GetLoc(Coord(xc * 2, yc * 2))].type = NORMAL;
+        _map.mut()[GetLoc(Coord(xc * 2 - dx[coming_from], yc * 2 - dy[coming_from]))].type = NORMAL;
         for (size_t i = 0; i < sizeof(dx) / sizeof(int); ++i) {
             int xn = xc + dx[i];
             int yn = yc + dy[i];
@@ -105,6 +106,7 @@ bool RTSMap::GenerateTDMaze(const std::function<uint16_t(int)>& f) {
             previous.push_back(i);
         }
     }
+    TerrainChanged();
     return true;
 }
 
@@ -138,24 +140,101 @@ bool RTSMap::GenerateMap(const std::function<uint16_t(int)>& f, int nImpassable,
 
 void RTSMap::reset_intermediates() {
     // Locality Search
-    _locality = LocalitySearch<UnitId>(PointF(-0.5, -0.5), PointF(_m + 0.5, _n + 0.5));
+    _locality.Reset(PointF(-0.5, -0.5), PointF(_m + 0.5, _n + 0.5));
+
+    _buildings.assign(GetPlaneSize(), 0);
+    _clusters.Invalidate();
 
     // Precompute map structure.
+    update_impassable();
     precompute_all_pair_distances();
 }
 
+void RTSMap::ClearMap() {
+    _infos.clear();
+    _locality.Clear();
+    _buildings.assign(GetPlaneSize(), 0);
+    _flow_fields.Invalidate();
+    _clusters.Invalidate();
+}
+
+void RTSMap::update_impassable() {
+    const int size = _m * _n * _level;
+    if (_impassable.size() != size) _impassable = PlaneBits(size);
+    else _impassable.Clear();
+    for (Loc l = 0; l < size; ++l) {
+        if ((*_map)[l].type == IMPASSABLE) _impassable.Set(l);
+    }
+}
+
+void RTSMap::TerrainChanged() {
+    update_impassable();
+    InvalidateDistanceFields();
+    _flow_fields.Invalidate();
+    _clusters.Invalidate();
+}
+
+void RTSMap::change_buildings(const PointF &p, int delta) {
+    const Coord c = p.ToCoord();
+    for (int x = c.x - 1; x <= c.x + 1; ++x) {
+        for (int y = c.y - 1; y <= c.y + 1; ++y) {
+            // The cell of the building, and those where a unit in the middle would collide with it.
+            const bool blocked = (x == c.x && y == c.y) || PointF::L2Sqr(p, PointF(x, y)) < 4 * kUnitRadius * kUnitRadius;
+            if (! IsIn(x, y) || ! blocked) continue;
+            const Loc l = GetLoc(x, y);
+            _buildings[l] += delta;
+            _clusters.SetPassable(l, ! _impassable.Get(l) && _buildings[l] == 0);
+        }
+    }
+    _flow_fields.Invalidate();
+}
+
 void RTSMap::load_default_map() {
     _m = 20;
     _n = 20;
     _level = 1;
-    _map.assign(_m * _n * _level, MapSlot());
+    _map.mut().assign(_m * _n * _level, MapSlot());
+}
+
+void RTSMap::SetSize(int m, int n) {
+    _m = m;
+    _n = n;
+    _map.mut().assign(_m * _n * _level, MapSlot());
+    reset_intermediates();
 }
 
 void RTSMap::precompute_all_pair_distances() {
-    // All-pair shortest distance for path-planning.
-    // Floyd–Warshall algorithm O(V^3) = O(m^3n^3)
-    // Not extremely fast, but since it is only computed
-    // once for each map, we could just use it.
+    // All-pair shortest distances for path-planning. Instead of Floyd–Warshall
+    // (O(m^3n^3) time, O(m^2n^2) memory), one BFS field per target is built on
+    // demand in GetDistanceField() and cached. Here we just drop the old ones.
+    InvalidateDistanceFields();
+}
+
+DistanceFieldCache::FieldPtr RTSMap::GetDistanceField(Loc target) const {
+    if (! _distance_fields.valid()) {
+        _distance_fields.Reset(_m, _n, [&](Loc l) { return ! _impassable.Get(l); });
+    }
+    return _distance_fields.Get(target);
+}
+
+FlowFieldCache::FieldPtr RTSMap::GetFlowField(Loc target) const {
+    if (! _flow_fields.valid()) {
+        _flow_fields.Reset(_m, _n, [&](Loc l) { return ! _impassable.Get(l) && _buildings[l] == 0; });
+    }
+    return _flow_fields.Get(target);
+}
+
+float RTSMap::GetClusterRoute(Loc from, Loc to, size_t max_cells, vector<Loc> *cells) const {
+    if (! _clusters.valid()) {
+        const int plane = GetPlaneSize();
+        vector<uint8_t> passable(plane);
+        for (Loc l = 0; l < plane; ++l) passable[l] = ! _impassable.Get(l) && _buildings[l] == 0;
+        _clusters.Build(_m, _n, std::move(passable));
+    }
+    static thread_local vector<Loc> nodes;
+    const float dist = _clusters.FindPath(from, to, &nodes);
+    _clusters.Refine(nodes, max_cells, cells);
+    return dist;
 }
 
 bool RTSMap::AddUnit(const UnitId &id, const PointF& new_p) {
@@ -170,9 +249,7 @@ bool RTSMap::MoveUnit(const UnitId &id, const PointF& new_p) {
     if (! _locality.Exists(id)) return false;
     if (! _locality.IsEmpty(new_p, kUnitRadius, id)) return false;
 
-    _locality.Remove(id);
-    _locality.Add(id, new_p, kUnitRadius);
-    return true;
+    return _locality.Move(id, new_p);
 }
 
 bool RTSMap::RemoveUnit(const UnitId &id) {
@@ -188,13 +265,33 @@ UnitId RTSMap::GetClosestUnitId(const PointF& p, float max_r) const {
     return *res;
 }
 
-set<UnitId> RTSMap::GetUnitIdInRegion(const PointF &left_top, const PointF &right_bottom) const {
-    return _locality.KeysInRegion(left_top, right_bottom);
+void RTSMap::GetUnitIdInRegion(const PointF &left_top, const PointF &right_bottom, vector<UnitId> *ids) const {
+    _locality.KeysInRegion(left_top, right_bottom, ids);
+}
+
+void RTSMap::GetClosestUnitIds(const PointF &p, int k, float max_r, vector<LocalitySearch<UnitId>::Neighbor> *ids) const {
+    _locality.KNearest(p, k, max_r, ids);
+}
+
+bool RTSMap::IsTerrainLinePassable(const PointF &s, const PointF &t) const {
+    const Coord cs = s.ToCoord();
+    const Coord ct = t.ToCoord();
+    return TraverseLine(s, t, [&](const Coord &c, float, float) {
+        if ((c.x == cs.x && c.y == cs.y) || (c.x == ct.x && c.y == ct.y)) return true;
+        return IsTerrainPassable(c);
+    });
 }
 
 vector<Loc> RTSMap::GetSight(const Loc& loc, int range) const {
-    Coord c = GetCoord(loc);
     vector<Loc> res;
+    GetSight(loc, range, &res);
+    return res;
+}
+
+void RTSMap::GetSight(const Loc& loc, int range, vector<Loc> *sight) const {
+    Coord c = GetCoord(loc);
+    vector<Loc> &res = *sight;
+    res.clear();
 
     const int xmin = std::max(0, c.x - range);
     const int xmax = std::min(_m - 1, c.x + range);
@@ -207,7 +304,6 @@ vector<Loc> RTSMap::GetSight(const Loc& loc, int range) const {
             res.push_back(GetLoc(x, y));
         }
     }
-    return res;
 }
 
 string RTSMap::PrintCoord(Loc loc) const {
@@ -241,7 +337,7 @@ string RTSMap::Draw() const {
         for (int i = 0; i < _m; ++i) {
             // Draw the map (only level 0)
             Loc loc = GetLoc(i, j, 0);
-            ss << _map[loc].type << " ";
+            ss << (*_map)[loc].type << " ";
         }
         ss << endl;
     }
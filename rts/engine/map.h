@@ -10,10 +10,15 @@
 #ifndef _MAP_H_
 #define _MAP_H_
 
+#include <cmath>
 #include <functional>
 #include <vector>
 #include "common.h"
+#include "cow_ptr.h"
 #include "locality_search.h"
+#include "distance_field.h"
+#include "cluster_graph.h"
+#include "fog_of_war.h"
 
 struct MapSlot {
   // three layers, terrian, ground and air.
@@ -44,7 +49,8 @@ struct PlayerMapInfo {
 // Map location is an integer.
 class RTSMap {
 private:
-  vector<MapSlot> _map;
+  // Terrain, shared between copies of the map until one of them changes it.
+  CowPtr<vector<MapSlot>> _map;
 
   // Size of the map.
   int _m, _n, _level;
@@ -55,8 +61,26 @@ private:
   // Locality search.
   LocalitySearch<UnitId> _locality;
 
+  // Impassable cells, one bit per Loc. Rebuilt by TerrainChanged().
+  PlaneBits _impassable;
+
+  // Terrain distance fields, built on first use for each target.
+  mutable DistanceFieldCache _distance_fields;
+
+  // #buildings blocking each cell of the plane (see AddBuilding()).
+  vector<int> _buildings;
+
+  // Flow fields over terrain and buildings, built on first use for each target.
+  mutable FlowFieldCache _flow_fields;
+
+  // Abstract graph over terrain and buildings for long routes, built on
+  // first use and repaired around the cells that buildings change.
+  mutable ClusterGraph _clusters;
+
 private:
   void reset_intermediates();
+  void update_impassable();
+  void change_buildings(const PointF &p, int delta);
   void load_default_map();
   void precompute_all_pair_distances();
 
@@ -65,6 +89,8 @@ private:
 public:
   // Load map from a file.
   RTSMap();
+  // Makes the map an empty m x n map. Units and players must be added after.
+  void SetSize(int m, int n);
   bool GenerateMap(const std::function<uint16_t (int)>& f, int nImpassable, int num_player, int init_resource);
   bool GenerateImpassable(const std::function<uint16_t(int)>& f, int nImpassable);
 
@@ -73,10 +99,21 @@ public:
 
 
   const vector<PlayerMapInfo> &GetPlayerMapInfo() const { return _infos; }
-  void ClearMap() { _infos.clear(); _locality.Clear();}
-
-  const MapSlot &operator()(const Loc& loc) const { return _map[loc]; }
-  MapSlot &operator()(const Loc& loc) { return _map[loc]; }
+  void ClearMap();
+
+  const MapSlot &operator()(const Loc& loc) const { return (*_map)[loc]; }
+  // Call TerrainChanged() after changing the terrain through this.
+  // Makes a private copy of the terrain if it is shared with another map.
+  MapSlot &operator()(const Loc& loc) { return _map.mut()[loc]; }
+  // Updates what is derived from the terrain: the impassable bitmap and the distance and flow fields.
+  void TerrainChanged();
+
+  // Buildings are units that never move. Flow fields and cluster routes go
+  // around the cells they block (their own, and those where a unit standing
+  // in the middle would collide with one). Flow fields are dropped whenever
+  // a building is added or removed; the cluster graph is repaired locally.
+  void AddBuilding(const PointF &p) { change_buildings(p, 1); }
+  void RemoveBuilding(const PointF &p) { change_buildings(p, -1); }
 
   int GetXSize() const { return _m; }
   int GetYSize() const { return _n; }
@@ -88,7 +125,7 @@ public:
       if (! IsIn(c)) return false;
 
       Loc loc = GetLoc(c);
-      const MapSlot &s = _map[loc];
+      const MapSlot &s = (*_map)[loc];
       // cannot block the path
       if (s.type == NORMAL) return false;
 
@@ -100,9 +137,7 @@ public:
       Coord c = p.ToCoord();
       if (! IsIn(c)) return false;
 
-      Loc loc = GetLoc(c);
-      const MapSlot &s = _map[loc];
-      if (s.type == IMPASSABLE) return false;
+      if (_impassable.Get(GetLoc(c))) return false;
 
       // [TODO] Add object radius here.
       if (check_locality)
@@ -113,10 +148,7 @@ public:
 
   bool CanPass(const Coord &c, UnitId id_exclude, bool check_locality = true) const {
       if (! IsIn(c)) return false;
-
-      Loc loc = GetLoc(c);
-      const MapSlot &s = _map[loc];
-      if (s.type == IMPASSABLE) return false;
+      if (_impassable.Get(GetLoc(c))) return false;
 
       // [TODO] Add object radius here.
       if (check_locality)
@@ -131,6 +163,22 @@ public:
       return _locality.LinePassable(s, t, kUnitRadius, 1e-4, &block_id, &result);
   }
 
+  bool IsTerrainPassable(const Coord &c) const { return IsIn(c) && ! _impassable.Get(GetLoc(c)); }
+
+  // Calls f(c, t_in, t_out) on every cell c the segment s -> t goes through,
+  // from s to t (grid traversal of Amanatides and Woo). The segment is in c
+  // from s + t_in * (t - s) to s + t_out * (t - s). Both cells beside a
+  // corner the segment goes through are visited. Returns false as soon as f
+  // does. Cell (x, y) is
+  // [x - 0.5, x + 0.5) x [y - 0.5, y + 0.5). Segments with an end far
+  // outside the map are not traversed (false).
+  template <typename F>
+  bool TraverseLine(const PointF &s, const PointF &t, F f) const;
+
+  // Whether the segment s -> t only goes through passable terrain. The
+  // cells of s and t are not checked. Units are ignored.
+  bool IsTerrainLinePassable(const PointF &s, const PointF &t) const;
+
   // Move a unit to next_loc;
   bool MoveUnit(const UnitId &id, const PointF& new_loc);
   bool AddUnit(const UnitId &id, const PointF& new_loc);
@@ -142,8 +190,33 @@ public:
   Loc GetLoc(const Coord& c) const;
   Loc GetLoc(int x, int y, int z = 0) const;
 
+  // Exact terrain-only distance from every cell to target (4-neighbor moves).
+  // Built lazily and kept in an LRU cache bounded by SetDistanceFieldCacheSize().
+  DistanceFieldCache::FieldPtr GetDistanceField(Loc target) const;
+  float GetTerrainDistance(Loc from, Loc to) const { return GetDistanceField(to)->Get(from); }
+  void InvalidateDistanceFields() { _distance_fields.Invalidate(); }
+  void SetDistanceFieldCacheSize(size_t max_bytes) { _distance_fields.SetMaxBytes(max_bytes); }
+  const DistanceFieldCache &GetDistanceFieldCache() const { return _distance_fields; }
+
+  // Shortest route from every cell to target around terrain and buildings
+  // (see FlowField), shared by all the units going there. Built lazily and
+  // kept in an LRU cache bounded by SetFlowFieldCacheSize().
+  FlowFieldCache::FieldPtr GetFlowField(Loc target) const;
+  void SetFlowFieldCacheSize(size_t max_bytes) { _flow_fields.SetMaxBytes(max_bytes); }
+  const FlowFieldCache &GetFlowFieldCache() const { return _flow_fields; }
+
+  // The first max_cells cells (or fewer, if it is shorter) of a route from
+  // -> to around terrain and buildings, found by hierarchical path finding
+  // (see ClusterGraph). Unlike a flow field, it costs nothing per target, so
+  // it suits large maps. Fills *cells (cleared first), from excluded, and
+  // returns the length of the whole route, or kUnreachableDist.
+  float GetClusterRoute(Loc from, Loc to, size_t max_cells, vector<Loc> *cells) const;
+  const ClusterGraph &GetClusterGraph() const { return _clusters; }
+
   // Get sight from the current location.
   vector<Loc> GetSight(const Loc& loc, int range) const;
+  // Same, but fill *sight (cleared first), which keeps its capacity.
+  void GetSight(const Loc& loc, int range, vector<Loc> *sight) const;
 
   bool IsIn(Loc loc) const { return loc >= 0 && loc < _m * _n * _level; }
   bool IsIn(int x, int y) const { return x >= 0 && x < _m && y >= 0 && y < _n; }
@@ -154,14 +227,69 @@ public:
   Loc GetLoc(const PointF& p) const { return GetLoc(p.ToCoord()); }
 
   UnitId GetClosestUnitId(const PointF& p, float max_r = 1e38) const;
-  set<UnitId> GetUnitIdInRegion(const PointF &left_top, const PointF &right_bottom) const;
+  // The queries below fill *ids (cleared first), which keeps its capacity.
+  // Units whose centers are in the rectangle.
+  void GetUnitIdInRegion(const PointF &left_top, const PointF &right_bottom, vector<UnitId> *ids) const;
+  // Up to k units closest to p within max_r, closest first, with their squared distances.
+  void GetClosestUnitIds(const PointF &p, int k, float max_r, vector<LocalitySearch<UnitId>::Neighbor> *ids) const;
+  // Same, among the units for which accept(id) is true.
+  template <typename Accept>
+  void GetClosestUnitIds(const PointF &p, int k, float max_r, Accept accept, vector<LocalitySearch<UnitId>::Neighbor> *ids) const {
+      _locality.KNearest(p, k, max_r, ids, accept);
+  }
 
   // Draw the map
   string Draw() const;
 
   string PrintDebugInfo() const;
 
-  SERIALIZER(RTSMap, _m, _n, _level, _map, _infos, _locality);
+  SERIALIZER(RTSMap, _m, _n, _level, _map, _infos, _locality, _impassable, _distance_fields, _buildings, _flow_fields, _clusters);
 };
 
+template <typename F>
+bool RTSMap::TraverseLine(const PointF &s, const PointF &t, F f) const {
+    const float kFar = 1e6;
+    if (std::abs(s.x) > kFar || std::abs(s.y) > kFar || std::abs(t.x) > kFar || std::abs(t.y) > kFar) return false;
+
+    const float dx = t.x - s.x;
+    const float dy = t.y - s.y;
+    int x = (int)std::floor(s.x + 0.5);
+    int y = (int)std::floor(s.y + 0.5);
+    const int x_end = (int)std::floor(t.x + 0.5);
+    const int y_end = (int)std::floor(t.y + 0.5);
+    const int step_x = dx > 0 ? 1 : -1;
+    const int step_y = dy > 0 ? 1 : -1;
+
+    // Along the segment (0 at s, 1 at t): distance between two x (y) cell
+    // borders, and the next x (y) border.
+    const float inf = std::numeric_limits<float>::infinity();
+    const float delta_x = dx != 0 ? std::abs(1 / dx) : inf;
+    const float delta_y = dy != 0 ? std::abs(1 / dy) : inf;
+    float next_x = dx > 0 ? (x + 0.5 - s.x) * delta_x : (dx < 0 ? (s.x - (x - 0.5)) * delta_x : inf);
+    float next_y = dy > 0 ? (y + 0.5 - s.y) * delta_y : (dy < 0 ? (s.y - (y - 0.5)) * delta_y : inf);
+
+    // Exactly one step per cell border, so rounding cannot miss the last cell.
+    const int n = std::abs(x_end - x) + std::abs(y_end - y);
+    float t_in = 0;
+    for (int i = 0; ; ++i) {
+        const bool go_x = x != x_end && (y == y_end || next_x < next_y);
+        const float t_out = i == n ? 1 : std::min(go_x ? next_x : next_y, 1.0f);
+        if (! f(Coord(x, y), t_in, t_out)) return false;
+        if (i == n) return true;
+        t_in = t_out;
+        // Through a corner: the other cell touching it is also crossed.
+        if (x != x_end && y != y_end && std::abs(next_x - next_y) < 1e-5) {
+            const Coord c = go_x ? Coord(x, y + step_y) : Coord(x + step_x, y);
+            if (! f(c, t_in, t_in)) return false;
+        }
+        if (go_x) {
+            x += step_x;
+            next_x += delta_x;
+        } else {
+            y += step_y;
+            next_y += delta_y;
+        }
+    }
+}
+
 #endif
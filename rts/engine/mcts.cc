@@ -0,0 +1,364 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "mcts.h"
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <sstream>
+#include "elf/ctpl_stl.h"
+
+namespace {
+
+inline void atomic_add(std::atomic<float> &a, float v) {
+    float old = a.load(std::memory_order_relaxed);
+    while (! a.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) { }
+}
+
+}  // namespace
+
+std::string MCTSOptions::PrintInfo() const {
+    std::stringstream ss;
+    ss << "[" << parallel << "] #threads: " << num_threads << " #simulations: " << num_simulations
+       << " action_ticks: " << action_ticks << " max_depth: " << max_depth << " rollout_ticks: " << rollout_ticks
+       << " exploration: " << exploration << " virtual_loss: " << virtual_loss
+       << " reuse_tree: " << (reuse_tree ? "true" : "false") << " max_nodes: " << max_nodes << " max_states: " << max_states;
+    return ss.str();
+}
+
+float MCTSActor::Evaluate(const RTSState &state, PlayerId player, PlayerId winner) {
+    (void)state;
+    if (winner == player) return 1.0;
+    if (winner >= 0) return 0.0;
+    return 0.5;
+}
+
+/////////////////////////////// MCTSSearch ///////////////////////////////
+// Statistics of a node are those of the edge that leads to it. They are
+// updated without locks; only the expansion of a node takes its lock.
+struct MCTSSearch::Node {
+    int action;
+
+    std::atomic<int> visits;
+    std::atomic<int> virtual_loss;
+    std::atomic<float> value_sum;
+
+    // What RTSState::Forward returned at the end of the edge, once it is
+    // played: INVALID if the game goes on.
+    std::atomic<int> result;
+
+    std::atomic<bool> expanded;
+    std::mutex lock;
+    std::vector<std::unique_ptr<Node>> children;
+
+    // State at the end of the edge, set once.
+    std::unique_ptr<RTSState> state;
+    std::atomic<const RTSState *> cached;
+
+    explicit Node(int a) : action(a), visits(0), virtual_loss(0), value_sum(0.0), result(INVALID), expanded(false), cached(nullptr) { }
+
+    // Drops the states in the subtree. Returns its #nodes.
+    size_t DropStates() {
+        state.reset();
+        cached = nullptr;
+        size_t n = 1;
+        for (const auto &child : children) n += child->DropStates();
+        return n;
+    }
+};
+
+struct MCTSSearch::Tree {
+    std::unique_ptr<Node> root;
+    std::atomic<int> num_nodes;
+    std::atomic<int> num_states;
+    std::atomic<int> sims_left;
+    std::atomic<int> sims_done;
+
+    Tree() : num_nodes(0), num_states(0), sims_left(0), sims_done(0) { }
+};
+
+// What a search thread works with. Buffers are reused across simulations.
+struct MCTSSearch::Worker {
+    std::unique_ptr<MCTSActor> actor;
+    RTSState state;
+    std::vector<Node *> path;
+};
+
+MCTSSearch::MCTSSearch(const MCTSOptions &options, ActorFactory factory)
+    : _options(options), _factory(factory), _root_state(nullptr), _player(INVALID), _next_tick(INVALID),
+      _num_simulations(0), _seconds(0) {
+    _options.num_threads = std::max(_options.num_threads, 1);
+}
+
+MCTSSearch::~MCTSSearch() {
+    // Threads may still refer to the workers.
+    _pool.reset();
+}
+
+MCTSSearch::Worker &MCTSSearch::worker(int idx) {
+    while ((int)_workers.size() <= idx) {
+        _workers.emplace_back(new Worker());
+        _workers.back()->actor.reset(_factory(_workers.size() - 1));
+    }
+    return *_workers[idx];
+}
+
+size_t MCTSSearch::GetNumNodes() const {
+    size_t n = 0;
+    for (const auto &tree : _trees) n += tree->num_nodes.load();
+    return n;
+}
+
+void MCTSSearch::Clear() {
+    _trees.clear();
+    _next_tick = INVALID;
+}
+
+void MCTSSearch::reset_trees(int num_trees) {
+    _trees.resize(num_trees);
+    for (auto &tree : _trees) {
+        if (tree == nullptr) tree.reset(new Tree());
+        tree->root.reset(new Node(INVALID));
+        tree->num_nodes = 1;
+        tree->num_states = 0;
+    }
+}
+
+int MCTSSearch::Search(const RTSState &state, PlayerId player) {
+    auto start = std::chrono::steady_clock::now();
+    const int num_threads = _options.num_threads;
+    const bool leaf_parallel = _options.parallel == MCTS_LEAF && num_threads > 1;
+    const int num_trees = _options.parallel == MCTS_ROOT ? num_threads : 1;
+
+    // Workers are created here, so that threads never create them.
+    for (int i = 0; i < num_threads; ++i) worker(i);
+    if (leaf_parallel) worker(num_threads);
+    if (num_threads > 1 && _pool == nullptr) _pool.reset(new ctpl::thread_pool(num_threads));
+
+    const int num_actions = worker(0).actor->GetNumActions();
+
+    bool reuse = _options.reuse_tree && player == _player && state.GetTick() == _next_tick && (int)_trees.size() == num_trees;
+    for (const auto &tree : _trees) reuse = reuse && tree->root != nullptr;
+    if (! reuse) reset_trees(num_trees);
+
+    _root_state = &state;
+    _player = player;
+    _next_tick = INVALID;
+
+    for (int i = 0; i < num_trees; ++i) {
+        Tree *tree = _trees[i].get();
+        tree->sims_left = _options.num_simulations / num_trees + (i < _options.num_simulations % num_trees ? 1 : 0);
+        tree->sims_done = 0;
+    }
+
+    if (! state.IsTerminal() && num_actions > 0) {
+        if (leaf_parallel) {
+            search_leaf_parallel(_trees[0].get());
+        } else if (num_threads == 1) {
+            run_simulations(_trees[0].get(), 0);
+        } else {
+            std::vector<std::future<void>> futures;
+            for (int i = 0; i < num_threads; ++i) {
+                Tree *tree = _trees[i % num_trees].get();
+                futures.push_back(_pool->push([this, tree, i](int) { run_simulations(tree, i); }));
+            }
+            for (auto &f : futures) f.get();
+        }
+    }
+
+    // Sum up the root actions over all trees.
+    _root_visits.assign(num_actions, 0);
+    _root_values.assign(num_actions, 0.0);
+    _num_simulations = 0;
+    for (const auto &tree : _trees) {
+        _num_simulations += tree->sims_done.load();
+        for (const auto &child : tree->root->children) {
+            _root_visits[child->action] += child->visits.load();
+            _root_values[child->action] += child->value_sum.load();
+        }
+    }
+
+    int best = 0;
+    for (int a = 0; a < num_actions; ++a) {
+        if (_root_visits[a] > 0) _root_values[a] /= _root_visits[a];
+        if (_root_visits[a] > _root_visits[best] || (_root_visits[a] == _root_visits[best] && _root_values[a] > _root_values[best])) {
+            best = a;
+        }
+    }
+
+    _next_tick = state.GetTick();
+    _root_state = nullptr;
+    _seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return best;
+}
+
+void MCTSSearch::Advance(int action) {
+    if (_next_tick == INVALID || ! _options.reuse_tree) {
+        Clear();
+        return;
+    }
+    for (auto &tree : _trees) {
+        Node *root = tree->root.get();
+        if (root == nullptr || ! root->expanded || action < 0 || action >= (int)root->children.size()) {
+            Clear();
+            return;
+        }
+        std::unique_ptr<Node> child = std::move(root->children[action]);
+        tree->root = std::move(child);
+        // The states were played against the policy of the other players,
+        // not against what they actually did.
+        tree->num_nodes = tree->root->DropStates();
+        tree->num_states = 0;
+    }
+    _next_tick += _options.action_ticks;
+}
+
+void MCTSSearch::run_simulations(Tree *tree, int worker_idx) {
+    Worker *w = _workers[worker_idx].get();
+    while (tree->sims_left.fetch_sub(1) > 0) {
+        PlayerId winner;
+        select(tree, w, &winner);
+        backup(w, rollout(w, winner));
+        tree->sims_done ++;
+    }
+}
+
+void MCTSSearch::select(Tree *tree, Worker *w, PlayerId *winner) {
+    const int vl = _options.virtual_loss;
+    Node *node = tree->root.get();
+    node->virtual_loss += vl;
+    w->path.clear();
+    w->path.push_back(node);
+
+    // Go down by the statistics first. The game is only played from the
+    // last node on the way that keeps its state.
+    const RTSState *start = _root_state;
+    size_t start_idx = 0;
+    for (int depth = 0; depth < _options.max_depth && node->result.load() == INVALID; ++depth) {
+        if (! node->expanded.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(node->lock);
+            if (! node->expanded.load(std::memory_order_relaxed)) {
+                const int n = w->actor->GetNumActions();
+                if (tree->num_nodes.fetch_add(n) + n > _options.max_nodes) {
+                    tree->num_nodes -= n;
+                    break;
+                }
+                node->children.reserve(n);
+                for (int a = 0; a < n; ++a) node->children.emplace_back(new Node(a));
+                node->expanded.store(true, std::memory_order_release);
+            }
+        }
+
+        // UCT, where the virtual losses count as visits of value 0. Edges
+        // not visited yet come first.
+        const float log_n = std::log((float)std::max(node->visits.load() + node->virtual_loss.load(), 1));
+        Node *best = nullptr;
+        float best_score = -std::numeric_limits<float>::max();
+        for (const auto &child : node->children) {
+            const int n = child->visits.load(std::memory_order_relaxed) + child->virtual_loss.load(std::memory_order_relaxed);
+            if (n == 0) {
+                best = child.get();
+                break;
+            }
+            const float score = child->value_sum.load(std::memory_order_relaxed) / n + _options.exploration * std::sqrt(log_n / n);
+            if (score > best_score) {
+                best_score = score;
+                best = child.get();
+            }
+        }
+
+        best->virtual_loss += vl;
+        w->path.push_back(best);
+        node = best;
+
+        const RTSState *cached = node->cached.load(std::memory_order_acquire);
+        if (cached != nullptr) {
+            start = cached;
+            start_idx = w->path.size() - 1;
+        }
+        if (node->visits.load() == 0) break;
+    }
+
+    w->state.CopyFrom(*start);
+    w->actor->Start(&w->state, _player);
+    *winner = start_idx > 0 ? w->path[start_idx]->result.load() : INVALID;
+
+    for (size_t i = start_idx + 1; i < w->path.size() && *winner == INVALID; ++i) {
+        Node *n = w->path[i];
+        *winner = w->state.Forward(w->actor->GetTreeBots(n->action), _options.action_ticks);
+        n->result = *winner;
+
+        // Keep the state of nodes that simulations go through again.
+        if (i + 1 < w->path.size() && n->cached.load() == nullptr && tree->num_states.load() < _options.max_states) {
+            std::lock_guard<std::mutex> lock(n->lock);
+            if (n->state == nullptr) {
+                n->state.reset(new RTSState());
+                n->state->CopyFrom(w->state);
+                n->cached.store(n->state.get(), std::memory_order_release);
+                tree->num_states ++;
+            }
+        }
+    }
+}
+
+float MCTSSearch::rollout(Worker *w, PlayerId winner) {
+    if (winner == INVALID && _options.rollout_ticks > 0) {
+        winner = w->state.Forward(w->actor->GetRolloutBots(), _options.rollout_ticks);
+    }
+    return w->actor->Evaluate(w->state, _player, winner);
+}
+
+void MCTSSearch::backup(Worker *w, float value) {
+    for (Node *node : w->path) {
+        node->visits ++;
+        atomic_add(node->value_sum, value);
+        node->virtual_loss -= _options.virtual_loss;
+    }
+}
+
+void MCTSSearch::search_leaf_parallel(Tree *tree) {
+    const int num_threads = _options.num_threads;
+    Worker *selector = _workers[num_threads].get();
+    std::vector<float> values(num_threads);
+    std::vector<std::future<void>> futures;
+
+    while (tree->sims_left.fetch_sub(1) > 0) {
+        PlayerId winner;
+        select(tree, selector, &winner);
+
+        futures.clear();
+        for (int i = 0; i < num_threads; ++i) {
+            futures.push_back(_pool->push([this, selector, winner, i, &values](int) {
+                Worker *w = _workers[i].get();
+                w->state.CopyFrom(selector->state);
+                w->actor->Start(&w->state, _player);
+                values[i] = rollout(w, winner);
+            }));
+        }
+        float value = 0.0;
+        for (int i = 0; i < num_threads; ++i) {
+            futures[i].get();
+            value += values[i];
+        }
+        backup(selector, value / num_threads);
+        tree->sims_done ++;
+    }
+}
+
+std::string MCTSSearch::PrintInfo() const {
+    std::stringstream ss;
+    ss << "#simulations: " << _num_simulations << " in " << _seconds << "s";
+    if (_seconds > 0) ss << " (" << _num_simulations / _seconds << "/s)";
+    ss << " #nodes: " << GetNumNodes() << std::endl;
+    for (size_t a = 0; a < _root_visits.size(); ++a) {
+        ss << "  [" << a << "] n: " << _root_visits[a] << " q: " << _root_values[a] << std::endl;
+    }
+    return ss.str();
+}
@@ -0,0 +1,167 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _MCTS_H_
+#define _MCTS_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "game.h"
+
+namespace ctpl { class thread_pool; }
+
+// How the threads of a search share the work.
+//   MCTS_TREE: all threads run simulations on one tree; virtual losses keep
+//              them on different paths.
+//   MCTS_ROOT: each thread grows its own tree; the root statistics of all
+//              trees are summed at the end.
+//   MCTS_LEAF: the calling thread grows the tree; each new leaf is rolled out
+//              once on every thread and the results are averaged.
+custom_enum(MCTSParallel, MCTS_TREE = 0, MCTS_ROOT, MCTS_LEAF);
+
+struct MCTSOptions {
+    MCTSParallel parallel = MCTS_TREE;
+    int num_threads = 1;
+
+    // #simulations per Search(), over all threads. In MCTS_LEAF, each leaf
+    // counts once however many rollouts it gets.
+    int num_simulations = 256;
+
+    // One level of the tree: the searching player commits to an action for
+    // this many ticks, while the other players follow their own policy.
+    int action_ticks = 50;
+    // Max #levels below the root.
+    int max_depth = 8;
+    // Ticks played by the rollout policy after leaving the tree. If 0, the
+    // leaf is evaluated right away (e.g., by a value network).
+    int rollout_ticks = 300;
+
+    // UCT exploration constant.
+    float exploration = 1.0;
+    // #losses added to an edge while a thread is below it.
+    int virtual_loss = 1;
+
+    // Keep the subtree of the action played for the next Search().
+    bool reuse_tree = true;
+    // Nodes are not expanded beyond this many per tree.
+    int max_nodes = 1 << 16;
+    // Max #game states kept in the nodes of a tree.
+    int max_states = 1024;
+
+    std::string PrintInfo() const;
+};
+
+// The game-specific part of a search. Each search thread has its own actor,
+// so an actor does not need to be thread-safe.
+class MCTSActor {
+public:
+    virtual ~MCTSActor() { }
+
+    // #actions of the searching player at each level of the tree.
+    virtual int GetNumActions() const = 0;
+
+    // Starts a simulation of player on state (a fork of the root or of a
+    // leaf). Bots should not carry anything over from the last simulation.
+    virtual void Start(RTSState *state, PlayerId player) = 0;
+
+    // Bots of one level of the tree, where player keeps playing action.
+    virtual const std::vector<AI *> &GetTreeBots(int action) = 0;
+
+    // Bots of a rollout, for all players.
+    virtual const std::vector<AI *> &GetRolloutBots() = 0;
+
+    // Value in [0, 1] for player of the state where a simulation stops.
+    // winner is what RTSState::Forward returned last (INVALID if the game
+    // goes on). By default, a win is 1, a loss 0 and anything else 0.5.
+    virtual float Evaluate(const RTSState &state, PlayerId player, PlayerId winner);
+};
+
+// Monte-Carlo tree search (UCT) over forked game states.
+//
+// A node is reached by a sequence of actions of the searching player, one per
+// level. A simulation forks the root state and plays the actions on the way
+// down, then rolls out from the new leaf. Nodes that simulations pass through
+// keep their state (up to max_states), so that later simulations fork it and
+// only play the rest of the way. The other players are part of the
+// environment (they follow the policy given by the actor), so the tree has a
+// single player and the values are those of the searching player.
+class MCTSSearch {
+public:
+    // Creates the actor of the search thread thread_idx. In MCTS_LEAF, the
+    // calling thread uses the actor num_threads; it only plays tree levels.
+    using ActorFactory = std::function<MCTSActor *(int thread_idx)>;
+
+    MCTSSearch(const MCTSOptions &options, ActorFactory factory);
+    ~MCTSSearch();
+
+    const MCTSOptions &GetOptions() const { return _options; }
+
+    // Searches from state for player and returns the action visited most.
+    // The subtree kept by Advance() is reused if state is where it leads to.
+    int Search(const RTSState &state, PlayerId player);
+
+    // Tells that action was played from the root of the last Search().
+    void Advance(int action);
+
+    // Drops all trees.
+    void Clear();
+
+    // Statistics of the root actions in the last Search(), over all trees.
+    const std::vector<int> &GetRootVisits() const { return _root_visits; }
+    const std::vector<float> &GetRootValues() const { return _root_values; }
+
+    // #simulations run by the last Search(), reused ones excluded.
+    int GetNumSimulations() const { return _num_simulations; }
+    // Duration of the last Search(), in seconds.
+    double GetSeconds() const { return _seconds; }
+    size_t GetNumNodes() const;
+
+    std::string PrintInfo() const;
+
+private:
+    struct Node;
+    struct Tree;
+    struct Worker;
+
+    MCTSOptions _options;
+    ActorFactory _factory;
+
+    std::vector<std::unique_ptr<Tree>> _trees;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::unique_ptr<ctpl::thread_pool> _pool;
+
+    // The root state of the current Search().
+    const RTSState *_root_state;
+    PlayerId _player;
+    // Tick of the root of the trees kept for the next Search(), INVALID if
+    // there are none.
+    Tick _next_tick;
+
+    std::vector<int> _root_visits;
+    std::vector<float> _root_values;
+    int _num_simulations;
+    double _seconds;
+
+    Worker &worker(int idx);
+
+    void reset_trees(int num_trees);
+    void run_simulations(Tree *tree, int worker_idx);
+
+    // Goes down the tree from the root to a new leaf, adding a virtual loss
+    // to each node passed, and leaves the state of the leaf in w.
+    void select(Tree *tree, Worker *w, PlayerId *winner);
+    float rollout(Worker *w, PlayerId winner);
+    void backup(Worker *w, float value);
+    void search_leaf_parallel(Tree *tree);
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "path_search.h"
+
+GridSearch &GridSearch::ThreadLocal(int m, int n) {
+    static thread_local GridSearch search;
+    search.reset(m, n);
+    return search;
+}
+
+void GridSearch::reset(int m, int n) {
+    _m = m;
+    _n = n;
+    // Only grows, so that a thread going through maps of different sizes
+    // does not reallocate. Stamps of new nodes are 0, never a generation.
+    if (_nodes.size() < (size_t)(m * n)) {
+        _nodes.resize(m * n, Node{0, 0, false, kClosed, INVALID, 0, 0});
+        // Neither holds a cell twice.
+        _heap.reserve(m * n);
+        _path.reserve(m * n);
+    }
+}
+
+void GridSearch::begin() {
+    _heap.clear();
+    if (++_gen == 0) {
+        // Wrapped around: old stamps could be taken for the new generation.
+        for (Node &node : _nodes) node.gen = node.probe_gen = 0;
+        _gen = 1;
+    }
+}
+
+const std::vector<Loc> &GridSearch::GetPath(Loc l) {
+    _path.clear();
+    while (l != INVALID) {
+        const Loc parent = _nodes[l].parent;
+        _path.push_back(l);
+        if (parent == INVALID) break;
+        // Fill in the straight run between two jump points.
+        const int x = l % _m, y = l / _m;
+        const int px = parent % _m, py = parent / _m;
+        const int step = px != x ? (px > x ? 1 : -1) : (py > y ? _m : -_m);
+        for (Loc c = l + step; c != parent; c += step) _path.push_back(c);
+        l = parent;
+    }
+    return _path;
+}
+
+const std::vector<Loc> &GridSearch::GetNodes(Loc l) {
+    _path.clear();
+    for (; l != INVALID; l = _nodes[l].parent) _path.push_back(l);
+    return _path;
+}
@@ -0,0 +1,279 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _PATH_SEARCH_H_
+#define _PATH_SEARCH_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "common.h"
+
+// A* over the cells of an m x n map plane, 4 neighbors of unit cost, with
+// scratch memory that is reused from one search to the next.
+//
+// Nodes are dense arrays indexed by Loc. A node belongs to the current search
+// only if its stamp is the generation of the search, so starting a search is
+// O(1) whatever the size of the plane. The open set is a binary heap that
+// keeps the position of each node, so that a shorter path to an open node
+// decreases its key in place instead of pushing a duplicate.
+//
+// With jump points, only the cells where a path may turn are expanded (jump
+// point search on a 4-connected grid): straight runs of cells with nothing new
+// on their sides are crossed in one step. Since all moves cost the same, the
+// paths are as short as those of plain A*.
+class GridSearch {
+public:
+    // The instance of the calling thread, ready for an m x n plane. It is
+    // shared by all the searches of the thread, so a path must be used (or
+    // copied) before the next search starts.
+    static GridSearch &ThreadLocal(int m, int n);
+
+    // Search from start to target. passable(Loc) tells whether a cell of the
+    // plane may be on the path (the target always may), heuristic(Loc) must be
+    // a consistent estimate of the distance to the target.
+    //
+    // Stops when the target is popped, or when the max_iteration-th node is
+    // popped (that node is the most promising one so far), and returns the
+    // popped node with *cost = g + h of it. Returns INVALID if the open set
+    // runs out before that.
+    template <typename Passable, typename Heuristic>
+    Loc Search(Loc start, Loc target, int max_iteration, bool jump_points,
+               Passable passable, Heuristic heuristic, float *cost) {
+        begin();
+        _target = target;
+
+        // Jumps look at the same cells many times, so ask passable() once.
+        auto walkable = [&](int x, int y) {
+            if (x < 0 || x >= _m || y < 0 || y >= _n) return false;
+            const Loc l = y * _m + x;
+            Node &node = _nodes[l];
+            if (node.probe_gen != _gen) {
+                node.probe_gen = _gen;
+                node.walkable = l == _target || passable(l);
+            }
+            return node.walkable;
+        };
+
+        return run(start, target, max_iteration, heuristic, cost, [&](Loc l) {
+            if (jump_points) expand_jump_points(l, walkable, heuristic);
+            else expand_neighbors(l, walkable, heuristic);
+        });
+    }
+
+    // The same search over a graph whose nodes are cells of the plane, but
+    // whose edges are given by the caller: neighbors(l, relax) must call
+    // relax(next, cost) for every edge l -> next.
+    template <typename Neighbors, typename Heuristic>
+    Loc SearchGraph(Loc start, Loc target, int max_iteration,
+                    Neighbors neighbors, Heuristic heuristic, float *cost) {
+        begin();
+        _target = target;
+        return run(start, target, max_iteration, heuristic, cost, [&](Loc l) {
+            const float g = _nodes[l].g;
+            neighbors(l, [&](Loc next, float c) { open(next, l, g + c, heuristic); });
+        });
+    }
+
+    // The cells of the path found by the last Search() from l back to the
+    // start, l first. Consecutive cells are adjacent, also with jump points.
+    // The vector is reused by the next call.
+    const std::vector<Loc> &GetPath(Loc l);
+
+    // The nodes of the path found by the last SearchGraph() from l back to
+    // the start, l first. The vector is reused by the next call.
+    const std::vector<Loc> &GetNodes(Loc l);
+
+    // #nodes popped by the last search.
+    int iterations() const { return _iterations; }
+
+private:
+    struct Node {
+        uint32_t gen;
+        // Generation in which walkable was computed.
+        uint32_t probe_gen;
+        bool walkable;
+        // Position in the heap, or kClosed once the node has been popped.
+        int32_t heap_pos;
+        Loc parent;
+        float g;
+        float f;
+    };
+    static const int32_t kClosed = -1;
+
+    int _m = 0, _n = 0;
+    uint32_t _gen = 0;
+    std::vector<Node> _nodes;
+    std::vector<Loc> _heap;
+    std::vector<Loc> _path;
+    Loc _target = INVALID;
+    int _iterations = 0;
+
+    void reset(int m, int n);
+    void begin();
+
+    template <typename Heuristic, typename Expand>
+    Loc run(Loc start, Loc target, int max_iteration, Heuristic &heuristic, float *cost, Expand expand) {
+        open(start, INVALID, 0.0, heuristic);
+        for (_iterations = 1; ! _heap.empty(); ++_iterations) {
+            const Loc l = pop();
+            if (l == target || _iterations == max_iteration) {
+                *cost = _nodes[l].f;
+                return l;
+            }
+            expand(l);
+        }
+        return INVALID;
+    }
+
+    bool fresh(Loc l) const { return _nodes[l].gen != _gen; }
+
+    // Lower f first. Among equal f, prefer larger g (closer to the target),
+    // then larger Loc, so that the order does not depend on the heap layout.
+    bool before(Loc a, Loc b) const {
+        const Node &na = _nodes[a], &nb = _nodes[b];
+        if (na.f != nb.f) return na.f < nb.f;
+        if (na.g != nb.g) return na.g > nb.g;
+        return a > b;
+    }
+
+    void place(int pos, Loc l) {
+        _heap[pos] = l;
+        _nodes[l].heap_pos = pos;
+    }
+
+    void sift_up(int pos) {
+        const Loc l = _heap[pos];
+        while (pos > 0) {
+            const int parent = (pos - 1) / 2;
+            if (! before(l, _heap[parent])) break;
+            place(pos, _heap[parent]);
+            pos = parent;
+        }
+        place(pos, l);
+    }
+
+    void sift_down(int pos) {
+        const Loc l = _heap[pos];
+        const int size = _heap.size();
+        while (true) {
+            int child = 2 * pos + 1;
+            if (child >= size) break;
+            if (child + 1 < size && before(_heap[child + 1], _heap[child])) child ++;
+            if (! before(_heap[child], l)) break;
+            place(pos, _heap[child]);
+            pos = child;
+        }
+        place(pos, l);
+    }
+
+    Loc pop() {
+        const Loc top = _heap.front();
+        const Loc last = _heap.back();
+        _heap.pop_back();
+        if (! _heap.empty()) {
+            place(0, last);
+            sift_down(0);
+        }
+        _nodes[top].heap_pos = kClosed;
+        return top;
+    }
+
+    // Reach l from parent with cost g: a new node, or a shorter path to an
+    // open one. Closed nodes are final, the heuristic being consistent.
+    template <typename Heuristic>
+    void open(Loc l, Loc parent, float g, Heuristic &heuristic) {
+        Node &node = _nodes[l];
+        if (fresh(l)) {
+            node.gen = _gen;
+            node.parent = parent;
+            node.g = g;
+            node.f = g + heuristic(l);
+            node.heap_pos = _heap.size();
+            _heap.push_back(l);
+            sift_up(node.heap_pos);
+        } else if (node.heap_pos != kClosed && g < node.g) {
+            node.f += g - node.g;
+            node.g = g;
+            node.parent = parent;
+            sift_up(node.heap_pos);
+        }
+    }
+
+    template <typename Walkable, typename Heuristic>
+    void expand_neighbors(Loc l, Walkable &walkable, Heuristic &heuristic) {
+        static const int dx[] = { 1, 0, -1, 0 };
+        static const int dy[] = { 0, 1, 0, -1 };
+        const int x = l % _m, y = l / _m;
+        const float g = _nodes[l].g + 1;
+        for (int i = 0; i < 4; ++i) {
+            if (walkable(x + dx[i], y + dy[i])) open(l + dy[i] * _m + dx[i], l, g, heuristic);
+        }
+    }
+
+    // Longest walk of a jump. A walk that goes that far stops as if it had
+    // found a jump point: the extra node costs a heap operation, but keeps
+    // a vertical walk, which looks sideways at every cell, from scanning
+    // the whole map on open terrain.
+    static const int kMaxJump = 8;
+
+    // From (x, y), walk in direction (dx, dy) until a cell where a shortest
+    // path may turn: the target, a cell whose side opens up (forced neighbor)
+    // or, when going vertically, a cell from which a horizontal walk finds
+    // one. Returns INVALID if the walk is blocked first.
+    template <typename Walkable>
+    Loc jump(int x, int y, int dx, int dy, Walkable &walkable) const {
+        for (int steps = 1; ; ++steps) {
+            x += dx;
+            y += dy;
+            if (! walkable(x, y)) return INVALID;
+            const Loc l = y * _m + x;
+            if (l == _target || steps == kMaxJump) return l;
+            if (dx != 0) {
+                if ((walkable(x, y - 1) && ! walkable(x - dx, y - 1)) || (walkable(x, y + 1) && ! walkable(x - dx, y + 1))) return l;
+            } else {
+                if ((walkable(x - 1, y) && ! walkable(x - 1, y - dy)) || (walkable(x + 1, y) && ! walkable(x + 1, y - dy))) return l;
+                if (jump(x, y, 1, 0, walkable) != INVALID || jump(x, y, -1, 0, walkable) != INVALID) return l;
+            }
+        }
+    }
+
+    template <typename Walkable, typename Heuristic>
+    void expand_jump_points(Loc l, Walkable &walkable, Heuristic &heuristic) {
+        const int x = l % _m, y = l / _m;
+        const Loc parent = _nodes[l].parent;
+
+        // Directions worth trying: all of them from the start, otherwise
+        // onward and to both sides, never back.
+        int dirs[4][2];
+        int num_dirs = 0;
+        auto add = [&](int dx, int dy) { dirs[num_dirs][0] = dx; dirs[num_dirs][1] = dy; num_dirs ++; };
+        if (parent == INVALID) {
+            add(1, 0); add(-1, 0); add(0, 1); add(0, -1);
+        } else {
+            const int px = parent % _m, py = parent / _m;
+            if (px != x) {
+                const int dx = x > px ? 1 : -1;
+                add(dx, 0); add(0, 1); add(0, -1);
+            } else {
+                const int dy = y > py ? 1 : -1;
+                add(0, dy); add(1, 0); add(-1, 0);
+            }
+        }
+
+        for (int i = 0; i < num_dirs; ++i) {
+            const Loc j = jump(x, y, dirs[i][0], dirs[i][1], walkable);
+            if (j == INVALID) continue;
+            const int steps = std::abs(j % _m - x) + std::abs(j / _m - y);
+            open(j, l, _nodes[l].g + steps, heuristic);
+        }
+    }
+};
+
+#endif
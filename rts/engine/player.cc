@@ -8,29 +8,9 @@
 */
 
 #include "player.h"
-#include "unit.h"
-
-template <typename T>
-static bool GetValue(const map< pair<Loc, Loc>, T > &m, const Loc &p1, const Loc &p2, T *value) {
-    auto it = m.find(make_pair(p1, p2));
-    if (it != m.end()) {
-        *value = it->second;
-        return true;
-    }
-    return false;
-}
-
-template <typename T>
-static void UpdateValue(const Loc &p1, const Loc &p2, const T& value, map< pair<Loc, Loc>, T > *m) {
-    pair<Loc, Loc> new_key(p1, p2);
-
-    auto it = m->find(new_key);
-    if (it != m->end()) {
-        it->second = value;
-    } else {
-        m->emplace(make_pair(std::move(new_key), value));
-    }
-}
+#include "path_search.h"
+#include "unit_slot_map.h"
+#include "zobrist.h"
 
 ///////////// Player ///////////////////
 string Player::Draw() const {
@@ -40,7 +20,7 @@ string Player::Draw() const {
         for (int x = 0; x < _map->GetXSize(); ++x) {
             // Draw the map (only level 0)
             Loc loc = _map->GetLoc(x, y, 0);
-            if ( _fogs[loc].CanSeeTerrain() ) {
+            if ( _visible.Get(loc) ) {
                 ss << (*_map)(loc).type << " ";
             } else {
                 ss << "# ";
@@ -51,32 +31,27 @@ string Player::Draw() const {
     return ss.str();
 }
 
-void Player::ComputeFOW(const Units &units) {
+void Player::ComputeFOW(const UnitSlotMap &units) {
     // Compute the player's fog of war.
-    // Two approaches, loop on the map (or in the future, viewport [TODO]),
-    // or loop on the units.
-    // [TODO]: We could do better with LocalitySearch.
-    // Clear fogs.
-    for (Fog &f : _fogs) {
-        f.Reset();
-    }
+    // Each unit ORs the precomputed stencil of its vision range into the visibility bits.
+    const int m = _map->GetXSize();
+    const int n = _map->GetYSize();
+    _visible.Clear();
     for (auto it = units.begin(); it != units.end(); ++it) {
-        const Unit *u = it->second.get();
+        const Unit *u = it->second;
         if (ExtractPlayerId(u->GetId()) == _player_id) {
             const int vis_r = u->GetProperty()._vis_r;
-            Loc l = _map->GetLoc(u->GetPointF());
-            for (const Loc &loc : _map->GetSight(l, vis_r)) {
-                _fogs[loc].SetClear();
-            }
+            Coord c = _map->GetCoord(_map->GetLoc(u->GetPointF()));
+            SightStencil::Get(vis_r).Apply(c.x, c.y, m, n, &_visible);
         }
     }
+    _explored |= _visible;
 }
 
 bool Player::FilterWithFOW(const Unit& u) const {
     if (! _map->IsIn(u.GetPointF())) return false;
-    // [TODO]: Could we do better?
     Loc l = _map->GetLoc(u.GetPointF());
-    return _fogs[l].CanSeeUnit();
+    return _visible.Get(l);
 }
 
 string Player::PrintInfo() const {
@@ -84,17 +59,20 @@ string Player::PrintInfo() const {
     ss << "Map ptr = " << _map << endl;
     ss << "Player id = " << _player_id << endl;
     ss << "Resource = " << _resource << endl;
-    ss << "Fog[" << _fogs.size() << "] = ";
-    for (size_t i = 0; i < _fogs.size(); ++i) ss << _fogs[i]._fog << " ";
+    ss << "Visible[" << _visible.size() << "] = ";
+    for (int i = 0; i < _visible.size(); ++i) ss << _visible.Get(i);
+    ss << endl;
+    ss << "Explored[" << _explored.size() << "] = ";
+    for (int i = 0; i < _explored.size(); ++i) ss << _explored.Get(i);
     ss << endl;
 
     return ss.str();
 }
 
-void Player::update_heuristic(const Loc &p1, const Loc &p2, float value) const {
-    float min_value = get_line_dist(p1, p2);
-    if (value < min_value) value = min_value;
-    UpdateValue(p1, p2, value, &_heuristics);
+uint64_t Player::ComputeHashKey() const {
+    // Fields start after those of Unit::ComputeHashKey(), whose objects may
+    // have the same id.
+    return zobrist::key(_player_id, 1024, _privilege) ^ zobrist::key(_player_id, 1025, _resource);
 }
 
 float Player::get_line_dist(const Loc &p1, const Loc &p2) const {
@@ -105,50 +83,23 @@ float Player::get_line_dist(const Loc &p1, const Loc &p2) const {
     return sqrt(static_cast<float>(dx * dx + dy * dy));
 }
 
-float Player::get_path_dist_heuristic(const Loc &p1, const Loc &p2) const {
-    float dist;
-    if (! GetValue(_heuristics, p1, p2, &dist)) {
-        dist = get_line_dist(p1, p2);
-    }
-    return dist;
-}
-
 bool Player::line_passable(UnitId id, const PointF &s, const PointF &t) const {
     const RTSMap &m = *_map;
-
-    float dist = sqrt(PointF::L2Sqr(s, t));
-    const int n = static_cast<int>(dist * 10 + 0.5);
-
-    PointF v;
-    PointF::Diff(t, s, &v);
-    v /= dist;
-
-    Loc ls = m.GetLoc(s);
-    Loc lt = m.GetLoc(t);
-
-    const float step = dist / n;
-
-    Loc last_lx = INVALID;
-
-    for (int i = 1; i < n; ++i) {
-        // Check discrete points {1 / n, ..., (n - 1) / n}
-        PointF x(s.x + v.x * step * i, s.y + v.y * step * i);
+    const Coord cs = s.ToCoord();
+    const Coord ct = t.ToCoord();
+    // Units are looked for kUnitProbe into each cell, or in its middle if the line only clips it.
+    const float kUnitProbe = 0.1;
+    const float probe = kUnitProbe / sqrt(PointF::L2Sqr(s, t));
+
+    // Check every cell the line goes through, except those of s and t.
+    return m.TraverseLine(s, t, [&](const Coord &c, float t_in, float t_out) {
+        if ((c.x == cs.x && c.y == cs.y) || (c.x == ct.x && c.y == ct.y)) return true;
+        if (! m.IsTerrainPassable(c)) return false;
+        const float a = std::min(t_in + probe, (t_in + t_out) / 2);
+        PointF x(s.x + (t.x - s.x) * a, s.y + (t.y - s.y) * a);
         // cout << "LinePassable[" << id << "]: Checking " << x << ". (s, t) = (" << s << ", " << t << ")" << endl;
-        Coord cx = x.ToCoord();
-        Loc lx = m.GetLoc(cx);
-        if (lx == last_lx) continue;
-        last_lx = lx;
-
-        if (lx != ls && lx != lt) {
-            if (! m.CanPass(x, id)) {
-                // cout << "(" << s << ") -> (" << t << ") line not passable due to (" << x << ")" << endl;
-                return false;
-            }
-        }
-    }
-
-    // cout << "(" << s << ") -> (" << t << ") line passable!" << endl;
-    return true;
+        return m.CanPass(x, id);
+    });
 }
 
 /*
@@ -157,7 +108,7 @@ bool Player::line_passable(UnitId id, const PointF &s, const PointF &t) const {
 }
 */
 
-bool Player::PathPlanning(Tick tick, UnitId id, const PointF &s, const PointF &t, int max_iteration, bool verbose, Coord *first_block, float *dist) const {
+bool Player::PathPlanning(Tick tick, UnitId id, const PointF &s, const PointF &t, int max_iteration, bool verbose, Coord *first_block, float *dist, bool jump_points) const {
     const RTSMap &m = *_map;
 
     Coord cs = s.ToCoord();
@@ -175,147 +126,133 @@ bool Player::PathPlanning(Tick tick, UnitId id, const PointF &s, const PointF &t
     *dist = 1e38;
 
     // Check cache. If the recomputation is fresh, just use it.
-    auto it_cache = _cache.find(make_pair(ls, lt));
-    if (it_cache != _cache.end()) {
-        if (tick - it_cache->second.first < 10) {
-            Loc loc = it_cache->second.second;
-            if (verbose) cout << "Cache hit! Tick: " << tick << " cache timestamp: " << it_cache->second.first << " Loc: " << loc << endl;
-            if (loc != INVALID) {
-                *first_block = m.GetCoord(loc);
+    CacheEntry &cached = cache_slot(ls, lt);
+    if (cached.start == ls && cached.target == lt) {
+        if (tick - cached.tick < kCacheValidTicks) {
+            if (verbose) cout << "Cache hit! Tick: " << tick << " cache timestamp: " << cached.tick << " Loc: " << cached.first_block << endl;
+            if (cached.first_block != INVALID) {
+                *first_block = m.GetCoord(cached.first_block);
             }
             return true;
         } else {
-            if (verbose) cout << "Cache out of date! Tick: " << tick << " cache timestamp: " << it_cache->second.first << endl;
-            _cache.erase(it_cache);
+            if (verbose) cout << "Cache out of date! Tick: " << tick << " cache timestamp: " << cached.tick << endl;
         }
     }
+    auto save_cache = [&](Loc l) {
+        cached.start = ls;
+        cached.target = lt;
+        cached.tick = tick;
+        cached.first_block = l;
+    };
 
     // Check if the two points are passable by a straight line. (Most common case).
     if (line_passable(id, s, t)) {
-        _cache[make_pair(ls, lt)] = make_pair(tick, INVALID);
+        save_cache(INVALID);
         return true;
     }
 
-    // 8 neighbors.
-    // const int dx[] = { 1, 0, -1, 0, 1, 1, -1, -1 };
-    // const int dy[] = { 0, 1, 0, -1, 1, -1, 1, -1 };
-    // const float dists[] = { 1.0, 1.0, 1.0, 1.0, kSqrt2, kSqrt2, kSqrt2, kSqrt2 };
-
-    const int dx[] = { 1, 0, -1, 0 };
-    const int dy[] = { 0, 1, 0, -1 };
-    const float dists[] = { 1.0, 1.0, 1.0, 1.0 };
-
-    // All "from" information.
-    // Loc -> Loc_from, dist_so_far.
-    map<Loc, pair<Loc, float> > c_from;
-    vector<Loc> c_popped;
-
-    // If s and t is not passable by a straight line.
-    priority_queue<Item> q;
-
-    float h0 = get_path_dist_heuristic(ls, lt);
-    q.emplace(Item(0.0, h0, ls, INVALID));
-    c_from.emplace(make_pair(ls, make_pair(INVALID, 0.0)));
-
-    if (verbose) {
-        cout << "Initial h0 = " << h0 << endl;
-    }
-
-    int iter = 1;
-    Loc l = INVALID;
-    bool found = false;
-
-    while (!q.empty()) {
-        Item v = q.top();
-        // cout << "Poped: " << v.PrintInfo(m) << endl;
-
-        // Save the current node to "from" information.
-        // Only the first occurrence matters (since given the same state, smallest g will come first).
-        c_popped.push_back(v.loc);
-        q.pop();
-
-        // Find the target, stop.
-        if (v.loc == lt || iter == max_iteration) {
-            if (verbose) {
-                cout << "[PathFinding] Tick: " << tick << "  Find the target! cost = " << v.cost << endl;
+    // The searches below only visit cells of the map plane.
+    if (! m.IsIn(cs)) return false;
+
+    // Units going to the same target share its flow field: follow it from the
+    // start, and aim at the farthest cell ahead that is in a straight line.
+    // On large maps, a field per target costs too much, so the cells ahead
+    // come from the cluster graph instead. Moving units are in neither; if
+    // they block the way out of the start, search around them below.
+    const bool large_map = m.GetPlaneSize() >= kClusterRouteMinCells;
+    if (m.IsIn(ct)) {
+        Loc ahead[kFlowLookahead];
+        int n = 0;
+        // Length of the route from the start.
+        float total = kUnreachableDist;
+        auto add = [&](Loc l) {
+            // As in the search, units block the cells close to the start.
+            const Coord c = m.GetCoord(l);
+            if (GetDistanceSquared(s, c) < 4 && l != lt && ! m.CanPass(c, id)) return false;
+            ahead[n++] = l;
+            return n < kFlowLookahead;
+        };
+
+        if (large_map) {
+            static thread_local vector<Loc> route;
+            total = m.GetClusterRoute(ls, lt, kFlowLookahead, &route);
+            for (Loc l : route) {
+                if (! add(l)) break;
+            }
+        } else {
+            FlowFieldCache::FieldPtr flow = m.GetFlowField(lt);
+            // A unit next to a building may be in a cell the building blocks.
+            // Then start from the neighbor closest to the target.
+            Loc first = flow->Next(ls);
+            if (! flow->Reachable(ls)) {
+                const Coord neighbors[] = { Coord(cs.x + 1, cs.y), Coord(cs.x - 1, cs.y), Coord(cs.x, cs.y + 1), Coord(cs.x, cs.y - 1) };
+                for (const Coord &c : neighbors) {
+                    if (! m.IsIn(c)) continue;
+                    const Loc l = m.GetLoc(c);
+                    if (flow->Reachable(l) && (first == INVALID || flow->Get(l) < flow->Get(first))) first = l;
+                }
+            }
+            if (first != INVALID) {
+                total = flow->Get(first) + 1;
+                for (Loc l = first; l != INVALID && add(l); l = flow->Next(l));
             }
-            *dist = v.cost;
-            found = true;
-            l = v.loc;
-            break;
         }
 
-        Coord c_curr = m.GetCoord(v.loc);
-        // Expand to 8 neighbor.
-        for (size_t i = 0; i < sizeof(dx) / sizeof(int); ++i) {
-            Coord next(c_curr.x + dx[i], c_curr.y + dy[i]);
-            Loc l_next = m.GetLoc(next);
-
-            // If we already push that before, skip.
-            if (c_from.find(l_next) != c_from.end()) continue;
-
-            // if we met with impassable location and has not reached the target (lt), skip.
-            if (l_next != lt) {
-               if (GetDistanceSquared(s, next) >= 4 && ! m.CanPass(next, id, false)) continue;
-               if (GetDistanceSquared(s, next) < 4 && ! m.CanPass(next, id)) continue;
-           }
+        for (int i = n - 1; i >= 0; --i) {
+            Coord waypoint = m.GetCoord(ahead[i]);
+            if (line_passable(id, s, PointF(waypoint.x, waypoint.y))) {
+                if (verbose) cout << (large_map ? "Cluster route" : "Flow field") << ": waypoint " << waypoint << " steps to target: " << total << endl;
+                *first_block = waypoint;
+                *dist = total;
+                save_cache(ahead[i]);
+                return true;
+            }
+        }
+    }
 
-            float h = get_path_dist_heuristic(l_next, lt);
-            float next_dist = v.g + dists[i];
+    // Terrain distance to the target. It never overestimates (units only add
+    // obstacles), and cells it cannot reach are never on a path to the target.
+    // If the start itself is cut off by terrain, or if the map is too large
+    // for a field per target, fall back to the straight line distance and
+    // search toward the most promising cell.
+    DistanceFieldCache::FieldPtr field;
+    if (m.IsIn(ct) && ! large_map) {
+        field = m.GetDistanceField(lt);
+        if (! field->Reachable(ls)) field.reset();
+    }
+    auto heuristic = [&](Loc l) { return field ? field->Get(l) : get_line_dist(l, lt); };
 
-            if (verbose) {
-                cout << "push: l_next = " << l_next << ", next_dist = " << next_dist << ", h = " << h << ", parent_loc = " << v.loc << endl;
-            }
+    // Units only block the cells close to the start; farther away they will
+    // have moved by the time we get there.
+    auto passable = [&](Loc l) {
+        if (field && ! field->Reachable(l)) return false;
+        const Coord next = m.GetCoord(l);
+        if (GetDistanceSquared(s, next) >= 4) return m.CanPass(next, id, false);
+        return m.CanPass(next, id);
+    };
 
-            q.emplace(Item(next_dist, h, l_next, v.loc));
-            c_from.emplace(make_pair(l_next, make_pair(v.loc, next_dist)));
-        }
-        iter ++;
+    if (verbose) {
+        cout << "Initial h0 = " << heuristic(ls) << endl;
     }
 
+    GridSearch &search = GridSearch::ThreadLocal(m.GetXSize(), m.GetYSize());
+    float cost;
+    Loc l = search.Search(ls, lt, max_iteration, jump_points, passable, heuristic, &cost);
+
     if (verbose) {
-        cout << "Total iter = " << iter << " optimal dist = " << *dist << endl;
+        cout << "Total iter = " << search.iterations() << " cost = " << cost << endl;
     }
 
-    if (! found) {
+    if (l == INVALID) {
         // Not found.
         return false;
     }
+    *dist = cost;
 
-    // Then do a backtrace to get the path.
-    vector<Loc> traj;
     // traj[0] is the last part of the trajectory, depending on max_iteration,
     // it might end in the target location, or reach some intermediate location, which is the most promising.
     // traj[-1] is the starting point.
-    while (l != INVALID) {
-        // cout << "Loc: " << m.GetCoord(l) << endl;
-        auto it = c_from.find(l);
-        if (it == c_from.end()) {
-            cout << "Path-finding error!" << endl;
-            return false;
-        }
-
-        traj.push_back(l);
-        update_heuristic(l, lt, *dist - it->second.second);
-        l = it->second.first;
-    }
-
-    // Delete trajectory from the map.
-    // cout << " Traj: ";
-    for (const Loc &l : traj) {
-        // cout << "(" << m.GetCoord(l) << ") ";
-        c_from.erase(l);
-    }
-    // cout << endl;
-
-    // For all visited node other than the true solution,
-    // their heuristic will be set to be opt + eps - g
-    for (Loc l : c_popped) {
-        auto it = c_from.find(l);
-        if (it != c_from.end()) {
-            update_heuristic(l, lt, (*dist + 1e-5f) - it->second.second);
-        }
-    }
+    const vector<Loc> &traj = search.GetPath(l);
 
     // Compute the first waypoint from the starting.
     // Starting from the end of path and check.
@@ -323,26 +260,26 @@ bool Player::PathPlanning(Tick tick, UnitId id, const PointF &s, const PointF &t
         Coord waypoint = m.GetCoord(traj[i]);
         if (line_passable(id, s, PointF(waypoint.x, waypoint.y))) {
             *first_block = waypoint;
-            _cache[make_pair(ls, lt)] = make_pair(tick, traj[i]);
+            save_cache(traj[i]);
             return true;
         }
     }
     // cout << "PathPlanning. No valid path, leave to local planning" << endl;
-    _cache[make_pair(ls, lt)] = make_pair(tick, INVALID);
+    save_cache(INVALID);
 
     return false;
 }
 
 string Player::PrintHeuristicsCache() const {
     stringstream ss;
-    ss << "Heuristics: " << endl;
-    for (auto it = _heuristics.begin(); it != _heuristics.end(); ++it) {
-        ss << "[" << it->first.first << ", " << it->first.second << "]: " << it->second << endl;
-    }
+    ss << _map->GetDistanceFieldCache().PrintInfo() << endl;
+    ss << _map->GetFlowFieldCache().PrintInfo() << endl;
+    ss << _map->GetClusterGraph().PrintInfo() << endl;
 
     ss << "Cache: " << endl;
-    for (auto it = _cache.begin(); it != _cache.end(); ++it) {
-        ss << "[" << it->first.first << ", " << it->first.second << "]: T " << it->second.first << ": " << it->second.second << endl;
+    for (const CacheEntry &e : _cache) {
+        if (e.start == INVALID) continue;
+        ss << "[" << e.start << ", " << e.target << "]: T " << e.tick << ": " << e.first_block << endl;
     }
     return ss.str();
 }
@@ -13,20 +13,11 @@
 #include "map.h"
 #include "cmd.h"
 #include "gamedef.h"
+#include "fog_of_war.h"
 #include <queue>
 
 class Unit;
-
-struct Fog {
-    // Fog level: 0 no fog, 100 completely invisible.
-    int _fog = 100;
-    void Reset() {  _fog = 100; }
-    void SetClear() { _fog = 0; }
-    bool CanSeeTerrain() const { return _fog < 50; }
-    bool CanSeeUnit() const { return _fog < 30; }
-
-    SERIALIZER(Fog, _fog);
-};
+class UnitSlotMap;
 
 // PlayerPrivilege, Normal player only see within the Fog of War.
 // KnowAll Player knows everything and can attack objects outside its FOW.
@@ -46,64 +37,51 @@ private:
     // How many resources the player have.
     int _resource;
 
-    // Current fog of war. This containers have the same size as the map.
-    vector<Fog> _fogs;
+    // Current fog of war, one bit per cell of the map plane: set if the
+    // cell is in the sight of one of the player's units this tick.
+    PlaneBits _visible;
+    // Cells that have ever been visible.
+    PlaneBits _explored;
+
+    // Cache for path planning: the first waypoint from a start cell to a
+    // target cell, reused for kCacheValidTicks ticks. first_block == INVALID:
+    // cannot pass / passable by a straight line (In this case, we return
+    // first_block = -1). Direct-mapped on (start, target), so that it has a
+    // fixed size: a new entry replaces whatever was in its slot.
+    struct CacheEntry {
+        Loc start = INVALID;
+        Loc target = INVALID;
+        Tick tick = 0;
+        Loc first_block = INVALID;
+
+        SERIALIZER(CacheEntry, start, target, tick, first_block);
+    };
+    mutable vector<CacheEntry> _cache;
 
-    // Heuristic function for path-planning.
-    // Loc x Loc -> min distance (in discrete space).
-    // If the key is not in _heuristics, then by default it is l2 distance.
-    mutable map< pair<Loc, Loc>, float > _heuristics;
+    static const int kCacheValidTicks = 10;
+    static const int kCacheSize = 256;
 
-    // Cache for path planning. If the cache is too old, it will recompute.
-    // Loc == INVALID: cannot pass / passable by a straight line (In this case, we return first_block = -1.
-    mutable map< pair<Loc, Loc>, pair<Tick, Loc> > _cache;
+    // #cells of the route looked ahead for a waypoint.
+    static const int kFlowLookahead = 16;
+    // Maps with at least that many cells per plane take routes from the
+    // cluster graph rather than from flow fields.
+    static const int kClusterRouteMinCells = 128 * 128;
 
-private:
-    struct Item {
-        float g;
-        float h;
-        float cost;
-        Loc loc;
-        Loc loc_from;
-        Item(float g, float h, const Loc &loc, const Loc &loc_from)
-            : g(g), h(h), loc(loc), loc_from(loc_from) {
-            cost = g + h;
-        }
-
-        friend bool operator<(const Item &m1, const Item &m2) {
-            if (m1.cost > m2.cost) return true;
-            if (m1.cost < m2.cost) return false;
-            if (m1.g > m2.g) return true;
-            if (m1.g < m2.g) return false;
-            if (m1.loc < m2.loc) return true;
-            if (m1.loc > m2.loc) return false;
-            if (m1.loc_from < m2.loc_from) return true;
-            if (m1.loc_from > m2.loc_from) return false;
-            return true;
-        }
-
-        string PrintInfo(const RTSMap &m) const {
-            stringstream ss;
-            ss << "cost: " << cost << " loc: (" << m.GetCoord(loc) << ") g: " << g << " h: " << h << " from: (" << m.GetCoord(loc_from) << ")";
-            return ss.str();
-        }
-    };
+    CacheEntry &cache_slot(Loc start, Loc target) const {
+        const uint32_t h = (uint32_t)start * 2654435761u ^ (uint32_t)target * 40503u;
+        return _cache[(h >> 8) % kCacheSize];
+    }
 
     bool line_passable(UnitId id, const PointF &curr, const PointF &target) const;
     float get_line_dist(const Loc &p1, const Loc &p2) const;
 
-    // Update the heuristic value.
-    void update_heuristic(const Loc &p1, const Loc &p2, float value) const;
-
-    // Get the heuristic distance from p1 to p2.
-    float get_path_dist_heuristic(const Loc &p1, const Loc &p2) const;
-
 public:
-    Player() : _map(nullptr), _player_id(INVALID), _privilege(PV_NORMAL), _resource(0) {
+    Player() : _map(nullptr), _player_id(INVALID), _privilege(PV_NORMAL), _resource(0), _cache(kCacheSize) {
     }
     Player(const RTSMap& m, int player_id)
-        : _map(&m), _player_id(player_id), _privilege(PV_NORMAL), _resource(0) {
-        _fogs.assign(_map->GetPlaneSize(), Fog());
+        : _map(&m), _player_id(player_id), _privilege(PV_NORMAL), _resource(0), _cache(kCacheSize) {
+        _visible = PlaneBits(_map->GetPlaneSize());
+        _explored = PlaneBits(_map->GetPlaneSize());
     }
 
     const RTSMap& GetMap() const { return *_map; }
@@ -112,7 +90,7 @@ public:
     int GetResource() const { return _resource; }
 
     string Draw() const;
-    void ComputeFOW(const map<UnitId, unique_ptr<Unit> > &units);
+    void ComputeFOW(const UnitSlotMap &units);
     bool FilterWithFOW(const Unit& u) const;
 
     float GetDistanceSquared(const PointF &p, const Coord &c) const {
@@ -121,8 +99,12 @@ public:
         return dx * dx + dy * dy;
     }
 
-    // It will change _heuristics internally.
-    bool PathPlanning(Tick tick, UnitId id, const PointF &curr, const PointF &target, int max_iteration, bool verbose, Coord *first_block, float *est_dist) const;
+    // Follows the flow field of the target (see RTSMap::GetFlowField()). If
+    // units are in the way, A* guided by the map's terrain distance field to
+    // the target, which is an exact heuristic when no unit is in the way.
+    // With jump_points, A* only expands the cells where the path may turn
+    // (see GridSearch), so max_iteration reaches further.
+    bool PathPlanning(Tick tick, UnitId id, const PointF &curr, const PointF &target, int max_iteration, bool verbose, Coord *first_block, float *est_dist, bool jump_points = false) const;
 
     void SetPrivilege(PlayerPrivilege new_pv) { _privilege = new_pv; }
     PlayerPrivilege GetPrivilege() const { return _privilege; }
@@ -137,19 +119,33 @@ public:
         return make_string("p", _player_id, _resource);
     }
 
-    void ClearCache() { _heuristics.clear(); _cache.clear(); _resource = 0; }
+    // Back to the start of a game: no resource, no cached path, and nothing
+    // of the map seen or explored yet.
+    void Reset() {
+        _cache.assign(kCacheSize, CacheEntry());
+        _resource = 0;
+        const int plane = _map != nullptr ? _map->GetPlaneSize() : 0;
+        if (_visible.size() == plane) _visible.Clear();
+        else _visible = PlaneBits(plane);
+        if (_explored.size() == plane) _explored.Clear();
+        else _explored = PlaneBits(plane);
+    }
 
-    bool CanSeeTerrain(Loc loc) const { return _fogs[loc].CanSeeTerrain(); }
+    bool CanSeeTerrain(Loc loc) const { return _visible.Get(loc); }
+    bool HasExplored(Loc loc) const { return _explored.Get(loc); }
 
     string PrintInfo() const;
 
+    // Zobrist key of the player, computed from scratch (see zobrist.h).
+    uint64_t ComputeHashKey() const;
+
     string PrintHeuristicsCache() const;
 
     // 24-30 encoding player id.
     static PlayerId ExtractPlayerId(UnitId id) { return (id >> 24); }
     static UnitId CombinePlayerId(UnitId raw_id, PlayerId player_id) { return (raw_id & 0xffffff) | (player_id << 24); }
 
-    SERIALIZER(Player, _player_id, _privilege, _resource, _fogs, _heuristics, _cache);
+    SERIALIZER(Player, _player_id, _privilege, _resource, _visible, _explored, _cache);
     HASH(Player, _player_id, _privilege, _resource);
 };
 
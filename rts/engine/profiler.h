@@ -0,0 +1,329 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "custom_enum.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Phases of a tick in RTSGame::MainLoop.
+custom_enum(TickPhase, PHASE_SAVE_SNAPSHOT = 0, PHASE_SAVE_KEYFRAME, PHASE_ACT, PHASE_FORWARD, PHASE_DURATIVE,
+            PHASE_IMMEDIATE, PHASE_UI, PHASE_FOW, PHASE_END_TICK, NUM_TICK_PHASE);
+
+// Monotonic cycle counter. Uses the TSC on x86 (constant rate on any CPU from
+// the last decade) and steady_clock elsewhere.
+class CycleClock {
+public:
+    static inline uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Measured once, the first time it is needed (takes ~10ms).
+    static double CyclesPerUsec() {
+        static const double rate = calibrate();
+        return rate;
+    }
+
+private:
+    static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto t1 = std::chrono::steady_clock::now();
+        uint64_t c1 = Now();
+        double usec = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        return (c1 - c0) / usec;
+#else
+        return 1000.0;
+#endif
+    }
+};
+
+// Durations of each tick phase, over all threads that record into it.
+//
+// Every thread writes to its own block of log2-bucketed histograms, so
+// recording is a few relaxed atomic stores and never contends. Blocks are
+// kept in a lock-free list and merged when queried, one per thread that ever
+// recorded into the profiler, and freed with it. Threads that exit keep
+// contributing what they recorded.
+class TickProfiler {
+public:
+    static const int kNumBuckets = 48;
+
+    struct Stats {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t max = 0;
+        uint64_t buckets[kNumBuckets] = { };
+        // Heap allocations, if an allocation counter is set.
+        uint64_t allocs = 0;
+
+        double mean_us() const { return count == 0 ? 0.0 : total / CycleClock::CyclesPerUsec() / count; }
+        double total_ms() const { return total / CycleClock::CyclesPerUsec() / 1000; }
+        double max_us() const { return max / CycleClock::CyclesPerUsec(); }
+
+        // Approximate quantile, q in [0, 1]. Interpolates within a bucket.
+        double quantile_us(double q) const {
+            if (count == 0) return 0.0;
+            double rank = q * count;
+            uint64_t seen = 0;
+            for (int i = 0; i < kNumBuckets; ++i) {
+                if (buckets[i] == 0) continue;
+                if (seen + buckets[i] >= rank) {
+                    double lo = (i == 0 ? 0 : (uint64_t)1 << (i - 1)), hi = (uint64_t)1 << i;
+                    double v = lo + (hi - lo) * (rank - seen) / buckets[i];
+                    return std::min(v, (double)max) / CycleClock::CyclesPerUsec();
+                }
+                seen += buckets[i];
+            }
+            return max_us();
+        }
+    };
+
+    TickProfiler() : _serial(next_serial()), _head(nullptr) { }
+    TickProfiler(const TickProfiler &) = delete;
+    TickProfiler &operator=(const TickProfiler &) = delete;
+
+    ~TickProfiler() {
+        Block *b = _head.load();
+        while (b != nullptr) {
+            Block *next = b->next;
+            delete b;
+            b = next;
+        }
+    }
+
+    // Shared by all games that are not given their own profiler.
+    static TickProfiler &Global() {
+        static TickProfiler profiler;
+        return profiler;
+    }
+
+    // Tools that count allocations (see elf/alloc_counter.h) set a function
+    // returning the number of allocations made so far by the calling thread.
+    // PhaseClock then charges allocations to phases as well.
+    using AllocCountFunc = uint64_t (*)();
+    static void SetAllocCounter(AllocCountFunc f) { alloc_counter().store(f); }
+    static AllocCountFunc GetAllocCounter() { return alloc_counter().load(std::memory_order_relaxed); }
+
+    void Add(TickPhase phase, uint64_t cycles, uint64_t allocs = 0) {
+        PhaseHist &h = local()->phases[phase];
+        // Only this thread writes h, so there is no need for atomic increments.
+        const int b = bucket(cycles);
+        h.count.store(h.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        h.total.store(h.total.load(std::memory_order_relaxed) + cycles, std::memory_order_relaxed);
+        if (cycles > h.max.load(std::memory_order_relaxed)) h.max.store(cycles, std::memory_order_relaxed);
+        h.buckets[b].store(h.buckets[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (allocs > 0) h.allocs.store(h.allocs.load(std::memory_order_relaxed) + allocs, std::memory_order_relaxed);
+    }
+
+    // Merge the histograms of all threads. May run concurrently with Add().
+    Stats Get(TickPhase phase) const {
+        Stats s;
+        for (const Block *b = _head.load(std::memory_order_acquire); b != nullptr; b = b->next) {
+            const PhaseHist &h = b->phases[phase];
+            s.count += h.count.load(std::memory_order_relaxed);
+            s.total += h.total.load(std::memory_order_relaxed);
+            s.max = std::max(s.max, h.max.load(std::memory_order_relaxed));
+            s.allocs += h.allocs.load(std::memory_order_relaxed);
+            for (int i = 0; i < kNumBuckets; ++i) s.buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    // Zero all histograms. Samples recorded concurrently may be partially lost.
+    void Reset() {
+        for (Block *b = _head.load(std::memory_order_acquire); b != nullptr; b = b->next) {
+            for (auto &h : b->phases) {
+                h.count.store(0, std::memory_order_relaxed);
+                h.total.store(0, std::memory_order_relaxed);
+                h.max.store(0, std::memory_order_relaxed);
+                h.allocs.store(0, std::memory_order_relaxed);
+                for (auto &c : h.buckets) c.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    int GetNumThreads() const {
+        int n = 0;
+        for (const Block *b = _head.load(std::memory_order_acquire); b != nullptr; b = b->next) n ++;
+        return n;
+    }
+
+    // phase name -> {count, total_ms, mean_us, p50_us, p90_us, p99_us, max_us},
+    // plus allocs if an allocation counter is set.
+    std::map<std::string, std::map<std::string, double>> Summary() const {
+        std::map<std::string, std::map<std::string, double>> res;
+        for (int i = 0; i < NUM_TICK_PHASE; ++i) {
+            Stats s = Get((TickPhase)i);
+            if (s.count == 0) continue;
+            res[_TickPhase2string((TickPhase)i)] = {
+                { "count", (double)s.count }, { "total_ms", s.total_ms() }, { "mean_us", s.mean_us() },
+                { "p50_us", s.quantile_us(0.5) }, { "p90_us", s.quantile_us(0.9) },
+                { "p99_us", s.quantile_us(0.99) }, { "max_us", s.max_us() }
+            };
+            if (GetAllocCounter() != nullptr) res[_TickPhase2string((TickPhase)i)]["allocs"] = s.allocs;
+        }
+        return res;
+    }
+
+    std::string PrintInfo() const {
+        std::stringstream ss;
+        for (const auto &item : Summary()) {
+            const auto &v = item.second;
+            ss << item.first << ": n=" << (uint64_t)v.at("count") << " mean " << v.at("mean_us") << "us p50 "
+               << v.at("p50_us") << "us p99 " << v.at("p99_us") << "us total " << v.at("total_ms") << "ms";
+            if (v.count("allocs")) ss << " allocs " << (uint64_t)v.at("allocs");
+            ss << std::endl;
+        }
+        return ss.str();
+    }
+
+private:
+    struct PhaseHist {
+        std::atomic<uint64_t> count{0}, total{0}, max{0}, allocs{0};
+        std::atomic<uint64_t> buckets[kNumBuckets];
+        PhaseHist() { for (auto &c : buckets) c.store(0, std::memory_order_relaxed); }
+    };
+
+    struct Block {
+        PhaseHist phases[NUM_TICK_PHASE];
+        std::thread::id owner;
+        Block *next = nullptr;
+    };
+
+    // Lets a thread find its blocks in the last few profilers it recorded
+    // into without touching shared state.
+    static const int kLocalCacheSize = 4;
+    struct LocalCache {
+        uint64_t serial[kLocalCacheSize] = { };
+        Block *block[kLocalCacheSize] = { };
+        int next = 0;
+    };
+
+    const uint64_t _serial;
+    std::atomic<Block *> _head;
+
+    static std::atomic<AllocCountFunc> &alloc_counter() {
+        static std::atomic<AllocCountFunc> f(nullptr);
+        return f;
+    }
+
+    static uint64_t next_serial() {
+        static std::atomic<uint64_t> serial(0);
+        return ++ serial;
+    }
+
+    // Bucket i holds durations in [2^(i-1), 2^i) cycles.
+    static int bucket(uint64_t cycles) {
+        if (cycles == 0) return 0;
+        return std::min(64 - __builtin_clzll(cycles), kNumBuckets - 1);
+    }
+
+    Block *local() {
+        static thread_local LocalCache cache;
+        for (int i = 0; i < kLocalCacheSize; ++i) {
+            if (cache.serial[i] == _serial) return cache.block[i];
+        }
+
+        // A thread going back and forth between more profilers than the cache
+        // holds finds its block again in the list. Only the thread itself adds
+        // its block, so it cannot be added twice.
+        const std::thread::id self = std::this_thread::get_id();
+        Block *b = _head.load(std::memory_order_acquire);
+        while (b != nullptr && b->owner != self) b = b->next;
+        if (b == nullptr) {
+            b = new Block();
+            b->owner = self;
+            b->next = _head.load(std::memory_order_relaxed);
+            while (! _head.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed)) { }
+        }
+        cache.serial[cache.next] = _serial;
+        cache.block[cache.next] = b;
+        cache.next = (cache.next + 1) % kLocalCacheSize;
+        return b;
+    }
+};
+
+// Times consecutive phases of one tick: each Record() charges the time since
+// the previous one (or since Start()) to a phase.
+class PhaseClock {
+public:
+    explicit PhaseClock(TickProfiler *profiler)
+        : _profiler(profiler), _last(CycleClock::Now()), _alloc_counter(TickProfiler::GetAllocCounter()), _last_allocs(0) {
+        Restart();
+    }
+
+    void Start() {
+        _last = CycleClock::Now();
+        if (_alloc_counter != nullptr) _last_allocs = _alloc_counter();
+    }
+
+    inline void Record(TickPhase phase) {
+        uint64_t now = CycleClock::Now();
+        uint64_t cycles = now - _last;
+        _last = now;
+        uint64_t allocs = 0;
+        if (_alloc_counter != nullptr) {
+            uint64_t n = _alloc_counter();
+            allocs = n - _last_allocs;
+            _last_allocs = n;
+        }
+        _local_total[phase] += cycles;
+        _local_count[phase] ++;
+        if (_profiler != nullptr) _profiler->Add(phase, cycles, allocs);
+    }
+
+    // Averages since the last Restart(), for this clock only.
+    void Restart() {
+        std::fill(_local_total, _local_total + NUM_TICK_PHASE, 0);
+        std::fill(_local_count, _local_count + NUM_TICK_PHASE, 0);
+    }
+
+    std::string Summary() const {
+        std::stringstream ss;
+        double total_time = 0;
+        for (int i = 0; i < NUM_TICK_PHASE; ++i) {
+            if (_local_count[i] > 0) {
+                double v = _local_total[i] / CycleClock::CyclesPerUsec() / 1000 / _local_count[i];
+                ss << _TickPhase2string((TickPhase)i) << ": " << v << "ms. ";
+                total_time += v;
+            }
+        }
+        ss << "Total: " << total_time << "ms.";
+        return ss.str();
+    }
+
+private:
+    TickProfiler *_profiler;
+    uint64_t _last;
+    TickProfiler::AllocCountFunc _alloc_counter;
+    uint64_t _last_allocs;
+    uint64_t _local_total[NUM_TICK_PHASE];
+    uint64_t _local_count[NUM_TICK_PHASE];
+};
+
+#endif
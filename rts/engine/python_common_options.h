@@ -72,6 +72,11 @@ struct PythonOptions {
 
     bool shuffle_player;
 
+    // If true, all players of a game send their states together and get
+    // their replies in one round trip. Requires ContextOptions.max_num_threads
+    // >= #players, since each player then uses its own key.
+    bool joint_act;
+
     int mcts_threads;
     int mcts_rollout_per_thread;
     int game_name;
@@ -79,7 +84,7 @@ struct PythonOptions {
     int handicap_level;
 
     PythonOptions()
-      : simulation_type(ST_NORMAL), max_tick(30000), seed(0), shuffle_player(false), mcts_threads(1), mcts_rollout_per_thread(1),
+      : simulation_type(ST_NORMAL), max_tick(30000), seed(0), shuffle_player(false), joint_act(false), mcts_threads(1), mcts_rollout_per_thread(1),
         game_name(0), handicap_level(0) {
     }
 
@@ -92,6 +97,7 @@ struct PythonOptions {
         std::cout << "Max tick: " << max_tick << std::endl;
         std::cout << "Seed: " << seed << std::endl;
         std::cout << "Shuffled: " << (shuffle_player ? "True" : "False") << std::endl;
+        std::cout << "Joint act: " << (joint_act ? "True" : "False") << std::endl;
         for (const AIOptions& ai_option : ai_options) {
             std::cout << ai_option.info() << std::endl;
         }
@@ -101,5 +107,5 @@ struct PythonOptions {
         std::cout << "Save_replay_prefix: \"" << save_replay_prefix << "\"" << std::endl;
     }
 
-    REGISTER_PYBIND_FIELDS(simulation_type, output_filename, cmd_dumper_prefix, save_replay_prefix, max_tick, seed, mcts_threads, mcts_rollout_per_thread, game_name, handicap_level, shuffle_player);
+    REGISTER_PYBIND_FIELDS(simulation_type, output_filename, cmd_dumper_prefix, save_replay_prefix, max_tick, seed, mcts_threads, mcts_rollout_per_thread, game_name, handicap_level, shuffle_player, joint_act);
 };
@@ -0,0 +1,408 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char kReplayMagic[] = "ELFRPLY1";
+static const char kReplayIndexMagic[] = "ELFRIDX1";
+static const size_t kMagicSize = 8;
+static const size_t kTrailerSize = sizeof(uint64_t) + kMagicSize;
+
+// CmdBase::Save writes _tick, _start_tick, _id, _cmd_id before the fields of
+// the derived class. In binary mode each of them is a raw int.
+static const size_t kCmdBaseBytes = 4 * sizeof(int);
+
+static void put_varint(std::string *s, uint64_t v) {
+    while (v >= 0x80) {
+        s->push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    s->push_back(static_cast<char>(v));
+}
+
+static void put_svarint(std::string *s, int64_t v) {
+    put_varint(s, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+static uint64_t get_varint(const char *data, size_t size, uint64_t *pos) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= size) throw std::range_error("Replay: truncated varint");
+        const uint8_t b = static_cast<uint8_t>(data[(*pos)++]);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (! (b & 0x80)) return v;
+    }
+    throw std::range_error("Replay: bad varint");
+}
+
+static int64_t get_svarint(const char *data, size_t size, uint64_t *pos) {
+    const uint64_t v = get_varint(data, size, pos);
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+///////////////////////////// ReplayWriter ////////////////////////////////
+ReplayWriter::ReplayWriter() : _num_cmds(0), _last_tick(0) {
+    _body.append(kReplayMagic, kMagicSize);
+}
+
+void ReplayWriter::Add(const CmdBase &cmd) {
+    if (_num_cmds % kReplayBlockSize == 0) {
+        _blocks.emplace_back(_body.size(), _blocks.empty() ? cmd.tick() : _blocks.back().second);
+        _pred = Predictor();
+    }
+
+    serializer::saver saver(true);
+    cmd.Save(saver);
+    const std::string s = saver.get_str();
+
+    int base[4];
+    if (s.size() < kCmdBaseBytes) throw std::range_error("Replay: cannot encode " + cmd.PrintInfo());
+    memcpy(base, s.data(), kCmdBaseBytes);
+    if (base[0] != cmd.tick() || base[1] != cmd.start_tick() || base[2] != cmd.id()) {
+        throw std::range_error("Replay: unexpected binary layout of " + cmd.PrintInfo());
+    }
+    const int cmd_id = base[3];
+
+    const std::string type = cmd._signature();
+    auto it = std::find(_types.begin(), _types.end(), type);
+    const int type_idx = it - _types.begin();
+    if (it == _types.end()) _types.push_back(type);
+
+    put_varint(&_body, type_idx);
+    put_svarint(&_body, static_cast<int64_t>(cmd.tick()) - _pred.tick);
+    put_svarint(&_body, static_cast<int64_t>(cmd.start_tick()) - cmd.tick());
+    put_svarint(&_body, static_cast<int64_t>(cmd.id()) - _pred.id);
+    put_svarint(&_body, static_cast<int64_t>(cmd_id) - _pred.cmd_id - 1);
+    put_varint(&_body, s.size() - kCmdBaseBytes);
+    _body.append(s, kCmdBaseBytes, std::string::npos);
+
+    _pred.tick = cmd.tick();
+    _pred.id = cmd.id();
+    _pred.cmd_id = cmd_id;
+
+    _last_tick = std::max(_last_tick, cmd.tick());
+    _blocks.back().second = _last_tick;
+    _num_cmds ++;
+}
+
+void ReplayWriter::AddKeyframe(Tick tick, std::string state) {
+    _keyframes.emplace_back(tick, std::move(state));
+}
+
+bool ReplayWriter::Save(const std::string &filename) const {
+    std::ofstream oFile(filename, std::ios::binary | std::ios::out);
+    if (! oFile.is_open()) return false;
+    const std::string s = Serialize();
+    oFile.write(s.data(), s.size());
+    return oFile.good();
+}
+
+std::string ReplayWriter::Serialize() const {
+    std::string tail;
+    std::vector<std::pair<uint64_t, uint64_t>> keyframe_loc;
+    uint64_t offset = _body.size();
+    for (const auto &kf : _keyframes) {
+        keyframe_loc.emplace_back(offset, kf.second.size());
+        offset += kf.second.size();
+    }
+    const uint64_t index_offset = offset;
+
+    put_varint(&tail, _types.size());
+    for (const auto &type : _types) {
+        put_varint(&tail, type.size());
+        tail += type;
+    }
+    put_varint(&tail, _num_cmds);
+    put_svarint(&tail, _last_tick);
+    put_varint(&tail, _blocks.size());
+    for (const auto &block : _blocks) {
+        put_varint(&tail, block.first);
+        put_svarint(&tail, block.second);
+    }
+    put_varint(&tail, _keyframes.size());
+    for (size_t i = 0; i < _keyframes.size(); ++i) {
+        put_svarint(&tail, _keyframes[i].first);
+        put_varint(&tail, keyframe_loc[i].first);
+        put_varint(&tail, keyframe_loc[i].second);
+    }
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) tail.push_back(static_cast<char>((index_offset >> (8 * i)) & 0xff));
+    tail.append(kReplayIndexMagic, kMagicSize);
+
+    std::string res;
+    res.reserve(index_offset + tail.size());
+    res += _body;
+    for (const auto &kf : _keyframes) res += kf.second;
+    res += tail;
+    return res;
+}
+
+///////////////////////////// ReplayReader ////////////////////////////////
+ReplayReader::ReplayReader()
+    : _data(nullptr), _size(0), _body_end(0), _mapped(false), _num_cmds(0), _last_tick(0),
+      _next_idx(0), _cursor(0), _loader(true) {
+}
+
+ReplayReader::~ReplayReader() {
+    unmap();
+}
+
+void ReplayReader::unmap() {
+#ifndef _WIN32
+    if (_mapped) munmap(const_cast<char *>(_data), _size);
+#endif
+    _mapped = false;
+    _data = nullptr;
+    _size = 0;
+    _body_end = 0;
+    _buffer.clear();
+}
+
+void ReplayReader::Clear() {
+    unmap();
+    _num_cmds = 0;
+    _last_tick = 0;
+    _types.clear();
+    _blocks.clear();
+    _keyframes.clear();
+    _text_cmds.clear();
+    _next_idx = 0;
+    _cursor = 0;
+    _next = Header();
+}
+
+bool ReplayReader::Load(const std::string &filename) {
+    Clear();
+
+    char magic[kMagicSize] = { 0 };
+    {
+        std::ifstream iFile(filename, std::ios::binary | std::ios::in);
+        if (! iFile.is_open()) return false;
+        iFile.read(magic, kMagicSize);
+    }
+    if (memcmp(magic, kReplayMagic, kMagicSize) == 0) return load_binary(filename);
+    return load_text(filename);
+}
+
+bool ReplayReader::load_text(const std::string &filename) {
+    serializer::loader loader(false);
+    if (! loader.read_from_file(filename)) return false;
+    loader >> _text_cmds;
+
+    _num_cmds = _text_cmds.size();
+    for (const auto &cmd : _text_cmds) _last_tick = std::max(_last_tick, cmd->tick());
+    Seek(0);
+    return true;
+}
+
+bool ReplayReader::load_binary(const std::string &filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    _size = st.st_size;
+    void *p = _size > 0 ? mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED) {
+        _size = 0;
+        return false;
+    }
+    _data = static_cast<const char *>(p);
+    _mapped = true;
+#else
+    std::ifstream iFile(filename, std::ios::binary | std::ios::in);
+    if (! iFile.is_open()) return false;
+    _buffer.assign(std::istreambuf_iterator<char>(iFile), std::istreambuf_iterator<char>());
+    _data = _buffer.data();
+    _size = _buffer.size();
+#endif
+    return load_index(filename);
+}
+
+bool ReplayReader::LoadFromString(std::string data) {
+    Clear();
+    if (data.size() < kMagicSize || memcmp(data.data(), kReplayMagic, kMagicSize) != 0) return false;
+    _buffer = std::move(data);
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return load_index("<memory>");
+}
+
+bool ReplayReader::load_index(const std::string &filename) {
+    try {
+        read_index(filename);
+    } catch (const std::range_error &e) {
+        std::cerr << e.what() << std::endl;
+        Clear();
+        return false;
+    }
+    return true;
+}
+
+void ReplayReader::read_index(const std::string &filename) {
+    if (_size < kMagicSize + kTrailerSize || memcmp(_data + _size - kMagicSize, kReplayIndexMagic, kMagicSize) != 0) {
+        throw std::range_error("Replay: " + filename + " has no index");
+    }
+
+    uint64_t pos = 0;
+    const char *trailer = _data + _size - kTrailerSize;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) pos |= static_cast<uint64_t>(static_cast<uint8_t>(trailer[i])) << (8 * i);
+
+    // Everything the index points to has to lie between the magic and the
+    // index itself; sums are checked as differences so that they cannot wrap.
+    const std::string corrupted = "Replay: corrupted index in " + filename;
+    const uint64_t index_end = _size - kTrailerSize;
+    if (pos < kMagicSize || pos > index_end) throw std::range_error(corrupted);
+    const uint64_t index_begin = pos;
+    // Each entry takes at least one byte, so a count cannot exceed what is left.
+    auto get_count = [&]() {
+        const uint64_t n = get_varint(_data, index_end, &pos);
+        if (n > index_end - pos) throw std::range_error(corrupted);
+        return n;
+    };
+
+    _types.resize(get_count());
+    for (auto &type : _types) {
+        const uint64_t len = get_varint(_data, index_end, &pos);
+        if (len > index_end - pos) throw std::range_error(corrupted);
+        type.assign(_data + pos, len);
+        pos += len;
+    }
+    const uint64_t num_cmds = get_varint(_data, index_end, &pos);
+    if (num_cmds > (uint64_t)std::numeric_limits<int>::max()) throw std::range_error(corrupted);
+    _num_cmds = num_cmds;
+    _last_tick = get_svarint(_data, index_end, &pos);
+
+    _blocks.resize(get_count());
+    if (_blocks.size() != (num_cmds + kReplayBlockSize - 1) / kReplayBlockSize) throw std::range_error(corrupted);
+    uint64_t last_offset = kMagicSize;
+    for (auto &block : _blocks) {
+        block.first = get_varint(_data, index_end, &pos);
+        block.second = get_svarint(_data, index_end, &pos);
+        if (block.first < last_offset || block.first > index_begin) throw std::range_error(corrupted);
+        last_offset = block.first;
+    }
+
+    // The commands end where the first keyframe starts.
+    _body_end = index_begin;
+    _keyframes.resize(get_count());
+    for (auto &kf : _keyframes) {
+        kf.tick = get_svarint(_data, index_end, &pos);
+        kf.offset = get_varint(_data, index_end, &pos);
+        kf.size = get_varint(_data, index_end, &pos);
+        if (kf.offset < kMagicSize || kf.offset > index_begin || kf.size > index_begin - kf.offset) throw std::range_error(corrupted);
+        _body_end = std::min(_body_end, kf.offset);
+    }
+    if (pos != index_end || last_offset > _body_end) throw std::range_error(corrupted);
+
+    Seek(0);
+}
+
+void ReplayReader::decode_header() {
+    if (Done()) return;
+    if (! is_binary()) {
+        _next.tick = _text_cmds[_next_idx]->tick();
+        return;
+    }
+    if (_next_idx % kReplayBlockSize == 0) _next = Header();
+
+    const uint64_t type_idx = get_varint(_data, _body_end, &_cursor);
+    _next.tick += get_svarint(_data, _body_end, &_cursor);
+    _next.start_tick = _next.tick + get_svarint(_data, _body_end, &_cursor);
+    _next.id += get_svarint(_data, _body_end, &_cursor);
+    _next.cmd_id += get_svarint(_data, _body_end, &_cursor) + 1;
+    _next.payload_size = get_varint(_data, _body_end, &_cursor);
+    if (type_idx >= _types.size() || _next.payload_size > _body_end - _cursor) throw std::range_error("Replay: corrupted command record");
+    _next.type_idx = type_idx;
+    _next.payload = _cursor;
+    _cursor += _next.payload_size;
+}
+
+CmdBPtr ReplayReader::Next() {
+    if (Done()) return nullptr;
+
+    CmdBPtr cmd;
+    if (! is_binary()) {
+        cmd = _text_cmds[_next_idx]->clone();
+    } else {
+        const std::string &type = _types[_next.type_idx];
+        auto it = CmdBase::_name2obj.find(type);
+        if (it == CmdBase::_name2obj.end()) throw std::range_error("Replay: unknown command type " + type);
+        cmd.reset(it->second());
+
+        std::string s(kCmdBaseBytes + _next.payload_size, 0);
+        const int base[4] = { _next.tick, _next.start_tick, _next.id, _next.cmd_id };
+        memcpy(&s[0], base, kCmdBaseBytes);
+        memcpy(&s[kCmdBaseBytes], _data + _next.payload, _next.payload_size);
+
+        _loader.get().clear();
+        _loader.get().str(s);
+        cmd->Load(_loader);
+    }
+
+    _next_idx ++;
+    decode_header();
+    return cmd;
+}
+
+void ReplayReader::seek_block(int block) {
+    _next_idx = block * kReplayBlockSize;
+    _cursor = _blocks.empty() ? 0 : _blocks[block].first;
+    _next = Header();
+    decode_header();
+}
+
+void ReplayReader::Seek(Tick t) {
+    if (! is_binary()) {
+        _next_idx = 0;
+        while (_next_idx < _num_cmds && _text_cmds[_next_idx]->tick() < t) _next_idx ++;
+        decode_header();
+        return;
+    }
+
+    // The first block whose running max tick reaches t contains the answer.
+    auto it = std::lower_bound(_blocks.begin(), _blocks.end(), t,
+        [](const std::pair<uint64_t, Tick> &block, Tick t) { return block.second < t; });
+    if (it == _blocks.end()) {
+        _next_idx = _num_cmds;
+        return;
+    }
+    seek_block(it - _blocks.begin());
+    while (! Done() && _next.tick < t) {
+        _next_idx ++;
+        decode_header();
+    }
+}
+
+bool ReplayReader::GetKeyframe(Tick t, Tick *keyframe_tick, std::string *state) const {
+    auto it = std::upper_bound(_keyframes.begin(), _keyframes.end(), t,
+        [](Tick t, const Keyframe &kf) { return t < kf.tick; });
+    if (it == _keyframes.begin()) return false;
+    -- it;
+    *keyframe_tick = it->tick;
+    state->assign(_data + it->offset, it->size);
+    return true;
+}
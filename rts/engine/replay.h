@@ -0,0 +1,153 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cmd.h"
+
+/* Binary replay format (all integers are LEB128 varints, signed ones zigzag encoded):
+
+     "ELFRPLY1"
+     Command records, in blocks of kReplayBlockSize. Within a block, each field is
+     delta-coded against the previous record; predictors restart at zero at every
+     block so that decoding can start at any block.
+         type_idx, d_tick, start_tick - tick, d_id, d_cmd_id - 1,
+         payload_size, payload (the binary serializer output of the derived
+         command fields, i.e. everything after the CmdBase fields)
+     Keyframes: binary snapshots (GameEnv + CmdReceiver) taken at the start of a tick.
+     Index:
+         #types, type names (command signatures)
+         #cmds, last_tick
+         #blocks, (offset, max tick up to and including this block) per block
+         #keyframes, (tick, offset, size) per keyframe
+     uint64 index offset (little endian), "ELFRIDX1"
+
+   Commands are expected in non-decreasing tick order, which is how CmdReceiver
+   records them. The old text format (serializer::saver(false) of vector<CmdBPtr>)
+   is still accepted by ReplayReader.
+*/
+
+const int kReplayBlockSize = 256;
+
+class ReplayWriter {
+public:
+    ReplayWriter();
+
+    void Add(const CmdBase &cmd);
+    // state is a binary snapshot of the game at the start of tick.
+    void AddKeyframe(Tick tick, std::string state);
+
+    int size() const { return _num_cmds; }
+
+    // The content of the replay file.
+    std::string Serialize() const;
+    bool Save(const std::string &filename) const;
+
+private:
+    std::string _body;
+    std::vector<std::string> _types;
+    int _num_cmds;
+    Tick _last_tick;
+
+    struct Predictor {
+        Tick tick = 0;
+        UnitId id = 0;
+        int cmd_id = -1;
+    };
+    Predictor _pred;
+
+    std::vector<std::pair<uint64_t, Tick>> _blocks;
+    std::vector<std::pair<Tick, std::string>> _keyframes;
+};
+
+// Reads a replay written by ReplayWriter (mapped into memory, commands are
+// decoded one at a time) or by the legacy text saver (loaded at once).
+class ReplayReader {
+public:
+    ReplayReader();
+    ~ReplayReader();
+    ReplayReader(const ReplayReader &) = delete;
+    ReplayReader &operator=(const ReplayReader &) = delete;
+
+    // Returns false if the file cannot be read, or is truncated or corrupted.
+    bool Load(const std::string &filename);
+    // Load a binary replay from memory (e.g., ReplayWriter::Serialize()).
+    bool LoadFromString(std::string data);
+    void Clear();
+
+    bool is_binary() const { return _data != nullptr; }
+    int size() const { return _num_cmds; }
+    Tick last_tick() const { return _last_tick; }
+
+    // Index of the next command to be returned by Next().
+    int pos() const { return _next_idx; }
+    bool Done() const { return _next_idx >= _num_cmds; }
+    Tick PeekTick() const { return _next.tick; }
+    CmdBPtr Next();
+
+    // Position at the first command with tick >= t. O(log n) for binary replays.
+    void Seek(Tick t);
+
+    // The latest keyframe at or before t. Returns false if there is none.
+    bool GetKeyframe(Tick t, Tick *keyframe_tick, std::string *state) const;
+    int GetNumKeyframes() const { return _keyframes.size(); }
+
+private:
+    // Memory mapping of a binary replay.
+    const char *_data;
+    size_t _size;
+    // End of the command records in _data.
+    uint64_t _body_end;
+    std::string _buffer;
+    bool _mapped;
+
+    int _num_cmds;
+    Tick _last_tick;
+    std::vector<std::string> _types;
+    std::vector<std::pair<uint64_t, Tick>> _blocks;
+
+    struct Keyframe {
+        Tick tick;
+        uint64_t offset, size;
+    };
+    std::vector<Keyframe> _keyframes;
+
+    // Legacy text replay.
+    std::vector<CmdBPtr> _text_cmds;
+
+    // Decoding state.
+    struct Header {
+        int type_idx = 0;
+        Tick tick = 0, start_tick = 0;
+        UnitId id = 0;
+        int cmd_id = -1;
+        uint64_t payload = 0, payload_size = 0;
+    };
+    int _next_idx;
+    uint64_t _cursor;
+    Header _next;
+    serializer::loader _loader;
+
+    bool load_binary(const std::string &filename);
+    // Read the index of the binary replay in _data. On a truncated or
+    // corrupted replay, print why, Clear() and return false.
+    bool load_index(const std::string &name);
+    // Same, but throws std::range_error.
+    void read_index(const std::string &name);
+    bool load_text(const std::string &filename);
+    void unmap();
+    void decode_header();
+    void seek_block(int block);
+};
+
+#endif
@@ -17,10 +17,10 @@ static const float HitAndRunDist3 = 10.0;
 ///////////////////////////// RuleActor //////////////////////////////
 
 void Preload::collect_stats(const GameEnv &env, int player_id, const CmdReceiver &receiver) {
-    // Clear all data
+    // Clear all data. The inner vectors keep their capacity across ticks.
     //
-    _my_troops.clear();
-    _enemy_troops.clear();
+    for (auto &troops : _my_troops) troops.clear();
+    for (auto &troops : _enemy_troops) troops.clear();
     _enemy_troops_in_range.clear();
     _all_my_troops.clear();
     _enemy_attacking_economy.clear();
@@ -39,6 +39,15 @@ void Preload::collect_stats(const GameEnv &env, int player_id, const CmdReceiver
 
     // Collect ...
     const Units& units = env.GetUnits();
+
+    // No list holds more than all the units, so they only grow when the
+    // number of units reaches a new peak, not whenever one of them does.
+    for (auto &troops : _my_troops) reserve_for(&troops, units.size());
+    for (auto &troops : _enemy_troops) reserve_for(&troops, units.size());
+    reserve_for(&_enemy_troops_in_range, units.size());
+    reserve_for(&_all_my_troops, units.size());
+    reserve_for(&_enemy_attacking_economy, units.size());
+    reserve_for(&_economy_being_attacked, units.size());
     //const RTSMap& m = env.GetMap();
     const Player& player = env.GetPlayer(_player_id);
 
@@ -46,7 +55,7 @@ void Preload::collect_stats(const GameEnv &env, int player_id, const CmdReceiver
 
     // Get the information of all other troops.
     for (auto it = units.begin(); it != units.end(); ++it) {
-        const Unit *u = it->second.get();
+        const Unit *u = it->second;
         if (u == nullptr) cout << "Unit cannot be nullptr" << endl << flush;
         // cout << "unit: " << u->GetProperty().PrintInfo() << endl << flush;
 
@@ -57,7 +66,7 @@ void Preload::collect_stats(const GameEnv &env, int player_id, const CmdReceiver
             if (InCmd(receiver, *u, BUILD)) {
                 const CmdDurative *curr_cmd = receiver.GetUnitDurativeCmd(u->GetId());
                 if (curr_cmd == nullptr) cout << "Cmd cannot be null! id = " << u->GetId() << endl << flush;
-                const CmdBuild *curr_cmd_build = dynamic_cast<const CmdBuild *>(curr_cmd);
+                const CmdBuild *curr_cmd_build = cmd_cast<CmdBuild>(curr_cmd);
                 if (curr_cmd_build == nullptr) cout << "Current cmd cannot be converted to CmdBuild!" << endl << flush;
                 UnitType ut = curr_cmd_build->build_type();
                 // if ((int)ut < 0 || (int)ut >= (int)NUM_UNITTYPE) cout << "buidl unit_type is invalid! " << (int)ut << endl << flush;
@@ -132,18 +141,26 @@ void Preload::GatherInfo(const GameEnv& env, int player_id, const CmdReceiver &r
     _result = OK;
 }
 
-const Unit *Preload::EnemyAtResource() {
+// The closest of the enemy troops in range whose squared distance to p is
+// below max_dist_sqr.
+const Unit *Preload::enemy_in_range_near(const GameEnv &env, const PointF &p, float max_dist_sqr) const {
+    const Player &player = env.GetPlayer(_player_id);
+    // Same filter as collect_stats().
+    return RuleActor::closest_dist(env, _enemy_troops_in_range, p, &max_dist_sqr, [&](const Unit &u) {
+        return u.GetPlayerId() != _player_id && u.GetUnitType() != RESOURCE && player.FilterWithFOW(u);
+    });
+}
+
+const Unit *Preload::EnemyAtResource(const GameEnv &env) {
     if (_enemy_at_resource == nullptr) {
-      float closest = 6.0;
-      _enemy_at_resource = RuleActor::closest_dist(_enemy_troops_in_range, _resource_loc, &closest);
+      _enemy_at_resource = enemy_in_range_near(env, _resource_loc, 6.0);
     }
     return _enemy_at_resource;
 }
 
-const Unit *Preload::EnemyAtBase() {
+const Unit *Preload::EnemyAtBase(const GameEnv &env) {
     if (_enemy_at_base == nullptr) {
-      float closest = 4.0;
-      _enemy_at_base = RuleActor::closest_dist(_enemy_troops_in_range, _base_loc, &closest);
+      _enemy_at_base = enemy_in_range_near(env, _base_loc, 4.0);
     }
     return _enemy_at_base;
 }
@@ -156,8 +173,8 @@ bool RuleActor::store_cmd(const Unit *u, CmdBPtr&& cmd, AssignedCmds *m) const {
     //
     if (curr_cmd != nullptr) {
         if (curr_cmd->type() == ATTACK && cmd->type() == ATTACK) {
-            const CmdAttack *curr_cmd_att = dynamic_cast<const CmdAttack *>(curr_cmd);
-            const CmdAttack *cmd_att = dynamic_cast<const CmdAttack *>(cmd.get());
+            const CmdAttack *curr_cmd_att = cmd_cast<CmdAttack>(curr_cmd);
+            const CmdAttack *cmd_att = cmd_cast<CmdAttack>(cmd.get());
             if (curr_cmd_att->target() == cmd_att->target()) return false;
         }
     }
@@ -176,12 +193,15 @@ void RuleActor::batch_store_cmds(const vector<const Unit *> &subset,
     }
 }
 
-bool RuleActor::hit_and_run(const GameEnv &env, const Unit *u, const vector<const Unit*> targets,
+bool RuleActor::hit_and_run(const GameEnv &env, const Unit *u, UnitType target_type,
         AssignedCmds *assigned_cmds) {
     // cout << "Check u " << hex << (void *)u << dec << endl << flush;
+    const vector<const Unit *> &targets = _preload.EnemyTroops()[target_type];
 
     float closest = std::numeric_limits<float>::max();
-    const Unit *closest_target = closest_dist(targets, u->GetPointF(), &closest);
+    const Unit *closest_target = closest_dist(env, targets, u->GetPointF(), &closest, [&](const Unit &t) {
+        return t.GetPlayerId() != _player_id && t.GetUnitType() == target_type;
+    });
     if (closest_target != nullptr) {
         UnitId opponent_target_id = closest_target->GetId();
         if (closest > HitAndRunDist2) {
@@ -279,11 +299,11 @@ bool RuleActor::act_per_unit(const GameEnv &env, const Unit *u, const int *state
         if (ut == RANGE_ATTACKER) {
             // cout << "Enemy only have worker" << endl << flush;
             if (enemy_troops[MELEE_ATTACKER].empty() && enemy_troops[RANGE_ATTACKER].empty() && ! enemy_troops[WORKER].empty()) {
-                hit_and_run(env, u, enemy_troops[WORKER], assigned_cmds);
+                hit_and_run(env, u, WORKER, assigned_cmds);
             }
 
             if (! enemy_troops[MELEE_ATTACKER].empty()) {
-                hit_and_run(env, u, enemy_troops[MELEE_ATTACKER], assigned_cmds);
+                hit_and_run(env, u, MELEE_ATTACKER, assigned_cmds);
             }
         }
         if (ut == RANGE_ATTACKER || ut == MELEE_ATTACKER) {
@@ -306,13 +326,13 @@ bool RuleActor::act_per_unit(const GameEnv &env, const Unit *u, const int *state
     if (state[STATE_DEFEND]) {
       // Group Retaliation. All troops attack.
       *state_string = "Defend enemy attack..NOOP";
-      const Unit *enemy_at_resource = _preload.EnemyAtResource();
+      const Unit *enemy_at_resource = _preload.EnemyAtResource(env);
       if (enemy_at_resource != nullptr) {
           *state_string = "Defend enemy attack..Success";
           store_cmd(u, _A(enemy_at_resource->GetId()), assigned_cmds);
       }
 
-      const Unit *enemy_at_base = _preload.EnemyAtBase();
+      const Unit *enemy_at_base = _preload.EnemyAtBase(env);
       if (enemy_at_base != nullptr) {
           *state_string = "Defend enemy attack..Success";
           store_cmd(u, _A(enemy_at_base->GetId()), assigned_cmds);
@@ -10,6 +10,10 @@
 #ifndef _RULE_ACTOR_H_
 #define _RULE_ACTOR_H_
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "cmd.h"
 #include "cmd_specific.gen.h"
 #include "game_env.h"
@@ -81,19 +85,24 @@ private:
         return (c != nullptr && c->type() == cmd);
     }
 
+    // Remove duplicates in place, keeping the first occurrence. The lists are
+    // short, so a linear scan is cheaper than building a set every tick.
     static void make_unique(vector<const Unit *> *us) {
-        set<const Unit *> tmp;
-        vector<const Unit *> res;
-        for (const Unit *u : *us) {
-            if (tmp.find(u) == tmp.end()) {
-                tmp.insert(u);
-                res.push_back(u);
-            }
+        auto end = us->begin();
+        for (auto it = us->begin(); it != us->end(); ++it) {
+            if (std::find(us->begin(), end, *it) == end) *end++ = *it;
         }
-        *us = res;
+        us->erase(end, us->end());
+    }
+
+    // Make room for n units, with slack so that a slowly growing n does not
+    // reallocate every tick.
+    static void reserve_for(vector<const Unit *> *us, size_t n) {
+        if (us->capacity() < n) us->reserve(2 * n);
     }
 
     void collect_stats(const GameEnv &env, int player_id, const CmdReceiver &receiver);
+    const Unit *enemy_in_range_near(const GameEnv &env, const PointF &p, float max_dist_sqr) const;
 
 public:
     Preload() : _base(nullptr), _player_id(INVALID), _num_unit_type(0),
@@ -126,8 +135,8 @@ public:
     int Price(UnitType ut) const { return _prices[ut]; }
     int Resource() const { return _resource; }
 
-    const Unit *EnemyAtResource();
-    const Unit *EnemyAtBase();
+    const Unit *EnemyAtResource(const GameEnv &env);
+    const Unit *EnemyAtBase(const GameEnv &env);
 
     const vector<vector<const Unit*> > &MyTroops() const { return _my_troops; }
     const vector<vector<const Unit*> > &EnemyTroops() const { return _enemy_troops; }
@@ -143,7 +152,12 @@ protected:
     const CmdReceiver *_receiver;
     Preload _preload;
     PlayerId _player_id;
-    bool hit_and_run(const GameEnv &env, const Unit *u, const vector<const Unit*> targets, AssignedCmds *assigned_cmds);
+    // u keeps its distance from the closest enemy of target_type.
+    bool hit_and_run(const GameEnv &env, const Unit *u, UnitType target_type, AssignedCmds *assigned_cmds);
+
+    // Up to this many candidates, a pass over them is cheaper than a ring
+    // search, which also visits the units of the player around p.
+    static const size_t kMaxLinearClosest = 32;
     bool store_cmd(const Unit *, CmdBPtr &&cmd, AssignedCmds *m) const;
     bool store_cmd_if_different(const Unit *, CmdBPtr &&cmd, AssignedCmds *m) const;
     void batch_store_cmds(const vector<const Unit *> &subset, const CmdBPtr& cmd, bool preemptive, AssignedCmds *m) const;
@@ -175,6 +189,24 @@ public:
         *closest = closest_dist;
         return closest_unit;
     }
+    // Same as closest_dist(units, p, closest), where units are the units of
+    // env for which accept(unit) is true, in increasing id order. Long lists
+    // are searched in rings around p on the map instead of one by one.
+    template <typename Accept>
+    static const Unit *closest_dist(const GameEnv &env, const vector<const Unit *>& units, const PointF &p, float *closest, Accept accept) {
+        if (units.size() <= kMaxLinearClosest) return closest_dist(units, p, closest);
+
+        static thread_local vector<LocalitySearch<UnitId>::Neighbor> neighbors;
+        // One step up, so that rounding does not leave out anything closer than *closest.
+        const float max_r = std::nextafter(std::sqrt(*closest), std::numeric_limits<float>::infinity());
+        env.GetMap().GetClosestUnitIds(p, 1, max_r, [&](UnitId id) {
+            const Unit *u = env.GetUnit(id);
+            return u != nullptr && accept(*u);
+        }, &neighbors);
+        if (neighbors.empty() || neighbors[0].first >= *closest) return nullptr;
+        *closest = neighbors[0].first;
+        return env.GetUnit(neighbors[0].second);
+    }
 
     static const CmdDurative *GetCurrCmd(const CmdReceiver &receiver, const Unit &u) {
         return receiver.GetUnitDurativeCmd(u.GetId());
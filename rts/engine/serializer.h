@@ -10,6 +10,7 @@
 #ifndef _SERIALIZER_H_
 #define _SERIALIZER_H_
 
+#include <array>
 #include <iomanip>
 #include <iostream>
 #include <functional>
@@ -21,6 +22,7 @@
 #include <utility>
 #include <unordered_map>
 #include <memory>
+#include <stdexcept>
 #include "pq_extend.h"
 
 namespace serializer {
@@ -134,6 +136,20 @@ public:
         return s;
     }
 
+    // Same format as a vector.
+    template <typename T, size_t N>
+    friend saver &operator<<(saver &s, const std::array<T, N>& v) {
+        int size = N;
+        if (! s.is_binary()) s.get() << " ";
+        s << size;
+        if (! s.is_binary()) s.get() << " ";
+        for (int i = 0; i < size; ++i) {
+            s << v[i];
+            if (! s.is_binary()) s.get() << " ";
+        }
+        return s;
+    }
+
     template <typename Key, typename T>
     friend saver &operator<<(saver &s, const std::map<Key, T>& m) {
         int size = m.size();
@@ -292,6 +308,15 @@ public:
         return l;
     }
 
+    template <typename T, size_t N>
+    friend loader &operator>>(loader &l, std::array<T, N>& v) {
+        int s;
+        l >> s;
+        if (s != (int)N) throw std::range_error("Expected " + std::to_string(N) + " elements, got " + std::to_string(s));
+        for (int i = 0; i < s; ++i) l >> v[i];
+        return l;
+    }
+
     template <typename Key, typename T>
     friend loader &operator>>(loader &l, std::map<Key, T>& m) {
         int s;
@@ -380,7 +405,7 @@ uint64_t hash_obj(const T &obj) {
 
 }
 
-// Hash functions for vectors.
+// Hash functions for vectors and arrays.
 namespace std
 {
     template<typename T>
@@ -393,6 +418,17 @@ namespace std
             return code;
         }
     };
+
+    template<typename T, size_t N>
+    struct hash<array<T, N>> {
+        uint64_t operator()(const array<T, N>& s) const {
+            uint64_t code = 0;
+            for (const auto &v : s) {
+                serializer::hash_combine(code, v);
+            }
+            return code;
+        }
+    };
 }
 
 #define SERIALIZER(TypeName, ...) \
@@ -8,6 +8,7 @@
 */
 
 #include "unit.h"
+#include "zobrist.h"
 #include <sstream>
 
 // -----------------------  Unit definition ----------------------
@@ -31,3 +32,22 @@ string Unit::Draw(Tick tick) const {
     // Draw the unit.
     return make_string("c", Player::ExtractPlayerId(_id), _last_p, _p, _type) + " " + _property.Draw(tick);
 }
+
+uint64_t Unit::ComputeHashKey() const {
+    const UnitProperty &p = _property;
+    // Fields are numbered so that no two of them share a key.
+    uint64_t k = zobrist::key(_id, 0, _type)
+        ^ zobrist::key(_id, 1, _p.x) ^ zobrist::key(_id, 2, _p.y)
+        ^ zobrist::key(_id, 3, _last_p.x) ^ zobrist::key(_id, 4, _last_p.y)
+        ^ zobrist::key(_id, 5, _built_since)
+        ^ zobrist::key(_id, 6, p._hp) ^ zobrist::key(_id, 7, p._max_hp)
+        ^ zobrist::key(_id, 8, p._att) ^ zobrist::key(_id, 9, p._def)
+        ^ zobrist::key(_id, 10, p._att_r) ^ zobrist::key(_id, 11, p._speed)
+        ^ zobrist::key(_id, 12, p._vis_r) ^ zobrist::key(_id, 13, p._changed_hp)
+        ^ zobrist::key(_id, 14, p._damage_from) ^ zobrist::key(_id, 15, p._attr)
+        ^ zobrist::key(_id, 16, p._has_flag);
+    for (size_t i = 0; i < p._cds.size(); ++i) {
+        k ^= zobrist::key(_id, 32 + 2 * i, p._cds[i]._cd) ^ zobrist::key(_id, 33 + 2 * i, p._cds[i]._last);
+    }
+    return k;
+}
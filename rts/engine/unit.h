@@ -28,6 +28,13 @@ protected:
   Tick _built_since;
   UnitProperty _property;
 
+  // Key of the unit in GameEnv::CurrentHashCode() and whether it may be out
+  // of date. Kept by GameEnv, not saved.
+  uint64_t _hash_key = 0;
+  bool _hash_dirty = false;
+
+  friend class GameEnv;
+
 public:
   Unit() : Unit(INVALID, INVALID, WORKER, PointF(), UnitProperty()) {
   }
@@ -54,6 +61,9 @@ public:
   // Print info in the screen.
   string PrintInfo(const RTSMap &m) const;
 
+  // Zobrist key of the unit, computed from scratch (see zobrist.h).
+  uint64_t ComputeHashKey() const;
+
   SERIALIZER(Unit, _id, _type, _p, _last_p, _built_since, _property);
   HASH(Unit, _property, _id, _type, _p, _last_p, _built_since);
 
@@ -62,6 +72,4 @@ public:
 
 STD_HASH(Unit);
 
-typedef map<UnitId, unique_ptr<Unit> > Units;
-
 #endif
@@ -0,0 +1,186 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _UNIT_SLOT_MAP_H_
+#define _UNIT_SLOT_MAP_H_
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "unit.h"
+
+// Unit storage of GameEnv.
+//
+// Units live in fixed-size chunks of slots, so their addresses are stable and
+// a Unit * stays valid until the unit is removed. Freed slots are reused.
+// Lookup by UnitId is O(1): the lower 24 bits of a UnitId come from a counter
+// that is never reused within a game, so they index a table of slots, and the
+// id stored in the slot tells whether the entry is stale (the id acts as the
+// generation of the slot).
+//
+// Iteration visits units in ascending UnitId order, exactly like the
+// std::map it replaces, over a packed array of (id, Unit *) pairs. Adding and
+// removing a unit is O(#units) in the worst case, which is cheap next to the
+// per-tick passes over all units.
+class UnitSlotMap {
+public:
+    using value_type = std::pair<UnitId, Unit *>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+    UnitSlotMap() : _size(0) { }
+    UnitSlotMap(const UnitSlotMap &) = delete;
+    UnitSlotMap &operator=(const UnitSlotMap &) = delete;
+
+    const_iterator begin() const { return _order.begin(); }
+    const_iterator end() const { return _order.end(); }
+    size_t size() const { return _order.size(); }
+    bool empty() const { return _order.empty(); }
+
+    const_iterator find(UnitId id) const {
+        const Unit *u = get(id);
+        return u == nullptr ? end() : lower_bound(id);
+    }
+
+    Unit *get(UnitId id) const {
+        const size_t idx = raw(id);
+        if (id < 0 || idx >= _index.size() || _index[idx] < 0) return nullptr;
+        Unit *u = slot(_index[idx]);
+        return u->GetId() == id ? u : nullptr;
+    }
+
+    // Returns nullptr if there is already a unit with the same id.
+    Unit *insert(const Unit &unit) {
+        const UnitId id = unit.GetId();
+        if (get(id) != nullptr) return nullptr;
+
+        int s;
+        if (! _free.empty()) {
+            s = _free.back();
+            _free.pop_back();
+        } else {
+            if ((_size >> kChunkBits) == (int)_chunks.size()) add_chunk();
+            s = _size ++;
+        }
+        Unit *u = slot(s);
+        *u = unit;
+
+        const size_t idx = raw(id);
+        if (idx >= _index.size()) _index.resize(std::max(idx + 1, _index.size() * 2), -1);
+        _index[idx] = s;
+
+        if (_order.empty() || _order.back().first < id) _order.emplace_back(id, u);
+        else _order.insert(lower_bound(id), value_type(id, u));
+        return u;
+    }
+
+    bool erase(UnitId id) {
+        Unit *u = get(id);
+        if (u == nullptr) return false;
+        _order.erase(lower_bound(id));
+
+        int &s = _index[raw(id)];
+        *u = Unit();
+        _free.push_back(s);
+        s = -1;
+        return true;
+    }
+
+    // Makes this map a copy of other, slot for slot, so that the units of
+    // the copy are in the same order. Chunks already allocated are reused.
+    void CopyFrom(const UnitSlotMap &other) {
+        const size_t num_chunks = (other._size + kChunkSize - 1) >> kChunkBits;
+        while (_chunks.size() < num_chunks) add_chunk();
+        for (int s = 0; s < other._size; ++s) *slot(s) = *other.slot(s);
+        _size = other._size;
+        _free = other._free;
+        _index = other._index;
+        _order.resize(other._order.size());
+        for (size_t i = 0; i < _order.size(); ++i) {
+            const UnitId id = other._order[i].first;
+            _order[i] = value_type(id, slot(_index[raw(id)]));
+        }
+    }
+
+    // Chunks (and the capacity of the tables) are kept for the next game.
+    void clear() {
+        _order.clear();
+        _index.clear();
+        _free.clear();
+        _size = 0;
+    }
+
+    // Same format as std::map<UnitId, unique_ptr<Unit>>, so snapshots and
+    // replays saved before are still readable.
+    friend serializer::saver &operator<<(serializer::saver &s, const UnitSlotMap &m) {
+        int size = m.size();
+        if (! s.is_binary()) s.get() << " ";
+        s << size;
+        if (! s.is_binary()) s.get() << " ";
+        for (const auto &item : m) {
+            if (! s.is_binary()) s.get() << " ";
+            s << item.first;
+            if (! s.is_binary()) s.get() << " ";
+            s << *item.second;
+            if (! s.is_binary()) s.get() << "  ";
+        }
+        return s;
+    }
+
+    friend serializer::loader &operator>>(serializer::loader &l, UnitSlotMap &m) {
+        int size;
+        l >> size;
+        m.clear();
+        for (int i = 0; i < size; ++i) {
+            UnitId id;
+            Unit u;
+            l >> id >> u;
+            m.insert(u);
+        }
+        return l;
+    }
+
+private:
+    static const int kChunkBits = 8;
+    static const int kChunkSize = 1 << kChunkBits;
+
+    std::vector<std::unique_ptr<Unit[]>> _chunks;
+    int _size;
+    std::vector<int> _free;
+
+    // Slot of each unit, indexed by the lower 24 bits of its id.
+    std::vector<int> _index;
+
+    // Sorted by id.
+    std::vector<value_type> _order;
+
+    static size_t raw(UnitId id) { return id & 0xffffff; }
+    Unit *slot(int s) const { return &_chunks[s >> kChunkBits][s & (kChunkSize - 1)]; }
+
+    // The tables of slots grow with the chunks, not unit by unit.
+    void add_chunk() {
+        _chunks.emplace_back(new Unit[kChunkSize]);
+        _free.reserve(_chunks.size() * kChunkSize);
+        _order.reserve(_chunks.size() * kChunkSize);
+    }
+
+    const_iterator lower_bound(UnitId id) const {
+        return std::lower_bound(_order.begin(), _order.end(), id,
+                [](const value_type &item, UnitId i) { return item.first < i; });
+    }
+    std::vector<value_type>::iterator lower_bound(UnitId id) {
+        return std::lower_bound(_order.begin(), _order.end(), id,
+                [](const value_type &item, UnitId i) { return item.first < i; });
+    }
+};
+
+typedef UnitSlotMap Units;
+
+#endif
@@ -19,6 +19,8 @@ public:
 
 private:
     GlobalStats _gstats;
+    // Tick phase durations of all games run by this wrapper.
+    TickProfiler _profiler;
 
 public:
     WrapperT() {
@@ -49,6 +51,7 @@ public:
         RTSGame game(op);
         wrapper.OnGameInit(&game);
         game.GetCmdReceiver()->GetGameStats().SetGlobalStats(&_gstats);
+        game.SetProfiler(&_profiler);
 
         unsigned long int seed = (op.seed == 0 ? time(NULL) : op.seed);
         std::mt19937 rng;
@@ -65,5 +68,8 @@ public:
     }
 
     std::string PrintInfo() const { return _gstats.PrintInfo(); }
+
+    const TickProfiler &GetProfiler() const { return _profiler; }
+    TickProfiler &GetProfiler() { return _profiler; }
 };
 
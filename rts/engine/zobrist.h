@@ -0,0 +1,46 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#ifndef _ZOBRIST_H_
+#define _ZOBRIST_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Zobrist-style hashing of game states.
+//
+// The hash of a state is the XOR of one key per (object, field, value), so
+// changing a field only takes XORing out its old key and XORing in the new
+// one. Values are not bounded (unit ids, positions), so instead of a table of
+// random numbers, a key is a strong mix of the triple.
+namespace zobrist {
+
+// Finalizer of splitmix64.
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Key of value in field of the object obj. value is hashed by its bits.
+template <typename T>
+inline uint64_t key(uint64_t obj, uint32_t field, const T &value) {
+    static_assert(sizeof(T) <= sizeof(uint64_t) && std::is_trivially_copyable<T>::value, "zobrist::key: value must fit in 64 bits");
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    return mix(mix(obj * 0x9e3779b97f4a7c15ULL + field) ^ bits);
+}
+
+}  // namespace zobrist
+
+#endif
@@ -64,6 +64,10 @@ public:
 
     CONTEXT_CALLS(GC, _context);
 
+    // Per-phase tick durations, merged over all games and threads.
+    std::map<std::string, std::map<std::string, double>> GetProfile() const { return _wrapper.GetProfiler().Summary(); }
+    void ResetProfile() { _wrapper.GetProfiler().Reset(); }
+
     void Stop() {
       _context.reset(nullptr); // first stop the threads, then destroy the games
     }
@@ -89,7 +93,9 @@ public:
 PYBIND11_MODULE(minirts, m) {
   register_common_func<GameContext>(m);
   CONTEXT_REGISTER(GameContext)
-    .def("GetParams", &GameContext::GetParams);
+    .def("GetParams", &GameContext::GetParams)
+    .def("GetProfile", &GameContext::GetProfile)
+    .def("ResetProfile", &GameContext::ResetProfile);
 
   // Also register other objects.
   PYCLASS_WITH_FIELDS(m, AIOptions)
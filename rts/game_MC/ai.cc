@@ -11,14 +11,11 @@
 #include "engine/game_env.h"
 #include "engine/unit.h"
 
-static inline void accu_value(int idx, float val, std::map<int, std::pair<int, float> > &idx2record) {
-    auto it = idx2record.find(idx);
-    if (it == idx2record.end()) {
-        idx2record.insert(make_pair(idx, make_pair(1, val)));
-    } else {
-        it->second.second += val;
-        it->second.first ++;
-    }
+// Sum val into s[idx] (zero initially); s[idx] is divided by count[idx] later.
+static inline void accu_value(int idx, float val, std::vector<float> &s, std::vector<int> &count, std::vector<int> &touched) {
+    if (count[idx] == 0) touched.push_back(idx);
+    s[idx] += val;
+    count[idx] ++;
 }
 
 void AIBase::save_structured_state(const GameEnv &env, Data *data) const {
@@ -42,7 +39,9 @@ void AIBase::save_structured_state(const GameEnv &env, Data *data) const {
     game->s.resize(sz);
     std::fill(game->s.begin(), game->s.end(), 0.0);
 
-    std::map<int, std::pair<int, float> > idx2record;
+    // Features that several units fall in are averaged.
+    _feature_count.resize(sz, 0);
+    _touched.clear();
 
     // res is not used.
     game->res.resize(env.GetNumOfPlayers() * res_pt);
@@ -62,7 +61,8 @@ void AIBase::save_structured_state(const GameEnv &env, Data *data) const {
     int mytroop = 0;
     int mybarrack = 0;
 
-    std::vector<int> quantized_r(env.GetNumOfPlayers(), 0);
+    std::vector<int> &quantized_r = _quantized_r;
+    quantized_r.assign(env.GetNumOfPlayers(), 0);
 
     while (! unit_iter.end()) {
         const Unit &u = *unit_iter;
@@ -73,12 +73,12 @@ void AIBase::save_structured_state(const GameEnv &env, Data *data) const {
 
         bool self_unit = (u.GetPlayerId() == _player_id);
 
-        accu_value(_OFFSET(t, x, y), 1.0, idx2record);
+        accu_value(_OFFSET(t, x, y), 1.0, game->s, _feature_count, _touched);
 
         // Self unit or enemy unit.
         // For historical reason, the flag of enemy unit = 2
-        accu_value(_OFFSET(n_type, x, y), (self_unit ? 1 : 2), idx2record);
-        accu_value(_OFFSET(n_type + 1, x, y), hp_level, idx2record);
+        accu_value(_OFFSET(n_type, x, y), (self_unit ? 1 : 2), game->s, _feature_count, _touched);
+        accu_value(_OFFSET(n_type + 1, x, y), hp_level, game->s, _feature_count, _touched);
 
         total_hp_ratio += hp_level;
 
@@ -91,8 +91,9 @@ void AIBase::save_structured_state(const GameEnv &env, Data *data) const {
         ++ unit_iter;
     }
 
-    for (const auto &p : idx2record) {
-        game->s[p.first] = p.second.second / p.second.first;
+    for (const int idx : _touched) {
+        game->s[idx] /= _feature_count[idx];
+        _feature_count[idx] = 0;
     }
 
     myworker = min(myworker, 3);
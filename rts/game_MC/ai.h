@@ -23,9 +23,26 @@ class AIBase : public AIWithComm<AIComm> {
 protected:
     bool _respect_fow;
 
+    // Scratch of save_structured_state(), kept to avoid allocations: the
+    // number of values summed into each feature, and the features touched.
+    mutable std::vector<int> _feature_count;
+    mutable std::vector<int> _touched;
+    mutable std::vector<int> _quantized_r;
+
     // Feature extraction.
     void save_structured_state(const GameEnv &env, Data *data) const override;
 
+    // Parses AIOptions::args, e.g., "start/100|decay/0.9".
+    static std::map<std::string, std::string> _parse(const std::string& args) {
+        std::map<std::string, std::string> kvmap;
+        for (const auto &item : CmdLineUtils::split(args, '|')) {
+            std::vector<std::string> kv = CmdLineUtils::split(item, '/');
+            if (kv.size() != 2) continue;
+            kvmap.insert(std::make_pair(kv[0], kv[1]));
+        }
+        return kvmap;
+    }
+
 public:
     AIBase() { }
     AIBase(const AIOptions &opt, CmdReceiver *receiver, AIComm *ai_comm = nullptr)
@@ -114,16 +131,6 @@ protected:
 
     RuleActor *rule_actor() override { return &_mc_rule_actor; }
 
-    static std::map<std::string, std::string> _parse(const std::string& args) {
-        std::map<std::string, std::string> kvmap;
-        for (const auto &item : CmdLineUtils::split(args, '|')) {
-            std::vector<std::string> kv = CmdLineUtils::split(item, '/');
-            if (kv.size() != 2) continue;
-            kvmap.insert(std::make_pair(kv[0], kv[1]));
-        }
-        return kvmap;
-    }
-    
 public:
     TrainedAI2(const AIOptions &opt, CmdReceiver *receiver, AIComm *ai_comm)
       : AIBase(opt, receiver, ai_comm), _backup_ai_tick_thres(0), _latest_start(0), _latest_start_decay(0) {
@@ -53,9 +53,11 @@ bool CmdGenerateUnit::run(GameEnv *env, CmdReceiver *receiver) {
     int ud_seed = f(2);
     bool shuffle_lr = (lr_seed == 0);
     bool shuffle_ud = (ud_seed == 0);
+    const int xsize = env->GetMap().GetXSize();
+    const int ysize = env->GetMap().GetYSize();
     auto shuffle_loc = [&] (PointF p, bool b1, bool b2) -> PointF {
-        int x = b1 ? 19 - p.x : p.x;
-        int y = b2 ? 19 - p.y : p.y;
+        int x = b1 ? xsize - 1 - p.x : p.x;
+        int y = b2 ? ysize - 1 - p.y : p.y;
         return PointF(x, y);
     };
 
@@ -76,8 +78,8 @@ bool CmdGenerateUnit::run(GameEnv *env, CmdReceiver *receiver) {
         // since the result will depend on which f is evaluated first, and will yield different results on
         // different platform/compiler (e.g., clang and gcc yields different results).
         // The following implementation is uniquely determined.
-        int x = f(6) + player_id * 10 + 2;
-        int y = f(6) + player_id * 10 + 2;
+        int x = f(6) + player_id * xsize / 2 + 2;
+        int y = f(6) + player_id * ysize / 2 + 2;
         return PointF(x, y);
     };
     for (PlayerId player_id = 0; player_id < 2; player_id++) {
@@ -15,6 +15,7 @@
 #include "engine/cmd_specific.gen.h"
 #include "cmd_specific.gen.h"
 #include "ai.h"
+#include "mcts_ai.h"
 
 int GameDef::GetNumUnitType() {
     return NUM_MINIRTS_UNITTYPE;
@@ -51,6 +52,12 @@ void GameDef::GlobalInit() {
         ai_options.fs = std::stoi(spec);
         return new HitAndRunAI(ai_options, nullptr);
     });
+
+    AI::RegisterAI("mcts", [](const std::string &spec) {
+        AIOptions ai_options;
+        ai_options.fs = std::stoi(spec);
+        return new MCTSAI(ai_options, nullptr);
+    });
 }
 
 void GameDef::Init() {
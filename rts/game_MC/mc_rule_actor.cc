@@ -114,13 +114,13 @@ bool MCRuleActor::ActByState(const GameEnv &env, const vector<int>& state, strin
         if (enemy_troops[MELEE_ATTACKER].empty() && enemy_troops[RANGE_ATTACKER].empty() && ! enemy_troops[WORKER].empty()) {
             // cout << "Enemy only have worker" << endl << flush;
             for (const Unit *u : my_troops[RANGE_ATTACKER]) {
-                hit_and_run(env, u, enemy_troops[WORKER], assigned_cmds);
+                hit_and_run(env, u, WORKER, assigned_cmds);
             }
         }
         if (! enemy_troops[MELEE_ATTACKER].empty()) {
             // cout << "Enemy only have malee attacker" << endl << flush;
             for (const Unit *u : my_troops[RANGE_ATTACKER]) {
-                hit_and_run(env, u, enemy_troops[MELEE_ATTACKER], assigned_cmds);
+                hit_and_run(env, u, MELEE_ATTACKER, assigned_cmds);
             }
         }
         if (! enemy_troops[RANGE_ATTACKER].empty()) {
@@ -144,13 +144,13 @@ bool MCRuleActor::ActByState(const GameEnv &env, const vector<int>& state, strin
       // Group Retaliation. All troops attack.
       *state_string = "Defend enemy attack..NOOP";
 
-      const Unit *enemy_at_resource = _preload.EnemyAtResource();
+      const Unit *enemy_at_resource = _preload.EnemyAtResource(env);
       if (enemy_at_resource != nullptr) {
           *state_string = "Defend enemy attack..Success";
           batch_store_cmds(all_my_troops, _A(enemy_at_resource->GetId()), true, assigned_cmds);
       }
 
-      const Unit *enemy_at_base = _preload.EnemyAtBase();
+      const Unit *enemy_at_base = _preload.EnemyAtBase(env);
       if (enemy_at_base != nullptr) {
           *state_string = "Defend enemy attack..Success";
           batch_store_cmds(all_my_troops, _A(enemy_at_base->GetId()), true, assigned_cmds);
@@ -0,0 +1,192 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#include "mcts_ai.h"
+#include <limits>
+#include "engine/game_env.h"
+#include "engine/unit.h"
+
+///////////////////////////// StrategyAI ////////////////////////////////
+bool StrategyAI::on_act(const GameEnv &env) {
+    _state.assign(NUM_AISTATE, 0);
+    _state[_action != INVALID ? _action : _rng() % NUM_AISTATE] = 1;
+    return gather_decide(env, [&](const GameEnv &e, string *s, AssignedCmds *assigned_cmds) {
+        return _mc_rule_actor.ActByState(e, _state, s, assigned_cmds);
+    });
+}
+
+///////////////////////////// ValueAI ////////////////////////////////
+float ValueAI::GetValue(const GameEnv &env) {
+    if (! send_data_wait_reply(env)) return 0.0;
+    return _ai_comm->info().data.newest().V;
+}
+
+///////////////////////////// MCActor ////////////////////////////////
+// Resources, plus the cost of the units scaled by their hp, plus the hp of
+// the bases.
+static float material(const GameEnv &env, PlayerId player) {
+    const GameDef &gamedef = env.GetGameDef();
+    float m = env.GetPlayer(player).GetResource();
+    for (auto it = env.GetUnitIterator(INVALID); ! it.end(); ++it) {
+        const Unit &u = *it;
+        if (u.GetPlayerId() != player) continue;
+        const UnitProperty &p = u.GetProperty();
+        if (u.GetUnitType() == BASE) m += p._hp;
+        else m += gamedef.unit(u.GetUnitType()).GetUnitCost() * p._hp / (p._max_hp + 1e-6);
+    }
+    return m;
+}
+
+MCActor::MCActor(int frame_skip, const std::string &opponent, const std::string &rollout, unsigned seed, AIComm *value_comm)
+    : _frame_skip(frame_skip), _opponent(opponent), _rollout(rollout), _rng(seed), _state(nullptr), _player(INVALID),
+      _action_bot(nullptr) {
+    if (value_comm != nullptr) {
+        AIOptions opt;
+        opt.name = "mcts_value";
+        _value_ai.reset(new ValueAI(opt, value_comm));
+    }
+}
+
+AI *MCActor::create_bot(const std::string &policy, PlayerId id) {
+    AI *bot = nullptr;
+    if (policy == "random") {
+        AIOptions opt;
+        opt.fs = _frame_skip;
+        bot = new StrategyAI(opt, nullptr, INVALID, _rng());
+    } else {
+        bot = AI::CreateAI(policy, std::to_string(_frame_skip));
+        if (bot == nullptr) throw std::range_error("MCActor: unknown policy " + policy);
+    }
+    bot->SetId(id);
+    bot->SetCmdReceiver(&_state->receiver());
+    return bot;
+}
+
+void MCActor::Start(RTSState *state, PlayerId player) {
+    _state = state;
+    _player = player;
+
+    const int num_players = state->env().GetNumOfPlayers();
+    _tree_bots.resize(num_players);
+    _rollout_bots.clear();
+    _rollout_bots.resize(num_players);
+    for (PlayerId i = 0; i < num_players; ++i) {
+        if (i == player) {
+            AIOptions opt;
+            opt.fs = _frame_skip;
+            _action_bot = new StrategyAI(opt, nullptr);
+            _action_bot->SetId(i);
+            _action_bot->SetCmdReceiver(&state->receiver());
+            _tree_bots[i].reset(_action_bot);
+        } else {
+            _tree_bots[i].reset(create_bot(_opponent, i));
+        }
+    }
+
+    if (_value_ai != nullptr) {
+        _value_ai->SetId(player);
+        _value_ai->SetCmdReceiver(&state->receiver());
+    }
+}
+
+const std::vector<AI *> &MCActor::GetTreeBots(int action) {
+    _action_bot->SetAction(action);
+    _bots.clear();
+    for (const auto &bot : _tree_bots) _bots.push_back(bot.get());
+    return _bots;
+}
+
+const std::vector<AI *> &MCActor::GetRolloutBots() {
+    _bots.clear();
+    for (size_t i = 0; i < _rollout_bots.size(); ++i) {
+        if (_rollout_bots[i] == nullptr) _rollout_bots[i].reset(create_bot(_rollout, i));
+        _bots.push_back(_rollout_bots[i].get());
+    }
+    return _bots;
+}
+
+float MCActor::Evaluate(const RTSState &state, PlayerId player, PlayerId winner) {
+    if (winner >= 0) return MCTSActor::Evaluate(state, player, winner);
+    if (_value_ai != nullptr) {
+        const float v = _value_ai->GetValue(state.env());
+        return std::min(std::max((v + 1) / 2, 0.0f), 1.0f);
+    }
+
+    const GameEnv &env = state.env();
+    float mine = 0.0, total = 0.0;
+    for (PlayerId i = 0; i < env.GetNumOfPlayers(); ++i) {
+        const float m = material(env, i);
+        if (i == player) mine = m;
+        total += m;
+    }
+    return total > 0 ? mine / total : 0.5;
+}
+
+///////////////////////////// MCTSAI ////////////////////////////////
+static std::string get_arg(const std::map<std::string, std::string> &kv, const std::string &key, const std::string &def) {
+    auto it = kv.find(key);
+    return it == kv.end() ? def : it->second;
+}
+
+MCTSAI::MCTSAI(const AIOptions &opt, CmdReceiver *receiver, const std::vector<AIComm *> &value_comms)
+    : AIBase(opt, receiver) {
+    const auto kv = _parse(opt.args);
+
+    MCTSOptions options;
+    options.num_threads = std::stoi(get_arg(kv, "threads", "1"));
+    options.num_simulations = std::stoi(get_arg(kv, "sims", std::to_string(options.num_simulations)));
+    const std::string parallel = get_arg(kv, "parallel", "tree");
+    if (parallel == "tree") options.parallel = MCTS_TREE;
+    else if (parallel == "root") options.parallel = MCTS_ROOT;
+    else if (parallel == "leaf") options.parallel = MCTS_LEAF;
+    else throw std::range_error("MCTSAI: unknown parallel " + parallel);
+
+    // A level of the tree is one act of this AI.
+    options.action_ticks = opt.fs;
+    options.max_depth = std::stoi(get_arg(kv, "depth", std::to_string(options.max_depth)));
+    // With a model, leaves are evaluated as they are.
+    options.rollout_ticks = std::stoi(get_arg(kv, "rollout_ticks", value_comms.empty() ? std::to_string(options.rollout_ticks) : "0"));
+    options.exploration = std::stof(get_arg(kv, "exploration", std::to_string(options.exploration)));
+    options.virtual_loss = std::stoi(get_arg(kv, "virtual_loss", std::to_string(options.virtual_loss)));
+    options.reuse_tree = get_arg(kv, "reuse", "1") != "0";
+
+    if (! value_comms.empty() && (int)value_comms.size() < options.num_threads) {
+        throw std::range_error("MCTSAI: need one AIComm per search thread, got " + std::to_string(value_comms.size()));
+    }
+
+    const int frame_skip = opt.fs;
+    const std::string opponent = get_arg(kv, "opponent", "simple");
+    const std::string rollout = get_arg(kv, "rollout", "simple");
+    const unsigned seed = std::stoul(get_arg(kv, "seed", "0"));
+    _search.reset(new MCTSSearch(options, [=](int thread_idx) {
+        AIComm *value_comm = thread_idx < (int)value_comms.size() ? value_comms[thread_idx] : nullptr;
+        return new MCActor(frame_skip, opponent, rollout, seed + thread_idx, value_comm);
+    }));
+}
+
+int MCTSAI::GetNumThreads(const AIOptions &opt) {
+    return std::stoi(get_arg(_parse(opt.args), "threads", "1"));
+}
+
+bool MCTSAI::UsesModel(const AIOptions &opt) {
+    return get_arg(_parse(opt.args), "eval", "") == "model";
+}
+
+bool MCTSAI::on_act(const GameEnv &env) {
+    // The search has no game length of its own.
+    _root.CopyFrom(env, *_receiver, std::numeric_limits<Tick>::max());
+    const int action = _search->Search(_root, _player_id);
+    _search->Advance(action);
+
+    _state.assign(NUM_AISTATE, 0);
+    _state[action] = 1;
+    return gather_decide(env, [&](const GameEnv &e, string *s, AssignedCmds *assigned_cmds) {
+        return _mc_rule_actor.ActByState(e, _state, s, assigned_cmds);
+    });
+}
@@ -0,0 +1,111 @@
+/**
+* Copyright (c) 2017-present, Facebook, Inc.
+* All rights reserved.
+*
+* This source code is licensed under the BSD-style license found in the
+* LICENSE file in the root directory of this source tree. An additional grant
+* of patent rights can be found in the PATENTS file in the same directory.
+*/
+
+#pragma once
+
+#include <random>
+#include "engine/mcts.h"
+#include "ai.h"
+
+// Plays one strategic action (an AIState) whenever it acts, like TrainedAI2
+// does with the action of the model. If the action is INVALID, a random one
+// is drawn each time.
+class StrategyAI : public AIBase {
+private:
+    MCRuleActor _mc_rule_actor;
+    int _action;
+    std::mt19937 _rng;
+
+    bool on_act(const GameEnv &env) override;
+    RuleActor *rule_actor() override { return &_mc_rule_actor; }
+
+public:
+    StrategyAI(const AIOptions &opt, CmdReceiver *receiver, int action = INVALID, unsigned seed = 0)
+        : AIBase(opt, receiver), _action(action), _rng(seed) {
+    }
+
+    void SetAction(int action) { _action = action; }
+};
+
+// Sends the state to the model and returns the value it replies, e.g., for
+// the leaves of a search. The requests of all search threads (one ValueAI
+// each) go through the collector, which batches them like any other request.
+class ValueAI : public AIBase {
+public:
+    ValueAI(const AIOptions &opt, AIComm *ai_comm) : AIBase(opt, nullptr, ai_comm) { }
+
+    // Value of env for this player, in [-1, 1].
+    float GetValue(const GameEnv &env);
+};
+
+// The Mini-RTS part of MCTSSearch. Actions are the strategic actions of
+// MCRuleActor. Policies are named like the registered AIs ("simple",
+// "hit_and_run"), or "random" for a random strategic action at each act.
+class MCActor : public MCTSActor {
+public:
+    // If value_comm is given, leaves are evaluated by the model; otherwise
+    // by a material count, unless the game is over.
+    MCActor(int frame_skip, const std::string &opponent, const std::string &rollout, unsigned seed, AIComm *value_comm = nullptr);
+
+    int GetNumActions() const override { return NUM_AISTATE; }
+    void Start(RTSState *state, PlayerId player) override;
+    const std::vector<AI *> &GetTreeBots(int action) override;
+    const std::vector<AI *> &GetRolloutBots() override;
+    float Evaluate(const RTSState &state, PlayerId player, PlayerId winner) override;
+
+private:
+    int _frame_skip;
+    std::string _opponent;
+    std::string _rollout;
+    std::mt19937 _rng;
+
+    RTSState *_state;
+    PlayerId _player;
+
+    // Bots of the current simulation, indexed by player id.
+    std::vector<std::unique_ptr<AI>> _tree_bots;
+    std::vector<std::unique_ptr<AI>> _rollout_bots;
+    std::vector<AI *> _bots;
+    StrategyAI *_action_bot;
+
+    std::unique_ptr<ValueAI> _value_ai;
+
+    AI *create_bot(const std::string &policy, PlayerId id);
+};
+
+// Picks its strategic action by MCTS over forks of the game every time it
+// acts, and plays it until the next time. The search sees the whole game
+// state, i.e., it ignores the fog of war.
+//
+// Options in AIOptions::args (see AIBase::_parse), e.g.
+// "threads/4|sims/800|parallel/tree|opponent/simple|rollout/simple":
+//   threads, sims, parallel (tree, root or leaf), depth, rollout_ticks,
+//   exploration, virtual_loss, reuse (0 or 1), opponent, rollout, seed, and
+//   eval/model to evaluate leaves with the model.
+class MCTSAI : public AIBase {
+private:
+    MCRuleActor _mc_rule_actor;
+    std::unique_ptr<MCTSSearch> _search;
+    RTSState _root;
+
+    bool on_act(const GameEnv &env) override;
+    RuleActor *rule_actor() override { return &_mc_rule_actor; }
+
+public:
+    // value_comms, if not empty, has one AIComm per search thread to evaluate
+    // leaves with the model. The caller owns them.
+    MCTSAI(const AIOptions &opt, CmdReceiver *receiver, const std::vector<AIComm *> &value_comms = std::vector<AIComm *>());
+
+    // Number of search threads asked for by opt.
+    static int GetNumThreads(const AIOptions &opt);
+    // Whether opt asks for leaves to be evaluated by the model.
+    static bool UsesModel(const AIOptions &opt);
+
+    const MCTSSearch &GetSearch() const { return *_search; }
+};
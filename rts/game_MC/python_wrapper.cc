@@ -68,6 +68,10 @@ public:
         return EntryInfo();
     }
 
+    // Per-phase tick durations, merged over all games and threads.
+    std::map<std::string, std::map<std::string, double>> GetProfile() const { return _wrapper.GetProfiler().Summary(); }
+    void ResetProfile() { _wrapper.GetProfiler().Reset(); }
+
     void Stop() {
       std::cout << "Final statistics: " << std::endl;
       std::cout << _wrapper.PrintInfo() << std::endl;
@@ -81,7 +85,9 @@ public:
 PYBIND11_MODULE(minirts, m) {
   register_common_func<GameContext>(m);
   CONTEXT_REGISTER(GameContext)
-    .def("GetParams", &GameContext::GetParams);
+    .def("GetParams", &GameContext::GetParams)
+    .def("GetProfile", &GameContext::GetProfile)
+    .def("ResetProfile", &GameContext::ResetProfile);
 
   // Also register other objects.
   PYCLASS_WITH_FIELDS(m, AIOptions)
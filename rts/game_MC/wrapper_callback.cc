@@ -13,13 +13,15 @@
 #include "engine/cmd_specific.gen.h"
 #include "cmd_specific.gen.h"
 #include "ai.h"
+#include "mcts_ai.h"
 
 typedef TrainedAI2 TrainAIType;
-static AI *get_ai(const AIOptions &opt, Context::AIComm *ai_comm) {
+static AIBase *get_ai(const AIOptions &opt, Context::AIComm *ai_comm, const std::vector<Context::AIComm *> &value_comms) {
     // std::cout << "AI type = " << ai_type << " Backup AI type = " << backup_ai_type << std::endl;
     if (opt.type == "AI_SIMPLE") return new SimpleAI(opt, nullptr);
     else if (opt.type == "AI_HIT_AND_RUN") return new HitAndRunAI(opt, nullptr);
     else if (opt.type == "AI_NN") return new TrainAIType(opt, nullptr, ai_comm);
+    else if (opt.type == "AI_MCTS") return new MCTSAI(opt, nullptr, value_comms);
     else return nullptr;
     /*
        std::string prompt = "Unknown ai_type! ai_type: " + std::to_string(ai_type) + " backup_ai_type: " + std::to_string(backup_ai_type);
@@ -43,11 +45,51 @@ void WrapperCallbacks::OnGameOptions(RTSGameOptions *rts_options) {
 void WrapperCallbacks::OnGameInit(RTSGame *game) {
     // std::cout << "Initialize opponent" << std::endl;
     std::vector<AI *> ais;
-    for (const AIOptions &ai_opt : _options.ai_options) {
-        Context::AIComm *ai_comm = new Context::AIComm(_game_idx, _comm);
+    if (_options.joint_act) {
+        // Each player needs its own key so that the requests of all players can be in flight together.
+        if (_context_options.max_num_threads < (int)_options.ai_options.size()) {
+            throw std::range_error("joint_act requires max_num_threads >= #players = " + std::to_string(_options.ai_options.size()));
+        }
+        _comm_group.reset(new Context::AICommGroup());
+    }
+    // #keys taken so far by the search threads of AI_MCTS players.
+    int num_value_comms = 0;
+    for (size_t i = 0; i < _options.ai_options.size(); ++i) {
+        Context::AIComm *ai_comm = nullptr;
+        if (_comm_group != nullptr) ai_comm = Context::AIComm(_game_idx, _comm).Spawn(i);
+        else ai_comm = new Context::AIComm(_game_idx, _comm);
         _ai_comms.emplace_back(ai_comm);
         initialize_ai_comm(*ai_comm);
-        ais.push_back(get_ai(ai_opt, ai_comm));
+
+        AIOptions opt = _options.ai_options[i];
+        std::vector<Context::AIComm *> value_comms;
+        if (opt.type == "AI_MCTS") {
+            // Options in args come first, so they win over the defaults.
+            opt.args += "|threads/" + std::to_string(_options.mcts_threads)
+                + "|sims/" + std::to_string(_options.mcts_threads * _options.mcts_rollout_per_thread);
+            if (MCTSAI::UsesModel(opt)) {
+                // Each search thread sends its leaves with its own key, after those of the players
+                // and of the search threads of the AI_MCTS players before this one.
+                const int num_players = _options.ai_options.size();
+                const int num_threads = MCTSAI::GetNumThreads(opt);
+                const int first_key = num_players + num_value_comms;
+                if (_context_options.max_num_threads < first_key + num_threads) {
+                    throw std::range_error("AI_MCTS with eval/model requires max_num_threads >= #players + #search threads of all AI_MCTS players = "
+                            + std::to_string(first_key + num_threads) + ", got " + std::to_string(_context_options.max_num_threads));
+                }
+                num_value_comms += num_threads;
+                for (int t = 0; t < num_threads; ++t) {
+                    Context::AIComm *value_comm = Context::AIComm(_game_idx, _comm).Spawn(first_key + t);
+                    _ai_comms.emplace_back(value_comm);
+                    initialize_ai_comm(*value_comm);
+                    value_comms.push_back(value_comm);
+                }
+            }
+        }
+
+        AIBase *ai = get_ai(opt, ai_comm, value_comms);
+        if (ai != nullptr && _comm_group != nullptr) ai->SetCommGroup(_comm_group.get());
+        ais.push_back(ai);
     }
 
     // std::cout << "Initialize ai" << std::endl;
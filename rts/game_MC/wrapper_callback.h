@@ -24,6 +24,8 @@ private:
     Context::Comm *_comm;
 
     std::vector<std::unique_ptr<Context::AIComm>> _ai_comms;
+    // Used if all players send their states jointly.
+    std::unique_ptr<Context::AICommGroup> _comm_group;
 
     void initialize_ai_comm(Context::AIComm &ai_comm);
 
@@ -15,7 +15,7 @@
 #include "ai.h"
 
 typedef TDTrainedAI TrainAIType;
-static AI *get_ai(const AIOptions &opt, Context::AIComm *ai_comm) {
+static AIBase *get_ai(const AIOptions &opt, Context::AIComm *ai_comm) {
     // std::cout << "AI type = " << ai_type << " Backup AI type = " << backup_ai_type << std::endl;
     if (opt.type == "AI_TD_BUILT_IN") return new TDBuiltInAI(opt, nullptr);
     else if (opt.type == "AI_TD_NN") return new TrainAIType(opt, nullptr, ai_comm);
@@ -36,11 +36,23 @@ void WrapperCallbacks::OnGameOptions(RTSGameOptions *rts_options) {
 
 void WrapperCallbacks::OnGameInit(RTSGame *game) {
     std::vector<AI *> ais;
-    for (const AIOptions &ai_opt : _options.ai_options) {
-        Context::AIComm *ai_comm = new Context::AIComm(_game_idx, _comm);
+    if (_options.joint_act) {
+        // Each player needs its own key so that the requests of all players can be in flight together.
+        if (_context_options.max_num_threads < (int)_options.ai_options.size()) {
+            throw std::range_error("joint_act requires max_num_threads >= #players = " + std::to_string(_options.ai_options.size()));
+        }
+        _comm_group.reset(new Context::AICommGroup());
+    }
+    for (size_t i = 0; i < _options.ai_options.size(); ++i) {
+        Context::AIComm *ai_comm = nullptr;
+        if (_comm_group != nullptr) ai_comm = Context::AIComm(_game_idx, _comm).Spawn(i);
+        else ai_comm = new Context::AIComm(_game_idx, _comm);
         _ai_comms.emplace_back(ai_comm);
         initialize_ai_comm(*ai_comm);
-        ais.push_back(get_ai(ai_opt, ai_comm));
+
+        AIBase *ai = get_ai(_options.ai_options[i], ai_comm);
+        if (ai != nullptr && _comm_group != nullptr) ai->SetCommGroup(_comm_group.get());
+        ais.push_back(ai);
     }
 
     // std::cout << "Initialize ai" << std::endl;